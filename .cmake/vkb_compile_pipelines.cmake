@@ -0,0 +1,64 @@
+################################################################################
+# vkb_compile_pipelines(<target>
+#                       [NAMESPACE  <namespace>]
+#                       [OUTPUT_DIR <dir>]
+#                       SOURCES <pipeline.json>...)
+#
+#  Compiles each pipeline json file (see samples/pipeline.json) into a
+#  header holding a constexpr vkb::StaticGraphicsPipeline. For the file
+#  gbuffer.json the header can be included with:
+#
+#      #include <vkb_pipelines/gbuffer.h>
+#
+#  and the pipeline is vkb_pipelines::gbuffer::pipeline. The headers are
+#  regenerated whenever the json file changes.
+#
+#  The vkb-pipeline-compiler runs on the build machine, so the hashes in the
+#  headers are only valid for targets using the same compiler and standard
+#  library.
+################################################################################
+get_filename_component(VKB_PIPELINE_COMPILER_SOURCE ${CMAKE_CURRENT_LIST_DIR}/../tools/pipeline-compiler.cpp ABSOLUTE)
+set(VKB_PIPELINE_COMPILER_SOURCE ${VKB_PIPELINE_COMPILER_SOURCE} CACHE INTERNAL "The source of the vkb-pipeline-compiler")
+
+function(vkb_compile_pipelines target)
+
+    cmake_parse_arguments(ARG "" "NAMESPACE;OUTPUT_DIR" "SOURCES" ${ARGN})
+
+    if(NOT ARG_NAMESPACE)
+        set(ARG_NAMESPACE vkb_pipelines)
+    endif()
+    if(NOT ARG_OUTPUT_DIR)
+        set(ARG_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/${target}-pipelines)
+    endif()
+
+    if(NOT TARGET vkb-pipeline-compiler)
+        add_executable(vkb-pipeline-compiler EXCLUDE_FROM_ALL ${VKB_PIPELINE_COMPILER_SOURCE})
+        target_link_libraries(vkb-pipeline-compiler PRIVATE vkb::vkb)
+        if(TARGET Vulkan::Vulkan)
+            target_link_libraries(vkb-pipeline-compiler PRIVATE Vulkan::Vulkan)
+        endif()
+    endif()
+
+    set(headers)
+    foreach(src ${ARG_SOURCES})
+
+        get_filename_component(src_abs  ${src} ABSOLUTE)
+        get_filename_component(src_name ${src} NAME_WE)
+        string(MAKE_C_IDENTIFIER ${src_name} src_name)
+
+        set(out ${ARG_OUTPUT_DIR}/${ARG_NAMESPACE}/${src_name}.h)
+
+        add_custom_command(OUTPUT  ${out}
+                           COMMAND ${CMAKE_COMMAND} -E make_directory ${ARG_OUTPUT_DIR}/${ARG_NAMESPACE}
+                           COMMAND vkb-pipeline-compiler --namespace ${ARG_NAMESPACE} --name ${src_name} --output ${out} ${src_abs}
+                           DEPENDS ${src_abs} vkb-pipeline-compiler
+                           COMMENT "Compiling pipeline ${src}"
+                           VERBATIM)
+
+        list(APPEND headers ${out})
+    endforeach()
+
+    target_sources(${target} PRIVATE ${headers})
+    target_include_directories(${target} PUBLIC ${ARG_OUTPUT_DIR})
+
+endfunction()
@@ -55,6 +55,21 @@ struct BufferCreateInfo2
 
         return mem;
     }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * A hash of the buffer description which is the same in every process.
+     */
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.f(usage).u64(size).e(sharingMode).u64(queueFamilyIndices.size());
+        for(auto i : queueFamilyIndices)
+            H.u32(i);
+        return H.value;
+    }
 };
 
 
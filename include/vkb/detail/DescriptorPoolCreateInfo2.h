@@ -4,6 +4,8 @@
 #include <vulkan/vulkan.hpp>
 #include <functional>
 #include "HashFunctions.h"
+#include "Storage.h"
+#include "DescriptorSetLayoutCreateInfo2.h"
 
 
 namespace vkb
@@ -14,7 +16,7 @@ struct DescriptorPoolCreateInfo2
     using object_type           = vk::DescriptorPool;
     using base_create_info_type = vk::DescriptorPoolCreateInfo;
 
-    uint32_t                            maxSets;
+    uint32_t                            maxSets = 0;
     std::vector<vk::DescriptorPoolSize> sizes;
     vk::DescriptorPoolCreateFlags       flags;
 
@@ -67,6 +69,21 @@ struct DescriptorPoolCreateInfo2
         return seed;
     }
 
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process.
+     */
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.u32(maxSets).f(flags).u64(sizes.size());
+        for(auto & b : sizes)
+            H.e(b.type).u32(b.descriptorCount);
+        return H.value;
+    }
+
     DescriptorPoolCreateInfo2& setMaxSets(uint32_t maxsets)
     {
         maxSets = maxsets;
@@ -83,6 +100,58 @@ struct DescriptorPoolCreateInfo2
         return *this;
     }
 
+    /**
+     * @brief createFromLayouts
+     * @param S
+     * @param expectedSets
+     * @param defaultSetCount
+     * @return
+     *
+     * Creates a DescriptorPoolCreateInfo2 which is large enough to
+     * allocate the expected number of descriptor sets for each of the
+     * descriptorSetLayouts stored in S, and no larger.
+     *
+     * expectedSets is keyed by the DescriptorSetLayoutCreateInfo2::hash() of
+     * the layout. Layouts which are not found in expectedSets
+     * will use defaultSetCount.
+     *
+     * The peak values recorded by the storage, S.getPeakSetsPerLayout(),
+     * can be saved and used as the expectedSets for the next run.
+     */
+    static DescriptorPoolCreateInfo2 createFromLayouts(Storage const & S,
+                                                       std::map<size_t, uint32_t> const & expectedSets,
+                                                       uint32_t defaultSetCount = 0)
+    {
+        std::map<vk::DescriptorType, uint32_t> totals;
+        uint32_t setCount = 0;
+
+        for(auto & l : S.descriptorSetLayouts)
+        {
+            auto f = expectedSets.find(l.first);
+            auto count = f == expectedSets.end() ? defaultSetCount : f->second;
+
+            if( count == 0 || !l.second )
+                continue;
+
+            auto & ci = S.getCreateInfo<vkb::DescriptorSetLayoutCreateInfo2>(l.second);
+            for(auto & b : ci.bindings)
+            {
+                auto & t = totals[b.descriptorType];
+                t = _saturatingMultiplyAdd(t, b.descriptorCount, count);
+            }
+            setCount = _saturatingMultiplyAdd(setCount, 1, count);
+        }
+
+        DescriptorPoolCreateInfo2 P;
+        P.setMaxSets(setCount);
+        for(auto & t : totals)
+        {
+            if( t.second > 0 )
+                P.setPoolSize(t.first, t.second);
+        }
+        return P;
+    }
+
 };
 
 }
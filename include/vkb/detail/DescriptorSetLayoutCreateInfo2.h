@@ -3,7 +3,11 @@
 
 #include <vulkan/vulkan.hpp>
 #include <functional>
+#include <map>
+#include <variant>
 #include "HashFunctions.h"
+#include "Storage.h"
+#include "SamplerCreateInfo2.h"
 
 
 namespace vkb
@@ -15,15 +19,54 @@ struct DescriptorSetLayoutCreateInfo2
     using base_create_info_type = vk::DescriptorSetLayoutCreateInfo;
 
 
+    using sampler_type = std::variant<SamplerCreateInfo2, vk::Sampler>;
+
     vk::DescriptorSetLayoutCreateFlags          flags;
     std::vector<vk::DescriptorSetLayoutBinding> bindings;
 
+    // binding index -> the immutable samplers for that binding.
+    // The pImmutableSamplers member of the bindings is ignored.
+    std::map<uint32_t, std::vector<sampler_type> > immutableSamplers;
+
+    /**
+     * @brief create_t
+     * @param CC
+     * @return
+     *
+     * All immutable samplers must be vk::Sampler handles, otherwise
+     * a std::runtime_error is thrown. Use create(Storage&, device) to
+     * create the samplers from SamplerCreateInfo2 structs.
+     */
     template<typename Callable_t>
     object_type create_t(Callable_t && CC) const
     {
+        auto B = bindings;
+        std::vector< std::vector<vk::Sampler> > samplers;
+        samplers.reserve(B.size());
+
+        for(auto & b : B)
+        {
+            b.pImmutableSamplers = nullptr;
+
+            auto f = immutableSamplers.find(b.binding);
+            if( f == immutableSamplers.end() )
+                continue;
+
+            auto & s = samplers.emplace_back();
+            for(auto & v : f->second)
+            {
+                if( !std::holds_alternative<vk::Sampler>(v) )
+                    throw std::runtime_error("Immutable samplers must be vk::Sampler handles. Use create(Storage&, device) to create them from SamplerCreateInfo2.");
+                s.push_back( std::get<vk::Sampler>(v) );
+            }
+            if( s.size() != b.descriptorCount )
+                throw std::runtime_error("The number of immutable samplers must be the same as the descriptorCount of the binding.");
+            b.pImmutableSamplers = s.data();
+        }
+
         vk::DescriptorSetLayoutCreateInfo D;
-        D.bindingCount = static_cast<uint32_t>(bindings.size());
-        D.pBindings    = bindings.data();
+        D.bindingCount = static_cast<uint32_t>(B.size());
+        D.pBindings    = B.data();
         D.flags        = flags;
 
         return CC(D);
@@ -53,16 +96,76 @@ struct DescriptorSetLayoutCreateInfo2
      *
      * Create the descriptor set layout, but only if a similar layout
      * doesnt' already exist in storage.
+     *
+     * Any immutable samplers given as SamplerCreateInfo2 are created
+     * in the storage, or reused if they already exist. Samplers given as
+     * handles which were created by the storage gain a reference. They are
+     * released when the layout is destroyed with S.destroy(layout, device)
      */
     object_type create(Storage & S, vk::Device device) const
     {
-        auto h = hash();
+        return create(S, device, hash());
+    }
+
+    /**
+     * @brief create
+     * @param S
+     * @param device
+     * @param h - the value of hash(), if it has already been calculated
+     * @return
+     *
+     * Same as create(S, device), but does not rehash the layout.
+     */
+    object_type create(Storage & S, vk::Device device, size_t h) const
+    {
         auto f = S.descriptorSetLayouts.find(h);
         if( f == S.descriptorSetLayouts.end())
         {
-            auto l = create(device);
+            auto cpy = *this;
+
+            // every sampler of the storage used by the layout, whether it
+            // was given as a SamplerCreateInfo2 or as a handle, holds a
+            // reference until the layout is destroyed
+            std::vector<vk::Sampler> acquired;
+            vk::DescriptorSetLayout l;
+            try
+            {
+                for(auto & x : cpy.immutableSamplers)
+                {
+                    for(auto & v : x.second)
+                    {
+                        if( auto si = std::get_if<SamplerCreateInfo2>(&v) )
+                        {
+                            auto s = si->create(S, device);
+                            acquired.push_back(s);
+                            v = s;
+                        }
+                        else if( S.acquire( std::get<vk::Sampler>(v) ) )
+                        {
+                            acquired.push_back( std::get<vk::Sampler>(v) );
+                        }
+                    }
+                }
+                l = cpy.create(device);
+            }
+            catch(...)
+            {
+                for(auto s : acquired)
+                    S.destroy(s, device);
+                throw;
+            }
+
             if( l )
+            {
                 S.storeCreateInfo(l, *this);
+                for(auto s : acquired)
+                    S.m_samplersByDescriptorSetLayout.emplace( static_cast<void*>(l), s);
+            }
+            else
+            {
+                for(auto s : acquired)
+                    S.destroy(s, device);
+            }
             S.descriptorSetLayouts[h] = l;
             return l;
         }
@@ -75,6 +178,7 @@ struct DescriptorSetLayoutCreateInfo2
     size_t hash() const
     {
         std::hash<size_t> H;
+        std::hash<void const*> Hv;
         size_t seed = hash_f( flags );
         for(auto & b : bindings)
         {
@@ -82,10 +186,68 @@ struct DescriptorSetLayoutCreateInfo2
             hash_c(seed, vkb::hash_f(b.stageFlags)  );
             hash_c(seed, vkb::hash_e(b.descriptorType ) );
             hash_c(seed, H(b.descriptorCount) );
+
+            auto f = immutableSamplers.find(b.binding);
+            if( f == immutableSamplers.end() )
+                continue;
+            for(auto & v : f->second)
+            {
+                if( auto si = std::get_if<SamplerCreateInfo2>(&v) )
+                    hash_c(seed, si->hash() );
+                else
+                    hash_c(seed, Hv( static_cast<void const*>( std::get<vk::Sampler>(v) ) ) );
+            }
         }
         return seed;
     }
 
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * A hash of the layout which is the same in every process. Immutable
+     * samplers are hashed by their content, so they must be given as
+     * SamplerCreateInfo2, otherwise a std::runtime_error is thrown.
+     */
+    uint64_t stableHash() const
+    {
+        return _stableHash(nullptr);
+    }
+
+    /**
+     * @brief stableHash
+     * @param S
+     * @return
+     *
+     * Same as stableHash(), but immutable samplers given as vk::Sampler
+     * handles are hashed by the create info they were created with in S.
+     */
+    uint64_t stableHash(Storage const & S) const
+    {
+        return _stableHash(&S);
+    }
+
+    bool operator==(DescriptorSetLayoutCreateInfo2 const & other) const
+    {
+        if( flags != other.flags || bindings.size() != other.bindings.size() )
+            return false;
+        for(size_t i=0;i<bindings.size();i++)
+        {
+            auto & a = bindings[i];
+            auto & b = other.bindings[i];
+            if( a.binding         != b.binding ||
+                a.descriptorType  != b.descriptorType ||
+                a.descriptorCount != b.descriptorCount ||
+                a.stageFlags      != b.stageFlags )
+                return false;
+        }
+        return immutableSamplers == other.immutableSamplers;
+    }
+    bool operator!=(DescriptorSetLayoutCreateInfo2 const & other) const
+    {
+        return !(*this == other);
+    }
+
 
     /**
      * @brief allocateFromPool
@@ -96,19 +258,124 @@ struct DescriptorSetLayoutCreateInfo2
      *
      * Allocate a descriptor set using this layout infromation. The layout will be
      * created in the storage are and reused if needed.
+     *
+     * The allocation is recorded in S.descriptorPoolStatistics[pool]
      */
     vk::DescriptorSet allocateFromPool(Storage & S, vk::DescriptorPool pool, vk::Device device)
     {
-        auto layout = create(S, device);
+        auto h      = hash();
+        auto layout = create(S, device, h);
         vk::DescriptorSetAllocateInfo i;
         i.setDescriptorSetCount(1)
          .setPSetLayouts(&layout)
          .setDescriptorPool(pool);
 
         auto sets = device.allocateDescriptorSets(i);
+
+        S.descriptorPoolStatistics[pool].recordAllocation(h, bindings, 1);
+
         return sets.front();
 
     }
+
+    /**
+     * @brief allocateFromPool
+     * @param S
+     * @param pool
+     * @param device
+     * @param count
+     * @param outSets - must have room for at least count descriptor sets
+     * @return
+     *
+     * Allocate count descriptor sets using this layout and write them
+     * into outSets. The layout is only hashed once and all the sets are
+     * allocated with a single call to vkAllocateDescriptorSets.
+     *
+     * Returns the result of the allocation, eg: vk::Result::eErrorOutOfPoolMemory
+     * if the pool does not have enough space. outSets is not modified if
+     * the allocation fails.
+     */
+    vk::Result allocateFromPool(Storage & S, vk::DescriptorPool pool, vk::Device device, uint32_t count, vk::DescriptorSet * outSets) const
+    {
+        auto h      = hash();
+        auto layout = create(S, device, h);
+
+        std::vector<vk::DescriptorSetLayout> layouts(count, layout);
+
+        vk::DescriptorSetAllocateInfo i;
+        i.setDescriptorSetCount(count)
+         .setPSetLayouts(layouts.data())
+         .setDescriptorPool(pool);
+
+        auto r = device.allocateDescriptorSets(&i, outSets);
+
+        if( r == vk::Result::eSuccess )
+            S.descriptorPoolStatistics[pool].recordAllocation(h, bindings, count);
+
+        return r;
+    }
+
+    /**
+     * @brief allocateFromPool
+     * @param S
+     * @param pool
+     * @param device
+     * @param layoutInfos - an array of count pointers to the layout of each set
+     * @param count
+     * @param outSets - must have room for at least count descriptor sets
+     * @return
+     *
+     * Allocate count descriptor sets with mixed layouts. outSets[i] will
+     * be allocated using the layout described by layoutInfos[i]. Each
+     * unique layout pointer is only hashed once and all the sets are
+     * allocated with a single call to vkAllocateDescriptorSets.
+     *
+     * Returns the result of the allocation.
+     */
+    static vk::Result allocateFromPool(Storage & S, vk::DescriptorPool pool, vk::Device device,
+                                       DescriptorSetLayoutCreateInfo2 const * const * layoutInfos,
+                                       uint32_t count,
+                                       vk::DescriptorSet * outSets)
+    {
+        struct _resolved_t
+        {
+            size_t                  hash;
+            vk::DescriptorSetLayout layout;
+            uint32_t                count;
+        };
+        std::map<DescriptorSetLayoutCreateInfo2 const*, _resolved_t> resolved;
+        std::vector<vk::DescriptorSetLayout>                        layouts;
+        layouts.reserve(count);
+
+        for(uint32_t j=0; j < count; j++)
+        {
+            auto f = resolved.find(layoutInfos[j]);
+            if( f == resolved.end() )
+            {
+                auto h = layoutInfos[j]->hash();
+                f = resolved.emplace(layoutInfos[j], _resolved_t{h, layoutInfos[j]->create(S, device, h), 0u}).first;
+            }
+            f->second.count++;
+            layouts.push_back(f->second.layout);
+        }
+
+        vk::DescriptorSetAllocateInfo i;
+        i.setDescriptorSetCount(count)
+         .setPSetLayouts(layouts.data())
+         .setDescriptorPool(pool);
+
+        auto r = device.allocateDescriptorSets(&i, outSets);
+
+        if( r == vk::Result::eSuccess )
+        {
+            auto & stats = S.descriptorPoolStatistics[pool];
+            for(auto & x : resolved)
+            {
+                stats.recordAllocation(x.second.hash, x.first->bindings, x.second.count);
+            }
+        }
+        return r;
+    }
     //============================================================
     // Helper functions
     //============================================================
@@ -118,6 +385,61 @@ struct DescriptorSetLayoutCreateInfo2
         return *this;
     }
 
+    /**
+     * @brief addDescriptor
+     * @param binding
+     * @param type - eSampler or eCombinedImageSampler
+     * @param stageFlags
+     * @param samplers
+     * @return
+     *
+     * Adds a binding with immutable samplers. The descriptorCount is
+     * the number of samplers. The samplers can be SamplerCreateInfo2
+     * structs or vk::Sampler handles.
+     */
+    DescriptorSetLayoutCreateInfo2& addDescriptor( uint32_t binding, vk::DescriptorType type, vk::ShaderStageFlags stageFlags, std::vector<sampler_type> const & samplers)
+    {
+        if( type != vk::DescriptorType::eSampler && type != vk::DescriptorType::eCombinedImageSampler )
+            throw std::runtime_error("Immutable samplers can only be used with eSampler or eCombinedImageSampler descriptors");
+        addDescriptor(binding, type, static_cast<uint32_t>(samplers.size()), stageFlags);
+        immutableSamplers[binding] = samplers;
+        return *this;
+    }
+
+protected:
+    uint64_t _stableHash(Storage const * S) const
+    {
+        StableHash H;
+        H.f(flags).u64(bindings.size());
+        for(auto & b : bindings)
+        {
+            H.u32(b.binding).e(b.descriptorType).u32(b.descriptorCount).f(b.stageFlags);
+
+            auto f = immutableSamplers.find(b.binding);
+            if( f == immutableSamplers.end() )
+            {
+                H.u64(0);
+                continue;
+            }
+            H.u64(f->second.size());
+            for(auto & v : f->second)
+            {
+                if( auto si = std::get_if<SamplerCreateInfo2>(&v) )
+                {
+                    H.u64( si->stableHash() );
+                }
+                else
+                {
+                    auto c = S ? S->tryGetCreateInfo<SamplerCreateInfo2>( std::get<vk::Sampler>(v) ) : nullptr;
+                    if( !c )
+                        throw std::runtime_error("Immutable sampler handles can only be hashed if they were created with the Storage");
+                    H.u64( c->stableHash() );
+                }
+            }
+        }
+        return H.value;
+    }
+
 
 };
 
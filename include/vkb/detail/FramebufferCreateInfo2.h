@@ -0,0 +1,142 @@
+#ifndef VKJSON_FRAMEBUFFERCREATEINFO2_H
+#define VKJSON_FRAMEBUFFERCREATEINFO2_H
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <variant>
+
+#include "HashFunctions.h"
+#include "Storage.h"
+#include "RenderPassCreateInfo2.h"
+
+namespace vkb
+{
+
+struct FramebufferCreateInfo2
+{
+    using object_type           = vk::Framebuffer;
+    using base_create_info_type = vk::FramebufferCreateInfo;
+
+    vk::FramebufferCreateFlags  flags;
+    std::vector<vk::ImageView>  attachments;
+    uint32_t                    width  = 0;
+    uint32_t                    height = 0;
+    uint32_t                    layers = 1;
+
+    std::variant< vkb::RenderPassCreateInfo2,
+                  vk::RenderPass>                         renderPass;
+
+    template<typename Callable_t>
+    object_type create_t(Callable_t && CC) const
+    {
+        if( !std::holds_alternative<vk::RenderPass>( renderPass ))
+        {
+            throw std::runtime_error("Cannot call create_t when the .renderPass is vkb::RenderPassCreateInfo2");
+        }
+        base_create_info_type C;
+        C.flags           = flags;
+        C.renderPass      = std::get<vk::RenderPass>(renderPass);
+        C.attachmentCount = static_cast<uint32_t>(attachments.size());
+        C.pAttachments    = attachments.data();
+        C.width           = width;
+        C.height          = height;
+        C.layers          = layers;
+
+        return CC(C);
+    }
+
+    object_type create(vk::Device d) const
+    {
+        return create_t( [d](base_create_info_type & C)
+        {
+            return d.createFramebuffer(C);
+        });
+    }
+
+    /**
+     * @brief create
+     * @param S
+     * @param device
+     * @return
+     *
+     * Create the framebuffer, but only if a similar framebuffer doesn't
+     * already exist in the storage. Framebuffers are stored by the compatibility
+     * class of the renderpass, so the same framebuffer is returned for
+     * all compatible renderpasses using the same attachments.
+     *
+     * The framebuffer will be destroyed if any of its attachments are
+     * destroyed using S.destroy(imageView, device) or if the image
+     * is invalidated using S.invalidate(image, device)
+     */
+    object_type create(Storage & S, vk::Device device) const
+    {
+        FramebufferCreateInfo2 cpy = *this;
+
+        if( !std::holds_alternative< vk::RenderPass >(cpy.renderPass) )
+        {
+            cpy.renderPass =  std::get<vkb::RenderPassCreateInfo2>(cpy.renderPass).create(S , device);
+        }
+
+        auto h = cpy._hash( vkb::RenderPassCreateInfo2::compatibilityHash(S, std::get<vk::RenderPass>(cpy.renderPass)) );
+
+        auto f = S.framebuffers.find(h);
+        if( f != S.framebuffers.end() )
+        {
+            return f->second;
+        }
+
+        auto l = cpy.create(device);
+        if( l )
+        {
+            S.framebuffers[h] = l;
+            for(auto & a : cpy.attachments)
+            {
+                S.m_framebuffersByImageView.emplace( static_cast<void*>(a), l);
+            }
+            S.storeCreateInfo(l, std::move(cpy));
+        }
+        return l;
+    }
+
+    /**
+     * @brief hash
+     * @return
+     *
+     * If the renderPass is a RenderPassCreateInfo2, only its compatibility class
+     * is hashed.
+     */
+    size_t hash() const
+    {
+        std::hash<void const*> Hv;
+        if( std::holds_alternative<vk::RenderPass>(renderPass) )
+        {
+            return _hash( Hv( static_cast<void const*>( std::get<vk::RenderPass>(renderPass))) );
+        }
+        else
+        {
+            return _hash( std::get<vkb::RenderPassCreateInfo2>(renderPass).compatibilityHash() );
+        }
+    }
+
+protected:
+    size_t _hash(size_t renderPassHash) const
+    {
+        std::hash<uint32_t>    Hu;
+        std::hash<void const*> Hv;
+
+        size_t seed = hash_f(flags);
+        hash_c(seed, renderPassHash);
+        for(auto & a : attachments)
+        {
+            hash_c(seed, Hv( static_cast<void const*>(a) ) );
+        }
+        hash_c(seed, Hu(width));
+        hash_c(seed, Hu(height));
+        hash_c(seed, Hu(layers));
+        return seed;
+    }
+};
+
+}
+
+#endif
@@ -3,7 +3,9 @@
 
 #include <vulkan/vulkan.hpp>
 #include <functional>
+#include <cstdint>
 #include <cstring>
+#include <string_view>
 
 namespace vkb
 {
@@ -18,7 +20,7 @@ inline void hash_c(std::size_t& seed, const T& v)
 template<typename T>
 inline size_t hash_e(T v)
 {
-    static_assert( std::is_enum<T>::value, "T is not an emum");
+    static_assert( std::is_enum<T>::value, "T is not an enum");
     static std::hash<size_t> H;
     return H( static_cast<size_t>(v));
 }
@@ -47,6 +49,221 @@ inline size_t hash_pod(T const & v)
     return seed;
 }
 
+//=============================================================================
+// The structs with an sType have padding after the sType member which is
+// not guaranteed to be initialized. Hash these member-wise so that two
+// equal structs always have the same hash.
+//=============================================================================
+inline size_t hash_pod(vk::PipelineRasterizationStateCreateInfo const & v)
+{
+    std::hash<uint32_t> H;
+    std::hash<float>    Hf;
+    size_t seed = 0x9e3779b9;
+    hash_c(seed, hash_f(v.flags));
+    hash_c(seed, H(v.depthClampEnable));
+    hash_c(seed, H(v.rasterizerDiscardEnable));
+    hash_c(seed, hash_e(v.polygonMode));
+    hash_c(seed, hash_f(v.cullMode));
+    hash_c(seed, hash_e(v.frontFace));
+    hash_c(seed, H(v.depthBiasEnable));
+    hash_c(seed, Hf(v.depthBiasConstantFactor));
+    hash_c(seed, Hf(v.depthBiasClamp));
+    hash_c(seed, Hf(v.depthBiasSlopeFactor));
+    hash_c(seed, Hf(v.lineWidth));
+    return seed;
+}
+
+inline size_t hash_pod(vk::PipelineMultisampleStateCreateInfo const & v)
+{
+    std::hash<uint32_t>    H;
+    std::hash<float>       Hf;
+    std::hash<void const*> Hv;
+    size_t seed = 0x9e3779b9;
+    hash_c(seed, hash_f(v.flags));
+    hash_c(seed, hash_e(v.rasterizationSamples));
+    hash_c(seed, H(v.sampleShadingEnable));
+    hash_c(seed, Hf(v.minSampleShading));
+    hash_c(seed, Hv(static_cast<void const*>(v.pSampleMask)));
+    hash_c(seed, H(v.alphaToCoverageEnable));
+    hash_c(seed, H(v.alphaToOneEnable));
+    return seed;
+}
+
+inline size_t hash_pod(vk::PipelineDepthStencilStateCreateInfo const & v)
+{
+    std::hash<uint32_t> H;
+    std::hash<float>    Hf;
+    size_t seed = 0x9e3779b9;
+    hash_c(seed, hash_f(v.flags));
+    hash_c(seed, H(v.depthTestEnable));
+    hash_c(seed, H(v.depthWriteEnable));
+    hash_c(seed, hash_e(v.depthCompareOp));
+    hash_c(seed, H(v.depthBoundsTestEnable));
+    hash_c(seed, H(v.stencilTestEnable));
+    hash_c(seed, hash_pod(v.front));
+    hash_c(seed, hash_pod(v.back));
+    hash_c(seed, Hf(v.minDepthBounds));
+    hash_c(seed, Hf(v.maxDepthBounds));
+    return seed;
+}
+
+inline size_t hash_pod(vk::PipelineInputAssemblyStateCreateInfo const & v)
+{
+    std::hash<uint32_t> H;
+    size_t seed = 0x9e3779b9;
+    hash_c(seed, hash_f(v.flags));
+    hash_c(seed, hash_e(v.topology));
+    hash_c(seed, H(v.primitiveRestartEnable));
+    return seed;
+}
+
+inline size_t hash_pod(vk::PipelineTessellationStateCreateInfo const & v)
+{
+    std::hash<uint32_t> H;
+    size_t seed = 0x9e3779b9;
+    hash_c(seed, hash_f(v.flags));
+    hash_c(seed, H(v.patchControlPoints));
+    return seed;
+}
+
+/**
+ * @brief The StableHash struct
+ *
+ * A 64 bit FNV-1a hash which gives the same value on every platform,
+ * compiler and process, so that it can be used to key on-disk caches.
+ * Integers are hashed as little endian bytes, floats by their bit
+ * pattern (with -0 and NaN made canonical) and strings by their length
+ * and characters.
+ *
+ * The stableHash() members of the CreateInfo2 structs are built on this.
+ *
+ * auto h = vkb::StableHash().u32(4).str("main").value;
+ */
+struct StableHash
+{
+    static constexpr uint64_t offsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t prime       = 1099511628211ull;
+
+    uint64_t value = offsetBasis;
+
+    StableHash& byte(uint8_t b)
+    {
+        value ^= b;
+        value *= prime;
+        return *this;
+    }
+
+    StableHash& bytes(void const * data, size_t size)
+    {
+        auto p = static_cast<uint8_t const*>(data);
+        for(size_t i=0;i<size;i++)
+            byte(p[i]);
+        return *this;
+    }
+
+    StableHash& u32(uint32_t v)
+    {
+        for(uint32_t i=0;i<4;i++)
+            byte( static_cast<uint8_t>(v >> (8*i)) );
+        return *this;
+    }
+
+    StableHash& u64(uint64_t v)
+    {
+        for(uint32_t i=0;i<8;i++)
+            byte( static_cast<uint8_t>(v >> (8*i)) );
+        return *this;
+    }
+
+    StableHash& f32(float v)
+    {
+        uint32_t b = 0;
+        if( v != v )
+            b = 0x7fc00000u;
+        else if( v != 0.0f )
+            std::memcpy(&b, &v, sizeof(b));
+        return u32(b);
+    }
+
+    StableHash& str(std::string_view s)
+    {
+        u64(s.size());
+        return bytes(s.data(), s.size());
+    }
+
+    StableHash& words(uint32_t const * data, size_t count)
+    {
+        for(size_t i=0;i<count;i++)
+            u32(data[i]);
+        return *this;
+    }
+
+    template<typename T>
+    StableHash& e(T v)
+    {
+        static_assert( std::is_enum<T>::value, "T is not an enum");
+        return u32( static_cast<uint32_t>(v) );
+    }
+
+    template<typename ...Bits>
+    StableHash& f(vk::Flags<Bits...> c)
+    {
+        auto v = static_cast<typename vk::Flags<Bits...>::MaskType>(c);
+        return sizeof(v) == sizeof(uint64_t) ? u64(static_cast<uint64_t>(v)) : u32( static_cast<uint32_t>(v) );
+    }
+
+    //=========================================================================
+    // The fixed function states, hashed member by member. Pointers are
+    // hashed by what they point to.
+    //=========================================================================
+    StableHash& pod(vk::StencilOpState const & v)
+    {
+        return e(v.failOp).e(v.passOp).e(v.depthFailOp).e(v.compareOp)
+              .u32(v.compareMask).u32(v.writeMask).u32(v.reference);
+    }
+
+    StableHash& pod(vk::PipelineRasterizationStateCreateInfo const & v)
+    {
+        return f(v.flags).u32(v.depthClampEnable).u32(v.rasterizerDiscardEnable)
+              .e(v.polygonMode).f(v.cullMode).e(v.frontFace).u32(v.depthBiasEnable)
+              .f32(v.depthBiasConstantFactor).f32(v.depthBiasClamp).f32(v.depthBiasSlopeFactor)
+              .f32(v.lineWidth);
+    }
+
+    StableHash& pod(vk::PipelineMultisampleStateCreateInfo const & v)
+    {
+        f(v.flags).e(v.rasterizationSamples).u32(v.sampleShadingEnable).f32(v.minSampleShading);
+        if( v.pSampleMask )
+        {
+            auto n = (static_cast<uint32_t>(v.rasterizationSamples) + 31u) / 32u;
+            u32(n).words(v.pSampleMask, n);
+        }
+        else
+        {
+            u32(0);
+        }
+        return u32(v.alphaToCoverageEnable).u32(v.alphaToOneEnable);
+    }
+
+    StableHash& pod(vk::PipelineDepthStencilStateCreateInfo const & v)
+    {
+        f(v.flags).u32(v.depthTestEnable).u32(v.depthWriteEnable).e(v.depthCompareOp)
+         .u32(v.depthBoundsTestEnable).u32(v.stencilTestEnable);
+        pod(v.front).pod(v.back);
+        return f32(v.minDepthBounds).f32(v.maxDepthBounds);
+    }
+
+    StableHash& pod(vk::PipelineInputAssemblyStateCreateInfo const & v)
+    {
+        return f(v.flags).e(v.topology).u32(v.primitiveRestartEnable);
+    }
+
+    StableHash& pod(vk::PipelineTessellationStateCreateInfo const & v)
+    {
+        return f(v.flags).u32(v.patchControlPoints);
+    }
+};
+
 }
 
 #endif
@@ -0,0 +1,118 @@
+#ifndef VKJSON_IMAGEVIEWCREATEINFO2_H
+#define VKJSON_IMAGEVIEWCREATEINFO2_H
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include "HashFunctions.h"
+#include "Storage.h"
+
+namespace vkb
+{
+
+struct ImageViewCreateInfo2
+{
+    using object_type           = vk::ImageView;
+    using base_create_info_type = vk::ImageViewCreateInfo;
+
+    vk::ImageViewCreateFlags  flags;
+    vk::Image                 image;
+    vk::ImageViewType         viewType         = vk::ImageViewType::e2D;
+    vk::Format                format           = vk::Format::eUndefined;
+    vk::ComponentMapping      components;
+    vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    template<typename Callable_t>
+    object_type create_t(Callable_t && CC) const
+    {
+        base_create_info_type C;
+        C.flags            = flags;
+        C.image            = image;
+        C.viewType         = viewType;
+        C.format           = format;
+        C.components       = components;
+        C.subresourceRange = subresourceRange;
+
+        return CC(C);
+    }
+
+    /**
+     * @brief create
+     * @param d
+     * @return
+     *
+     * Create the image view
+     */
+    object_type create(vk::Device d) const
+    {
+        return create_t( [d](base_create_info_type & C)
+        {
+            return d.createImageView(C);
+        });
+    }
+
+    /**
+     * @brief create
+     * @param S
+     * @return
+     *
+     * Create the image view, but only if a similar view
+     * doesnt' already exist in storage. The view will be destroyed
+     * when the image is invalidated using S.invalidate(image, device)
+     */
+    object_type create(Storage & S, vk::Device device) const
+    {
+        auto h = hash();
+        auto f = S.imageViews.find(h);
+        if( f == S.imageViews.end())
+        {
+            auto l = create(device);
+            if( l )
+            {
+                S.storeCreateInfo(l, *this);
+                S.imageViews[h] = l;
+                S.m_imageViewsByImage.emplace( static_cast<void*>(image), l);
+            }
+            return l;
+        }
+        else
+        {
+            return f->second;
+        }
+    }
+
+    size_t hash() const
+    {
+        std::hash<uint32_t>    Hu;
+        std::hash<void const*> Hv;
+
+        size_t seed = hash_f(flags);
+        hash_c(seed, Hv( static_cast<void const*>(image) ) );
+        hash_c(seed, hash_e(viewType));
+        hash_c(seed, hash_e(format));
+        hash_c(seed, hash_e(components.r));
+        hash_c(seed, hash_e(components.g));
+        hash_c(seed, hash_e(components.b));
+        hash_c(seed, hash_e(components.a));
+        hash_c(seed, hash_f(subresourceRange.aspectMask));
+        hash_c(seed, Hu(subresourceRange.baseMipLevel));
+        hash_c(seed, Hu(subresourceRange.levelCount));
+        hash_c(seed, Hu(subresourceRange.baseArrayLayer));
+        hash_c(seed, Hu(subresourceRange.layerCount));
+        return seed;
+    }
+
+    //============================================================
+    // Helper functions
+    //============================================================
+    ImageViewCreateInfo2& setImage(vk::Image i, vk::Format f, vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor)
+    {
+        image                       = i;
+        format                      = f;
+        subresourceRange.aspectMask = aspect;
+        return *this;
+    }
+};
+
+}
+
+#endif
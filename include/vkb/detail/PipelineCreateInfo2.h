@@ -1,12 +1,18 @@
 #ifndef VKJSON_PIPELINECREATEINFO2_H
 #define VKJSON_PIPELINECREATEINFO2_H
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#include <type_traits>
 #include <vulkan/vulkan.hpp>
 
 #include "HashFunctions.h"
 #include "ShaderModuleCreateInfo2.h"
 #include "PipelineLayoutCreateInfo2.h"
 #include "RenderPassCreateInfo2.h"
+#include "PipelineRenderingCreateInfo2.h"
 
 namespace vkb
 {
@@ -19,6 +25,12 @@ struct PipelineShaderStageCreateInfo2
     vk::ShaderModule        module;
     std::vector<uint32_t>   code; // if given, the PipelineCreateInfo2 will generate the shader module
 
+    // specialization constants, sorted by constantID. The values are
+    // packed in specializationData in the same order.
+    // Use setSpecializationConstant( ) to modify them.
+    std::vector<vk::SpecializationMapEntry> specializationEntries;
+    std::vector<uint8_t>                    specializationData;
+
     size_t hash() const
     {
         std::hash<std::string> Hs;
@@ -27,9 +39,180 @@ struct PipelineShaderStageCreateInfo2
         auto seed = Hs(name);
         hash_c(seed, hash_e(stage));
         hash_c(seed, Hv(static_cast<void const*>(module)));
+        if( !specializationEntries.empty() )
+        {
+            for(auto & e : specializationEntries)
+            {
+                hash_c(seed, e.constantID);
+                hash_c(seed, e.size);
+            }
+            for(auto b : specializationData)
+                hash_c(seed, b);
+        }
         return seed;
     }
 
+    /**
+     * @brief setSpecializationConstant
+     * @param constantID
+     * @param value
+     * @return
+     *
+     * Sets the value of the specialization constant with the given
+     * constant_id. The value must be a bool, integer or floating point
+     * type of the same size as the constant in the shader. bool is stored
+     * as a vk::Bool32.
+     *
+     * vert.setSpecializationConstant(0, true)
+     *     .setSpecializationConstant(1, 4u)
+     *     .setSpecializationConstant(2, 0.5f);
+     */
+    template<typename T>
+    PipelineShaderStageCreateInfo2& setSpecializationConstant(uint32_t constantID, T value)
+    {
+        static_assert( std::is_arithmetic<T>::value, "Specialization constants must be bool, integer or floating point values");
+        if constexpr( std::is_same<T, bool>::value )
+        {
+            return setSpecializationConstant<vk::Bool32>(constantID, value ? VK_TRUE : VK_FALSE);
+        }
+        else
+        {
+            auto e = _findSpecializationEntry(constantID);
+            if( e != specializationEntries.end() && e->constantID == constantID && e->size != sizeof(T) )
+            {
+                removeSpecializationConstant(constantID);
+                e = _findSpecializationEntry(constantID);
+            }
+            if( e == specializationEntries.end() || e->constantID != constantID )
+            {
+                auto offset = e == specializationEntries.end() ? static_cast<uint32_t>(specializationData.size()) : e->offset;
+                for(auto i = e; i != specializationEntries.end(); ++i)
+                    i->offset += static_cast<uint32_t>(sizeof(T));
+                specializationData.insert(specializationData.begin() + offset, sizeof(T), 0);
+                e = specializationEntries.insert(e, vk::SpecializationMapEntry(constantID, offset, sizeof(T)));
+            }
+            std::memcpy( specializationData.data() + e->offset, &value, sizeof(T));
+            return *this;
+        }
+    }
+
+    /**
+     * @brief getSpecializationConstant
+     * @param constantID
+     * @return
+     *
+     * Returns the value set with setSpecializationConstant( ). Throws a
+     * std::runtime_error if the constant has not been set, or was set with
+     * a type of a different size.
+     */
+    template<typename T>
+    T getSpecializationConstant(uint32_t constantID) const
+    {
+        static_assert( std::is_arithmetic<T>::value, "Specialization constants must be bool, integer or floating point values");
+        if constexpr( std::is_same<T, bool>::value )
+        {
+            return getSpecializationConstant<vk::Bool32>(constantID) != VK_FALSE;
+        }
+        else
+        {
+            auto e = _findSpecializationEntry(constantID);
+            if( e == specializationEntries.end() || e->constantID != constantID )
+                throw std::runtime_error("Specialization constant " + std::to_string(constantID) + " has not been set");
+            if( e->size != sizeof(T) )
+                throw std::runtime_error("Specialization constant " + std::to_string(constantID) + " was set with a different type");
+            T v;
+            std::memcpy(&v, specializationData.data() + e->offset, sizeof(T));
+            return v;
+        }
+    }
+
+    /**
+     * @brief removeSpecializationConstant
+     * @param constantID
+     * @return
+     *
+     * Removes the constant, the shader will use its default value.
+     * Returns false if the constant was not set.
+     */
+    bool removeSpecializationConstant(uint32_t constantID)
+    {
+        auto e = _findSpecializationEntry(constantID);
+        if( e == specializationEntries.end() || e->constantID != constantID )
+            return false;
+
+        auto offset = e->offset;
+        auto size   = static_cast<uint32_t>(e->size);
+        specializationData.erase(specializationData.begin() + offset, specializationData.begin() + offset + size);
+        e = specializationEntries.erase(e);
+        for(; e != specializationEntries.end(); ++e)
+            e->offset -= size;
+        return true;
+    }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Hashes the entry point, the stage and the SPIR-V, so the value is
+     * the same in every process. Throws a std::runtime_error if the stage
+     * only has a module handle, use stableHash(S) in that case.
+     */
+    uint64_t stableHash() const
+    {
+        return _stableHash(nullptr);
+    }
+
+    /**
+     * @brief stableHash
+     * @param S
+     * @return
+     *
+     * Same as stableHash(), but a module handle is hashed by the SPIR-V
+     * it was created with in S.
+     */
+    uint64_t stableHash(Storage const & S) const
+    {
+        return _stableHash(&S);
+    }
+
+protected:
+    std::vector<vk::SpecializationMapEntry>::iterator _findSpecializationEntry(uint32_t constantID)
+    {
+        return std::lower_bound(specializationEntries.begin(), specializationEntries.end(), constantID,
+                                [](vk::SpecializationMapEntry const & a, uint32_t b){ return a.constantID < b; });
+    }
+    std::vector<vk::SpecializationMapEntry>::const_iterator _findSpecializationEntry(uint32_t constantID) const
+    {
+        return std::lower_bound(specializationEntries.begin(), specializationEntries.end(), constantID,
+                                [](vk::SpecializationMapEntry const & a, uint32_t b){ return a.constantID < b; });
+    }
+
+    uint64_t _stableHash(Storage const * S) const
+    {
+        StableHash H;
+        H.str(name).e(stage);
+        if( code.size() > 0 )
+        {
+            H.u64( StableHash().words(code.data(), code.size()).value );
+        }
+        else
+        {
+            auto c = S ? S->tryGetCreateInfo<ShaderModuleCreateInfo2>(module) : nullptr;
+            if( !c )
+                throw std::runtime_error("Shader module handles can only be hashed if they were created with the Storage");
+            H.u64( c->stableHash() );
+        }
+        // only hashed when present, so stages without constants keep their values
+        if( !specializationEntries.empty() )
+        {
+            H.u64(specializationEntries.size());
+            for(auto & e : specializationEntries)
+                H.u32(e.constantID).u32(e.offset).u64(e.size);
+            H.u64(specializationData.size());
+            H.bytes(specializationData.data(), specializationData.size());
+        }
+        return H.value;
+    }
 };
 
 struct PipelineViewportStateCreateInfo2
@@ -50,6 +233,18 @@ struct PipelineViewportStateCreateInfo2
         }
         return seed;
     }
+
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.u64(viewports.size());
+        for(auto & v : viewports)
+            H.f32(v.x).f32(v.y).f32(v.width).f32(v.height).f32(v.minDepth).f32(v.maxDepth);
+        H.u64(scissors.size());
+        for(auto & v : scissors)
+            H.u32( static_cast<uint32_t>(v.offset.x) ).u32( static_cast<uint32_t>(v.offset.y) ).u32(v.extent.width).u32(v.extent.height);
+        return H.value;
+    }
 };
 
 struct PipelineVertexInputStateCreateInfo2
@@ -70,6 +265,18 @@ struct PipelineVertexInputStateCreateInfo2
         }
         return seed;
     }
+
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.u64(vertexBindingDescriptions.size());
+        for(auto & v : vertexBindingDescriptions)
+            H.u32(v.binding).u32(v.stride).e(v.inputRate);
+        H.u64(vertexAttributeDescriptions.size());
+        for(auto & v : vertexAttributeDescriptions)
+            H.u32(v.location).u32(v.binding).e(v.format).u32(v.offset);
+        return H.value;
+    }
 };
 
 struct PipelineColorBlendStateCreateInfo2
@@ -101,6 +308,23 @@ struct PipelineColorBlendStateCreateInfo2
         hash_c(seed, Hf(blendConstants[3]) );
         return seed;
     }
+
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.f(flags).e(logicOp).u32(logicOpEnable);
+        H.u64(attachments.size());
+        for(auto & v : attachments)
+        {
+            H.u32(v.blendEnable)
+             .e(v.srcColorBlendFactor).e(v.dstColorBlendFactor).e(v.colorBlendOp)
+             .e(v.srcAlphaBlendFactor).e(v.dstAlphaBlendFactor).e(v.alphaBlendOp)
+             .f(v.colorWriteMask);
+        }
+        for(auto c : blendConstants)
+            H.f32(c);
+        return H.value;
+    }
 };
 
 struct GraphicsPipelineCreateInfo2
@@ -128,7 +352,11 @@ struct GraphicsPipelineCreateInfo2
                   vk::PipelineLayout>                     layout;
 
     std::variant< vkb::RenderPassCreateInfo2,
-                  vk::RenderPass>                         renderPass;
+                  vk::RenderPass,
+                  vkb::PipelineRenderingCreateInfo2>      renderPass; // the formats only, for dynamic rendering
+
+    vk::PipelineCreateFlags                               flags;
+    vk::Pipeline                                          basePipelineHandle; // the parent when flags has eDerivative, not hashed
     //=======================================================================
 
     GraphicsPipelineCreateInfo2()
@@ -168,12 +396,20 @@ struct GraphicsPipelineCreateInfo2
         {
             throw std::runtime_error("Cannot call create_t when the .layout is vkb::PipelineLayoutCreateInfo2");
         }
-        if( !std::holds_alternative<vk::RenderPass>( renderPass ))
+        if( std::holds_alternative<vkb::RenderPassCreateInfo2>( renderPass ))
         {
             throw std::runtime_error("Cannot call create_t when the .renderPass is vkb::RenderPassCreateInfo2");
         }
         base_create_info_type C;
 
+        // dynamic rendering: the formats are chained instead of a render pass
+        vk::PipelineRenderingCreateInfoKHR _rendering;
+        if( auto r = std::get_if<vkb::PipelineRenderingCreateInfo2>( &renderPass ) )
+        {
+            _rendering = r->create_t( [](vk::PipelineRenderingCreateInfoKHR & R){ return R; });
+            C.pNext    = &_rendering;
+        }
+
         vk::PipelineColorBlendStateCreateInfo _blendState;
         _blendState.pAttachments       = blendState.attachments.data();
         _blendState.attachmentCount    = static_cast<uint32_t>(blendState.attachments.size());
@@ -202,12 +438,23 @@ struct GraphicsPipelineCreateInfo2
         _viewportState.viewportCount = static_cast<uint32_t>(viewportState.viewports.size());
 
         std::vector<vk::PipelineShaderStageCreateInfo>  _stages;
+        std::vector<vk::SpecializationInfo>             _specializations;
+        _specializations.reserve(stages.size());
         for(auto & s : stages)
         {
             auto & _s = _stages.emplace_back();
             _s.pName  = s.name.c_str();
             _s.module = s.module;
             _s.stage  = s.stage;
+            if( !s.specializationEntries.empty() )
+            {
+                auto & _sp = _specializations.emplace_back();
+                _sp.mapEntryCount = static_cast<uint32_t>(s.specializationEntries.size());
+                _sp.pMapEntries   = s.specializationEntries.data();
+                _sp.dataSize      = s.specializationData.size();
+                _sp.pData         = s.specializationData.data();
+                _s.pSpecializationInfo = &_sp;
+            }
             if( s.module == vk::ShaderModule()  && s.code.size() > 0)
             {
                 throw std::runtime_error("Cannot create pipeline using this create_t( ) when shader source code is given. Use .create(vkb::Storage&, vk::device) to create the pipeline while compiling the shaders");
@@ -225,8 +472,14 @@ struct GraphicsPipelineCreateInfo2
         C.pVertexInputState   = &_vertexInputState;
         C.pStages             = _stages.data();
         C.stageCount          = static_cast<uint32_t>(_stages.size());
-        C.renderPass          = std::get<vk::RenderPass>(renderPass);;
+        C.renderPass          = _renderPassHandle();
         C.layout              = std::get<vk::PipelineLayout>(layout);
+        C.flags               = flags;
+        if( basePipelineHandle )
+        {
+            C.basePipelineHandle = basePipelineHandle;
+            C.basePipelineIndex  = -1;
+        }
 
         return CC(C);
 
@@ -248,16 +501,345 @@ struct GraphicsPipelineCreateInfo2
      * @return
      *
      * Create the pipeline and return the layout and renderpass as well. If the CreateInfo struct
-     * provided the layout/renderpass, then the returned values are teh same.
+     * provided the layout/renderpass, then the returned values are teh same. With dynamic
+     * rendering the returned renderpass is null.
      *
      * If the createInfo struct provided layout and renderpass descriptions, then the new layout/renderpasses
      * will be created and returned.
      */
     std::tuple<object_type, vk::PipelineLayout, vk::RenderPass> create(Storage & S, vk::Device device) const
     {
-        //auto h = hash();
-        //auto & _map = S.shaderModules;
+        auto cpy = _compile(S, device);
+
+        auto _layout     = std::get<vk::PipelineLayout>(cpy.layout);
+        auto _renderPass = cpy._renderPassHandle();
+
+        // pipelines are stored by the compatibility class of the
+        // renderpass so that a pipeline can be shared between
+        // all compatible renderpasses.
+        auto h = cpy.storageKey(S);
+        auto f = S.pipelines.find(h);
+        if( f != S.pipelines.end() )
+        {
+            // the pipeline is shared, so it is only destroyed
+            // once every caller has destroyed it.
+            S.acquire(f->second, false);
+            return std::make_tuple(f->second, _layout, _renderPass);
+        }
+
+        auto x = std::make_tuple(cpy.create(device), _layout, _renderPass );
+        if( std::get<0>(x) )
+        {
+            S.pipelines[h] = std::get<0>(x);
+            S.storeCreateInfo( std::get<0>(x), std::move(cpy));
+        }
+        return x;
+    }
+
+    //=====================================================================
+    // Graphics Pipeline Libraries (VK_EXT_graphics_pipeline_library)
+    //=====================================================================
+
+    /**
+     * The four parts a graphics pipeline is split into, in the order
+     * they are passed to link_t( )
+     */
+    static constexpr std::array<vk::GraphicsPipelineLibraryFlagBitsEXT, 4> libraryParts =
+    {
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface
+    };
+
+    /**
+     * @brief createLibrary_t
+     * @param part
+     * @param CC
+     * @return
+     *
+     * Same as create_t( ), but the create info only holds the state used by
+     * one part of the pipeline and is chained with a
+     * vk::GraphicsPipelineLibraryCreateInfoEXT:
+     *
+     *   eVertexInputInterface     - vertexInputState, inputAssemblyState
+     *   ePreRasterizationShaders  - vertex/tessellation/geometry stages, viewportState,
+     *                               rasterizationState, tessellation, layout, renderPass
+     *   eFragmentShader           - fragment stage, depthStencilState, multisampleState,
+     *                               layout, renderPass
+     *   eFragmentOutputInterface  - blendState, multisampleState, renderPass
+     *
+     * The dynamic states are given to every part.
+     */
+    template<typename Callable_t>
+    object_type createLibrary_t(vk::GraphicsPipelineLibraryFlagBitsEXT part, Callable_t && CC) const
+    {
+        return create_t( [&](base_create_info_type & C)
+        {
+            using P = vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+            vk::GraphicsPipelineLibraryCreateInfoEXT _library;
+            _library.flags = part;
+            _library.pNext = const_cast<void*>(C.pNext);
+
+            std::vector<vk::PipelineShaderStageCreateInfo> _stages;
+            for(uint32_t i=0;i<C.stageCount;i++)
+            {
+                if( _isLibraryStage(part, C.pStages[i].stage) )
+                    _stages.push_back(C.pStages[i]);
+            }
+
+            C.pNext      = &_library;
+            C.flags     |= vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+            C.pStages    = _stages.data();
+            C.stageCount = static_cast<uint32_t>(_stages.size());
+
+            if( part != P::eVertexInputInterface )
+            {
+                C.pVertexInputState   = nullptr;
+                C.pInputAssemblyState = nullptr;
+            }
+            if( part != P::ePreRasterizationShaders )
+            {
+                C.pViewportState      = nullptr;
+                C.pRasterizationState = nullptr;
+                C.pTessellationState  = nullptr;
+            }
+            if( part != P::eFragmentShader )
+            {
+                C.pDepthStencilState  = nullptr;
+            }
+            if( part != P::eFragmentShader && part != P::eFragmentOutputInterface )
+            {
+                C.pMultisampleState   = nullptr;
+            }
+            if( part != P::eFragmentOutputInterface )
+            {
+                C.pColorBlendState    = nullptr;
+            }
+            if( part != P::ePreRasterizationShaders && part != P::eFragmentShader )
+            {
+                C.layout = vk::PipelineLayout();
+            }
+            if( part == P::eVertexInputInterface )
+            {
+                C.renderPass = vk::RenderPass();
+            }
+            return CC(C);
+        });
+    }
+
+    /**
+     * @brief link_t
+     * @param libraries - the four parts, in the order of libraryParts
+     * @param CC
+     * @param linkTimeOptimization
+     * @return
+     *
+     * Links a complete pipeline from the libraries created with
+     * createLibrary_t( ). The layout must be a vk::PipelineLayout and
+     * the same as the one the libraries were created with.
+     */
+    template<typename Callable_t>
+    object_type link_t(std::array<vk::Pipeline, 4> const & libraries, Callable_t && CC, bool linkTimeOptimization=false) const
+    {
+        if( !std::holds_alternative<vk::PipelineLayout>( layout ))
+        {
+            throw std::runtime_error("Cannot call link_t when the .layout is vkb::PipelineLayoutCreateInfo2");
+        }
+        for(auto & l : libraries)
+        {
+            if( l == vk::Pipeline() )
+                throw std::runtime_error("Cannot link a pipeline from a null pipeline library");
+        }
+
+        vk::PipelineLibraryCreateInfoKHR _libraries;
+        _libraries.libraryCount = static_cast<uint32_t>(libraries.size());
+        _libraries.pLibraries   = libraries.data();
+
+        base_create_info_type C;
+        C.pNext  = &_libraries;
+        C.flags  = flags;
+        C.layout = std::get<vk::PipelineLayout>(layout);
+        C.renderPass = _renderPassHandle();
+        if( linkTimeOptimization )
+            C.flags |= vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+
+        return CC(C);
+    }
 
+    /**
+     * @brief createLibrary
+     * @param S
+     * @param device
+     * @param part
+     * @return
+     *
+     * Returns the library for one part of the pipeline, creating it if
+     * S does not hold one with the same libraryKey( ). The shader modules,
+     * layout and renderPass must be handles created with S.
+     */
+    object_type createLibrary(Storage & S, vk::Device device, vk::GraphicsPipelineLibraryFlagBitsEXT part) const
+    {
+        auto h = libraryKey(S, part);
+        auto f = S.pipelineLibraries.find(h);
+        if( f != S.pipelineLibraries.end() )
+        {
+            return f->second;
+        }
+
+        auto p = createLibrary_t(part, [device](base_create_info_type & C)
+        {
+            return device.createGraphicsPipeline(vk::PipelineCache(), C);
+        });
+        if( p )
+        {
+            S.pipelineLibraries[h] = p;
+        }
+        return p;
+    }
+
+    /**
+     * @brief createLinked
+     * @param S
+     * @param device
+     * @param linkTimeOptimization
+     * @return
+     *
+     * Same as create(S, device), but the pipeline is linked from the four
+     * library parts, each of which is cached in S.pipelineLibraries. Pipelines
+     * which only differ in, eg: their vertex format or blend state reuse the
+     * shader parts and only cost a link instead of a full compile.
+     */
+    std::tuple<object_type, vk::PipelineLayout, vk::RenderPass> createLinked(Storage & S, vk::Device device, bool linkTimeOptimization=false) const
+    {
+        auto cpy = _compile(S, device);
+
+        auto _layout     = std::get<vk::PipelineLayout>(cpy.layout);
+        auto _renderPass = cpy._renderPassHandle();
+
+        auto h = cpy.storageKey(S);
+        auto f = S.pipelines.find(h);
+        if( f != S.pipelines.end() )
+        {
+            S.acquire(f->second, false);
+            return std::make_tuple(f->second, _layout, _renderPass);
+        }
+
+        std::array<vk::Pipeline, 4> libraries;
+        for(size_t i=0;i<libraryParts.size();i++)
+        {
+            libraries[i] = cpy.createLibrary(S, device, libraryParts[i]);
+        }
+
+        auto p = cpy.link_t(libraries, [device](base_create_info_type & C)
+        {
+            return device.createGraphicsPipeline(vk::PipelineCache(), C);
+        }, linkTimeOptimization);
+
+        if( p )
+        {
+            S.pipelines[h] = p;
+            S.storeCreateInfo( p, std::move(cpy));
+        }
+        return std::make_tuple(p, _layout, _renderPass);
+    }
+
+    /**
+     * @brief libraryKey
+     * @param S
+     * @param part
+     * @return
+     *
+     * Returns the key the library for one part of the pipeline is stored
+     * under in S.pipelineLibraries. As with storageKey( ), the renderPass
+     * must be a vk::RenderPass or a PipelineRenderingCreateInfo2.
+     */
+    size_t libraryKey(Storage const & S, vk::GraphicsPipelineLibraryFlagBitsEXT part) const
+    {
+        return _libraryHash(part, _renderPassKey(S) );
+    }
+
+    /**
+     * @brief libraryHash
+     * @param part
+     * @return
+     *
+     * Same as hash(), but only the state used by one part of the pipeline
+     * is hashed (see createLibrary_t). Eg: changing the blendState only
+     * changes the hash of the eFragmentOutputInterface part.
+     */
+    size_t libraryHash(vk::GraphicsPipelineLibraryFlagBitsEXT part) const
+    {
+        return _libraryHash(part, _renderPassHash() );
+    }
+
+    /**
+     * @brief storageKey
+     * @param S
+     * @return
+     *
+     * Returns the key the pipeline is stored under in S.pipelines. The
+     * renderPass must be a vk::RenderPass, it is replaced by the hash of
+     * its compatibility class, or a PipelineRenderingCreateInfo2.
+     */
+    size_t storageKey(Storage const & S) const
+    {
+        return _hash( _renderPassKey(S) );
+    }
+
+    /**
+     * @brief hash
+     * @return
+     *
+     * If the renderPass is a RenderPassCreateInfo2, only its compatibility class
+     * is hashed, since the same pipeline can be used with any compatible renderpass.
+     * If it is a PipelineRenderingCreateInfo2, only the attachment formats are hashed.
+     *
+     * If it is a vk::RenderPass, the handle itself is hashed, since its compatibility
+     * class can only be looked up in a Storage. Two compatible render pass handles
+     * therefore give different hashes, so hash() is not the key the pipeline is
+     * stored under in S.pipelines, use storageKey(S) for that.
+     */
+    size_t hash() const
+    {
+        return _hash( _renderPassHash() );
+    }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process, so it can
+     * key an on-disk pipeline cache. Shaders are hashed by their SPIR-V and the
+     * layout by the content of its descriptor set layouts. Throws a
+     * std::runtime_error if the pipeline references handles, use stableHash(S)
+     * for those.
+     */
+    uint64_t stableHash() const
+    {
+        return _stableHash(nullptr);
+    }
+
+    /**
+     * @brief stableHash
+     * @param S
+     * @return
+     *
+     * Same as stableHash(), but the shader module, pipeline layout and
+     * render pass handles are hashed by the create infos they were created
+     * with in S.
+     */
+    uint64_t stableHash(Storage const & S) const
+    {
+        return _stableHash(&S);
+    }
+
+protected:
+    // returns a copy where the shader modules, layout and renderPass
+    // are handles created with S
+    GraphicsPipelineCreateInfo2 _compile(Storage & S, vk::Device device) const
+    {
         GraphicsPipelineCreateInfo2 cpy = *this;
 
         // Loop through all the shader stages and make
@@ -286,18 +868,164 @@ struct GraphicsPipelineCreateInfo2
             cpy.layout =  std::get<vkb::PipelineLayoutCreateInfo2>(cpy.layout).create(S , device);
         }
 
-        if( !std::holds_alternative< vk::RenderPass >(cpy.renderPass) )
+        if( std::holds_alternative< vkb::RenderPassCreateInfo2 >(cpy.renderPass) )
         {
             cpy.renderPass =  std::get<vkb::RenderPassCreateInfo2>(cpy.renderPass).create(S , device);
         }
+        return cpy;
+    }
 
-        auto x = std::make_tuple(cpy.create(device), std::get<vk::PipelineLayout>(cpy.layout), std::get<vk::RenderPass>(cpy.renderPass) );
-        if( std::get<0>(x) )
-            S.storeCreateInfo( std::get<0>(x), std::move(cpy));
-        return x;
+    // the render pass handle, null for dynamic rendering
+    vk::RenderPass _renderPassHandle() const
+    {
+        auto r = std::get_if<vk::RenderPass>(&renderPass);
+        return r ? *r : vk::RenderPass();
     }
 
-    size_t hash() const
+    size_t _renderPassHash() const
+    {
+        std::hash<void const*> Hv;
+        if( auto r = std::get_if<vk::RenderPass>(&renderPass) )
+            return Hv( static_cast<void const*>(*r) );
+        if( auto r = std::get_if<vkb::RenderPassCreateInfo2>(&renderPass) )
+            return r->compatibilityHash();
+        return std::get<vkb::PipelineRenderingCreateInfo2>(renderPass).hash();
+    }
+
+    // the renderPass must be a handle created with S or the formats
+    size_t _renderPassKey(Storage const & S) const
+    {
+        if( auto r = std::get_if<vkb::PipelineRenderingCreateInfo2>(&renderPass) )
+            return r->hash();
+        return vkb::RenderPassCreateInfo2::compatibilityHash(S, std::get<vk::RenderPass>(renderPass));
+    }
+
+    // the derivative flags do not change the pipeline, so a derivative
+    // shares its key with a pipeline created from scratch
+    vk::PipelineCreateFlags _hashedFlags() const
+    {
+        return flags & ~(vk::PipelineCreateFlagBits::eAllowDerivatives | vk::PipelineCreateFlagBits::eDerivative);
+    }
+
+    static bool _isLibraryStage(vk::GraphicsPipelineLibraryFlagBitsEXT part, vk::ShaderStageFlagBits stage)
+    {
+        switch(part)
+        {
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+                return stage != vk::ShaderStageFlagBits::eFragment;
+            case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+                return stage == vk::ShaderStageFlagBits::eFragment;
+            default:
+                return false;
+        }
+    }
+
+    size_t _libraryHash(vk::GraphicsPipelineLibraryFlagBitsEXT part, size_t renderPassHash) const
+    {
+        using P = vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+        size_t seed = 0x9e3779b9;
+        hash_c(seed, hash_e(part));
+
+        for(auto & s : stages)
+        {
+            if( _isLibraryStage(part, s.stage) )
+                hash_c(seed, s.hash() );
+        }
+        for(auto & v : dynamicStates)
+            hash_c(seed, hash_e(v) );
+        if( _hashedFlags() )
+            hash_c(seed, hash_f(_hashedFlags()));
+
+        switch(part)
+        {
+            case P::eVertexInputInterface:
+                hash_c(seed, vertexInputState.hash());
+                hash_c(seed, hash_pod(inputAssemblyState));
+                return seed;
+            case P::ePreRasterizationShaders:
+                hash_c(seed, viewportState.hash());
+                hash_c(seed, hash_pod(rasterizationState));
+                hash_c(seed, hash_pod(tessellation));
+                break;
+            case P::eFragmentShader:
+                hash_c(seed, hash_pod(depthStencilState));
+                hash_c(seed, hash_pod(multisampleState));
+                break;
+            case P::eFragmentOutputInterface:
+                hash_c(seed, blendState.hash());
+                hash_c(seed, hash_pod(multisampleState));
+                hash_c(seed, renderPassHash);
+                return seed;
+        }
+
+        std::hash<void const*> Hv;
+        if( std::holds_alternative<vk::PipelineLayout>(layout) )
+        {
+            hash_c(seed, Hv( static_cast<void const*>( std::get<vk::PipelineLayout>(layout))));
+        }
+        else
+        {
+            hash_c(seed, std::get<vkb::PipelineLayoutCreateInfo2>(layout).hash() );
+        }
+        hash_c(seed, renderPassHash);
+
+        return seed;
+    }
+
+    uint64_t _stableHash(Storage const * S) const
+    {
+        StableHash H;
+
+        H.u64(stages.size());
+        for(auto & s : stages)
+            H.u64( S ? s.stableHash(*S) : s.stableHash() );
+
+        H.u64( blendState.stableHash() );
+        H.u64( vertexInputState.stableHash() );
+        H.pod(rasterizationState);
+        H.pod(multisampleState);
+        H.pod(depthStencilState);
+        H.pod(inputAssemblyState);
+        H.u64(dynamicStates.size());
+        for(auto & v : dynamicStates)
+            H.e(v);
+        H.u64( viewportState.stableHash() );
+        H.pod(tessellation);
+        if( _hashedFlags() )
+            H.f(_hashedFlags());
+
+        if( std::holds_alternative<vk::PipelineLayout>(layout) )
+        {
+            auto c = S ? S->tryGetCreateInfo<PipelineLayoutCreateInfo2>( std::get<vk::PipelineLayout>(layout) ) : nullptr;
+            if( !c )
+                throw std::runtime_error("Pipeline layout handles can only be hashed if they were created with the Storage");
+            H.u64( c->stableHash(*S) );
+        }
+        else
+        {
+            auto & l = std::get<vkb::PipelineLayoutCreateInfo2>(layout);
+            H.u64( S ? l.stableHash(*S) : l.stableHash() );
+        }
+
+        if( std::holds_alternative<vk::RenderPass>(renderPass) )
+        {
+            if( !S )
+                throw std::runtime_error("Render pass handles can only be hashed if they were created with the Storage");
+            H.u64( vkb::RenderPassCreateInfo2::stableCompatibilityHash(*S, std::get<vk::RenderPass>(renderPass)) );
+        }
+        else if( std::holds_alternative<vkb::RenderPassCreateInfo2>(renderPass) )
+        {
+            H.u64( std::get<vkb::RenderPassCreateInfo2>(renderPass).stableCompatibilityHash() );
+        }
+        else
+        {
+            H.u64( std::get<vkb::PipelineRenderingCreateInfo2>(renderPass).stableHash() );
+        }
+        return H.value;
+    }
+
+    size_t _hash(size_t renderPassHash) const
     {
         size_t seed = 0x9e3779b9;
 
@@ -315,6 +1043,8 @@ struct GraphicsPipelineCreateInfo2
 
         hash_c( seed, viewportState.hash());
         hash_c(seed, hash_pod(tessellation));
+        if( _hashedFlags() )
+            hash_c(seed, hash_f(_hashedFlags()));
 
         std::hash<void const*> Hv;
         if( std::holds_alternative<vk::PipelineLayout>(layout) )
@@ -326,18 +1056,12 @@ struct GraphicsPipelineCreateInfo2
             hash_c(seed, std::get<vkb::PipelineLayoutCreateInfo2>(layout).hash() );
         }
 
-        if( std::holds_alternative<vk::RenderPass>(renderPass) )
-        {
-            hash_c(seed, Hv( static_cast<void const*>( std::get<vk::RenderPass>(renderPass))));
-        }
-        else
-        {
-            hash_c(seed, std::get<vkb::RenderPassCreateInfo2>(renderPass).hash() );
-        }
+        hash_c(seed, renderPassHash);
 
         return seed;
     }
 
+public:
 
     //=====================================================================
     // Helper Functions
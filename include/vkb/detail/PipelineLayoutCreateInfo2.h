@@ -107,7 +107,65 @@ struct PipelineLayoutCreateInfo2
         return seed;
     }
 
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * A hash of the layout which is the same in every process. The set
+     * layouts are hashed by their content, so this only works if the layout
+     * is described by setLayoutsDescriptions. Use stableHash(S) if the
+     * layout references vk::DescriptorSetLayout handles.
+     */
+    uint64_t stableHash() const
+    {
+        return _stableHash(nullptr);
+    }
+
+    /**
+     * @brief stableHash
+     * @param S
+     * @return
+     *
+     * Same as stableHash(), but setLayouts handles are hashed by the create
+     * info they were created with in S. A layout described with
+     * setLayoutsDescriptions and the same layout described by handles
+     * have the same stable hash.
+     */
+    uint64_t stableHash(Storage const & S) const
+    {
+        return _stableHash(&S);
+    }
+
+protected:
+    uint64_t _stableHash(Storage const * S) const
+    {
+        StableHash H;
+        if( setLayoutsDescriptions.size() > 0 && setLayouts.size()==0)
+        {
+            H.u64(setLayoutsDescriptions.size());
+            for(auto & l : setLayoutsDescriptions)
+                H.u64( S ? l.stableHash(*S) : l.stableHash() );
+        }
+        else
+        {
+            H.u64(setLayouts.size());
+            for(auto & l : setLayouts)
+            {
+                auto c = S ? S->tryGetCreateInfo<DescriptorSetLayoutCreateInfo2>(l) : nullptr;
+                if( !c )
+                    throw std::runtime_error("Descriptor set layout handles can only be hashed if they were created with the Storage");
+                H.u64( c->stableHash(*S) );
+            }
+        }
+        H.u64(pushConstantRanges.size());
+        for(auto & b : pushConstantRanges)
+        {
+            H.u32(b.size).u32(b.offset).f(b.stageFlags);
+        }
+        return H.value;
+    }
 
+public:
     //===============================================================
     // Helper functions
     //===============================================================
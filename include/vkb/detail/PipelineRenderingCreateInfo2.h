@@ -0,0 +1,103 @@
+#ifndef VKJSON_PIPELINERENDERINGCREATEINFO2_H
+#define VKJSON_PIPELINERENDERINGCREATEINFO2_H
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <vector>
+#include "HashFunctions.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The PipelineRenderingCreateInfo2 struct
+ *
+ * The attachment formats of a pipeline used with dynamic rendering
+ * (VK_KHR_dynamic_rendering). Use it as the renderPass of a
+ * GraphicsPipelineCreateInfo2 instead of a render pass:
+ *
+ * vkb::PipelineRenderingCreateInfo2 R;
+ * R.colorAttachmentFormats = {vk::Format::eB8G8R8A8Unorm};
+ * R.depthAttachmentFormat  = vk::Format::eD32Sfloat;
+ *
+ * PCI.renderPass = R;
+ *
+ * No render pass or framebuffer objects are created. The pipeline can be
+ * used in any vkCmdBeginRenderingKHR( ) with the same attachment formats.
+ */
+struct PipelineRenderingCreateInfo2
+{
+    using base_create_info_type = vk::PipelineRenderingCreateInfoKHR;
+
+    uint32_t                viewMask = 0;
+    std::vector<vk::Format> colorAttachmentFormats;
+    vk::Format              depthAttachmentFormat   = vk::Format::eUndefined;
+    vk::Format              stencilAttachmentFormat = vk::Format::eUndefined;
+
+    template<typename Callable_t>
+    auto create_t(Callable_t && CC) const
+    {
+        base_create_info_type C;
+        C.viewMask                = viewMask;
+        C.colorAttachmentCount    = static_cast<uint32_t>(colorAttachmentFormats.size());
+        C.pColorAttachmentFormats = colorAttachmentFormats.data();
+        C.depthAttachmentFormat   = depthAttachmentFormat;
+        C.stencilAttachmentFormat = stencilAttachmentFormat;
+        return CC(C);
+    }
+
+    /**
+     * @brief hash
+     * @return
+     *
+     * Hashes the formats and the view mask. Pipelines with the same
+     * formats have the same hash, whichever pass they are used in.
+     */
+    size_t hash() const
+    {
+        std::hash<uint32_t> Hu;
+
+        size_t seed = 0x9e3779b9;
+        hash_c(seed, Hu(viewMask));
+        hash_c(seed, Hu( static_cast<uint32_t>(colorAttachmentFormats.size()) ));
+        for(auto f : colorAttachmentFormats)
+            hash_c(seed, hash_e(f));
+        hash_c(seed, hash_e(depthAttachmentFormat));
+        hash_c(seed, hash_e(stencilAttachmentFormat));
+        return seed;
+    }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process.
+     */
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.u32(viewMask);
+        H.u64(colorAttachmentFormats.size());
+        for(auto f : colorAttachmentFormats)
+            H.e(f);
+        H.e(depthAttachmentFormat);
+        H.e(stencilAttachmentFormat);
+        return H.value;
+    }
+
+    bool operator == ( PipelineRenderingCreateInfo2 const & other) const
+    {
+        return viewMask                == other.viewMask
+            && colorAttachmentFormats  == other.colorAttachmentFormats
+            && depthAttachmentFormat   == other.depthAttachmentFormat
+            && stencilAttachmentFormat == other.stencilAttachmentFormat;
+    }
+    bool operator != ( PipelineRenderingCreateInfo2 const & other) const
+    {
+        return !(*this == other);
+    }
+};
+
+}
+
+#endif
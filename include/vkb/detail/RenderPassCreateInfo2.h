@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.hpp>
 #include <functional>
 #include "HashFunctions.h"
+#include "Storage.h"
 
 namespace vkb
 {
@@ -68,6 +69,145 @@ struct SubpassDescription2
         return seed;
     }
 
+    /**
+     * @brief compatibilityHash
+     * @param attachments - the attachments of the render pass this subpass belongs to
+     * @return
+     *
+     * Hashes only the parts of the subpass which affect render pass
+     * compatibility. Attachment references are hashed by the format and
+     * sample count of the attachment they refer to, not by their index
+     * or layout. Unused references at the end of an array are ignored.
+     */
+    size_t compatibilityHash(std::vector<vk::AttachmentDescription> const & attachments) const
+    {
+        std::hash<uint32_t> Hu;
+
+        auto _hashRef = [&](size_t & seed, vk::AttachmentReference const & a)
+        {
+            if( a.attachment == VK_ATTACHMENT_UNUSED || a.attachment >= attachments.size() )
+            {
+                hash_c(seed, Hu(VK_ATTACHMENT_UNUSED));
+            }
+            else
+            {
+                hash_c(seed, hash_e(attachments[a.attachment].format ));
+                hash_c(seed, hash_e(attachments[a.attachment].samples));
+            }
+        };
+        auto _hashRefs = [&](size_t & seed, std::vector<vk::AttachmentReference> const & refs)
+        {
+            auto count = refs.size();
+            while( count > 0 && refs[count-1].attachment == VK_ATTACHMENT_UNUSED )
+                --count;
+
+            hash_c(seed, Hu(static_cast<uint32_t>(count)));
+            for(size_t i=0;i<count;i++)
+                _hashRef(seed, refs[i]);
+        };
+
+        size_t seed = 0x9e3779b9;
+        hash_c(seed, hash_e(pipelineBindPoint));
+
+        _hashRefs(seed, inputAttachments);
+        _hashRefs(seed, colorAttachments);
+
+        hash_c(seed, Hu(depthStencilAttachment.has_value() ? 1u : 0u));
+        if( depthStencilAttachment.has_value())
+            _hashRef(seed, *depthStencilAttachment);
+
+        hash_c(seed, Hu(resolveAttachment.has_value() ? 1u : 0u));
+        if( resolveAttachment.has_value())
+            _hashRef(seed, *resolveAttachment);
+
+        for(auto & a : preserveAttachments)
+        {
+            hash_c(seed, Hu(a) );
+        }
+        return seed;
+    }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process.
+     */
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        auto _hashRefs = [&](std::vector<vk::AttachmentReference> const & refs)
+        {
+            H.u64(refs.size());
+            for(auto & a : refs)
+                H.e(a.layout).u32(a.attachment);
+        };
+        auto _hashOpt = [&](std::optional<vk::AttachmentReference> const & a)
+        {
+            H.byte(a.has_value() ? 1 : 0);
+            if( a.has_value() )
+                H.e(a->layout).u32(a->attachment);
+        };
+
+        H.e(pipelineBindPoint);
+        _hashRefs(inputAttachments);
+        _hashRefs(colorAttachments);
+        _hashOpt(depthStencilAttachment);
+        _hashOpt(resolveAttachment);
+        H.u64(preserveAttachments.size()).words(preserveAttachments.data(), preserveAttachments.size());
+        return H.value;
+    }
+
+    /**
+     * @brief stableCompatibilityHash
+     * @param attachments
+     * @return
+     *
+     * Same as compatibilityHash(attachments), but the value is the
+     * same in every process.
+     */
+    uint64_t stableCompatibilityHash(std::vector<vk::AttachmentDescription> const & attachments) const
+    {
+        StableHash H;
+        auto _hashRef = [&](vk::AttachmentReference const & a)
+        {
+            if( a.attachment == VK_ATTACHMENT_UNUSED || a.attachment >= attachments.size() )
+            {
+                H.u32(VK_ATTACHMENT_UNUSED);
+            }
+            else
+            {
+                H.e(attachments[a.attachment].format);
+                H.e(attachments[a.attachment].samples);
+            }
+        };
+        auto _hashRefs = [&](std::vector<vk::AttachmentReference> const & refs)
+        {
+            // trailing unused references do not affect compatibility
+            auto count = refs.size();
+            while( count > 0 && refs[count-1].attachment == VK_ATTACHMENT_UNUSED )
+                --count;
+            H.u32(static_cast<uint32_t>(count));
+            for(size_t i=0;i<count;i++)
+                _hashRef(refs[i]);
+        };
+
+        H.e(pipelineBindPoint);
+        _hashRefs(inputAttachments);
+        _hashRefs(colorAttachments);
+
+        H.u32(depthStencilAttachment.has_value() ? 1u : 0u);
+        if( depthStencilAttachment.has_value())
+            _hashRef(*depthStencilAttachment);
+
+        H.u32(resolveAttachment.has_value() ? 1u : 0u);
+        if( resolveAttachment.has_value())
+            _hashRef(*resolveAttachment);
+
+        for(auto & a : preserveAttachments)
+            H.u32(a);
+        return H.value;
+    }
 };
 
 
@@ -119,7 +259,20 @@ struct RenderPassCreateInfo2
 
     object_type create(Storage & S, vk::Device device) const
     {
-        auto h = hash();
+        return create(S, device, hash());
+    }
+
+    /**
+     * @brief create
+     * @param S
+     * @param device
+     * @param h - the value of hash(), if it has already been calculated
+     * @return
+     *
+     * Same as create(S, device), but does not rehash the render pass.
+     */
+    object_type create(Storage & S, vk::Device device, size_t h) const
+    {
         auto & _map = S.renderPasses;
 
         auto f = _map.find(h);
@@ -171,6 +324,151 @@ struct RenderPassCreateInfo2
         return seed;
     }
 
+    /**
+     * @brief compatibilityHash
+     * @return
+     *
+     * Returns the hash of the render pass compatibility class. Two
+     * render passes which are compatible with each other (see Render Pass
+     * Compatibility in the Vulkan spec) have the same compatibilityHash,
+     * so pipelines and framebuffers created for one can be used with the other.
+     *
+     * The load/store ops, the initial/final layouts of the attachments and the
+     * layouts of the attachment references are not hashed. The dependencies are
+     * hashed because the spec requires them to be identical.
+     */
+    size_t compatibilityHash() const
+    {
+        std::hash<uint32_t> Hu;
+
+        size_t seed = 0x9e3779b9;
+
+        hash_c(seed, Hu( static_cast<uint32_t>(attachments.size()) ) );
+        for(auto & a : attachments)
+        {
+            hash_c(seed, hash_f(a.flags  ));
+            hash_c(seed, hash_e(a.format ));
+            hash_c(seed, hash_e(a.samples));
+        }
+        for(auto & a : dependencies)
+        {
+            hash_c( seed, Hu(a.srcSubpass     ) );
+            hash_c( seed, Hu(a.dstSubpass     ) );
+            hash_c( seed, hash_f(a.srcStageMask   ) );
+            hash_c( seed, hash_f(a.dstStageMask   ) );
+            hash_c( seed, hash_f(a.srcAccessMask  ) );
+            hash_c( seed, hash_f(a.dstAccessMask  ) );
+            hash_c( seed, hash_f(a.dependencyFlags) );
+        }
+
+        hash_c(seed, Hu( static_cast<uint32_t>(subpasses.size()) ) );
+        for(auto & b : subpasses)
+        {
+            hash_c(seed, b.compatibilityHash(attachments) );
+        }
+        return seed;
+    }
+
+    /**
+     * @brief compatibilityHash
+     * @param S
+     * @param rp
+     * @return
+     *
+     * Returns the compatibility hash of a renderpass which was created
+     * using the storage. If the renderpass was not created using the
+     * storage, the handle is hashed instead.
+     */
+    static size_t compatibilityHash(Storage const & S, vk::RenderPass rp)
+    {
+        if( auto c = S.tryGetCreateInfo<vkb::RenderPassCreateInfo2>(rp) )
+        {
+            return c->compatibilityHash();
+        }
+        std::hash<void const*> Hv;
+        return Hv( static_cast<void const*>(rp) );
+    }
+
+    /**
+     * @brief isCompatible
+     * @param other
+     * @return
+     *
+     * Returns true if the two render passes are in the same
+     * compatibility class.
+     */
+    bool isCompatible(RenderPassCreateInfo2 const & other) const
+    {
+        return compatibilityHash() == other.compatibilityHash();
+    }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process, so it
+     * can be used as a key for on-disk caches.
+     */
+    uint64_t stableHash() const
+    {
+        StableHash H;
+        H.u64(attachments.size());
+        for(auto & a : attachments)
+        {
+            H.f(a.flags).e(a.format).e(a.samples).e(a.loadOp).e(a.storeOp)
+             .e(a.stencilLoadOp).e(a.stencilStoreOp).e(a.initialLayout).e(a.finalLayout);
+        }
+        _stableHashDependencies(H);
+        H.u64(subpasses.size());
+        for(auto & b : subpasses)
+        {
+            H.u64( b.stableHash() );
+        }
+        return H.value;
+    }
+
+    /**
+     * @brief stableCompatibilityHash
+     * @return
+     *
+     * Same as compatibilityHash(), but the value is the same in every process.
+     */
+    uint64_t stableCompatibilityHash() const
+    {
+        StableHash H;
+        H.u64(attachments.size());
+        for(auto & a : attachments)
+        {
+            H.f(a.flags).e(a.format).e(a.samples);
+        }
+        _stableHashDependencies(H);
+        H.u64(subpasses.size());
+        for(auto & b : subpasses)
+        {
+            H.u64( b.stableCompatibilityHash(attachments) );
+        }
+        return H.value;
+    }
+
+    /**
+     * @brief stableCompatibilityHash
+     * @param S
+     * @param rp
+     * @return
+     *
+     * Returns the stable compatibility hash of a renderpass which was
+     * created using the storage. Throws a std::runtime_error if the
+     * render pass was not created with S.
+     */
+    static uint64_t stableCompatibilityHash(Storage const & S, vk::RenderPass rp)
+    {
+        if( auto c = S.tryGetCreateInfo<vkb::RenderPassCreateInfo2>(rp) )
+        {
+            return c->stableCompatibilityHash();
+        }
+        throw std::runtime_error("Render pass handles can only be hashed if they were created with the Storage");
+    }
+
 
 
     // Create a simple renderpass given the output color attachment formats/layouts and the depth stencil format/layout
@@ -238,6 +536,18 @@ struct RenderPassCreateInfo2
         return R;
     }
 
+protected:
+    void _stableHashDependencies(StableHash & H) const
+    {
+        H.u64(dependencies.size());
+        for(auto & a : dependencies)
+        {
+            H.u32(a.srcSubpass).u32(a.dstSubpass)
+             .f(a.srcStageMask).f(a.dstStageMask)
+             .f(a.srcAccessMask).f(a.dstAccessMask)
+             .f(a.dependencyFlags);
+        }
+    }
 };
 
 
@@ -3,6 +3,7 @@
 
 #include <vulkan/vulkan.hpp>
 #include <functional>
+#include <string>
 #include "HashFunctions.h"
 #include "Storage.h"
 
@@ -41,33 +42,173 @@ struct SamplerCreateInfo2 : public vk::SamplerCreateInfo
      * @param S
      * @return
      *
-     * Create the descriptor set layout, but only if a similar layout
-     * doesnt' already exist in storage.
+     * Create the sampler, but only if an equivalent sampler doesn't
+     * already exist in storage. Each call increases the reference count
+     * of the returned sampler, call S.destroy(sampler, device) once for
+     * each call to create( ).
+     *
+     * Throws std::runtime_error if a new sampler is needed but the storage
+     * already holds S.maxSamplerAllocationCount samplers.
+     *
+     * Throws std::runtime_error if pNext is not null. The extension structs
+     * (eg: Ycbcr conversion, reduction mode) change the sampler, but they
+     * are not part of the hash and cannot be stored with the create info,
+     * so samplers which need them must be created with create(device).
      */
     object_type create(Storage & S, vk::Device device) const
     {
+        if( pNext != nullptr )
+        {
+            throw std::runtime_error("Cannot create sampler using the storage: pNext must be null");
+        }
         auto h = hash();
         auto f = S.samplers.find(h);
         if( f == S.samplers.end())
         {
-            auto l = create(device);
+            if( S.maxSamplerAllocationCount != 0 && S.samplers.size() >= S.maxSamplerAllocationCount )
+            {
+                throw std::runtime_error("Cannot create sampler: the storage already holds "
+                                         + std::to_string(S.samplers.size())
+                                         + " samplers and maxSamplerAllocationCount is "
+                                         + std::to_string(S.maxSamplerAllocationCount));
+            }
+            auto cpy = canonical();
+            auto l = cpy.create(device);
             if( l )
-                S.storeCreateInfo(l, *this);
-            S.samplers[h] = l;
+            {
+                S.storeCreateInfo(l, cpy);
+                S.samplers[h] = l;
+                S.samplerReferenceCount[l] = 1;
+            }
             return l;
         }
         else
         {
+            S.samplerReferenceCount[f->second]++;
             return f->second;
         }
     }
 
+    /**
+     * @brief canonical
+     * @return
+     *
+     * Returns a copy with all the fields that do not affect the
+     * sampler set to their default values. eg: maxAnisotropy is
+     * ignored if anisotropyEnable is false. The pNext chain is
+     * not copied, so it is ignored by hash( ) and operator==.
+     */
+    SamplerCreateInfo2 canonical() const
+    {
+        SamplerCreateInfo2 c;
+        base_create_info_type & C = c;
+        C = *this;
+        c.pNext = nullptr;
+        if( !anisotropyEnable )
+            c.maxAnisotropy = 0.0f;
+        if( !compareEnable )
+            c.compareOp = vk::CompareOp::eNever;
+        if( !_usesBorderColor() )
+            c.borderColor = vk::BorderColor::eFloatTransparentBlack;
+        return c;
+    }
+
+    /**
+     * @brief hash
+     * @return
+     *
+     * Hashes the fields of the canonical sampler, so that samplers
+     * which behave identically have the same hash.
+     */
     size_t hash() const
     {
-        size_t seed = hash_pod( *this);
+        auto c = canonical();
+
+        std::hash<float>    Hf;
+        std::hash<uint32_t> Hu;
+
+        size_t seed = hash_f(c.flags);
+        hash_c(seed, hash_e(c.magFilter));
+        hash_c(seed, hash_e(c.minFilter));
+        hash_c(seed, hash_e(c.mipmapMode));
+        hash_c(seed, hash_e(c.addressModeU));
+        hash_c(seed, hash_e(c.addressModeV));
+        hash_c(seed, hash_e(c.addressModeW));
+        hash_c(seed, Hf(c.mipLodBias));
+        hash_c(seed, Hu(c.anisotropyEnable));
+        hash_c(seed, Hf(c.maxAnisotropy));
+        hash_c(seed, Hu(c.compareEnable));
+        hash_c(seed, hash_e(c.compareOp));
+        hash_c(seed, Hf(c.minLod));
+        hash_c(seed, Hf(c.maxLod));
+        hash_c(seed, hash_e(c.borderColor));
+        hash_c(seed, Hu(c.unnormalizedCoordinates));
         return seed;
     }
 
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * Same as hash(), but the value is the same in every process.
+     */
+    uint64_t stableHash() const
+    {
+        auto c = canonical();
+
+        StableHash H;
+        H.f(c.flags)
+         .e(c.magFilter)
+         .e(c.minFilter)
+         .e(c.mipmapMode)
+         .e(c.addressModeU)
+         .e(c.addressModeV)
+         .e(c.addressModeW)
+         .f32(c.mipLodBias)
+         .u32(c.anisotropyEnable)
+         .f32(c.maxAnisotropy)
+         .u32(c.compareEnable)
+         .e(c.compareOp)
+         .f32(c.minLod)
+         .f32(c.maxLod)
+         .e(c.borderColor)
+         .u32(c.unnormalizedCoordinates);
+        return H.value;
+    }
+
+    bool operator==(SamplerCreateInfo2 const & other) const
+    {
+        auto a = canonical();
+        auto b = other.canonical();
+        return a.flags                   == b.flags &&
+               a.magFilter               == b.magFilter &&
+               a.minFilter               == b.minFilter &&
+               a.mipmapMode              == b.mipmapMode &&
+               a.addressModeU            == b.addressModeU &&
+               a.addressModeV            == b.addressModeV &&
+               a.addressModeW            == b.addressModeW &&
+               a.mipLodBias              == b.mipLodBias &&
+               a.anisotropyEnable        == b.anisotropyEnable &&
+               a.maxAnisotropy           == b.maxAnisotropy &&
+               a.compareEnable           == b.compareEnable &&
+               a.compareOp               == b.compareOp &&
+               a.minLod                  == b.minLod &&
+               a.maxLod                  == b.maxLod &&
+               a.borderColor             == b.borderColor &&
+               a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+    }
+    bool operator!=(SamplerCreateInfo2 const & other) const
+    {
+        return !(*this == other);
+    }
+
+protected:
+    bool _usesBorderColor() const
+    {
+        return addressModeU == vk::SamplerAddressMode::eClampToBorder ||
+               addressModeV == vk::SamplerAddressMode::eClampToBorder ||
+               addressModeW == vk::SamplerAddressMode::eClampToBorder;
+    }
 
 };
 
@@ -17,13 +17,28 @@ struct ShaderModuleCreateInfo2
 
     std::vector<uint32_t>   code;
 
+    // An alternative to code. The SPIR-V is read from memory which is
+    // owned by someone else, eg: a memory mapped vkb::PipelineArchive.
+    // It is only used if code is empty and must stay valid for as long
+    // as this create info, or the copy kept in the Storage, is used.
+    uint32_t const *        externalCode     = nullptr;
+    size_t                  externalCodeSize = 0; // number of uint32_t words
+
+    uint32_t const * codeData() const
+    {
+        return code.empty() ? externalCode : code.data();
+    }
+    size_t codeSize() const
+    {
+        return code.empty() ? externalCodeSize : code.size();
+    }
 
     template<typename Callable_t>
     object_type create_t(Callable_t && CC) const
     {
         vk::ShaderModuleCreateInfo C;
-        C.pCode = code.data();
-        C.codeSize = code.size() * sizeof(uint32_t);
+        C.pCode = codeData();
+        C.codeSize = codeSize() * sizeof(uint32_t);
         return CC(C);
     }
 
@@ -47,6 +62,7 @@ struct ShaderModuleCreateInfo2
         {
             auto l = create(device);
             _map[h] = l;
+            S.storeCreateInfo(l, *this);
             return l;
         }
         else
@@ -61,12 +77,25 @@ struct ShaderModuleCreateInfo2
 
         size_t seed = 0x9e3779b9;
 
-        for(auto & b : code)
+        auto data = codeData();
+        for(size_t i=0;i<codeSize();i++)
         {
-            hash_c(seed, H(b) );
+            hash_c(seed, H(data[i]) );
         }
         return seed;
     }
+
+    /**
+     * @brief stableHash
+     * @return
+     *
+     * The content hash of the SPIR-V, which is the same in every process.
+     * This is the same value as PipelineArchive::contentHash( ) of the code.
+     */
+    uint64_t stableHash() const
+    {
+        return StableHash().words(codeData(), codeSize()).value;
+    }
 };
 
 //inline void from_json(const nlohmann::json & j, DescriptorSetLayoutCreateInfo2& p)
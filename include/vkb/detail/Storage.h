@@ -2,13 +2,423 @@
 #define VKJSON_STORAGE_H
 
 #include <vulkan/vulkan.hpp>
-#include <typeindex>
+#include <atomic>
 #include <map>
-#include <any>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <tuple>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace vkb
 {
 
+/**
+ * @brief The DescriptorPoolStatistics struct
+ *
+ * Keeps track of how many descriptor sets/descriptors have been
+ * allocated from a pool which was created using the Storage.
+ * The allocated values are reset when the pool is reset, the
+ * peak values are never reset.
+ *
+ * peakSetsPerLayout is keyed by the DescriptorSetLayoutCreateInfo2 hash
+ * and can be given directly to DescriptorPoolCreateInfo2::createFromLayouts( )
+ * on the next run to size the pool.
+ */
+// returns a + b*c, clamped to the largest uint32_t instead of overflowing
+inline uint32_t _saturatingMultiplyAdd(uint32_t a, uint32_t b, uint32_t c)
+{
+    uint64_t v = uint64_t(a) + uint64_t(b) * uint64_t(c);
+    return static_cast<uint32_t>( std::min<uint64_t>(v, std::numeric_limits<uint32_t>::max()) );
+}
+
+struct DescriptorPoolStatistics
+{
+    uint32_t                               allocatedSets = 0;
+    uint32_t                               peakSets      = 0;
+    std::map<vk::DescriptorType, uint32_t> allocatedDescriptors;
+    std::map<vk::DescriptorType, uint32_t> peakDescriptors;
+    std::map<size_t, uint32_t>             allocatedSetsPerLayout;
+    std::map<size_t, uint32_t>             peakSetsPerLayout;
+
+    void recordAllocation(size_t layoutHash, std::vector<vk::DescriptorSetLayoutBinding> const & bindings, uint32_t setCount)
+    {
+        allocatedSets  = _saturatingMultiplyAdd(allocatedSets, 1, setCount);
+        peakSets       = std::max(peakSets, allocatedSets);
+
+        auto & l = allocatedSetsPerLayout[layoutHash];
+        l        = _saturatingMultiplyAdd(l, 1, setCount);
+        auto & pl = peakSetsPerLayout[layoutHash];
+        pl        = std::max(pl, l);
+
+        for(auto & b : bindings)
+        {
+            auto & d = allocatedDescriptors[b.descriptorType];
+            d        = _saturatingMultiplyAdd(d, b.descriptorCount, setCount);
+            auto & pd = peakDescriptors[b.descriptorType];
+            pd        = std::max(pd, d);
+        }
+    }
+
+    void reset()
+    {
+        allocatedSets = 0;
+        allocatedDescriptors.clear();
+        allocatedSetsPerLayout.clear();
+    }
+};
+
+/**
+ * @brief The DestructionQueue struct
+ *
+ * A bounded FIFO of handles waiting to be destroyed once the GPU
+ * has finished the frame they were last used in. Inserting is O(1)
+ * and never allocates after the first insert.
+ *
+ * Handles must be retired in increasing frame order. A handle retired
+ * with a frame index lower than the previous one is treated as if it
+ * was retired in the previous frame, which only delays its destruction.
+ */
+template<typename T>
+struct DestructionQueue
+{
+    struct Entry
+    {
+        T        handle;
+        uint64_t frame = 0;
+    };
+
+    explicit DestructionQueue(size_t capacity = 4096) : m_capacity(capacity)
+    {
+    }
+
+    /**
+     * @brief push
+     * @param handle
+     * @param frame
+     *
+     * Throws std::runtime_error if the queue is full.
+     */
+    void push(T handle, uint64_t frame)
+    {
+        if( m_size == m_capacity )
+        {
+            throw std::runtime_error("DestructionQueue is full (" + std::to_string(m_capacity)
+                                     + " objects). Call collect( ) more often or increase the capacity.");
+        }
+        if( m_entries.empty() )
+            m_entries.resize(m_capacity);
+
+        if( m_size != 0 )
+            frame = std::max(frame, m_lastFrame);
+        m_lastFrame = frame;
+
+        m_entries[ (m_front + m_size) % m_capacity ] = Entry{handle, frame};
+        ++m_size;
+    }
+
+    /**
+     * @brief collect
+     * @param completedFrame
+     * @param destroyer - called as destroyer(handle)
+     * @return the number of handles destroyed
+     *
+     * Destroys all the handles which were retired in or before completedFrame.
+     * Handles which were removed with remove( ) are skipped.
+     */
+    template<typename Callable_t>
+    size_t collect(uint64_t completedFrame, Callable_t && destroyer)
+    {
+        size_t count = 0;
+        while( m_size != 0 && m_entries[m_front].frame <= completedFrame )
+        {
+            auto h = m_entries[m_front].handle;
+            m_front = (m_front + 1) % m_capacity;
+            --m_size;
+            if( !h )
+                continue;
+            ++count;
+            destroyer(h);
+        }
+        return count;
+    }
+
+    /**
+     * @brief remove
+     * @param handle
+     *
+     * Removes a handle which has been destroyed by other means, so that
+     * collect( ) does not destroy it again. This is O(size()).
+     */
+    void remove(T handle)
+    {
+        for(size_t i=0;i<m_size;i++)
+        {
+            auto & e = m_entries[ (m_front + i) % m_capacity ];
+            if( e.handle == handle )
+                e.handle = T();
+        }
+    }
+
+    /**
+     * @brief setCapacity
+     * @param capacity
+     *
+     * Changes the maximum number of handles the queue can hold.
+     * Throws std::runtime_error if the queue holds more handles
+     * than the new capacity.
+     */
+    void setCapacity(size_t capacity)
+    {
+        if( capacity < m_size || capacity == 0 )
+            throw std::runtime_error("DestructionQueue capacity must be non-zero and not less than its size");
+
+        std::vector<Entry> e;
+        if( m_size != 0 )
+        {
+            e.resize(capacity);
+            for(size_t i=0;i<m_size;i++)
+                e[i] = m_entries[ (m_front + i) % m_capacity ];
+        }
+        m_entries.swap(e);
+        m_front    = 0;
+        m_capacity = capacity;
+    }
+
+    size_t size()     const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool   empty()    const { return m_size == 0; }
+
+protected:
+    std::vector<Entry> m_entries;
+    size_t             m_capacity;
+    size_t             m_front     = 0;
+    size_t             m_size      = 0;
+    uint64_t           m_lastFrame = 0;
+};
+
+// type-erased interface so the Storage can erase create infos
+// without knowing their type
+struct _CreateInfoArenaBase
+{
+    virtual ~_CreateInfoArenaBase() = default;
+    virtual bool   erase(void * h) = 0;
+    virtual size_t size() const = 0;
+};
+
+/**
+ * @brief The _HandleIndex struct
+ *
+ * An open addressing hash table (linear probing) mapping a
+ * non-null handle to a slot index. It does not allocate per entry.
+ */
+struct _HandleIndex
+{
+    struct Slot
+    {
+        void *   key   = nullptr;
+        uint32_t value = 0;
+    };
+
+    uint32_t const * find(void * h) const
+    {
+        // empty slots have a null key
+        if( m_size == 0 || h == nullptr )
+            return nullptr;
+        for(size_t i = _bucket(h); ; i = (i+1) & m_mask)
+        {
+            if( m_slots[i].key == h )
+                return &m_slots[i].value;
+            if( m_slots[i].key == nullptr )
+                return nullptr;
+        }
+    }
+
+    // returns false if the handle already exists
+    bool insert(void * h, uint32_t value)
+    {
+        if( (m_size+1)*4 > m_slots.size()*3 )
+            _grow();
+        for(size_t i = _bucket(h); ; i = (i+1) & m_mask)
+        {
+            if( m_slots[i].key == h )
+                return false;
+            if( m_slots[i].key == nullptr )
+            {
+                m_slots[i] = Slot{h, value};
+                ++m_size;
+                return true;
+            }
+        }
+    }
+
+    void erase(void * h)
+    {
+        if( m_size == 0 )
+            return;
+        size_t i = _bucket(h);
+        while( m_slots[i].key != h )
+        {
+            if( m_slots[i].key == nullptr )
+                return;
+            i = (i+1) & m_mask;
+        }
+        // backward shift the entries which follow so that no
+        // tombstones are needed
+        for(size_t j = (i+1) & m_mask; m_slots[j].key != nullptr; j = (j+1) & m_mask)
+        {
+            auto b = _bucket(m_slots[j].key);
+            if( ((j - b) & m_mask) >= ((j - i) & m_mask) )
+            {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i] = Slot();
+        --m_size;
+    }
+
+    template<typename Callable_t>
+    void forEach(Callable_t && C) const
+    {
+        for(auto & x : m_slots)
+        {
+            if( x.key != nullptr )
+                C(x.key, x.value);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+protected:
+    size_t _bucket(void * h) const
+    {
+        auto v = reinterpret_cast<uintptr_t>(h);
+        return static_cast<size_t>( (static_cast<uint64_t>(v) * 0x9E3779B97F4A7C15ull) >> 32 ) & m_mask;
+    }
+
+    void _grow()
+    {
+        std::vector<Slot> old( std::max<size_t>(16, m_slots.size()*2) );
+        old.swap(m_slots);
+        m_mask = m_slots.size()-1;
+        m_size = 0;
+        for(auto & x : old)
+        {
+            if( x.key != nullptr )
+                insert(x.key, x.value);
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t            m_mask = 0;
+    size_t            m_size = 0;
+};
+
+/**
+ * @brief The CreateInfoArena struct
+ *
+ * Holds the create info structs of one type, indexed by the handle
+ * of the object they created. The structs are stored contiguously in
+ * chunks and never move, so references remain valid until the object
+ * is erased. Erased slots are reused.
+ */
+template<typename T>
+struct CreateInfoArena : public _CreateInfoArenaBase
+{
+    T const * find(void * h) const
+    {
+        auto f = m_index.find(h);
+        return f == nullptr ? nullptr : &m_data[*f];
+    }
+    T * find(void * h)
+    {
+        auto f = m_index.find(h);
+        return f == nullptr ? nullptr : &m_data[*f];
+    }
+
+    /**
+     * @brief insert
+     * @return false if the handle is null or already exists
+     */
+    template<typename U>
+    bool insert(void * h, U && v)
+    {
+        if( h == nullptr || m_index.find(h) != nullptr )
+            return false;
+
+        uint32_t slot;
+        if( m_free.empty() )
+        {
+            slot = static_cast<uint32_t>(m_data.size());
+            m_data.emplace_back( std::forward<U>(v) );
+        }
+        else
+        {
+            slot = m_free.back();
+            m_free.pop_back();
+            m_data[slot] = std::forward<U>(v);
+        }
+        m_index.insert(h, slot);
+        return true;
+    }
+
+    bool erase(void * h) override
+    {
+        auto f = m_index.find(h);
+        if( f == nullptr )
+            return false;
+        m_data[*f] = T();
+        m_free.push_back(*f);
+        m_index.erase(h);
+        return true;
+    }
+
+    size_t size() const override
+    {
+        return m_index.size();
+    }
+
+    /**
+     * @brief forEach
+     *
+     * Calls C(void* handle, T const & createInfo) for each object
+     */
+    template<typename Callable_t>
+    void forEach(Callable_t && C) const
+    {
+        m_index.forEach([&](void * h, uint32_t slot)
+        {
+            C(h, m_data[slot]);
+        });
+    }
+
+protected:
+    std::deque<T>                       m_data;
+    std::vector<uint32_t>               m_free;
+    _HandleIndex                        m_index;
+};
+
+inline size_t _nextTypeIndex()
+{
+    // _typeIndex<T>() may be first called for two types from two threads
+    static std::atomic<size_t> i{0};
+    return i.fetch_add(1, std::memory_order_relaxed);
+}
+
+// a unique, dense index for each type
+template<typename T>
+inline size_t _typeIndex()
+{
+    static const size_t i = _nextTypeIndex();
+    return i;
+}
+
 /**
  * @brief The Storage struct
  *
@@ -18,10 +428,27 @@ namespace vkb
  */
 struct Storage
 {
+    /**
+     * @brief destroy
+     * @param d
+     * @param dev
+     *
+     * Destroys the layout and releases any immutable samplers
+     * the storage created for it.
+     */
     void destroy( vk::DescriptorSetLayout d, vk::Device dev )
     {
         dev.destroyDescriptorSetLayout(d);
         _remove(d,descriptorSetLayouts);
+
+        auto r = m_samplersByDescriptorSetLayout.equal_range( static_cast<void*>(d) );
+        std::vector<vk::Sampler> samplersToRelease;
+        for(auto i = r.first; i != r.second; ++i)
+            samplersToRelease.push_back(i->second);
+        m_samplersByDescriptorSetLayout.erase(r.first, r.second);
+
+        for(auto s : samplersToRelease)
+            destroy(s, dev);
     }
 
     void destroy( vk::PipelineLayout d, vk::Device dev )
@@ -42,27 +469,183 @@ struct Storage
     void destroy( vk::DeviceMemory d, vk::Device dev )
     {
         dev.freeMemory(d);
-        m_createInfos.erase(d);
+        _eraseCreateInfo(d);
     }
     void destroy( vk::Buffer d, vk::Device dev )
     {
         dev.destroyBuffer(d);
-        m_createInfos.erase(d);
+        _eraseCreateInfo(d);
     }
     void destroy( vk::DescriptorPool d, vk::Device dev )
     {
         dev.destroyDescriptorPool(d);
-        m_createInfos.erase(d);
+        _eraseCreateInfo(d);
+        descriptorPoolStatistics.erase(d);
     }
+    /**
+     * @brief destroy
+     * @param d
+     * @param dev
+     *
+     * Pipelines shared through create(S, device) are reference
+     * counted (see pipelineReferenceCount). The pipeline is only destroyed
+     * once every reference has been released.
+     */
     void destroy( vk::Pipeline d, vk::Device dev)
     {
+        auto f = pipelineReferenceCount.find(d);
+        if( f != pipelineReferenceCount.end() )
+        {
+            if( --f->second != 0 )
+                return;
+            pipelineReferenceCount.erase(f);
+        }
         dev.destroyPipeline(d);
+        _remove(d, pipelines);
+        _remove(d, pipelineLibraries);
     }
+
+    /**
+     * @brief acquire
+     * @param d
+     * @param created - true if the caller has just created d
+     *
+     * Adds a reference to a pipeline in the storage. A pipeline which
+     * the caller did not create, and which is not reference counted yet,
+     * is counted as having one reference held by whoever created it.
+     */
+    void acquire( vk::Pipeline d, bool created)
+    {
+        auto & n = pipelineReferenceCount[d];
+        if( n == 0 && !created )
+            n = 1;
+        n++;
+    }
+
+    /**
+     * @brief getReferenceCount
+     * @param d
+     * @return
+     *
+     * Returns the number of references to a pipeline added with
+     * acquire( ), or 0 if the pipeline is not reference counted.
+     */
+    uint32_t getReferenceCount( vk::Pipeline d) const
+    {
+        auto f = pipelineReferenceCount.find(d);
+        return f == pipelineReferenceCount.end() ? 0u : f->second;
+    }
+    /**
+     * @brief destroy
+     * @param d
+     * @param dev
+     *
+     * Samplers created with SamplerCreateInfo2::create(storage, device)
+     * are shared and reference counted. The sampler is only destroyed
+     * once destroy( ) has been called for every call to create( ).
+     */
     void destroy( vk::Sampler d, vk::Device dev)
     {
+        auto f = samplerReferenceCount.find(d);
+        if( f != samplerReferenceCount.end() )
+        {
+            if( --f->second != 0 )
+                return;
+            samplerReferenceCount.erase(f);
+        }
         dev.destroySampler(d);
         _remove(d, samplers);
-        m_createInfos.erase(d);
+        _unretire(d);
+    }
+
+    /**
+     * @brief getReferenceCount
+     * @param d
+     * @return
+     *
+     * Returns the number of users of a sampler created by the storage
+     * or 0 if the storage does not know about the sampler.
+     */
+    uint32_t getReferenceCount( vk::Sampler d) const
+    {
+        auto f = samplerReferenceCount.find(d);
+        return f == samplerReferenceCount.end() ? 0u : f->second;
+    }
+
+    /**
+     * @brief acquire
+     * @param d
+     * @return
+     *
+     * Adds a reference to a sampler created by the storage. Returns
+     * false, and does nothing, if the storage does not know about
+     * the sampler.
+     */
+    bool acquire( vk::Sampler d)
+    {
+        auto f = samplerReferenceCount.find(d);
+        if( f == samplerReferenceCount.end() )
+            return false;
+        f->second++;
+        return true;
+    }
+    void destroy( vk::Framebuffer d, vk::Device dev)
+    {
+        dev.destroyFramebuffer(d);
+        _remove(d, framebuffers);
+        _removeDependent(d, m_framebuffersByImageView);
+        _unretire(d);
+    }
+    /**
+     * @brief destroy
+     * @param d
+     * @param dev
+     *
+     * Destroys the image view as well as any framebuffers in the
+     * storage which use it as an attachment.
+     */
+    void destroy( vk::ImageView d, vk::Device dev)
+    {
+        auto key = static_cast<void*>(d);
+        for(auto f = m_framebuffersByImageView.find(key); f != m_framebuffersByImageView.end(); f = m_framebuffersByImageView.find(key))
+        {
+            destroy(f->second, dev);
+        }
+        dev.destroyImageView(d);
+        _remove(d, imageViews);
+        _removeDependent(d, m_imageViewsByImage);
+        _unretire(d);
+    }
+    /**
+     * @brief invalidate
+     * @param d
+     * @param dev
+     *
+     * Destroys all the image views in the storage which were created
+     * from this image, and any framebuffers that use those views. Call this
+     * before destroying an image which was not created by the storage,
+     * eg: the swapchain images when the swapchain is recreated.
+     */
+    void invalidate( vk::Image d, vk::Device dev)
+    {
+        auto key = static_cast<void*>(d);
+        for(auto f = m_imageViewsByImage.find(key); f != m_imageViewsByImage.end(); f = m_imageViewsByImage.find(key))
+        {
+            destroy(f->second, dev);
+        }
+    }
+    /**
+     * @brief destroy
+     * @param d
+     * @param dev
+     *
+     * Invalidates the image and then destroys it.
+     */
+    void destroy( vk::Image d, vk::Device dev)
+    {
+        invalidate(d, dev);
+        dev.destroyImage(d);
+        _eraseCreateInfo(d);
     }
     /**
      * @brief mapMemory
@@ -90,28 +673,197 @@ struct Storage
      */
     void  unmapMemory(vk::DeviceMemory m, vk::Device device);
 
+    /**
+     * @brief resetDescriptorPool
+     * @param pool
+     * @param device
+     *
+     * Resets the descriptor pool, returning all descriptor sets back
+     * to the pool. The allocation statistics for the pool are reset, but
+     * the peak values are kept.
+     */
+    void resetDescriptorPool(vk::DescriptorPool pool, vk::Device device)
+    {
+        device.resetDescriptorPool(pool);
+        auto f = descriptorPoolStatistics.find(pool);
+        if( f != descriptorPoolStatistics.end() )
+            f->second.reset();
+    }
 
+    /**
+     * @brief getPeakSetsPerLayout
+     * @return
+     *
+     * Returns the highest number of descriptor sets that were allocated
+     * at any one time for each layout. The peaks of all pools are added,
+     * since the sets of one layout may be spread over several pools, so a
+     * single pool created from the result can hold all of them. This can be
+     * saved and given to DescriptorPoolCreateInfo2::createFromLayouts( ) on
+     * the next run.
+     */
+    std::map<size_t, uint32_t> getPeakSetsPerLayout() const
+    {
+        std::map<size_t, uint32_t> peak;
+        for(auto & p : descriptorPoolStatistics)
+        {
+            for(auto & l : p.second.peakSetsPerLayout)
+            {
+                auto & v = peak[l.first];
+                v = _saturatingMultiplyAdd(v, 1, l.second);
+            }
+        }
+        return peak;
+    }
+
+
+
+    /**
+     * @brief retire
+     * @param h
+     * @param frameIndex - the last frame which uses the object
+     *
+     * Queues the object to be destroyed once frameIndex has completed
+     * on the GPU, instead of destroying it immediately. Call
+     * collect(completedFrame, device) once per frame.
+     *
+     * Throws std::runtime_error if the queue for this object type is full.
+     */
+    template<typename vulkan_handle>
+    void retire(vulkan_handle h, uint64_t frameIndex)
+    {
+        std::get< DestructionQueue<vulkan_handle> >(m_retired).push(h, frameIndex);
+    }
+
+    /**
+     * @brief collect
+     * @param completedFrame
+     * @param device
+     * @return the number of objects destroyed
+     *
+     * Destroys all objects which were retired in or before completedFrame
+     * using destroy(handle, device).
+     */
+    size_t collect(uint64_t completedFrame, vk::Device device)
+    {
+        return collect(completedFrame, [this, device](auto h)
+        {
+            destroy(h, device);
+        });
+    }
+
+    /**
+     * @brief collect
+     * @param completedFrame
+     * @param destroyer - called as destroyer(handle) for each object type
+     * @return the number of objects destroyed
+     *
+     * Same as above, but each object is passed to destroyer instead.
+     * Dependent objects are destroyed first, eg: framebuffers before image
+     * views, buffers/images before memory.
+     */
+    template<typename Callable_t>
+    size_t collect(uint64_t completedFrame, Callable_t && destroyer)
+    {
+        return std::apply([&](auto & ... q)
+        {
+            return (size_t(0) + ... + q.collect(completedFrame, destroyer));
+        }, m_retired);
+    }
+
+    /**
+     * @brief setRetireCapacity
+     * @param capacity
+     *
+     * Sets the maximum number of retired objects of each type.
+     */
+    void setRetireCapacity(size_t capacity)
+    {
+        std::apply([&](auto & ... q)
+        {
+            (q.setCapacity(capacity), ...);
+        }, m_retired);
+    }
+
+    /**
+     * @brief retiredCount
+     * @return
+     *
+     * Returns the number of objects waiting to be destroyed.
+     */
+    size_t retiredCount() const
+    {
+        return std::apply([&](auto const & ... q)
+        {
+            return (size_t(0) + ... + q.size());
+        }, m_retired);
+    }
 
     /**
      * @brief destroyAll
      * @param d
      *
-     * Destroys all remaining objects.
+     * Destroys all remaining objects, including any retired objects.
+     * The device must be idle.
      */
     void destroyAll(vk::Device d)
     {
+        collect(std::numeric_limits<uint64_t>::max(), d);
+
+        for(auto & x : framebuffers)
+        {
+            d.destroyFramebuffer(x.second);
+            _eraseCreateInfo(x.second);
+        }
+        for(auto & x : imageViews)
+        {
+            d.destroyImageView(x.second);
+            _eraseCreateInfo(x.second);
+        }
+        for(auto & x : pipelines)
+        {
+            d.destroyPipeline(x.second);
+            _eraseCreateInfo(x.second);
+        }
+        for(auto & x : pipelineLibraries)
+        {
+            d.destroyPipeline(x.second);
+        }
         for(auto & x : pipelineLayouts)
+        {
             d.destroyPipelineLayout(x.second);
+            _eraseCreateInfo(x.second);
+        }
         for(auto & x : descriptorSetLayouts)
+        {
             d.destroyDescriptorSetLayout(x.second);
+            _eraseCreateInfo(x.second);
+        }
         for(auto & x : shaderModules)
+        {
             d.destroyShaderModule(x.second);
+            _eraseCreateInfo(x.second);
+        }
         for(auto & x : renderPasses)
+        {
             d.destroyRenderPass(x.second);
+            _eraseCreateInfo(x.second);
+        }
         for(auto & x : samplers)
+        {
             d.destroySampler(x.second);
+            _eraseCreateInfo(x.second);
+        }
 
+        framebuffers.clear();
+        imageViews.clear();
+        m_framebuffersByImageView.clear();
+        m_imageViewsByImage.clear();
+        m_samplersByDescriptorSetLayout.clear();
+        pipelines.clear();
+        pipelineReferenceCount.clear();
+        pipelineLibraries.clear();
         samplers.clear();
+        samplerReferenceCount.clear();
         descriptorSetLayouts.clear();
         pipelineLayouts.clear();
         shaderModules.clear();
@@ -130,28 +882,73 @@ struct Storage
     template<typename CreateInfoStruct, typename vulkan_handle>
     CreateInfoStruct const& getCreateInfo( vulkan_handle d) const
     {
-        try
-        {
-            return std::any_cast<CreateInfoStruct const&>(m_createInfos.at( static_cast<void*>(d) ));
-        }
-        catch( std::exception & e)
-        {
+        auto c = tryGetCreateInfo<CreateInfoStruct>(d);
+        if( c == nullptr )
             throw std::out_of_range("Cound not find the object in the storage. Was this object created using the create(storage&, &createinfo) ?");
-        }
+        return *c;
+    }
+
+    /**
+     * @brief tryGetCreateInfo
+     * @param d
+     * @return
+     *
+     * Returns a pointer to the CreateInfo struct that created this vulkan
+     * object, or nullptr if it was not created using the storage.
+     */
+    template<typename CreateInfoStruct, typename vulkan_handle>
+    CreateInfoStruct const* tryGetCreateInfo( vulkan_handle d) const
+    {
+        auto a = _findArena<CreateInfoStruct>();
+        return a == nullptr ? nullptr : a->find( static_cast<void*>(d) );
+    }
+
+    /**
+     * @brief getCreateInfoArena
+     * @return
+     *
+     * Returns the arena holding all the CreateInfoStruct structs,
+     * or nullptr if none have been stored.
+     */
+    template<typename CreateInfoStruct>
+    CreateInfoArena<CreateInfoStruct> const* getCreateInfoArena() const
+    {
+        return _findArena<CreateInfoStruct>();
     }
 protected:
     template<typename CreateInfoStruct, typename vulkan_handle>
     CreateInfoStruct & _getCreateInfo( vulkan_handle d)
     {
-        try
-        {
-            return std::any_cast<CreateInfoStruct&>(m_createInfos.at( static_cast<void*>(d) ));
-        }
-        catch( std::exception & e)
-        {
+        auto a = const_cast<CreateInfoArena<CreateInfoStruct>*>(_findArena<CreateInfoStruct>());
+        auto c = a == nullptr ? nullptr : a->find( static_cast<void*>(d) );
+        if( c == nullptr )
             throw std::out_of_range("Cound not find the object in the storage. Was this object created using the create(storage&, &createinfo) ?");
+        return *c;
+    }
+
+    template<typename CreateInfoStruct>
+    CreateInfoArena<CreateInfoStruct> const* _findArena() const
+    {
+        auto i = _typeIndex<CreateInfoStruct>();
+        if( i >= m_createInfoArenas.size() )
+            return nullptr;
+        return static_cast<CreateInfoArena<CreateInfoStruct> const*>( m_createInfoArenas[i].get() );
+    }
+
+    // erases the create info of the handle from whichever arena holds it
+    template<typename vulkan_handle>
+    void _eraseCreateInfo( vulkan_handle d)
+    {
+        auto i = _typeIndex<vulkan_handle>();
+        if( i >= m_arenasByHandleType.size() )
+            return;
+        for(auto a : m_arenasByHandleType[i])
+        {
+            if( a->erase( static_cast<void*>(d) ) )
+                return;
         }
     }
+
     template<typename T>
     void _remove( T d, std::map<size_t, T> & mp )
     {
@@ -160,18 +957,53 @@ protected:
             if( itr->second == d)
             {
                 mp.erase(itr);
-                return;
+                break;
             }
         }
-        m_createInfos.erase(d);
+        _eraseCreateInfo(d);
+    }
+    // removes all the entries in the multimap whose value is d
+    template<typename T>
+    void _removeDependent( T d, std::multimap<void*, T> & mp )
+    {
+        for (auto itr = mp.begin(); itr != mp.end(); )
+        {
+            if( itr->second == d)
+                itr = mp.erase(itr);
+            else
+                ++itr;
+        }
+    }
+    // forgets a retired handle which was destroyed by a cascade, so that
+    // collect( ) does not destroy it a second time
+    template<typename T>
+    void _unretire( T d )
+    {
+        std::get< DestructionQueue<T> >(m_retired).remove(d);
     }
 public:
     template<typename vulkan_handle, typename CreateInfo>
     void storeCreateInfo( vulkan_handle h, CreateInfo && c )
     {
-        if( m_createInfos.count(static_cast<void*>(h) ))
-            throw std::runtime_error("Object already exists");
-        m_createInfos[ static_cast<void*>(h) ] = std::move(c);
+        using info_type = typename std::decay<CreateInfo>::type;
+
+        auto i = _typeIndex<info_type>();
+        if( i >= m_createInfoArenas.size() )
+            m_createInfoArenas.resize(i+1);
+
+        auto & a = m_createInfoArenas[i];
+        if( !a )
+        {
+            a = std::make_unique< CreateInfoArena<info_type> >();
+
+            auto j = _typeIndex<vulkan_handle>();
+            if( j >= m_arenasByHandleType.size() )
+                m_arenasByHandleType.resize(j+1);
+            m_arenasByHandleType[j].push_back(a.get());
+        }
+
+        if( !static_cast<CreateInfoArena<info_type>*>(a.get())->insert( static_cast<void*>(h), std::forward<CreateInfo>(c)) )
+            throw std::runtime_error("Object already exists or is a null handle");
     }
 
     std::map< size_t , vk::Sampler >             samplers;
@@ -179,8 +1011,45 @@ public:
     std::map< size_t , vk::PipelineLayout >      pipelineLayouts;
     std::map< size_t , vk::ShaderModule>         shaderModules;
     std::map< size_t , vk::RenderPass>           renderPasses;
+    std::map< size_t , vk::Pipeline>             pipelines; // keyed by the renderpass compatibility class
+    std::map< size_t , vk::Pipeline>             pipelineLibraries; // graphics pipeline library parts, keyed by GraphicsPipelineCreateInfo2::libraryKey
+    std::map< size_t , vk::ImageView>            imageViews;
+    std::map< size_t , vk::Framebuffer>          framebuffers; // keyed by the renderpass compatibility class
+
+    std::map< vk::DescriptorPool, DescriptorPoolStatistics> descriptorPoolStatistics;
+
+    std::map< vk::Sampler, uint32_t> samplerReferenceCount;
+    std::map< vk::Pipeline, uint32_t> pipelineReferenceCount; // pipelines shared through create(S, device)
+
+    // The maximum number of samplers the storage will create, 0 for no limit.
+    // Set this to physicalDevice.getProperties().limits.maxSamplerAllocationCount
+    uint32_t maxSamplerAllocationCount = 0;
+
+    // one arena per CreateInfo type, indexed by _typeIndex<CreateInfo>()
+    std::vector< std::unique_ptr<_CreateInfoArenaBase> > m_createInfoArenas;
+    // the arenas which hold create infos for each handle type, indexed by _typeIndex<vulkan_handle>()
+    std::vector< std::vector<_CreateInfoArenaBase*> >     m_arenasByHandleType;
+
+    // image -> imageViews created from it, imageView -> framebuffers using it
+    std::multimap< void*, vk::ImageView>   m_imageViewsByImage;
+    std::multimap< void*, vk::Framebuffer> m_framebuffersByImageView;
+
+    // descriptorSetLayout -> immutable samplers it holds a reference to
+    std::multimap< void*, vk::Sampler>     m_samplersByDescriptorSetLayout;
 
-    std::map< void*, std::any> m_createInfos;
+    // objects waiting to be destroyed, in the order they are collected
+    std::tuple< DestructionQueue<vk::Framebuffer>,
+                DestructionQueue<vk::ImageView>,
+                DestructionQueue<vk::Image>,
+                DestructionQueue<vk::Pipeline>,
+                DestructionQueue<vk::PipelineLayout>,
+                DestructionQueue<vk::DescriptorSetLayout>,
+                DestructionQueue<vk::Sampler>,
+                DestructionQueue<vk::ShaderModule>,
+                DestructionQueue<vk::RenderPass>,
+                DestructionQueue<vk::DescriptorPool>,
+                DestructionQueue<vk::Buffer>,
+                DestructionQueue<vk::DeviceMemory> > m_retired;
 };
 
 
@@ -0,0 +1,411 @@
+#ifndef VKB_BINARYENCODING_H
+#define VKB_BINARYENCODING_H
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../vkb.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The BinaryWriter/BinaryReader structs
+ *
+ * Helpers used to write create infos into compact binary blobs, eg:
+ * vkb::StorageSnapshot and vkb::PipelineArchive. Values are written in
+ * the byte order of the host.
+ *
+ * Vulkan structs without pointers are written as they are, structs
+ * with sType/pNext are written field by field. Handles are never
+ * written. The reader throws std::runtime_error if it runs past the
+ * end of the data.
+ */
+struct BinaryWriter
+{
+    std::vector<uint8_t> data;
+
+    template<typename T>
+    void pod(T const & v)
+    {
+        static_assert( std::is_standard_layout<T>::value, "T must be a standard layout type");
+        auto b = reinterpret_cast<uint8_t const*>(&v);
+        data.insert(data.end(), b, b + sizeof(T));
+    }
+    template<typename T>
+    void vec(std::vector<T> const & v)
+    {
+        pod( static_cast<uint32_t>(v.size()) );
+        for(auto & x : v)
+            pod(x);
+    }
+    void str(std::string const & s)
+    {
+        pod( static_cast<uint32_t>(s.size()) );
+        data.insert(data.end(), s.begin(), s.end());
+    }
+};
+
+struct BinaryReader
+{
+    uint8_t const * p;
+    uint8_t const * end;
+
+    void check(bool b) const
+    {
+        if( !b )
+            throw std::runtime_error("The binary data is truncated or corrupt");
+    }
+    template<typename T>
+    T pod()
+    {
+        check( static_cast<size_t>(end - p) >= sizeof(T) );
+        T v;
+        std::memcpy(static_cast<void*>(&v), p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    uint32_t count()
+    {
+        auto c = pod<uint32_t>();
+        check( c <= static_cast<size_t>(end - p) ); // every element is at least one byte
+        return c;
+    }
+    template<typename T>
+    void vec(std::vector<T> & v)
+    {
+        v.resize( count() );
+        for(auto & x : v)
+            x = pod<T>();
+    }
+    std::string str()
+    {
+        auto c = count();
+        std::string s(reinterpret_cast<char const*>(p), c);
+        p += c;
+        return s;
+    }
+};
+
+inline void writeBinary(BinaryWriter & W, SamplerCreateInfo2 const & x)
+{
+    W.pod(x.flags);
+    W.pod(x.magFilter);
+    W.pod(x.minFilter);
+    W.pod(x.mipmapMode);
+    W.pod(x.addressModeU);
+    W.pod(x.addressModeV);
+    W.pod(x.addressModeW);
+    W.pod(x.mipLodBias);
+    W.pod(x.anisotropyEnable);
+    W.pod(x.maxAnisotropy);
+    W.pod(x.compareEnable);
+    W.pod(x.compareOp);
+    W.pod(x.minLod);
+    W.pod(x.maxLod);
+    W.pod(x.borderColor);
+    W.pod(x.unnormalizedCoordinates);
+}
+inline void readBinary(BinaryReader & R, SamplerCreateInfo2 & x)
+{
+    x.flags                   = R.pod<decltype(x.flags)>();
+    x.magFilter               = R.pod<decltype(x.magFilter)>();
+    x.minFilter               = R.pod<decltype(x.minFilter)>();
+    x.mipmapMode              = R.pod<decltype(x.mipmapMode)>();
+    x.addressModeU            = R.pod<decltype(x.addressModeU)>();
+    x.addressModeV            = R.pod<decltype(x.addressModeV)>();
+    x.addressModeW            = R.pod<decltype(x.addressModeW)>();
+    x.mipLodBias              = R.pod<decltype(x.mipLodBias)>();
+    x.anisotropyEnable        = R.pod<decltype(x.anisotropyEnable)>();
+    x.maxAnisotropy           = R.pod<decltype(x.maxAnisotropy)>();
+    x.compareEnable           = R.pod<decltype(x.compareEnable)>();
+    x.compareOp               = R.pod<decltype(x.compareOp)>();
+    x.minLod                  = R.pod<decltype(x.minLod)>();
+    x.maxLod                  = R.pod<decltype(x.maxLod)>();
+    x.borderColor             = R.pod<decltype(x.borderColor)>();
+    x.unnormalizedCoordinates = R.pod<decltype(x.unnormalizedCoordinates)>();
+}
+
+inline void _writeBinaryRef(BinaryWriter & W, std::optional<vk::AttachmentReference> const & r)
+{
+    W.pod( static_cast<uint8_t>(r.has_value()) );
+    if( r.has_value() )
+        W.pod(*r);
+}
+inline void _readBinaryRef(BinaryReader & R, std::optional<vk::AttachmentReference> & r)
+{
+    if( R.pod<uint8_t>() )
+        r = R.pod<vk::AttachmentReference>();
+    else
+        r.reset();
+}
+
+inline void writeBinary(BinaryWriter & W, RenderPassCreateInfo2 const & x)
+{
+    W.vec(x.attachments);
+    W.vec(x.dependencies);
+    W.pod( static_cast<uint32_t>(x.subpasses.size()) );
+    for(auto & s : x.subpasses)
+    {
+        W.pod(s.pipelineBindPoint);
+        W.vec(s.inputAttachments);
+        W.vec(s.colorAttachments);
+        _writeBinaryRef(W, s.depthStencilAttachment);
+        _writeBinaryRef(W, s.resolveAttachment);
+        W.vec(s.preserveAttachments);
+    }
+}
+inline void readBinary(BinaryReader & R, RenderPassCreateInfo2 & x)
+{
+    R.vec(x.attachments);
+    R.vec(x.dependencies);
+    x.subpasses.resize( R.count() );
+    for(auto & s : x.subpasses)
+    {
+        s.pipelineBindPoint = R.pod<vk::PipelineBindPoint>();
+        R.vec(s.inputAttachments);
+        R.vec(s.colorAttachments);
+        _readBinaryRef(R, s.depthStencilAttachment);
+        _readBinaryRef(R, s.resolveAttachment);
+        R.vec(s.preserveAttachments);
+    }
+}
+
+inline void writeBinary(BinaryWriter & W, PipelineRenderingCreateInfo2 const & x)
+{
+    W.pod(x.viewMask);
+    W.vec(x.colorAttachmentFormats);
+    W.pod(x.depthAttachmentFormat);
+    W.pod(x.stencilAttachmentFormat);
+}
+inline void readBinary(BinaryReader & R, PipelineRenderingCreateInfo2 & x)
+{
+    x.viewMask                = R.pod<decltype(x.viewMask)>();
+    R.vec(x.colorAttachmentFormats);
+    x.depthAttachmentFormat   = R.pod<decltype(x.depthAttachmentFormat)>();
+    x.stencilAttachmentFormat = R.pod<decltype(x.stencilAttachmentFormat)>();
+}
+
+inline void writeBinary(BinaryWriter & W, DescriptorSetLayoutCreateInfo2 const & x)
+{
+    W.pod(x.flags);
+    W.pod( static_cast<uint32_t>(x.bindings.size()) );
+    for(auto & b : x.bindings)
+    {
+        W.pod(b.binding);
+        W.pod(b.descriptorType);
+        W.pod(b.descriptorCount);
+        W.pod(b.stageFlags);
+    }
+    W.pod( static_cast<uint32_t>(x.immutableSamplers.size()) );
+    for(auto & b : x.immutableSamplers)
+    {
+        W.pod(b.first);
+        W.pod( static_cast<uint32_t>(b.second.size()) );
+        for(auto & s : b.second)
+        {
+            auto c = std::get_if<SamplerCreateInfo2>(&s);
+            if( c == nullptr )
+                throw std::runtime_error("Immutable samplers must be given as SamplerCreateInfo2 to be written");
+            writeBinary(W, *c);
+        }
+    }
+}
+inline void readBinary(BinaryReader & R, DescriptorSetLayoutCreateInfo2 & x)
+{
+    x.flags = R.pod<decltype(x.flags)>();
+    x.bindings.resize( R.count() );
+    for(auto & b : x.bindings)
+    {
+        b.binding            = R.pod<uint32_t>();
+        b.descriptorType     = R.pod<vk::DescriptorType>();
+        b.descriptorCount    = R.pod<uint32_t>();
+        b.stageFlags         = R.pod<vk::ShaderStageFlags>();
+        b.pImmutableSamplers = nullptr;
+    }
+    auto n = R.count();
+    for(uint32_t i=0;i<n;i++)
+    {
+        auto & v = x.immutableSamplers[ R.pod<uint32_t>() ];
+        v.resize( R.count() );
+        for(auto & s : v)
+        {
+            SamplerCreateInfo2 si;
+            readBinary(R, si);
+            s = si;
+        }
+    }
+}
+
+inline void writeBinary(BinaryWriter & W, GraphicsPipelineCreateInfo2 const & x)
+{
+    W.pod( static_cast<uint32_t>(x.stages.size()) );
+    for(auto & s : x.stages)
+    {
+        W.str(s.name);
+        W.pod(s.stage);
+        W.pod( static_cast<uint32_t>(s.specializationEntries.size()) );
+        for(auto & e : s.specializationEntries)
+        {
+            W.pod(e.constantID);
+            W.pod(e.offset);
+            W.pod( static_cast<uint32_t>(e.size) );
+        }
+        W.vec(s.specializationData);
+    }
+
+    W.vec(x.blendState.attachments);
+    W.pod(x.blendState.flags);
+    W.pod(x.blendState.logicOpEnable);
+    W.pod(x.blendState.logicOp);
+    W.pod(x.blendState.blendConstants);
+
+    W.vec(x.vertexInputState.vertexBindingDescriptions);
+    W.vec(x.vertexInputState.vertexAttributeDescriptions);
+
+    auto & r = x.rasterizationState;
+    W.pod(r.flags);
+    W.pod(r.depthClampEnable);
+    W.pod(r.rasterizerDiscardEnable);
+    W.pod(r.polygonMode);
+    W.pod(r.cullMode);
+    W.pod(r.frontFace);
+    W.pod(r.depthBiasEnable);
+    W.pod(r.depthBiasConstantFactor);
+    W.pod(r.depthBiasClamp);
+    W.pod(r.depthBiasSlopeFactor);
+    W.pod(r.lineWidth);
+
+    auto & m = x.multisampleState;
+    W.pod(m.flags);
+    W.pod(m.rasterizationSamples);
+    W.pod(m.sampleShadingEnable);
+    W.pod(m.minSampleShading);
+    W.pod(m.alphaToCoverageEnable);
+    W.pod(m.alphaToOneEnable);
+
+    auto & d = x.depthStencilState;
+    W.pod(d.flags);
+    W.pod(d.depthTestEnable);
+    W.pod(d.depthWriteEnable);
+    W.pod(d.depthCompareOp);
+    W.pod(d.depthBoundsTestEnable);
+    W.pod(d.stencilTestEnable);
+    W.pod(d.front);
+    W.pod(d.back);
+    W.pod(d.minDepthBounds);
+    W.pod(d.maxDepthBounds);
+
+    W.pod(x.inputAssemblyState.flags);
+    W.pod(x.inputAssemblyState.topology);
+    W.pod(x.inputAssemblyState.primitiveRestartEnable);
+
+    W.vec(x.dynamicStates);
+    W.vec(x.viewportState.viewports);
+    W.vec(x.viewportState.scissors);
+
+    W.pod(x.tessellation.flags);
+    W.pod(x.tessellation.patchControlPoints);
+
+    // the base pipeline is a handle, so a derivative is restored as a normal pipeline
+    W.pod( x.flags & ~vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eDerivative) );
+
+    // the formats are written for dynamic rendering, render passes are
+    // handles or descriptions which are written by the caller
+    auto rendering = std::get_if<PipelineRenderingCreateInfo2>(&x.renderPass);
+    W.pod( static_cast<uint8_t>(rendering != nullptr) );
+    if( rendering )
+        writeBinary(W, *rendering);
+}
+inline void readBinary(BinaryReader & R, GraphicsPipelineCreateInfo2 & x)
+{
+    x.stages.resize( R.count() );
+    for(auto & s : x.stages)
+    {
+        s.name  = R.str();
+        s.stage = R.pod<vk::ShaderStageFlagBits>();
+        s.specializationEntries.resize( R.count() );
+        for(auto & e : s.specializationEntries)
+        {
+            e.constantID = R.pod<uint32_t>();
+            e.offset     = R.pod<uint32_t>();
+            e.size       = R.pod<uint32_t>();
+        }
+        R.vec(s.specializationData);
+        for(auto & e : s.specializationEntries)
+            R.check( e.offset + e.size <= s.specializationData.size() );
+    }
+
+    R.vec(x.blendState.attachments);
+    x.blendState.flags         = R.pod<decltype(x.blendState.flags)>();
+    x.blendState.logicOpEnable = R.pod<decltype(x.blendState.logicOpEnable)>();
+    x.blendState.logicOp       = R.pod<decltype(x.blendState.logicOp)>();
+    for(auto & c : x.blendState.blendConstants)
+        c = R.pod<float>();
+
+    R.vec(x.vertexInputState.vertexBindingDescriptions);
+    R.vec(x.vertexInputState.vertexAttributeDescriptions);
+
+    auto & r = x.rasterizationState;
+    r.flags                   = R.pod<decltype(r.flags)>();
+    r.depthClampEnable        = R.pod<decltype(r.depthClampEnable)>();
+    r.rasterizerDiscardEnable = R.pod<decltype(r.rasterizerDiscardEnable)>();
+    r.polygonMode             = R.pod<decltype(r.polygonMode)>();
+    r.cullMode                = R.pod<decltype(r.cullMode)>();
+    r.frontFace               = R.pod<decltype(r.frontFace)>();
+    r.depthBiasEnable         = R.pod<decltype(r.depthBiasEnable)>();
+    r.depthBiasConstantFactor = R.pod<decltype(r.depthBiasConstantFactor)>();
+    r.depthBiasClamp          = R.pod<decltype(r.depthBiasClamp)>();
+    r.depthBiasSlopeFactor    = R.pod<decltype(r.depthBiasSlopeFactor)>();
+    r.lineWidth               = R.pod<decltype(r.lineWidth)>();
+
+    auto & m = x.multisampleState;
+    m.flags                 = R.pod<decltype(m.flags)>();
+    m.rasterizationSamples  = R.pod<decltype(m.rasterizationSamples)>();
+    m.sampleShadingEnable   = R.pod<decltype(m.sampleShadingEnable)>();
+    m.minSampleShading      = R.pod<decltype(m.minSampleShading)>();
+    m.alphaToCoverageEnable = R.pod<decltype(m.alphaToCoverageEnable)>();
+    m.alphaToOneEnable      = R.pod<decltype(m.alphaToOneEnable)>();
+
+    auto & d = x.depthStencilState;
+    d.flags                 = R.pod<decltype(d.flags)>();
+    d.depthTestEnable       = R.pod<decltype(d.depthTestEnable)>();
+    d.depthWriteEnable      = R.pod<decltype(d.depthWriteEnable)>();
+    d.depthCompareOp        = R.pod<decltype(d.depthCompareOp)>();
+    d.depthBoundsTestEnable = R.pod<decltype(d.depthBoundsTestEnable)>();
+    d.stencilTestEnable     = R.pod<decltype(d.stencilTestEnable)>();
+    d.front                 = R.pod<decltype(d.front)>();
+    d.back                  = R.pod<decltype(d.back)>();
+    d.minDepthBounds        = R.pod<decltype(d.minDepthBounds)>();
+    d.maxDepthBounds        = R.pod<decltype(d.maxDepthBounds)>();
+
+    x.inputAssemblyState.flags                  = R.pod<decltype(x.inputAssemblyState.flags)>();
+    x.inputAssemblyState.topology               = R.pod<decltype(x.inputAssemblyState.topology)>();
+    x.inputAssemblyState.primitiveRestartEnable = R.pod<decltype(x.inputAssemblyState.primitiveRestartEnable)>();
+
+    R.vec(x.dynamicStates);
+    R.vec(x.viewportState.viewports);
+    R.vec(x.viewportState.scissors);
+
+    x.tessellation.flags              = R.pod<decltype(x.tessellation.flags)>();
+    x.tessellation.patchControlPoints = R.pod<decltype(x.tessellation.patchControlPoints)>();
+
+    x.flags = R.pod<vk::PipelineCreateFlags>();
+
+    x.layout     = vk::PipelineLayout();
+    x.renderPass = vk::RenderPass();
+    if( R.pod<uint8_t>() )
+    {
+        PipelineRenderingCreateInfo2 rendering;
+        readBinary(R, rendering);
+        x.renderPass = std::move(rendering);
+    }
+}
+
+}
+
+#endif
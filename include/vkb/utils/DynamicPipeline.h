@@ -1,29 +1,212 @@
 #ifndef VKB_DYNAMICPIPELINE_H
 #define VKB_DYNAMICPIPELINE_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
 #include "../detail/PipelineCreateInfo2.h"
 
 namespace vkb
 {
 
+/**
+ * @brief The PipelineStateKey struct
+ *
+ * The state of a DynamicPipeline packed into a single 64-bit integer.
+ * Each field is described at compile time by its bit offset and width:
+ *
+ * vkb::PipelineStateKey K;
+ * K.set<vkb::PipelineStateKey::CullMode>( 2 );
+ * auto c = K.get<vkb::PipelineStateKey::CullMode>();
+ *
+ * The upper 32 bits hold the id of the states which do not fit into a
+ * few bits: the line width, the depth bias factors and the
+ * specialization constants.
+ */
+struct PipelineStateKey
+{
+    template<uint32_t Offset, uint32_t Bits>
+    struct Field
+    {
+        static constexpr uint32_t offset = Offset;
+        static constexpr uint32_t bits   = Bits;
+        static constexpr uint64_t mask   = ((uint64_t(1) << Bits) - 1) << Offset;
+    };
+
+    using Topology          = Field< 0, 4>;
+    using PrimitiveRestart  = Field< 4, 1>;
+    using PolygonMode       = Field< 5, 2>; // 3 if the mode is stored in Extra
+    using CullMode          = Field< 7, 2>;
+    using FrontFace         = Field< 9, 1>;
+    using DepthClamp        = Field<10, 1>;
+    using RasterizerDiscard = Field<11, 1>;
+    using DepthBias         = Field<12, 1>;
+    using Extra             = Field<32,32>;
+
+    uint64_t value = 0;
+
+    template<typename F>
+    static constexpr bool fits(uint64_t v)
+    {
+        return v <= (F::mask >> F::offset);
+    }
+
+    /**
+     * @brief set
+     * @param v
+     *
+     * Sets the field F to v. Throws if v does not fit into the field.
+     */
+    template<typename F>
+    PipelineStateKey& set(uint64_t v)
+    {
+        if( !fits<F>(v) )
+            throw std::runtime_error("The value does not fit into its field of the PipelineStateKey");
+        value = (value & ~F::mask) | (v << F::offset);
+        return *this;
+    }
+
+    template<typename F>
+    uint64_t get() const
+    {
+        return (value & F::mask) >> F::offset;
+    }
+
+    bool operator==(PipelineStateKey const & o) const
+    {
+        return value == o.value;
+    }
+    bool operator!=(PipelineStateKey const & o) const
+    {
+        return value != o.value;
+    }
+};
+
 struct DynamicPipeline
 {
     using value_type = std::tuple<vk::Pipeline, vk::PipelineLayout, vk::RenderPass>;
+
+    struct VariantStatistics
+    {
+        vk::Pipeline             pipeline;
+        vk::Pipeline             basePipeline;     // the parent, if it was created as a derivative
+        std::chrono::nanoseconds compileTime{0};   // time spent creating the pipeline
+        bool                     compiled = false; // false if the storage already held the pipeline
+    };
+
+    /**
+     * @brief The DynamicState struct
+     *
+     * The values recorded by recordDynamicState( ) when the cull mode,
+     * front face and topology are dynamic states, see init( ).
+     */
+    struct DynamicState
+    {
+        vk::CullModeFlags     cullMode;
+        vk::FrontFace         frontFace = vk::FrontFace::eCounterClockwise;
+        vk::PrimitiveTopology topology  = vk::PrimitiveTopology::eTriangleList;
+
+        bool operator==(DynamicState const & o) const
+        {
+            return cullMode == o.cullMode && frontFace == o.frontFace && topology == o.topology;
+        }
+        bool operator!=(DynamicState const & o) const
+        {
+            return !(*this == o);
+        }
+    };
+
+    /**
+     * @brief The CommandBufferState struct
+     *
+     * The dynamic state last recorded into a command buffer. Dynamic state
+     * belongs to the command buffer, so keep one of these per command buffer
+     * and pass it to the recordDynamicState( ) of every DynamicPipeline which
+     * records into it.
+     */
+    struct CommandBufferState
+    {
+        bool         valid = false;
+        DynamicState recorded;
+
+        // the next recordDynamicState( ) records every value. Call this when
+        // beginning the command buffer, or after binding a pipeline where
+        // these states are not dynamic.
+        void invalidate()
+        {
+            valid = false;
+        }
+    };
 protected:
+
+    // the states stored in PipelineStateKey::Extra
+    struct _Extra
+    {
+        vk::PipelineRasterizationStateCreateInfo               rasterizationState; // line width, depth bias factors and polygon mode
+        std::vector< std::vector<vk::SpecializationMapEntry> > specializationEntries; // per stage
+        std::vector< std::vector<uint8_t> >                    specializationData;
+    };
+
     vkb::GraphicsPipelineCreateInfo2 m_cci;
-    std::map< size_t, value_type >   m_pipelines;
+    vkb::GraphicsPipelineCreateInfo2 m_base; // the state given to init( ), the variants are unpacked from it
+    PipelineStateKey                 m_key;
+    bool                             m_dirty = false; // m_key must be packed from m_cci again
+
+    // the variants are kept in an insert-only open addressed table. The
+    // builder fills a free slot and then sets its ready flag, so readers
+    // only do acquire loads and never write to shared memory. Variants are
+    // not removed before destroy( ), so a slot never changes once it is ready.
+    struct _Slot
+    {
+        std::atomic<bool> ready{false};
+        uint64_t          key = 0;
+        value_type        value;
+    };
+    struct _Table
+    {
+        explicit _Table(size_t capacity) : mask(capacity - 1), slots(new _Slot[capacity])
+        {
+        }
+        size_t                   mask;  // the capacity is a power of two
+        std::unique_ptr<_Slot[]> slots;
+        size_t                   size = 0; // only used by the builder
+    };
+
+    // the table is replaced by one twice as large when it is half full.
+    // Readers may still be probing the old tables, so they are kept until
+    // destroy( ). Together they are smaller than the current table.
+    std::atomic< _Table* >                 m_table{nullptr};
+    std::vector< std::unique_ptr<_Table> > m_tables; // the last one is current
+    std::atomic<size_t>                    m_count{0};
+
+    // every distinct set of extra states is kept until destroy( ), so a
+    // stream of new line widths or specialization constants grows these
+    std::unordered_multimap< size_t, uint32_t > m_extraIds; // hash of the extra states -> PipelineStateKey::Extra
+    std::vector< _Extra >                       m_extras;   // indexed by PipelineStateKey::Extra
+    std::map< uint64_t, VariantStatistics >    m_statistics;
     vkb::Storage                    *m_storage = nullptr;
     vk::Device                       m_device;
+    bool                             m_extendedDynamicState = false;
+    bool                             m_derivatives = true;
 
 public:
     DynamicPipeline()
     {
+        _resetTable();
     }
 
+    DynamicPipeline(DynamicPipeline const &) = delete;
+    DynamicPipeline& operator=(DynamicPipeline const &) = delete;
+
     vkb::GraphicsPipelineCreateInfo2 const & currentCreateInfo() const
     {
         return m_cci;
@@ -32,71 +215,261 @@ public:
     // that have been created.
     size_t pipelineCount() const
     {
-        return m_pipelines.size();
+        return m_count.load(std::memory_order_relaxed);
     }
 
-    // destroy all pipelines that have been created
-    // renderpasses/layouts will not be destroyed
+    // release all pipelines that have been created. A pipeline
+    // is destroyed once no other user of the storage holds it.
+    // renderpasses/layouts will not be destroyed. No other
+    // thread may be calling get( ) at the same time.
     void destroy()
     {
-        for(auto &  x : m_pipelines)
+        std::lock_guard<std::mutex> L(_builder());
+        _forEachVariant([this](value_type const & v)
         {
-            m_device.destroyPipeline( std::get<0>( x.second ));
-        }
-        m_pipelines.clear();
+            m_storage->destroy( std::get<0>(v), m_device);
+        });
+        _resetTable();
+        m_statistics.clear();
+        m_extraIds.clear();
+        m_extras.clear();
+    }
+
+    /**
+     * @brief setDerivatives
+     * @param enabled
+     *
+     * Call before init( ). If enabled (the default), every pipeline is
+     * created with eAllowDerivatives, and each new variant is created as
+     * a derivative of the existing variant whose state is closest to it.
+     * Compare the statistics( ) with and without derivatives to see if
+     * the driver benefits from them.
+     */
+    void setDerivatives(bool enabled)
+    {
+        m_derivatives = enabled;
+    }
+
+    /**
+     * @brief statistics
+     * @return
+     *
+     * The statistics of each variant created by get( ) or init( ),
+     * keyed by the PipelineStateKey value of the variant. Not safe to
+     * read while other threads may be creating variants.
+     */
+    std::map< uint64_t, VariantStatistics > const & statistics() const
+    {
+        return m_statistics;
+    }
+
+    /**
+     * @brief key
+     * @return
+     *
+     * The key of the current state, which selects the pipeline
+     * returned by get( ). Pass it, or a key derived from it with the
+     * key overloads of the setters, to get(key) from other threads.
+     */
+    PipelineStateKey key()
+    {
+        _update();
+        return m_key;
     }
     /**
      * @brief init
      * @param S
      * @param C
      * @param device
+     * @param extendedDynamicState
      *
      * Initialize the DyamicPipeline with an initial state.
      *  This will compile the pipeline.
+     *
+     * If extendedDynamicState is true (the device must have the
+     * extendedDynamicState feature of VK_EXT_extended_dynamic_state enabled)
+     * the cull mode, front face and topology are dynamic states of the
+     * pipeline. Changing them does not create a new pipeline, they are
+     * recorded with recordDynamicState( ) instead. Only the topology class
+     * (points, lines, triangles or patches) selects the pipeline.
      */
-    void init(vkb::Storage * S, vkb::GraphicsPipelineCreateInfo2 const &C, vk::Device device)
+    void init(vkb::Storage * S, vkb::GraphicsPipelineCreateInfo2 const &C, vk::Device device, bool extendedDynamicState = false)
     {
         m_device  = device;
         m_storage = S;
+        m_extendedDynamicState = extendedDynamicState;
+
+        auto c = _static(C);
+        if( m_extendedDynamicState )
+        {
+            for(auto d : {vk::DynamicState::eCullModeEXT, vk::DynamicState::eFrontFaceEXT, vk::DynamicState::ePrimitiveTopologyEXT})
+            {
+                if( std::find(c.dynamicStates.begin(), c.dynamicStates.end(), d) == c.dynamicStates.end() )
+                    c.dynamicStates.push_back(d);
+            }
+        }
+
         // compile the initial pipeline.
-        auto p = C.create(*m_storage, device);
+        m_key   = _pack(c);
+        m_dirty = false;
+
+        std::lock_guard<std::mutex> L(_builder());
+        auto p = _create(c, m_key.value);
 
         m_cci     = m_storage->getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(p));
 
-        auto h = _hash(m_cci);
-        m_pipelines[h] = p;
+        // keep the dynamic values the caller asked for
+        m_cci.rasterizationState.cullMode  = C.rasterizationState.cullMode;
+        m_cci.rasterizationState.frontFace = C.rasterizationState.frontFace;
+        m_cci.inputAssemblyState.topology  = C.inputAssemblyState.topology;
+        m_cci.flags                        = C.flags;
+        m_cci.basePipelineHandle           = C.basePipelineHandle;
+        m_base = m_cci;
     }
 
+    /**
+     * @brief get
+     * @return
+     *
+     * Returns the pipeline for the current state, creating it if it
+     * does not exist yet. The setters update the key of the state as
+     * they are called, so this is a single integer lookup.
+     */
     value_type get()
     {
-        auto h = _hash(m_cci);
-        auto f = m_pipelines.find(h);
+        _update();
+        return get(m_key);
+    }
 
-        if( f == m_pipelines.end() )
-        {
-            auto p = m_cci.create(*m_storage, m_device);
+    /**
+     * @brief get
+     * @param k
+     * @return
+     *
+     * Returns the pipeline for the state k, creating it if it does not
+     * exist yet. This can be called from any number of threads at the
+     * same time, as long as no thread calls init( ) or destroy( ):
+     *
+     * auto k = dP.key();                          // on the main thread
+     * ...
+     * auto p = dP.get( dP.setCullMode(k, vk::CullModeFlagBits::eBack) );  // on a recording thread
+     *
+     * With the extended dynamic state, the cull mode, front face and
+     * topology are recorded instead, each thread passes its own values:
+     *
+     * auto k = dP.key();                          // on the main thread
+     * auto v = dP.dynamicState();
+     * ...
+     * v.cullMode = vk::CullModeFlagBits::eBack;   // on a recording thread
+     * auto p = dP.get(k);
+     * dP.recordDynamicState(cmd, cmdState, v, dld);
+     *
+     * Existing pipelines are found in an insert-only hash table without
+     * locking or writing to shared memory. New pipelines are created one
+     * at a time by a single builder shared by every DynamicPipeline, since
+     * the Storage is not thread safe. The table doubles when it is half
+     * full, so creating N variants takes O(N) time and memory.
+     */
+    value_type get(PipelineStateKey k)
+    {
+        if( auto v = _find( *m_table.load(std::memory_order_acquire), k.value) )
+            return *v;
 
-            m_cci     = m_storage->getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(p));
+        std::lock_guard<std::mutex> L(_builder());
 
-            m_pipelines[h] = p;
-            return p;
-        }
-        else
-        {
-            return f->second;
-        }
+        // another thread may have created it while we were waiting
+        if( auto v = _find( *m_table.load(std::memory_order_relaxed), k.value) )
+            return *v;
+
+        return _create(_unpack(k), k.value);
+    }
+
+    /**
+     * @brief extendedDynamicState
+     * @return
+     *
+     * Returns true if the cull mode, front face and topology are
+     * dynamic states, see init( ).
+     */
+    bool extendedDynamicState() const
+    {
+        return m_extendedDynamicState;
+    }
+
+    /**
+     * @brief dynamicState
+     * @return
+     *
+     * The cull mode, front face and topology of the current state. With
+     * the extended dynamic state they are not part of key( ), so read them
+     * together with the key and give them to recordDynamicState( ).
+     */
+    DynamicState dynamicState() const
+    {
+        DynamicState v;
+        v.cullMode  = m_cci.rasterizationState.cullMode;
+        v.frontFace = m_cci.rasterizationState.frontFace;
+        v.topology  = m_cci.inputAssemblyState.topology;
+        return v;
     }
 
+    /**
+     * @brief recordDynamicState
+     * @param cmd
+     * @param state - what has already been recorded into cmd
+     * @param values - the values to record
+     * @param d - the dispatcher used to call the commands
+     *
+     * Records the cull mode, front face and topology into the command buffer
+     * with setCullModeEXT( ), setFrontFaceEXT( ) and setPrimitiveTopologyEXT( ).
+     * Only the values which differ from state are recorded, and state is
+     * updated. Does nothing unless extendedDynamicState was given to init( ).
+     * The values are given by the caller, so this can be called from any
+     * number of threads, each recording its own command buffer.
+     *
+     * The loader does not export extension commands, so unless the default
+     * dispatcher is a vk::DispatchLoaderDynamic, pass one which has been
+     * initialized with the device:
+     *
+     * vk::DispatchLoaderDynamic dld(instance, vkGetInstanceProcAddr, device);
+     * vkb::DynamicPipeline::CommandBufferState state; // one per command buffer
+     *
+     * auto [pipeline, layout, renderPass] = dP.get();
+     * cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+     * dP.recordDynamicState(cmd, state, dP.dynamicState(), dld);
+     */
+    template<typename CommandBuffer_t, typename Dispatch_t = VULKAN_HPP_DEFAULT_DISPATCHER_TYPE>
+    void recordDynamicState(CommandBuffer_t & cmd, CommandBufferState & state, DynamicState const & values,
+                            Dispatch_t const & d = VULKAN_HPP_DEFAULT_DISPATCHER) const
+    {
+        if( !m_extendedDynamicState )
+            return;
+
+        auto & r = state.recorded;
+        if( !state.valid || r.cullMode != values.cullMode )
+            cmd.setCullModeEXT(values.cullMode, d);
+        if( !state.valid || r.frontFace != values.frontFace )
+            cmd.setFrontFaceEXT(values.frontFace, d);
+        if( !state.valid || r.topology != values.topology )
+            cmd.setPrimitiveTopologyEXT(values.topology, d);
+
+        state.valid = true;
+        r           = values;
+    }
 
     //==============================================================
-    // the properties of thes can be modified
+    // the properties of thes can be modified. The key is packed
+    // again at the next get( ), so call these again after get( )
+    // instead of holding on to the reference.
     //==============================================================
     vk::PipelineInputAssemblyStateCreateInfo& getInputAssemblyState()
     {
+        m_dirty = true;
         return m_cci.inputAssemblyState;
     }
     vk::PipelineRasterizationStateCreateInfo& getRasterizationState()
     {
+        m_dirty = true;
         return m_cci.rasterizationState;
     }
 
@@ -107,34 +480,443 @@ public:
     void setTopology( vk::PrimitiveTopology p )
     {
         m_cci.inputAssemblyState.setTopology(p);
+        m_key = setTopology(m_key, p);
     }
     void setCullMode( vk::CullModeFlags p )
     {
         m_cci.rasterizationState.setCullMode(p);
+        m_key = setCullMode(m_key, p);
     }
     void setFrontFace( vk::FrontFace p )
     {
         m_cci.rasterizationState.setFrontFace(p);
+        m_key = setFrontFace(m_key, p);
     }
     void setPolygonMode( vk::PolygonMode p )
     {
         m_cci.rasterizationState.setPolygonMode(p);
+        if( PipelineStateKey::fits<PipelineStateKey::PolygonMode>( static_cast<uint64_t>(p) ) && m_key.get<PipelineStateKey::PolygonMode>() != 3 )
+            m_key = setPolygonMode(m_key, p);
+        else
+            m_dirty = true; // the mode is stored in the extra states
+    }
+
+    //==============================================================
+    // the same helpers for keys, these do not change the
+    // current state and can be called from any thread. With the
+    // extended dynamic state the cull mode, front face and exact
+    // topology are not part of the key, so these only keep the
+    // topology class. Record the values with recordDynamicState( ).
+    //==============================================================
+    PipelineStateKey setTopology( PipelineStateKey k, vk::PrimitiveTopology p ) const
+    {
+        return k.set<PipelineStateKey::Topology>( static_cast<uint64_t>( m_extendedDynamicState ? _topologyClass(p) : p) );
+    }
+    PipelineStateKey setCullMode( PipelineStateKey k, vk::CullModeFlags p ) const
+    {
+        if( !m_extendedDynamicState )
+            k.set<PipelineStateKey::CullMode>( static_cast<vk::CullModeFlags::MaskType>(p) );
+        return k;
+    }
+    PipelineStateKey setFrontFace( PipelineStateKey k, vk::FrontFace p ) const
+    {
+        if( !m_extendedDynamicState )
+            k.set<PipelineStateKey::FrontFace>( static_cast<uint64_t>(p) );
+        return k;
+    }
+    // throws if the mode does not fit into the key, eg: eFillRectangleNV
+    PipelineStateKey setPolygonMode( PipelineStateKey k, vk::PolygonMode p ) const
+    {
+        if( static_cast<uint64_t>(p) == 3 )
+            throw std::runtime_error("The polygon mode does not fit into the PipelineStateKey");
+        return k.set<PipelineStateKey::PolygonMode>( static_cast<uint64_t>(p) );
+    }
+
+    /**
+     * @brief setSpecializationConstant
+     * @param stages
+     * @param constantID
+     * @param value
+     *
+     * Sets a specialization constant of every shader stage in stages.
+     * Each set of values selects its own pipeline. Throws if the pipeline
+     * has none of the stages.
+     */
+    template<typename T>
+    void setSpecializationConstant( vk::ShaderStageFlags stages, uint32_t constantID, T value)
+    {
+        bool found = false;
+        for(auto & s : m_cci.stages)
+        {
+            if( stages & s.stage )
+            {
+                s.setSpecializationConstant(constantID, value);
+                found = true;
+            }
+        }
+        if( !found )
+            throw std::runtime_error("The pipeline has none of the shader stages the specialization constant is set for");
+        m_dirty = true;
     }
 
 protected:
-    // calcualte the hash based on the rasterization staate
-    // and the input assembly.
-    static size_t _hash(vkb::GraphicsPipelineCreateInfo2 const & C)
+    void _update()
+    {
+        if( m_dirty )
+        {
+            m_key   = _pack(m_cci);
+            m_dirty = false;
+        }
+    }
+
+    // packs the rasterization state, the input assembly
+    // and the specialization constants into the key
+    PipelineStateKey _pack(vkb::GraphicsPipelineCreateInfo2 const & C)
     {
+        using K = PipelineStateKey;
+
+        auto r  = C.rasterizationState;
+        auto ia = C.inputAssemblyState;
+        _staticState(r, ia);
+
+        auto polygonMode = static_cast<uint64_t>(r.polygonMode);
+        bool packed      = K::fits<K::PolygonMode>(polygonMode) && polygonMode != 3;
+
+        K k;
+        k.set<K::Topology>(         static_cast<uint64_t>(ia.topology) )
+         .set<K::PrimitiveRestart>( ia.primitiveRestartEnable ? 1 : 0 )
+         .set<K::PolygonMode>(      packed ? polygonMode : 3 )
+         .set<K::CullMode>(         static_cast<vk::CullModeFlags::MaskType>(r.cullMode) )
+         .set<K::FrontFace>(        static_cast<uint64_t>(r.frontFace) )
+         .set<K::DepthClamp>(       r.depthClampEnable ? 1 : 0 )
+         .set<K::RasterizerDiscard>(r.rasterizerDiscardEnable ? 1 : 0 )
+         .set<K::DepthBias>(        r.depthBiasEnable ? 1 : 0 );
+
+        // the states which do not fit into a few bits are
+        // hashed and replaced by a small id.
         size_t seed = 0x9e3779b9;
+        hash_c(seed, r.lineWidth);
+        hash_c(seed, r.depthBiasConstantFactor);
+        hash_c(seed, r.depthBiasClamp);
+        hash_c(seed, r.depthBiasSlopeFactor);
+        if( !packed )
+            hash_c(seed, polygonMode);
 
-        hash_c(seed, hash_pod(C.rasterizationState));
-        hash_c(seed, hash_pod(C.inputAssemblyState));
+        // only the constants, the modules are not created
+        // yet when init( ) packs the first key
+        for(auto & s : C.stages)
+        {
+            if( !s.specializationEntries.empty() )
+                hash_c(seed, hash_e(s.stage));
+            for(auto & e : s.specializationEntries)
+            {
+                hash_c(seed, e.constantID);
+                hash_c(seed, e.size);
+            }
+            for(auto b : s.specializationData)
+                hash_c(seed, b);
+        }
 
-        return seed;
+        k.set<K::Extra>( _intern(seed, C, packed) );
+        return k;
     }
 
+    // the id of the extra states of C, whose hash is h. Different states
+    // with the same hash are compared in full and get their own ids.
+    uint32_t _intern(size_t h, vkb::GraphicsPipelineCreateInfo2 const & C, bool packedPolygonMode)
+    {
+        _Extra e;
+        e.rasterizationState = C.rasterizationState;
+        if( packedPolygonMode )
+            e.rasterizationState.polygonMode = vk::PolygonMode::eFill; // it is in the key instead
+        for(auto & s : C.stages)
+        {
+            e.specializationEntries.push_back(s.specializationEntries);
+            e.specializationData.push_back(s.specializationData);
+        }
+
+        std::lock_guard<std::mutex> L(_builder());
+
+        auto r = m_extraIds.equal_range(h);
+        for(auto i = r.first; i != r.second; ++i)
+        {
+            if( _sameExtra(m_extras[i->second], e) )
+                return i->second;
+        }
+
+        auto id = static_cast<uint32_t>(m_extras.size());
+        m_extras.push_back( std::move(e) );
+        m_extraIds.emplace(h, id);
+        return id;
+    }
 
+    // compares the states which are hashed by _pack( )
+    static bool _sameExtra(_Extra const & a, _Extra const & b)
+    {
+        auto & x = a.rasterizationState;
+        auto & y = b.rasterizationState;
+        if( x.lineWidth               != y.lineWidth ||
+            x.depthBiasConstantFactor != y.depthBiasConstantFactor ||
+            x.depthBiasClamp          != y.depthBiasClamp ||
+            x.depthBiasSlopeFactor    != y.depthBiasSlopeFactor ||
+            x.polygonMode             != y.polygonMode )
+            return false;
+
+        if( a.specializationData != b.specializationData ||
+            a.specializationEntries.size() != b.specializationEntries.size() )
+            return false;
+        for(size_t i=0;i<a.specializationEntries.size();i++)
+        {
+            auto & u = a.specializationEntries[i];
+            auto & v = b.specializationEntries[i];
+            if( !std::equal(u.begin(), u.end(), v.begin(), v.end(), [](vk::SpecializationMapEntry const & p, vk::SpecializationMapEntry const & q)
+                {
+                    return p.constantID == q.constantID && p.offset == q.offset && p.size == q.size;
+                }) )
+                return false;
+        }
+        return true;
+    }
+
+    // the create info for the state k, the builder must be locked
+    vkb::GraphicsPipelineCreateInfo2 _unpack(PipelineStateKey k) const
+    {
+        using K = PipelineStateKey;
+
+        if( k.get<K::Extra>() >= m_extras.size() )
+            throw std::runtime_error("The PipelineStateKey was not created by this DynamicPipeline");
+        auto & e = m_extras[ k.get<K::Extra>() ];
+
+        auto c   = m_base;
+        auto & r  = c.rasterizationState;
+        auto & ia = c.inputAssemblyState;
+
+        ia.topology                = static_cast<vk::PrimitiveTopology>( k.get<K::Topology>() );
+        ia.primitiveRestartEnable  = static_cast<vk::Bool32>( k.get<K::PrimitiveRestart>() );
+        r.polygonMode              = k.get<K::PolygonMode>() == 3 ? e.rasterizationState.polygonMode
+                                                                  : static_cast<vk::PolygonMode>( k.get<K::PolygonMode>() );
+        r.cullMode                 = static_cast<vk::CullModeFlagBits>( k.get<K::CullMode>() );
+        r.frontFace                = static_cast<vk::FrontFace>( k.get<K::FrontFace>() );
+        r.depthClampEnable         = static_cast<vk::Bool32>( k.get<K::DepthClamp>() );
+        r.rasterizerDiscardEnable  = static_cast<vk::Bool32>( k.get<K::RasterizerDiscard>() );
+        r.depthBiasEnable          = static_cast<vk::Bool32>( k.get<K::DepthBias>() );
+        r.lineWidth                = e.rasterizationState.lineWidth;
+        r.depthBiasConstantFactor  = e.rasterizationState.depthBiasConstantFactor;
+        r.depthBiasClamp           = e.rasterizationState.depthBiasClamp;
+        r.depthBiasSlopeFactor     = e.rasterizationState.depthBiasSlopeFactor;
+
+        for(size_t i=0; i<c.stages.size() && i<e.specializationEntries.size(); i++)
+        {
+            c.stages[i].specializationEntries = e.specializationEntries[i];
+            c.stages[i].specializationData    = e.specializationData[i];
+        }
+        return _static(c);
+    }
+
+    // mixes the bits of the key, the fields are in the low bits
+    // and the id of the extra states is in the high bits
+    static size_t _slotIndex(uint64_t k)
+    {
+        k ^= k >> 30;
+        k *= 0xbf58476d1ce4e5b9ull;
+        k ^= k >> 27;
+        k *= 0x94d049bb133111ebull;
+        k ^= k >> 31;
+        return static_cast<size_t>(k);
+    }
+
+    // the variant with the key k, or nullptr. The table is at most
+    // half full, so the probe always ends at an empty slot
+    static value_type const * _find(_Table const & t, uint64_t k)
+    {
+        for(size_t i = _slotIndex(k) & t.mask; ; i = (i + 1) & t.mask)
+        {
+            auto & s = t.slots[i];
+            if( !s.ready.load(std::memory_order_acquire) )
+                return nullptr;
+            if( s.key == k )
+                return &s.value;
+        }
+    }
+
+    // the builder must be locked
+    static void _insert(_Table & t, uint64_t k, value_type const & v)
+    {
+        size_t i = _slotIndex(k) & t.mask;
+        while( t.slots[i].ready.load(std::memory_order_relaxed) )
+            i = (i + 1) & t.mask;
+
+        auto & s = t.slots[i];
+        s.key   = k;
+        s.value = v;
+        s.ready.store(true, std::memory_order_release);
+        t.size++;
+    }
+
+    // makes the variant visible to get( ), the builder must be locked
+    void _publish(uint64_t k, value_type const & v)
+    {
+        auto t = m_table.load(std::memory_order_relaxed);
+        if( (t->size + 1) * 2 > t->mask + 1 )
+        {
+            auto n = std::make_unique<_Table>( (t->mask + 1) * 2 );
+            for(size_t i=0; i<=t->mask; i++)
+            {
+                if( t->slots[i].ready.load(std::memory_order_relaxed) )
+                    _insert(*n, t->slots[i].key, t->slots[i].value);
+            }
+            t = n.get();
+            m_tables.push_back( std::move(n) );
+            m_table.store(t, std::memory_order_release);
+        }
+        _insert(*t, k, v);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // replaces all the tables with an empty one, no other
+    // thread may be calling get( )
+    void _resetTable()
+    {
+        m_tables.clear();
+        m_tables.push_back( std::make_unique<_Table>(16) );
+        m_table.store(m_tables.back().get(), std::memory_order_release);
+        m_count.store(0, std::memory_order_relaxed);
+    }
+
+    // calls f for every variant, the builder must be locked
+    template<typename Callable_t>
+    void _forEachVariant(Callable_t && f) const
+    {
+        auto t = m_table.load(std::memory_order_relaxed);
+        for(size_t i=0; i<=t->mask; i++)
+        {
+            if( t->slots[i].ready.load(std::memory_order_relaxed) )
+                f( t->slots[i].value );
+        }
+    }
+
+    // every DynamicPipeline creates its variants through the same
+    // builder, since they may share the Storage
+    static std::mutex & _builder()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    // creates the variant, as a derivative of the closest existing
+    // variant if derivatives are enabled, records its statistics and
+    // publishes it. The builder must be locked
+    value_type _create(vkb::GraphicsPipelineCreateInfo2 c, uint64_t h)
+    {
+        c.flags &= ~vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eDerivative);
+        c.basePipelineHandle = vk::Pipeline();
+        if( m_derivatives )
+        {
+            c.flags |= vk::PipelineCreateFlagBits::eAllowDerivatives;
+            c.basePipelineHandle = _closestBase(c);
+            if( c.basePipelineHandle )
+                c.flags |= vk::PipelineCreateFlagBits::eDerivative;
+        }
+
+        // variants are shared with every other user of the storage. create( )
+        // adds a reference when it returns an existing pipeline, so destroy( )
+        // only releases this DynamicPipeline's references.
+        auto count = m_storage->pipelines.size();
+        auto t0    = std::chrono::steady_clock::now();
+        auto p     = c.create(*m_storage, m_device);
+        auto t1    = std::chrono::steady_clock::now();
+
+        auto & st   = m_statistics[h];
+        st.pipeline = std::get<0>(p);
+        st.compiled = m_storage->pipelines.size() != count;
+        if( st.compiled )
+        {
+            st.basePipeline = c.basePipelineHandle;
+            st.compileTime  = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0);
+        }
+
+        _publish(h, p);
+        return p;
+    }
+
+    // the existing variant which allows derivatives and
+    // differs from c in the fewest states
+    vk::Pipeline _closestBase(vkb::GraphicsPipelineCreateInfo2 const & c) const
+    {
+        vk::Pipeline base;
+        size_t       best = std::numeric_limits<size_t>::max();
+        _forEachVariant([&](value_type const & v)
+        {
+            auto p = std::get<0>(v);
+            auto b = m_storage->tryGetCreateInfo<vkb::GraphicsPipelineCreateInfo2>(p);
+            if( !b || !(b->flags & vk::PipelineCreateFlagBits::eAllowDerivatives) )
+                return;
+            auto d = _distance(*b, c);
+            if( d < best )
+            {
+                best = d;
+                base = p;
+            }
+        });
+        return base;
+    }
+
+    static size_t _distance(vkb::GraphicsPipelineCreateInfo2 const & a, vkb::GraphicsPipelineCreateInfo2 const & b)
+    {
+        auto & x = a.rasterizationState;
+        auto & y = b.rasterizationState;
+
+        size_t d = 0;
+        d += x.depthClampEnable        != y.depthClampEnable;
+        d += x.rasterizerDiscardEnable != y.rasterizerDiscardEnable;
+        d += x.polygonMode             != y.polygonMode;
+        d += x.cullMode                != y.cullMode;
+        d += x.frontFace               != y.frontFace;
+        d += x.depthBiasEnable         != y.depthBiasEnable;
+        d += x.lineWidth               != y.lineWidth;
+        d += a.inputAssemblyState.topology               != b.inputAssemblyState.topology;
+        d += a.inputAssemblyState.primitiveRestartEnable != b.inputAssemblyState.primitiveRestartEnable;
+        for(size_t i=0; i<a.stages.size() && i<b.stages.size(); i++)
+            d += a.stages[i].specializationData != b.stages[i].specializationData;
+        return d;
+    }
+
+    // the create info with the dynamic states replaced by fixed values,
+    // so that it is the same for every value of the dynamic states
+    vkb::GraphicsPipelineCreateInfo2 _static(vkb::GraphicsPipelineCreateInfo2 C) const
+    {
+        _staticState(C.rasterizationState, C.inputAssemblyState);
+        return C;
+    }
+
+    void _staticState(vk::PipelineRasterizationStateCreateInfo & r, vk::PipelineInputAssemblyStateCreateInfo & ia) const
+    {
+        if( !m_extendedDynamicState )
+            return;
+        r.cullMode  = vk::CullModeFlagBits::eNone;
+        r.frontFace = vk::FrontFace::eCounterClockwise;
+        ia.topology = _topologyClass(ia.topology);
+    }
+
+    // without dynamicPrimitiveTopologyUnrestricted, the dynamic topology
+    // must be of the same class as the pipeline's topology
+    static vk::PrimitiveTopology _topologyClass(vk::PrimitiveTopology t)
+    {
+        switch(t)
+        {
+            case vk::PrimitiveTopology::ePointList:
+                return vk::PrimitiveTopology::ePointList;
+            case vk::PrimitiveTopology::eLineList:
+            case vk::PrimitiveTopology::eLineStrip:
+            case vk::PrimitiveTopology::eLineListWithAdjacency:
+            case vk::PrimitiveTopology::eLineStripWithAdjacency:
+                return vk::PrimitiveTopology::eLineList;
+            case vk::PrimitiveTopology::ePatchList:
+                return vk::PrimitiveTopology::ePatchList;
+            default:
+                return vk::PrimitiveTopology::eTriangleList;
+        }
+    }
 
 };
 
@@ -0,0 +1,291 @@
+#ifndef VKB_MEMORYALIASINGPLANNER_H
+#define VKB_MEMORYALIASINGPLANNER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkb
+{
+
+/**
+ * @brief The MemoryAliasingPlanner struct
+ *
+ * Plans how transient resources (render targets, scratch buffers, etc)
+ * can share vk::DeviceMemory blocks. Each resource is given its memory
+ * requirements and the interval [firstUse, lastUse] in which it is
+ * used. Resources whose intervals do not overlap may occupy the same
+ * memory.
+ *
+ * The planner does not create any vulkan objects.
+ *
+ * vkb::MemoryAliasingPlanner P;
+ *
+ * auto gbuffer = P.addResource( device.getImageMemoryRequirements(gbufferImage), 0, 1);
+ * auto hdr     = P.addResource( device.getImageMemoryRequirements(hdrImage),     1, 2);
+ * auto bloom   = P.addResource( device.getImageMemoryRequirements(bloomImage),   2, 3);
+ *
+ * auto plan = P.plan();
+ *
+ * // allocate plan.blocks[i].size bytes for each block and bind
+ * // each resource at plan.placements[r].offset of block plan.placements[r].block
+ *
+ * Resources are placed largest first. A resource is placed at the lowest
+ * offset of the first compatible block where it does not overlap any
+ * resource with an overlapping lifetime. If no such block exists, a new
+ * block is created. When all resources are the same size this is
+ * greedy interval-graph coloring, where each block/offset is a colour.
+ */
+struct MemoryAliasingPlanner
+{
+    struct Resource
+    {
+        vk::MemoryRequirements requirements;
+        uint32_t               firstUse = 0;
+        uint32_t               lastUse  = 0;
+        bool                   linear   = true; // buffers and linear images. Optimal images must set this to false
+    };
+
+    struct Placement
+    {
+        uint32_t       block  = 0;
+        vk::DeviceSize offset = 0;
+    };
+
+    struct Block
+    {
+        vk::DeviceSize      size           = 0;
+        vk::DeviceSize      alignment      = 1;
+        uint32_t            memoryTypeBits = ~0u; // the memory types which all resources in the block support
+        std::vector<size_t> resources;            // index of the resources placed in this block
+    };
+
+    struct Plan
+    {
+        std::vector<Block>     blocks;
+        std::vector<Placement> placements;    // one per resource, in the order they were added
+        vk::DeviceSize         totalSize = 0; // sum of all block sizes
+        vk::DeviceSize         unaliasedSize = 0; // total size if each resource had its own allocation
+
+        vk::DeviceSize bytesSaved() const
+        {
+            return unaliasedSize - totalSize;
+        }
+    };
+
+    std::vector<Resource> resources;
+
+    // the bufferImageGranularity from the physical device limits.
+    // linear and optimal resources which are alive at the same time
+    // are never placed in the same page
+    vk::DeviceSize bufferImageGranularity = 1;
+
+    //=========================================================================
+    // Helper functions
+    //=========================================================================
+    /**
+     * @brief addResource
+     * @param requirements
+     * @param firstUse
+     * @param lastUse
+     * @param linear
+     * @return the index of the resource
+     *
+     * Adds a resource which is used from firstUse to lastUse, inclusive.
+     * The units are arbitrary (eg: pass index).
+     */
+    size_t addResource(vk::MemoryRequirements const & requirements, uint32_t firstUse, uint32_t lastUse, bool linear = true)
+    {
+        if( lastUse < firstUse )
+            throw std::runtime_error("Resource lastUse must not be less than firstUse");
+
+        auto & r        = resources.emplace_back();
+        r.requirements  = requirements;
+        r.firstUse      = firstUse;
+        r.lastUse       = lastUse;
+        r.linear        = linear;
+        return resources.size()-1;
+    }
+
+    /**
+     * @brief plan
+     * @return
+     *
+     * Assigns each resource a block and an offset within that block.
+     */
+    Plan plan() const
+    {
+        Plan out;
+        out.placements.resize(resources.size());
+
+        std::vector<size_t> order(resources.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+        {
+            auto & A = resources[a];
+            auto & B = resources[b];
+            if( A.requirements.size != B.requirements.size )
+                return A.requirements.size > B.requirements.size;
+            return A.firstUse < B.firstUse;
+        });
+
+        for(auto i : order)
+        {
+            auto & r = resources[i];
+            out.unaliasedSize += r.requirements.size;
+
+            bool placed = false;
+            for(uint32_t b=0; b<out.blocks.size() && !placed; b++)
+            {
+                auto & B = out.blocks[b];
+                if( (B.memoryTypeBits & r.requirements.memoryTypeBits) == 0 )
+                    continue;
+
+                vk::DeviceSize offset;
+                if( !_findOffset(out, B, i, offset) )
+                    continue;
+
+                B.memoryTypeBits &= r.requirements.memoryTypeBits;
+                B.alignment       = std::max(B.alignment, _alignment(r));
+                B.resources.push_back(i);
+                out.placements[i] = {b, offset};
+                placed = true;
+            }
+
+            if( !placed )
+            {
+                auto & B          = out.blocks.emplace_back();
+                B.size            = r.requirements.size;
+                B.alignment       = _alignment(r);
+                B.memoryTypeBits  = r.requirements.memoryTypeBits;
+                B.resources.push_back(i);
+                out.placements[i] = {static_cast<uint32_t>(out.blocks.size()-1), 0};
+            }
+        }
+
+        for(auto & B : out.blocks)
+            out.totalSize += B.size;
+
+        return out;
+    }
+
+    /**
+     * @brief isValid
+     * @param P
+     * @return
+     *
+     * Returns true if no two resources with overlapping lifetimes
+     * overlap in memory and each resource is correctly aligned and
+     * fits in its block.
+     */
+    bool isValid(Plan const & P) const
+    {
+        if( P.placements.size() != resources.size() )
+            return false;
+
+        for(size_t i=0;i<resources.size();i++)
+        {
+            auto & r = resources[i];
+            auto & p = P.placements[i];
+            if( p.block >= P.blocks.size() )
+                return false;
+            auto & B = P.blocks[p.block];
+            if( p.offset % _alignment(r) != 0 )
+                return false;
+            if( p.offset + r.requirements.size > B.size )
+                return false;
+            if( (B.memoryTypeBits & r.requirements.memoryTypeBits) == 0 )
+                return false;
+
+            for(size_t j=i+1;j<resources.size();j++)
+            {
+                if( P.placements[j].block != p.block )
+                    continue;
+                if( !_livesOverlap(r, resources[j]) )
+                    continue;
+                auto range = _range(j, P.placements[j].offset, r.linear);
+                if( p.offset < range.second && range.first < p.offset + r.requirements.size )
+                    return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    static bool _livesOverlap(Resource const & a, Resource const & b)
+    {
+        return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+    }
+
+    static vk::DeviceSize _alignUp(vk::DeviceSize x, vk::DeviceSize a)
+    {
+        return (x + a - 1) / a * a;
+    }
+
+    static vk::DeviceSize _alignment(Resource const & r)
+    {
+        return std::max<vk::DeviceSize>(1, r.requirements.alignment);
+    }
+
+    /**
+     * @brief _range
+     *
+     * Returns the memory range occupied by resource j placed at offset
+     * as seen by a resource which is linear/non-linear. If the two
+     * differ, the range is expanded to the bufferImageGranularity.
+     */
+    std::pair<vk::DeviceSize, vk::DeviceSize> _range(size_t j, vk::DeviceSize offset, bool linear) const
+    {
+        auto & o   = resources[j];
+        auto begin = offset;
+        auto end   = offset + o.requirements.size;
+        if( o.linear != linear && bufferImageGranularity > 1)
+        {
+            begin = begin / bufferImageGranularity * bufferImageGranularity;
+            end   = _alignUp(end, bufferImageGranularity);
+        }
+        return {begin, end};
+    }
+
+    /**
+     * @brief _findOffset
+     *
+     * Finds the lowest aligned offset in block B where resource i does
+     * not overlap any resource which is alive at the same time.
+     */
+    bool _findOffset(Plan const & P, Block const & B, size_t i, vk::DeviceSize & offset) const
+    {
+        auto & r = resources[i];
+
+        std::vector< std::pair<vk::DeviceSize, vk::DeviceSize> > occupied;
+        for(auto j : B.resources)
+        {
+            if( _livesOverlap(r, resources[j]) )
+                occupied.push_back( _range(j, P.placements[j].offset, r.linear) );
+        }
+        std::sort(occupied.begin(), occupied.end());
+
+        vk::DeviceSize candidate = 0;
+        for(auto & o : occupied)
+        {
+            if( candidate + r.requirements.size <= o.first )
+                break;
+            candidate = std::max(candidate, _alignUp(o.second, _alignment(r)));
+        }
+
+        if( candidate + r.requirements.size > B.size )
+            return false;
+
+        offset = candidate;
+        return true;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,529 @@
+#ifndef VKB_PIPELINEARCHIVE_H
+#define VKB_PIPELINEARCHIVE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BinaryEncoding.h"
+
+#if defined(_WIN32)
+    // files are read into memory
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace vkb
+{
+
+/**
+ * @brief The PipelineArchive struct
+ *
+ * A single file which holds SPIR-V blobs, graphics pipeline descriptions
+ * which use them and, optionally, a pipeline cache. Use
+ * PipelineArchive::Builder to write the file:
+ *
+ * vkb::PipelineArchive::Builder B;
+ * B.addPipeline("gbuffer", gbufferPipelineCreateInfo); // stages must have code
+ * B.addPipeline("shadow",  shadowPipelineCreateInfo);
+ * B.setPipelineCache( pipelineCacheData );
+ * B.writeFile("pipelines.vkba");
+ *
+ * At run time the file is memory mapped and nothing is read until it is
+ * needed. Shader modules are created directly from the mapped pages:
+ *
+ * auto A    = vkb::PipelineArchive::open("pipelines.vkba");
+ * auto info = A.getPipeline("gbuffer", S, device); // creates the shader modules
+ * auto [pipeline, layout, renderPass] = info.create(S, device);
+ *
+ * The shader module create infos kept in the Storage point into the
+ * archive, so the archive should stay open while they may be read
+ * (eg: by vkb::StorageSnapshot::capture).
+ *
+ * File layout, all offsets are from the start of the file and all
+ * sections are 8 byte aligned. Values are in the byte order of the
+ * host which wrote the file.
+ *
+ *    Header
+ *    Entry[shaderCount]    sorted by key (content hash of the SPIR-V)
+ *    Entry[pipelineCount]  sorted by key (hash of the pipeline name)
+ *    SPIR-V blobs
+ *    pipeline records
+ *    pipeline cache
+ */
+struct PipelineArchive
+{
+    static constexpr uint32_t magic   = 0x41424B56; // "VKBA"
+    static constexpr uint32_t version = 4;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t shaderCount;
+        uint32_t pipelineCount;
+        uint64_t shaderIndexOffset;
+        uint64_t pipelineIndexOffset;
+        uint64_t pipelineCacheOffset;
+        uint64_t pipelineCacheSize;
+        uint64_t fileSize;
+        uint64_t reserved;
+    };
+
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t offset;
+        uint64_t size; // in bytes
+    };
+
+    /**
+     * @brief The Builder struct
+     *
+     * Collects shaders and pipelines and writes the archive. Identical
+     * SPIR-V used by multiple pipelines is only stored once.
+     */
+    struct Builder
+    {
+        /**
+         * @brief addShader
+         * @param code
+         * @return the key of the shader in the archive
+         */
+        uint64_t addShader(std::vector<uint32_t> const & code)
+        {
+            auto key = contentHash(code.data(), code.size() * sizeof(uint32_t));
+
+            auto f = m_shaders.find(key);
+            if( f == m_shaders.end() )
+                m_shaders.emplace(key, code);
+            else if( f->second != code )
+                throw std::runtime_error("Two different shaders have the same content hash");
+            return key;
+        }
+
+        /**
+         * @brief addPipeline
+         * @param name
+         * @param info
+         *
+         * Adds a pipeline to the archive. Handles cannot be stored, so
+         * each stage must provide its SPIR-V code, the layout must be a
+         * PipelineLayoutCreateInfo2 which uses setLayoutsDescriptions and
+         * the renderPass must be a RenderPassCreateInfo2 or a
+         * PipelineRenderingCreateInfo2.
+         */
+        void addPipeline(std::string const & name, GraphicsPipelineCreateInfo2 const & info)
+        {
+            auto key = contentHash(name.data(), name.size());
+            if( m_pipelines.count(key) )
+                throw std::runtime_error("A pipeline named " + name + " (or with the same hash) is already in the archive");
+
+            auto layout     = std::get_if<PipelineLayoutCreateInfo2>(&info.layout);
+            auto renderPass = std::get_if<RenderPassCreateInfo2>(&info.renderPass);
+            if( layout == nullptr || !layout->setLayouts.empty() )
+                throw std::runtime_error("Archived pipelines must describe their layout using PipelineLayoutCreateInfo2::setLayoutsDescriptions");
+            if( renderPass == nullptr && !std::holds_alternative<PipelineRenderingCreateInfo2>(info.renderPass) )
+                throw std::runtime_error("Archived pipelines must describe their renderpass using RenderPassCreateInfo2 or PipelineRenderingCreateInfo2");
+
+            std::vector<uint64_t> shaders;
+            for(auto & s : info.stages)
+            {
+                if( s.code.empty() )
+                    throw std::runtime_error("Archived pipelines must provide the SPIR-V code for each stage");
+                shaders.push_back( addShader(s.code) );
+            }
+
+            BinaryWriter W;
+            W.str(name);
+            writeBinary(W, info);
+            W.vec(shaders);
+            W.vec(layout->pushConstantRanges);
+            W.pod( static_cast<uint32_t>(layout->setLayoutsDescriptions.size()) );
+            for(auto & l : layout->setLayoutsDescriptions)
+                writeBinary(W, l);
+            // the formats for dynamic rendering are written with the info
+            if( renderPass )
+                writeBinary(W, *renderPass);
+
+            m_pipelines.emplace(key, std::move(W.data));
+        }
+
+        /**
+         * @brief setPipelineCache
+         * @param data
+         *
+         * Embeds a pipeline cache, eg: from vk::Device::getPipelineCacheData( )
+         */
+        void setPipelineCache(std::vector<uint8_t> data)
+        {
+            m_pipelineCache = std::move(data);
+        }
+
+        std::vector<uint8_t> build() const
+        {
+            Header H = {};
+            H.magic         = magic;
+            H.version       = version;
+            H.shaderCount   = static_cast<uint32_t>(m_shaders.size());
+            H.pipelineCount = static_cast<uint32_t>(m_pipelines.size());
+
+            H.shaderIndexOffset   = sizeof(Header);
+            H.pipelineIndexOffset = H.shaderIndexOffset + sizeof(Entry) * m_shaders.size();
+
+            std::vector<Entry> entries;
+            uint64_t offset = H.pipelineIndexOffset + sizeof(Entry) * m_pipelines.size();
+
+            // std::map is sorted by key, so the entries are too.
+            for(auto & x : m_shaders)
+            {
+                entries.push_back( {x.first, offset, x.second.size() * sizeof(uint32_t)} );
+                offset = _alignUp(offset + entries.back().size);
+            }
+            for(auto & x : m_pipelines)
+            {
+                entries.push_back( {x.first, offset, x.second.size()} );
+                offset = _alignUp(offset + entries.back().size);
+            }
+
+            H.pipelineCacheOffset = m_pipelineCache.empty() ? 0 : offset;
+            H.pipelineCacheSize   = m_pipelineCache.size();
+            H.fileSize            = _alignUp(offset + m_pipelineCache.size());
+
+            std::vector<uint8_t> out(H.fileSize, 0);
+            std::memcpy(out.data(), &H, sizeof(H));
+            std::memcpy(out.data() + sizeof(H), entries.data(), entries.size() * sizeof(Entry));
+
+            size_t i=0;
+            for(auto & x : m_shaders)
+            {
+                std::memcpy(out.data() + entries[i].offset, x.second.data(), entries[i].size);
+                i++;
+            }
+            for(auto & x : m_pipelines)
+            {
+                std::memcpy(out.data() + entries[i].offset, x.second.data(), entries[i].size);
+                i++;
+            }
+            if( !m_pipelineCache.empty() )
+                std::memcpy(out.data() + H.pipelineCacheOffset, m_pipelineCache.data(), m_pipelineCache.size());
+
+            return out;
+        }
+
+        void writeFile(std::string const & path) const
+        {
+            auto data = build();
+            std::ofstream f(path, std::ios::out | std::ios::binary);
+            f.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if( !f )
+                throw std::runtime_error("Could not write " + path);
+        }
+
+    protected:
+        std::map<uint64_t, std::vector<uint32_t>> m_shaders;
+        std::map<uint64_t, std::vector<uint8_t>>  m_pipelines;
+        std::vector<uint8_t>                      m_pipelineCache;
+    };
+
+    PipelineArchive() = default;
+
+    /**
+     * @brief PipelineArchive
+     * @param data
+     * @param size
+     *
+     * Uses an archive which is already in memory. The memory is not
+     * copied and must outlive the archive and any shader module create
+     * infos returned by it. data must be at least 8 byte aligned.
+     */
+    PipelineArchive(uint8_t const * data, size_t size)
+    {
+        _setData(data, size);
+    }
+
+    PipelineArchive(PipelineArchive const &) = delete;
+    PipelineArchive & operator=(PipelineArchive const &) = delete;
+
+    PipelineArchive(PipelineArchive && other) noexcept
+    {
+        *this = std::move(other);
+    }
+    PipelineArchive & operator=(PipelineArchive && other) noexcept
+    {
+        if( this != &other )
+        {
+            _unmap();
+            m_data       = other.m_data;
+            m_size       = other.m_size;
+            m_mapped     = other.m_mapped;
+            m_buffer     = std::move(other.m_buffer);
+            other.m_data   = nullptr;
+            other.m_size   = 0;
+            other.m_mapped = false;
+        }
+        return *this;
+    }
+
+    ~PipelineArchive()
+    {
+        _unmap();
+    }
+
+    /**
+     * @brief open
+     * @param path
+     * @return
+     *
+     * Memory maps the archive. The file is not read until a shader or
+     * pipeline is requested. Throws std::runtime_error if the file cannot
+     * be opened or is not an archive.
+     */
+    static PipelineArchive open(std::string const & path)
+    {
+        PipelineArchive A;
+#if defined(_WIN32)
+        std::ifstream f(path, std::ios::in | std::ios::binary);
+        if( !f )
+            throw std::runtime_error("Could not open " + path);
+        A.m_buffer.assign( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+        A._setData(A.m_buffer.data(), A.m_buffer.size());
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if( fd < 0 )
+            throw std::runtime_error("Could not open " + path);
+
+        struct stat st;
+        if( ::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)) )
+        {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a vkb::PipelineArchive");
+        }
+
+        auto size = static_cast<size_t>(st.st_size);
+        auto p    = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if( p == MAP_FAILED )
+            throw std::runtime_error("Could not map " + path);
+
+        A.m_mapped = true;
+        A.m_data   = static_cast<uint8_t const*>(p);
+        A.m_size   = size;
+        A._setData(A.m_data, A.m_size);
+#endif
+        return A;
+    }
+
+    uint32_t shaderCount() const
+    {
+        return _header().shaderCount;
+    }
+    uint32_t pipelineCount() const
+    {
+        return _header().pipelineCount;
+    }
+
+    bool hasShader(uint64_t key) const
+    {
+        return _find(_shaderIndex(), shaderCount(), key) != nullptr;
+    }
+    bool hasPipeline(std::string const & name) const
+    {
+        return _findPipeline(name) != nullptr;
+    }
+
+    /**
+     * @brief getShaderModule
+     * @param key
+     * @return
+     *
+     * Returns a create info which reads the SPIR-V directly from the
+     * archive. Throws std::out_of_range if the shader is not in the archive.
+     */
+    ShaderModuleCreateInfo2 getShaderModule(uint64_t key) const
+    {
+        auto e = _find(_shaderIndex(), shaderCount(), key);
+        if( e == nullptr )
+            throw std::out_of_range("Shader is not in the archive");
+
+        ShaderModuleCreateInfo2 C;
+        C.externalCode     = reinterpret_cast<uint32_t const*>(m_data + e->offset);
+        C.externalCodeSize = e->size / sizeof(uint32_t);
+        return C;
+    }
+
+    /**
+     * @brief getPipeline
+     * @param name
+     * @param S
+     * @param device
+     * @return
+     *
+     * Reads the pipeline record and creates its shader modules from the
+     * archive. The returned create info can be created using
+     * create(S, device). Throws std::out_of_range if the pipeline is not
+     * in the archive.
+     */
+    GraphicsPipelineCreateInfo2 getPipeline(std::string const & name, Storage & S, vk::Device device) const
+    {
+        auto e = _findPipeline(name);
+        if( e == nullptr )
+            throw std::out_of_range("Pipeline " + name + " is not in the archive");
+
+        BinaryReader R{m_data + e->offset, m_data + e->offset + e->size};
+        R.str();
+
+        GraphicsPipelineCreateInfo2 info;
+        readBinary(R, info);
+
+        std::vector<uint64_t> shaders;
+        R.vec(shaders);
+        R.check(shaders.size() == info.stages.size());
+        for(size_t i=0;i<shaders.size();i++)
+            info.stages[i].module = getShaderModule(shaders[i]).create(S, device);
+
+        PipelineLayoutCreateInfo2 layout;
+        R.vec(layout.pushConstantRanges);
+        layout.setLayoutsDescriptions.resize( R.count() );
+        for(auto & l : layout.setLayoutsDescriptions)
+            readBinary(R, l);
+        info.layout = std::move(layout);
+
+        if( !std::holds_alternative<PipelineRenderingCreateInfo2>(info.renderPass) )
+        {
+            RenderPassCreateInfo2 renderPass;
+            readBinary(R, renderPass);
+            info.renderPass = std::move(renderPass);
+        }
+
+        return info;
+    }
+
+    /**
+     * @brief pipelineCacheData
+     * @return
+     *
+     * The embedded pipeline cache, or nullptr if there is none. Use it
+     * as the pInitialData of a vk::PipelineCacheCreateInfo.
+     */
+    void const * pipelineCacheData() const
+    {
+        return _header().pipelineCacheSize == 0 ? nullptr : m_data + _header().pipelineCacheOffset;
+    }
+    size_t pipelineCacheSize() const
+    {
+        return _header().pipelineCacheSize;
+    }
+
+    /**
+     * @brief contentHash
+     *
+     * 64 bit FNV-1a hash. The keys in the archive must be the same on
+     * every platform, so std::hash cannot be used.
+     */
+    static uint64_t contentHash(void const * data, size_t size)
+    {
+        return StableHash().bytes(data, size).value;
+    }
+
+protected:
+    static uint64_t _alignUp(uint64_t x)
+    {
+        return (x + 7) & ~uint64_t(7);
+    }
+
+    Header const & _header() const
+    {
+        if( m_data == nullptr )
+            throw std::runtime_error("The vkb::PipelineArchive is empty");
+        return *reinterpret_cast<Header const*>(m_data);
+    }
+    Entry const * _shaderIndex() const
+    {
+        return reinterpret_cast<Entry const*>(m_data + _header().shaderIndexOffset);
+    }
+    Entry const * _pipelineIndex() const
+    {
+        return reinterpret_cast<Entry const*>(m_data + _header().pipelineIndexOffset);
+    }
+
+    // binary search the sorted index. Entries which point
+    // outside of the file are treated as corrupt.
+    Entry const * _find(Entry const * index, uint32_t count, uint64_t key) const
+    {
+        auto e = std::lower_bound(index, index + count, key, [](Entry const & a, uint64_t k)
+        {
+            return a.key < k;
+        });
+        if( e == index + count || e->key != key )
+            return nullptr;
+        if( e->offset > m_size || e->size > m_size - e->offset || e->offset % 8 != 0 )
+            throw std::runtime_error("The vkb::PipelineArchive is corrupt");
+        return e;
+    }
+
+    Entry const * _findPipeline(std::string const & name) const
+    {
+        auto e = _find(_pipelineIndex(), pipelineCount(), contentHash(name.data(), name.size()));
+        if( e == nullptr )
+            return nullptr;
+
+        // make sure it is not a different pipeline with the same hash
+        BinaryReader R{m_data + e->offset, m_data + e->offset + e->size};
+        return R.str() == name ? e : nullptr;
+    }
+
+    // only the header and the location of the indices are
+    // validated, everything else is checked when it is used
+    void _setData(uint8_t const * data, size_t size)
+    {
+        if( reinterpret_cast<uintptr_t>(data) % 8 != 0 )
+            throw std::runtime_error("The vkb::PipelineArchive data must be 8 byte aligned");
+        if( data == nullptr || size < sizeof(Header) )
+            throw std::runtime_error("Not a vkb::PipelineArchive");
+
+        auto & H = *reinterpret_cast<Header const*>(data);
+        if( H.magic != magic )
+            throw std::runtime_error("Not a vkb::PipelineArchive");
+        if( H.version != version )
+            throw std::runtime_error("Unsupported vkb::PipelineArchive version " + std::to_string(H.version));
+        if( H.fileSize != size
+            || H.shaderIndexOffset   != sizeof(Header)
+            || H.pipelineIndexOffset != H.shaderIndexOffset + uint64_t(H.shaderCount) * sizeof(Entry)
+            || H.pipelineIndexOffset + uint64_t(H.pipelineCount) * sizeof(Entry) > size
+            || H.pipelineCacheOffset > size
+            || H.pipelineCacheSize   > size - H.pipelineCacheOffset )
+            throw std::runtime_error("The vkb::PipelineArchive is truncated or corrupt");
+
+        m_data = data;
+        m_size = size;
+    }
+
+    void _unmap()
+    {
+#if !defined(_WIN32)
+        if( m_mapped )
+            ::munmap( const_cast<uint8_t*>(m_data), m_size);
+#endif
+        m_mapped = false;
+        m_data   = nullptr;
+        m_size   = 0;
+        m_buffer.clear();
+    }
+
+    uint8_t const *      m_data   = nullptr;
+    size_t               m_size   = 0;
+    bool                 m_mapped = false;
+    std::vector<uint8_t> m_buffer; // used when memory mapping is not available
+};
+
+}
+
+#endif
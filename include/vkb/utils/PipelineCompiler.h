@@ -0,0 +1,353 @@
+#ifndef VKB_PIPELINECOMPILER_H
+#define VKB_PIPELINECOMPILER_H
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "PipelineJson.h"
+#include "StaticPipeline.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The PipelineCompiler struct
+ *
+ * Generates a C++ header which holds a GraphicsPipelineCreateInfo2 as
+ * a constexpr StaticGraphicsPipeline, along with its descriptor set
+ * layouts and render pass. The hashes of the descriptor set layouts and
+ * the render pass are computed when the header is generated.
+ *
+ * The pipeline's layout and render pass must be described by create
+ * infos. Shader stages and immutable samplers cannot be compiled.
+ *
+ * auto info   = vkb::PipelineJson::load("gbuffer.json");
+ * auto header = vkb::PipelineCompiler::generate("gbuffer", info);
+ *
+ * The generated header contains:
+ *
+ * namespace vkb_pipelines { namespace gbuffer {
+ *     inline constexpr vkb::StaticDescriptorSetLayout setLayouts[]  = {...};
+ *     inline constexpr vkb::StaticRenderPass          renderPass    = {...}; // if described
+ *     inline constexpr vkb::StaticGraphicsPipeline    pipeline      = {...};
+ * }}
+ *
+ * Use vkb_compile_pipelines( ) in cmake to compile json files at build time.
+ */
+struct PipelineCompiler
+{
+    static std::string generate(std::string const & name, GraphicsPipelineCreateInfo2 const & info, std::string const & nameSpace = "vkb_pipelines")
+    {
+        if( !_isIdentifier(name) || !_isIdentifier(nameSpace) )
+            throw std::runtime_error("The pipeline name and namespace must be C++ identifiers");
+        if( !info.stages.empty() )
+            throw std::runtime_error("Shader stages cannot be compiled into a StaticGraphicsPipeline");
+        if( !std::holds_alternative<PipelineLayoutCreateInfo2>(info.layout) )
+            throw std::runtime_error("The pipeline layout must be a PipelineLayoutCreateInfo2");
+        if( !std::holds_alternative<RenderPassCreateInfo2>(info.renderPass) )
+            throw std::runtime_error("The render pass must be a RenderPassCreateInfo2");
+
+        auto & layout = std::get<PipelineLayoutCreateInfo2>(info.layout);
+        auto & rp     = std::get<RenderPassCreateInfo2>(info.renderPass);
+        if( !layout.setLayouts.empty() )
+            throw std::runtime_error("The pipeline layout must use setLayoutsDescriptions");
+
+        std::ostringstream o;
+        o << "// Generated by the vkb pipeline compiler. Do not edit.\n";
+        o << "#pragma once\n\n";
+        o << "#include <vkb/utils/StaticPipeline.h>\n\n";
+        o << "namespace " << nameSpace << " { namespace " << name << " {\n\n";
+
+        //=====================================================================
+        // descriptor set layouts
+        //=====================================================================
+        auto & sets = layout.setLayoutsDescriptions;
+        for(size_t i=0;i<sets.size();i++)
+        {
+            if( !sets[i].immutableSamplers.empty() )
+                throw std::runtime_error("Immutable samplers cannot be compiled into a StaticDescriptorSetLayout");
+
+            _array(o, "vk::DescriptorSetLayoutBinding", "set" + std::to_string(i) + "_bindings", sets[i].bindings, [](auto & b)
+            {
+                return "vkb::StaticInit::binding(" + _u(b.binding) + ", " + _e("vk::DescriptorType", b.descriptorType) + ", "
+                                                   + _u(b.descriptorCount) + ", " + _f("vk::ShaderStageFlags", b.stageFlags) + ")";
+            });
+        }
+        if( !sets.empty() )
+        {
+            o << "inline constexpr vkb::StaticDescriptorSetLayout setLayouts[] = {\n";
+            for(size_t i=0;i<sets.size();i++)
+            {
+                auto b = "set" + std::to_string(i) + "_bindings";
+                o << "    { " << _f("vk::DescriptorSetLayoutCreateFlags", sets[i].flags) << ", "
+                  << _ptr(sets[i].bindings, b) << ", " << _u(sets[i].bindings.size()) << ", " << _hash(sets[i].hash()) << " },\n";
+            }
+            o << "};\n\n";
+        }
+
+        _array(o, "vk::PushConstantRange", "pushConstantRanges", layout.pushConstantRanges, [](auto & r)
+        {
+            return "vkb::StaticInit::pushConstantRange(" + _f("vk::ShaderStageFlags", r.stageFlags) + ", " + _u(r.offset) + ", " + _u(r.size) + ")";
+        });
+
+        //=====================================================================
+        // render pass
+        //=====================================================================
+        bool hasRenderPass = !rp.attachments.empty() || !rp.subpasses.empty() || !rp.dependencies.empty();
+        if( hasRenderPass )
+            _renderPass(o, rp);
+
+        //=====================================================================
+        // pipeline
+        //=====================================================================
+        _array(o, "vk::PipelineColorBlendAttachmentState", "blendAttachments", info.blendState.attachments, [](auto & a)
+        {
+            return "vkb::StaticInit::blendAttachment(" + _u(a.blendEnable) + ", "
+                    + _e("vk::BlendFactor", a.srcColorBlendFactor) + ", " + _e("vk::BlendFactor", a.dstColorBlendFactor) + ", " + _e("vk::BlendOp", a.colorBlendOp) + ", "
+                    + _e("vk::BlendFactor", a.srcAlphaBlendFactor) + ", " + _e("vk::BlendFactor", a.dstAlphaBlendFactor) + ", " + _e("vk::BlendOp", a.alphaBlendOp) + ", "
+                    + _f("vk::ColorComponentFlags", a.colorWriteMask) + ")";
+        });
+        _array(o, "vk::VertexInputBindingDescription", "vertexBindings", info.vertexInputState.vertexBindingDescriptions, [](auto & b)
+        {
+            return "vkb::StaticInit::vertexBinding(" + _u(b.binding) + ", " + _u(b.stride) + ", " + _e("vk::VertexInputRate", b.inputRate) + ")";
+        });
+        _array(o, "vk::VertexInputAttributeDescription", "vertexAttributes", info.vertexInputState.vertexAttributeDescriptions, [](auto & a)
+        {
+            return "vkb::StaticInit::vertexAttribute(" + _u(a.location) + ", " + _u(a.binding) + ", " + _e("vk::Format", a.format) + ", " + _u(a.offset) + ")";
+        });
+        _array(o, "vk::DynamicState", "dynamicStates", info.dynamicStates, [](auto & d)
+        {
+            return _e("vk::DynamicState", d);
+        });
+        _array(o, "vk::Viewport", "viewports", info.viewportState.viewports, [](auto & v)
+        {
+            return "vkb::StaticInit::viewport(" + _float(v.x) + ", " + _float(v.y) + ", " + _float(v.width) + ", " + _float(v.height) + ", "
+                                                + _float(v.minDepth) + ", " + _float(v.maxDepth) + ")";
+        });
+        _array(o, "vk::Rect2D", "scissors", info.viewportState.scissors, [](auto & r)
+        {
+            return "vkb::StaticInit::scissor(" + std::to_string(r.offset.x) + ", " + std::to_string(r.offset.y) + ", "
+                                               + _u(r.extent.width) + ", " + _u(r.extent.height) + ")";
+        });
+
+        auto & B  = info.blendState;
+        auto & RS = info.rasterizationState;
+        auto & MS = info.multisampleState;
+        auto & DS = info.depthStencilState;
+        auto & IA = info.inputAssemblyState;
+        auto & TS = info.tessellation;
+
+        o << "inline constexpr vkb::StaticGraphicsPipeline pipeline = {\n";
+        o << "    /* setLayouts         */ " << (sets.empty() ? "nullptr" : "setLayouts") << ", " << _u(sets.size()) << ",\n";
+        o << "    /* pushConstantRanges */ " << _ptr(layout.pushConstantRanges, "pushConstantRanges") << ", " << _u(layout.pushConstantRanges.size()) << ",\n";
+        o << "    /* blendAttachments   */ " << _ptr(B.attachments, "blendAttachments") << ", " << _u(B.attachments.size()) << ",\n";
+        o << "    /* blendFlags         */ " << _f("vk::PipelineColorBlendStateCreateFlags", B.flags) << ",\n";
+        o << "    /* logicOpEnable      */ " << _u(B.logicOpEnable) << ",\n";
+        o << "    /* logicOp            */ " << _e("vk::LogicOp", B.logicOp) << ",\n";
+        o << "    /* blendConstants     */ { " << _float(B.blendConstants[0]) << ", " << _float(B.blendConstants[1]) << ", "
+                                            << _float(B.blendConstants[2]) << ", " << _float(B.blendConstants[3]) << " },\n";
+        o << "    /* vertexBindings     */ " << _ptr(info.vertexInputState.vertexBindingDescriptions, "vertexBindings") << ", " << _u(info.vertexInputState.vertexBindingDescriptions.size()) << ",\n";
+        o << "    /* vertexAttributes   */ " << _ptr(info.vertexInputState.vertexAttributeDescriptions, "vertexAttributes") << ", " << _u(info.vertexInputState.vertexAttributeDescriptions.size()) << ",\n";
+        o << "    /* rasterizationState */ vkb::StaticInit::rasterizationState(" << _f("vk::PipelineRasterizationStateCreateFlags", RS.flags) << ", "
+          << _u(RS.depthClampEnable) << ", " << _u(RS.rasterizerDiscardEnable) << ", " << _e("vk::PolygonMode", RS.polygonMode) << ", "
+          << _f("vk::CullModeFlags", RS.cullMode) << ", " << _e("vk::FrontFace", RS.frontFace) << ", " << _u(RS.depthBiasEnable) << ", "
+          << _float(RS.depthBiasConstantFactor) << ", " << _float(RS.depthBiasClamp) << ", " << _float(RS.depthBiasSlopeFactor) << ", " << _float(RS.lineWidth) << "),\n";
+        o << "    /* multisampleState   */ vkb::StaticInit::multisampleState(" << _f("vk::PipelineMultisampleStateCreateFlags", MS.flags) << ", "
+          << _e("vk::SampleCountFlagBits", MS.rasterizationSamples) << ", " << _u(MS.sampleShadingEnable) << ", " << _float(MS.minSampleShading) << ", "
+          << _u(MS.alphaToCoverageEnable) << ", " << _u(MS.alphaToOneEnable) << "),\n";
+        o << "    /* depthStencilState  */ vkb::StaticInit::depthStencilState(" << _f("vk::PipelineDepthStencilStateCreateFlags", DS.flags) << ", "
+          << _u(DS.depthTestEnable) << ", " << _u(DS.depthWriteEnable) << ", " << _e("vk::CompareOp", DS.depthCompareOp) << ", "
+          << _u(DS.depthBoundsTestEnable) << ", " << _u(DS.stencilTestEnable) << ", " << _stencilOp(DS.front) << ", " << _stencilOp(DS.back) << ", "
+          << _float(DS.minDepthBounds) << ", " << _float(DS.maxDepthBounds) << "),\n";
+        o << "    /* inputAssemblyState */ vkb::StaticInit::inputAssemblyState(" << _f("vk::PipelineInputAssemblyStateCreateFlags", IA.flags) << ", "
+          << _e("vk::PrimitiveTopology", IA.topology) << ", " << _u(IA.primitiveRestartEnable) << "),\n";
+        o << "    /* tessellation       */ vkb::StaticInit::tessellationState(" << _f("vk::PipelineTessellationStateCreateFlags", TS.flags) << ", "
+          << _u(TS.patchControlPoints) << "),\n";
+        o << "    /* dynamicStates      */ " << _ptr(info.dynamicStates, "dynamicStates") << ", " << _u(info.dynamicStates.size()) << ",\n";
+        o << "    /* viewports          */ " << _ptr(info.viewportState.viewports, "viewports") << ", " << _u(info.viewportState.viewports.size()) << ",\n";
+        o << "    /* scissors           */ " << _ptr(info.viewportState.scissors, "scissors") << ", " << _u(info.viewportState.scissors.size()) << ",\n";
+        o << "    /* renderPass         */ " << (hasRenderPass ? "&renderPass" : "nullptr") << "\n";
+        o << "};\n\n";
+
+        o << "}}\n";
+        return o.str();
+    }
+
+    /**
+     * @brief compile
+     * @param jsonPath
+     * @param name
+     * @param nameSpace
+     * @return
+     *
+     * Loads a pipeline json file and generates its header.
+     */
+    static std::string compile(std::string const & jsonPath, std::string const & name, std::string const & nameSpace = "vkb_pipelines")
+    {
+        return generate(name, PipelineJson::load(jsonPath), nameSpace);
+    }
+
+    /**
+     * @brief identifier
+     * @param path
+     * @return
+     *
+     * Returns the file name of path without its extension, with all
+     * characters which cannot be used in a C++ identifier replaced by '_'.
+     */
+    static std::string identifier(std::string const & path)
+    {
+        auto s = path.substr( path.find_last_of("/\\") == std::string::npos ? 0 : path.find_last_of("/\\") + 1 );
+        s = s.substr(0, s.find('.'));
+        for(auto & c : s)
+        {
+            if( !std::isalnum(static_cast<unsigned char>(c)) )
+                c = '_';
+        }
+        if( s.empty() || std::isdigit(static_cast<unsigned char>(s[0])) )
+            s = "_" + s;
+        return s;
+    }
+
+protected:
+    static bool _isIdentifier(std::string const & s)
+    {
+        if( s.empty() || std::isdigit(static_cast<unsigned char>(s[0])) )
+            return false;
+        for(auto c : s)
+        {
+            if( !std::isalnum(static_cast<unsigned char>(c)) && c != '_' )
+                return false;
+        }
+        return true;
+    }
+
+    static std::string _u(uint64_t v)
+    {
+        return std::to_string(v) + "u";
+    }
+
+    template<typename T>
+    static std::string _e(char const * type, T v)
+    {
+        return std::string(type) + "(" + std::to_string(static_cast<int64_t>(v)) + ")";
+    }
+
+    template<typename ...Bits>
+    static std::string _f(char const * type, vk::Flags<Bits...> v)
+    {
+        uint64_t m = 0;
+        std::memcpy(&m, &v, sizeof(v));
+        return std::string(type) + "(" + _u(m) + ")";
+    }
+
+    static std::string _float(float v)
+    {
+        if( !std::isfinite(v) )
+            throw std::runtime_error("Floating point values must be finite");
+
+        // 9 significant digits round trips every float
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(v));
+        std::string s(buf);
+        if( s.find_first_of(".e") == std::string::npos )
+            s += ".0";
+        return s + "f";
+    }
+
+    static std::string _hash(size_t h)
+    {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "static_cast<size_t>(0x%llxull)", static_cast<unsigned long long>(h));
+        return buf;
+    }
+
+    static std::string _stencilOp(vk::StencilOpState const & s)
+    {
+        return "vkb::StaticInit::stencilOp(" + _e("vk::StencilOp", s.failOp) + ", " + _e("vk::StencilOp", s.passOp) + ", "
+                + _e("vk::StencilOp", s.depthFailOp) + ", " + _e("vk::CompareOp", s.compareOp) + ", "
+                + _u(s.compareMask) + ", " + _u(s.writeMask) + ", " + _u(s.reference) + ")";
+    }
+
+    template<typename T>
+    static std::string _ptr(std::vector<T> const & v, std::string const & name)
+    {
+        return v.empty() ? "nullptr" : name;
+    }
+
+    template<typename T, typename Callable_t>
+    static void _array(std::ostringstream & o, char const * type, std::string const & name, std::vector<T> const & values, Callable_t && f)
+    {
+        // zero sized arrays are not allowed, the struct uses nullptr instead
+        if( values.empty() )
+            return;
+        o << "inline constexpr " << type << " " << name << "[] = {\n";
+        for(auto & v : values)
+            o << "    " << f(v) << ",\n";
+        o << "};\n\n";
+    }
+
+    static void _renderPass(std::ostringstream & o, RenderPassCreateInfo2 const & rp)
+    {
+        _array(o, "vk::AttachmentDescription", "renderPass_attachments", rp.attachments, [](auto & a)
+        {
+            return "vkb::StaticInit::attachment(" + _f("vk::AttachmentDescriptionFlags", a.flags) + ", " + _e("vk::Format", a.format) + ", "
+                    + _e("vk::SampleCountFlagBits", a.samples) + ", " + _e("vk::AttachmentLoadOp", a.loadOp) + ", " + _e("vk::AttachmentStoreOp", a.storeOp) + ", "
+                    + _e("vk::AttachmentLoadOp", a.stencilLoadOp) + ", " + _e("vk::AttachmentStoreOp", a.stencilStoreOp) + ", "
+                    + _e("vk::ImageLayout", a.initialLayout) + ", " + _e("vk::ImageLayout", a.finalLayout) + ")";
+        });
+        _array(o, "vk::SubpassDependency", "renderPass_dependencies", rp.dependencies, [](auto & d)
+        {
+            return "vkb::StaticInit::dependency(" + _u(d.srcSubpass) + ", " + _u(d.dstSubpass) + ", "
+                    + _f("vk::PipelineStageFlags", d.srcStageMask) + ", " + _f("vk::PipelineStageFlags", d.dstStageMask) + ", "
+                    + _f("vk::AccessFlags", d.srcAccessMask) + ", " + _f("vk::AccessFlags", d.dstAccessMask) + ", "
+                    + _f("vk::DependencyFlags", d.dependencyFlags) + ")";
+        });
+
+        auto _ref = [](auto & r)
+        {
+            return "vkb::StaticInit::reference(" + _u(r.attachment) + ", " + _e("vk::ImageLayout", r.layout) + ")";
+        };
+
+        std::vector<std::string> subpasses;
+        for(size_t i=0;i<rp.subpasses.size();i++)
+        {
+            auto & s = rp.subpasses[i];
+            auto p   = "renderPass_subpass" + std::to_string(i) + "_";
+
+            _array(o, "vk::AttachmentReference", p + "input", s.inputAttachments, _ref);
+            _array(o, "vk::AttachmentReference", p + "color", s.colorAttachments, _ref);
+            _array(o, "uint32_t", p + "preserve", s.preserveAttachments, [](auto & a){ return _u(a); });
+            if( s.depthStencilAttachment )
+                o << "inline constexpr vk::AttachmentReference " << p << "depthStencil = " << _ref(*s.depthStencilAttachment) << ";\n\n";
+            if( s.resolveAttachment )
+                o << "inline constexpr vk::AttachmentReference " << p << "resolve = " << _ref(*s.resolveAttachment) << ";\n\n";
+
+            subpasses.push_back( "{ " + _e("vk::PipelineBindPoint", s.pipelineBindPoint) + ", "
+                                 + _ptr(s.inputAttachments, p + "input") + ", " + _u(s.inputAttachments.size()) + ", "
+                                 + _ptr(s.colorAttachments, p + "color") + ", " + _u(s.colorAttachments.size()) + ", "
+                                 + (s.depthStencilAttachment ? "&" + p + "depthStencil" : std::string("nullptr")) + ", "
+                                 + (s.resolveAttachment      ? "&" + p + "resolve"      : std::string("nullptr")) + ", "
+                                 + _ptr(s.preserveAttachments, p + "preserve") + ", " + _u(s.preserveAttachments.size()) + " }" );
+        }
+        _array(o, "vkb::StaticSubpass", "renderPass_subpasses", subpasses, [](auto & s){ return s; });
+
+        o << "inline constexpr vkb::StaticRenderPass renderPass = {\n";
+        o << "    " << _ptr(rp.attachments,  "renderPass_attachments")  << ", " << _u(rp.attachments.size())  << ",\n";
+        o << "    " << _ptr(rp.dependencies, "renderPass_dependencies") << ", " << _u(rp.dependencies.size()) << ",\n";
+        o << "    " << _ptr(rp.subpasses,    "renderPass_subpasses")    << ", " << _u(rp.subpasses.size())    << ",\n";
+        o << "    /* hash              */ " << _hash(rp.hash()) << ",\n";
+        o << "    /* compatibilityHash */ " << _hash(rp.compatibilityHash()) << "\n";
+        o << "};\n\n";
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,906 @@
+#ifndef VKB_PIPELINEJSON_H
+#define VKB_PIPELINEJSON_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../vkb.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The PerfectHashTable struct
+ *
+ * A compile time map from strings to integers, built with "hash and
+ * displace": the strings are split into buckets and each bucket is given
+ * its own hash seed, chosen at compile time, so that no two strings
+ * share a slot. A lookup is two hashes and one string compare.
+ *
+ * static constexpr auto T = vkb::makePerfectHashTable({ {"Vertex", 0}, {"Instance", 1} });
+ *
+ * uint32_t v;
+ * T.find("Instance", v); // true, v==1
+ */
+template<size_t N>
+struct PerfectHashTable
+{
+    using item_type = std::pair<std::string_view, uint32_t>;
+
+    static constexpr size_t _pow2(size_t n)
+    {
+        size_t m = 1;
+        while( m < n )
+            m *= 2;
+        return m;
+    }
+    static constexpr size_t size    = _pow2(2*N);
+    static constexpr size_t buckets = _pow2(N);
+
+    std::string_view names[size]    = {};
+    uint32_t         values[size]   = {};
+    bool             used[size]     = {};
+    uint32_t         seeds[buckets] = {}; // 0 for empty buckets
+
+    constexpr explicit PerfectHashTable(item_type const (&items)[N])
+    {
+        size_t bucketOf[N]         = {};
+        size_t bucketSize[buckets] = {};
+        bool   placed[buckets]     = {};
+
+        for(size_t i=0;i<N;i++)
+        {
+            bucketOf[i] = hash(items[i].first, 0) & (buckets-1);
+            bucketSize[ bucketOf[i] ]++;
+        }
+
+        // place the largest buckets first, while most slots are free
+        for(size_t n=0;n<buckets;n++)
+        {
+            size_t b = buckets;
+            for(size_t j=0;j<buckets;j++)
+            {
+                if( !placed[j] && (b == buckets || bucketSize[j] > bucketSize[b]) )
+                    b = j;
+            }
+            placed[b] = true;
+            if( bucketSize[b] == 0 )
+                break;
+
+            for(uint32_t s=1; seeds[b]==0; s++)
+            {
+                size_t slots[N] = {};
+                size_t k        = 0;
+                bool   ok       = true;
+                for(size_t i=0;i<N && ok;i++)
+                {
+                    if( bucketOf[i] != b )
+                        continue;
+                    auto slot = hash(items[i].first, s) & (size-1);
+                    ok = !used[slot];
+                    for(size_t j=0;j<k && ok;j++)
+                        ok = slots[j] != slot;
+                    slots[k++] = slot;
+                }
+                if( !ok )
+                    continue;
+
+                k = 0;
+                for(size_t i=0;i<N;i++)
+                {
+                    if( bucketOf[i] != b )
+                        continue;
+                    auto slot    = slots[k++];
+                    used[slot]   = true;
+                    names[slot]  = items[i].first;
+                    values[slot] = items[i].second;
+                }
+                seeds[b] = s;
+            }
+        }
+    }
+
+    static constexpr uint32_t hash(std::string_view s, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for(auto c : s)
+        {
+            h ^= static_cast<uint8_t>(c);
+            h *= 16777619u;
+        }
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return h;
+    }
+
+    constexpr bool find(std::string_view s, uint32_t & value) const
+    {
+        auto seed = seeds[ hash(s, 0) & (buckets-1) ];
+        if( seed == 0 )
+            return false;
+        auto slot = hash(s, seed) & (size-1);
+        if( !used[slot] || names[slot] != s )
+            return false;
+        value = values[slot];
+        return true;
+    }
+
+    constexpr bool contains(std::string_view s) const
+    {
+        uint32_t v = 0;
+        return find(s, v);
+    }
+};
+
+template<size_t N>
+constexpr PerfectHashTable<N> makePerfectHashTable(std::pair<std::string_view, uint32_t> const (&items)[N])
+{
+    return PerfectHashTable<N>(items);
+}
+
+/**
+ * @brief The JsonReader struct
+ *
+ * A small pull parser. Values are read straight from the text without
+ * building a document tree. Throws std::runtime_error on malformed input.
+ *
+ * R.object([&](std::string_view key)
+ * {
+ *     if( key == "stride") stride = R.integer();
+ *     else R.skip();
+ * });
+ */
+struct JsonReader
+{
+    explicit JsonReader(std::string_view text) : m_p(text.data()), m_end(text.data() + text.size()), m_begin(text.data())
+    {
+    }
+
+    // call f(key) for each member of an object. f must read the value
+    template<typename Callable_t>
+    void object(Callable_t && f)
+    {
+        expect('{');
+        if( _consume('}') )
+            return;
+        std::string copy;
+        do
+        {
+            // keys with escapes are decoded into the scratch buffer,
+            // which the value may overwrite
+            auto key = string();
+            if( key.data() == m_scratch.data() )
+            {
+                copy = std::string(key);
+                key  = copy;
+            }
+            expect(':');
+            f(key);
+        } while( _consume(',') );
+        expect('}');
+    }
+
+    // call f() for each element of an array. f must read the value
+    template<typename Callable_t>
+    void array(Callable_t && f)
+    {
+        expect('[');
+        if( _consume(']') )
+            return;
+        do
+        {
+            f();
+        } while( _consume(',') );
+        expect(']');
+    }
+
+    /**
+     * @brief string
+     * @return
+     *
+     * The returned view points into the text, or into an internal buffer
+     * if the string had escape sequences. It is valid until the next call.
+     */
+    std::string_view string()
+    {
+        expect('"');
+        auto start = m_p;
+        while( m_p < m_end && *m_p != '"' && *m_p != '\\' )
+            m_p++;
+        if( m_p < m_end && *m_p == '"' )
+            return std::string_view(start, static_cast<size_t>(m_p++ - start));
+
+        m_scratch.assign(start, m_p);
+        while( m_p < m_end && *m_p != '"' )
+        {
+            if( *m_p == '\\' )
+            {
+                if( ++m_p == m_end )
+                    break;
+                switch(*m_p)
+                {
+                    case 'n': m_scratch += '\n'; break;
+                    case 't': m_scratch += '\t'; break;
+                    case 'r': m_scratch += '\r'; break;
+                    case 'b': m_scratch += '\b'; break;
+                    case 'f': m_scratch += '\f'; break;
+                    case 'u': error("Unicode escapes are not supported");
+                    default:  m_scratch += *m_p; break;
+                }
+                m_p++;
+            }
+            else
+            {
+                m_scratch += *m_p++;
+            }
+        }
+        expect('"');
+        return m_scratch;
+    }
+
+    double number()
+    {
+        _ws();
+        auto start = m_p;
+        while( m_p < m_end && (std::isdigit(static_cast<unsigned char>(*m_p)) || *m_p=='-' || *m_p=='+' || *m_p=='.' || *m_p=='e' || *m_p=='E') )
+            m_p++;
+        if( start == m_p )
+            error("Expected a number");
+
+        // strtod needs a null terminated string
+        char buf[64];
+        auto n = static_cast<size_t>(m_p - start);
+        if( n >= sizeof(buf) )
+            error("Invalid number");
+        std::memcpy(buf, start, n);
+        buf[n] = 0;
+
+        char * e = nullptr;
+        auto v = std::strtod(buf, &e);
+        if( e != buf + n )
+            error("Invalid number");
+        return v;
+    }
+
+    uint32_t integer()
+    {
+        _ws();
+        if( m_p == m_end || !std::isdigit(static_cast<unsigned char>(*m_p)) )
+            error("Expected a non-negative integer");
+        uint64_t v = 0;
+        while( m_p < m_end && std::isdigit(static_cast<unsigned char>(*m_p)) )
+        {
+            v = v*10 + static_cast<uint64_t>(*m_p++ - '0');
+            if( v > UINT32_MAX )
+                error("Integer is too large");
+        }
+        return static_cast<uint32_t>(v);
+    }
+
+    bool boolean()
+    {
+        _ws();
+        if( _literal("true") )
+            return true;
+        if( _literal("false") )
+            return false;
+        error("Expected true or false");
+        return false;
+    }
+
+    // a number, or a boolean which is read as 0 or 1
+    float numberOrBoolean()
+    {
+        _ws();
+        if( m_p < m_end && (*m_p == 't' || *m_p == 'f') )
+            return boolean() ? 1.0f : 0.0f;
+        return static_cast<float>(number());
+    }
+
+    // skip any value
+    void skip()
+    {
+        _ws();
+        if( m_p == m_end )
+            error("Unexpected end of document");
+        switch(*m_p)
+        {
+            case '{': object([this](std::string_view){ skip(); }); break;
+            case '[': array([this]{ skip(); }); break;
+            case '"': string(); break;
+            case 't':
+            case 'f': boolean(); break;
+            case 'n': if( !_literal("null") ) error("Unexpected value"); break;
+            default : number(); break;
+        }
+    }
+
+    void expect(char c)
+    {
+        if( !_consume(c) )
+            error(std::string("Expected '") + c + "'");
+    }
+
+    // throws if there is anything other than whitespace left
+    void finish()
+    {
+        _ws();
+        if( m_p != m_end )
+            error("Unexpected data at the end of the document");
+    }
+
+    [[noreturn]] void error(std::string const & msg) const
+    {
+        throw std::runtime_error(msg + " at offset " + std::to_string(m_p - m_begin));
+    }
+
+protected:
+    void _ws()
+    {
+        while( m_p < m_end && (*m_p==' ' || *m_p=='\n' || *m_p=='\r' || *m_p=='\t') )
+            m_p++;
+    }
+    bool _consume(char c)
+    {
+        _ws();
+        if( m_p < m_end && *m_p == c )
+        {
+            m_p++;
+            return true;
+        }
+        return false;
+    }
+    bool _literal(std::string_view s)
+    {
+        if( static_cast<size_t>(m_end - m_p) >= s.size() && std::string_view(m_p, s.size()) == s )
+        {
+            m_p += s.size();
+            return true;
+        }
+        return false;
+    }
+
+    char const * m_p;
+    char const * m_end;
+    char const * m_begin;
+    std::string  m_scratch;
+};
+
+/**
+ * @brief The PipelineJson struct
+ *
+ * Loads pipeline descriptions which follow the schema in
+ * samples/pipeline.json into a GraphicsPipelineCreateInfo2. Values
+ * which are not in the document keep the defaults of
+ * GraphicsPipelineCreateInfo2 (or the schema's defaults for blend
+ * attachments and vertex inputs). Shader stages and viewports are not
+ * part of the schema and must be set afterwards. The optional renderPass
+ * section describes a single subpass render pass, see
+ * RenderPassCreateInfo2::createSimpleRenderPass( ).
+ *
+ * auto info = vkb::PipelineJson::load("pipelines/gbuffer.json");
+ * info.addStage( vk::ShaderStageFlagBits::eVertex, "main", "gbuffer.vert.spv");
+ *
+ * // many files at once, on all cores
+ * auto infos = vkb::PipelineJson::loadAll(paths);
+ *
+ * Enum strings are resolved with PerfectHashTables. Unknown members are
+ * ignored, unknown enum values throw std::runtime_error.
+ */
+struct PipelineJson
+{
+    static GraphicsPipelineCreateInfo2 parse(std::string_view text)
+    {
+        GraphicsPipelineCreateInfo2 info;
+        parse(text, info);
+        return info;
+    }
+
+    static void parse(std::string_view text, GraphicsPipelineCreateInfo2 & info)
+    {
+        JsonReader R(text);
+        R.object([&](std::string_view key)
+        {
+            if(      key == "layout"             ) _layout(R, info);
+            else if( key == "dynamicStates"      ) _dynamicStates(R, info);
+            else if( key == "colorBlendState"    ) _colorBlendState(R, info);
+            else if( key == "inputAssemblyState" ) _inputAssemblyState(R, info);
+            else if( key == "vertexInputState"   ) _vertexInputState(R, info);
+            else if( key == "rasterizationState" ) _rasterizationState(R, info);
+            else if( key == "depthStencilState"  ) _depthStencilState(R, info);
+            else if( key == "multisampleState"   ) _multisampleState(R, info);
+            else if( key == "renderPass"         ) _renderPass(R, info);
+            else R.skip();
+        });
+        R.finish();
+    }
+
+    static GraphicsPipelineCreateInfo2 load(std::string const & path)
+    {
+        std::ifstream f(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if( !f )
+            throw std::runtime_error("Could not open " + path);
+
+        std::string text( static_cast<size_t>(f.tellg()), '\0' );
+        f.seekg(0);
+        f.read(&text[0], static_cast<std::streamsize>(text.size()));
+
+        try
+        {
+            return parse(text);
+        }
+        catch(std::exception & e)
+        {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+    }
+
+    /**
+     * @brief loadAll
+     * @param paths
+     * @param threadCount - 0 to use all cores
+     * @return
+     *
+     * Loads each file on a pool of threads. The output is in the same
+     * order as paths. If any file fails to load, the first error is
+     * rethrown after all threads have finished.
+     */
+    static std::vector<GraphicsPipelineCreateInfo2> loadAll(std::vector<std::string> const & paths, uint32_t threadCount = 0)
+    {
+        std::vector<GraphicsPipelineCreateInfo2> out(paths.size());
+
+        if( threadCount == 0 )
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::max(1u, std::min<uint32_t>(threadCount, static_cast<uint32_t>(paths.size())));
+
+        std::vector<std::exception_ptr> errors(paths.size());
+        std::vector<std::thread>        threads;
+        for(uint32_t t=0;t<threadCount;t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for(size_t i=t; i<paths.size(); i+=threadCount)
+                {
+                    try
+                    {
+                        out[i] = load(paths[i]);
+                    }
+                    catch(...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            });
+        }
+        for(auto & t : threads)
+            t.join();
+
+        for(auto & e : errors)
+        {
+            if( e )
+                std::rethrow_exception(e);
+        }
+        return out;
+    }
+
+    //=========================================================================
+    // Enum tables. The values are the ones in the Vulkan specification so
+    // that extension enumerants do not depend on the version of vulkan.hpp
+    //=========================================================================
+    template<typename T, typename Table_t>
+    static T _enum(JsonReader & R, Table_t const & table, char const * what)
+    {
+        auto s = R.string();
+        uint32_t v = 0;
+        if( !table.find(s, v) )
+            R.error("Unknown " + std::string(what) + " \"" + std::string(s) + "\"");
+        return static_cast<T>(v);
+    }
+
+    static vk::Format _format(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"R32Sfloat", 100}, {"R32G32Sfloat", 103}, {"R32G32B32Sfloat", 106}, {"R32G32B32A32Sfloat", 109},
+            {"R8G8B8A8Unorm", 37}, {"R8G8B8A8Snorm", 38}, {"R8G8B8A8Srgb", 43}, {"B8G8R8A8Unorm", 44},
+            {"B8G8R8A8Srgb", 50}, {"A2B10G10R10UnormPack32", 64}, {"R16G16B16A16Sfloat", 97},
+            {"D16Unorm", 124}, {"D32Sfloat", 126}, {"D24UnormS8Uint", 129}, {"D32SfloatS8Uint", 130}
+        });
+        return _enum<vk::Format>(R, T, "format");
+    }
+
+    static vk::ImageLayout _imageLayout(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Undefined", 0}, {"General", 1}, {"ColorAttachmentOptimal", 2}, {"DepthStencilAttachmentOptimal", 3},
+            {"DepthStencilReadOnlyOptimal", 4}, {"ShaderReadOnlyOptimal", 5}, {"TransferSrcOptimal", 6},
+            {"TransferDstOptimal", 7}, {"PresentSrcKHR", 1000001002}
+        });
+        return _enum<vk::ImageLayout>(R, T, "image layout");
+    }
+
+    static vk::BlendFactor _blendFactor(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Zero", 0}, {"One", 1}, {"SrcColor", 2}, {"OneMinusSrcColor", 3}, {"DstColor", 4},
+            {"OneMinusDstColor", 5}, {"SrcAlpha", 6}, {"OneMinusSrcAlpha", 7}, {"DstAlpha", 8},
+            {"OneMinusDstAlpha", 9}, {"ConstantColor", 10}, {"OneMinusConstantColor", 11},
+            {"ConstantAlpha", 12}, {"OneMinusConstantAlpha", 13}, {"SrcAlphaSaturate", 14},
+            {"Src1Color", 15}, {"OneMinusSrc1Color", 16}, {"Src1Alpha", 17}, {"OneMinusSrc1Alpha", 18}
+        });
+        return _enum<vk::BlendFactor>(R, T, "blend factor");
+    }
+
+    static vk::BlendOp _blendOp(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Add", 0}, {"Subtract", 1}, {"ReverseSubtract", 2}, {"Min", 3}, {"Max", 4},
+            {"ZeroEXT", 1000148000}, {"SrcEXT", 1000148001}, {"DstEXT", 1000148002},
+            {"SrcOverEXT", 1000148003}, {"DstOverEXT", 1000148004}, {"SrcInEXT", 1000148005},
+            {"DstInEXT", 1000148006}, {"SrcOutEXT", 1000148007}, {"DstOutEXT", 1000148008},
+            {"SrcAtopEXT", 1000148009}, {"DstAtopEXT", 1000148010}, {"XorEXT", 1000148011},
+            {"MultiplyEXT", 1000148012}, {"ScreenEXT", 1000148013}, {"OverlayEXT", 1000148014},
+            {"DarkenEXT", 1000148015}, {"LightenEXT", 1000148016}, {"ColordodgeEXT", 1000148017},
+            {"ColorburnEXT", 1000148018}, {"HardlightEXT", 1000148019}, {"SoftlightEXT", 1000148020},
+            {"DifferenceEXT", 1000148021}, {"ExclusionEXT", 1000148022}, {"InvertEXT", 1000148023},
+            {"InvertRgbEXT", 1000148024}, {"LineardodgeEXT", 1000148025}, {"LinearburnEXT", 1000148026},
+            {"VividlightEXT", 1000148027}, {"LinearlightEXT", 1000148028}, {"PinlightEXT", 1000148029},
+            {"HardmixEXT", 1000148030}, {"HslHueEXT", 1000148031}, {"HslSaturationEXT", 1000148032},
+            {"HslColorEXT", 1000148033}, {"HslLuminosityEXT", 1000148034}, {"PlusEXT", 1000148035},
+            {"PlusClampedEXT", 1000148036}, {"PlusClampedAlphaEXT", 1000148037}, {"PlusDarkerEXT", 1000148038},
+            {"MinusEXT", 1000148039}, {"MinusClampedEXT", 1000148040}, {"ContrastEXT", 1000148041},
+            {"InvertOvgEXT", 1000148042}, {"RedEXT", 1000148043}, {"GreenEXT", 1000148044},
+            {"BlueEXT", 1000148045}
+        });
+        return _enum<vk::BlendOp>(R, T, "blend op");
+    }
+
+    static vk::ShaderStageFlagBits _shaderStage(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Vertex", 0x1}, {"TessellationControl", 0x2}, {"TessellationEvaluation", 0x4},
+            {"Geometry", 0x8}, {"Fragment", 0x10}, {"Compute", 0x20}, {"TaskNV", 0x40},
+            {"MeshNV", 0x80}, {"RaygenNV", 0x100}, {"AnyHitNV", 0x200}, {"ClosestHitNV", 0x400},
+            {"MissNV", 0x800}, {"IntersectionNV", 0x1000}, {"CallableNV", 0x2000}
+        });
+        return _enum<vk::ShaderStageFlagBits>(R, T, "shader stage");
+    }
+
+    static vk::DescriptorType _descriptorType(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Sampler", 0}, {"CombinedImageSampler", 1}, {"SampledImage", 2}, {"StorageImage", 3},
+            {"UniformTexelBuffer", 4}, {"StorageTexelBuffer", 5}, {"UniformBuffer", 6},
+            {"StorageBuffer", 7}, {"UniformBufferDynamic", 8}, {"StorageBufferDynamic", 9},
+            {"InputAttachment", 10}, {"InlineUniformBlockEXT", 1000138000}, {"AccelerationStructureNV", 1000165000}
+        });
+        return _enum<vk::DescriptorType>(R, T, "descriptor type");
+    }
+
+    static vk::DynamicState _dynamicState(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Viewport", 0}, {"Scissor", 1}, {"LineWidth", 2}, {"DepthBias", 3}, {"BlendConstants", 4},
+            {"DepthBounds", 5}, {"StencilCompareMask", 6}, {"StencilWriteMask", 7}, {"StencilReference", 8},
+            {"ViewportWScalingNV", 1000087000}, {"DiscardRectangleEXT", 1000099000},
+            {"SampleLocationsEXT", 1000143000}, {"ViewportShadingRatePaletteNV", 1000164004},
+            {"ViewportCoarseSampleOrderNV", 1000164006}, {"ExclusiveScissorNV", 1000205001},
+            {"LineStippleEXT", 1000259000}
+        });
+        return _enum<vk::DynamicState>(R, T, "dynamic state");
+    }
+
+    static vk::LogicOp _logicOp(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Clear", 0}, {"And", 1}, {"AndReverse", 2}, {"Copy", 3}, {"AndInverted", 4}, {"NoOp", 5},
+            {"Xor", 6}, {"Or", 7}, {"Nor", 8}, {"Equivalent", 9}, {"Invert", 10}, {"OrReverse", 11},
+            {"CopyInverted", 12}, {"OrInverted", 13}, {"Nand", 14}, {"Set", 15}
+        });
+        return _enum<vk::LogicOp>(R, T, "logic op");
+    }
+
+    static vk::PrimitiveTopology _topology(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"PointList", 0}, {"LineList", 1}, {"LineStrip", 2}, {"TriangleList", 3}, {"TriangleStrip", 4},
+            {"TriangleFan", 5}, {"LineListWithAdjacency", 6}, {"LineStripWithAdjacency", 7},
+            {"TriangleListWithAdjacency", 8}, {"TriangleStripWithAdjacency", 9}, {"PatchList", 10}
+        });
+        return _enum<vk::PrimitiveTopology>(R, T, "topology");
+    }
+
+    static vk::VertexInputRate _inputRate(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({ {"Vertex", 0}, {"Instance", 1} });
+        return _enum<vk::VertexInputRate>(R, T, "input rate");
+    }
+
+    static vk::PolygonMode _polygonMode(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({ {"Fill", 0}, {"Line", 1}, {"Point", 2} });
+        return _enum<vk::PolygonMode>(R, T, "polygon mode");
+    }
+
+    static vk::CullModeFlagBits _cullMode(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({ {"None", 0}, {"Front", 1}, {"Back", 2}, {"FrontAndBack", 3} });
+        return _enum<vk::CullModeFlagBits>(R, T, "cull mode");
+    }
+
+    static vk::FrontFace _frontFace(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({ {"CounterClockwise", 0}, {"Clockwise", 1} });
+        return _enum<vk::FrontFace>(R, T, "front face");
+    }
+
+    static vk::CompareOp _compareOp(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"Never", 0}, {"Less", 1}, {"Equal", 2}, {"LessOrEqual", 3}, {"Greater", 4},
+            {"NotEqual", 5}, {"GreaterOrEqual", 6}, {"Always", 7}
+        });
+        return _enum<vk::CompareOp>(R, T, "compare op");
+    }
+
+    static vk::SampleCountFlagBits _sampleCount(JsonReader & R)
+    {
+        static constexpr auto T = makePerfectHashTable({
+            {"1", 1}, {"2", 2}, {"4", 4}, {"8", 8}, {"16", 16}, {"32", 32}, {"64", 64}
+        });
+        return _enum<vk::SampleCountFlagBits>(R, T, "sample count");
+    }
+
+    //=========================================================================
+    // Sections of the document
+    //=========================================================================
+    static void _layout(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & layout = std::get<PipelineLayoutCreateInfo2>(info.layout);
+        R.object([&](std::string_view key)
+        {
+            if( key != "descriptorSets" )
+                return R.skip();
+
+            R.array([&]
+            {
+                uint32_t set = 0;
+                DescriptorSetLayoutCreateInfo2 dsl;
+                R.object([&](std::string_view k)
+                {
+                    if( k == "set" )
+                        set = R.integer();
+                    else if( k == "bindings" )
+                        R.array([&]{ _binding(R, dsl); });
+                    else
+                        R.skip();
+                });
+
+                auto & sets = layout.setLayoutsDescriptions;
+                if( set >= sets.size() )
+                    sets.resize(set+1);
+                sets[set] = std::move(dsl);
+            });
+        });
+    }
+
+    static void _binding(JsonReader & R, DescriptorSetLayoutCreateInfo2 & dsl)
+    {
+        uint32_t             binding = 0;
+        uint32_t             count   = 1;
+        vk::DescriptorType   type    = vk::DescriptorType::eUniformBuffer;
+        vk::ShaderStageFlags stages;
+
+        R.object([&](std::string_view key)
+        {
+            if(      key == "binding"         ) binding = R.integer();
+            else if( key == "descriptorCount" ) count   = R.integer();
+            else if( key == "descriptorType"  ) type    = _descriptorType(R);
+            else if( key == "stageFlags"      ) R.array([&]{ stages |= _shaderStage(R); });
+            else R.skip();
+        });
+        dsl.addDescriptor(binding, type, count, stages);
+    }
+
+    static void _dynamicStates(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        R.object([&](std::string_view key)
+        {
+            if( key == "dynamicStates" )
+                R.array([&]{ info.dynamicStates.push_back( _dynamicState(R) ); });
+            else
+                R.skip();
+        });
+    }
+
+    static void _colorBlendState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & B = info.blendState;
+        R.object([&](std::string_view key)
+        {
+            if( key == "ColorBlendAttachmentState" )
+            {
+                R.array([&]
+                {
+                    auto & a = info.addBlendStateAttachment();
+                    R.object([&](std::string_view k)
+                    {
+                        if(      k == "blendEnable"         ) a.blendEnable         = R.boolean();
+                        else if( k == "srcColorBlendFactor" ) a.srcColorBlendFactor = _blendFactor(R);
+                        else if( k == "dstColorBlendFactor" ) a.dstColorBlendFactor = _blendFactor(R);
+                        else if( k == "colorBlendOp"        ) a.colorBlendOp        = _blendOp(R);
+                        else if( k == "srcAlphaBlendFactor" ) a.srcAlphaBlendFactor = _blendFactor(R);
+                        else if( k == "dstAlphaBlendFactor" ) a.dstAlphaBlendFactor = _blendFactor(R);
+                        else if( k == "alphaBlendOp"        ) a.alphaBlendOp        = _blendOp(R);
+                        else if( k == "ColorComponentFlagBits.R" ) _colorComponent(R, a, vk::ColorComponentFlagBits::eR);
+                        else if( k == "ColorComponentFlagBits.G" ) _colorComponent(R, a, vk::ColorComponentFlagBits::eG);
+                        else if( k == "ColorComponentFlagBits.B" ) _colorComponent(R, a, vk::ColorComponentFlagBits::eB);
+                        else if( k == "ColorComponentFlagBits.A" ) _colorComponent(R, a, vk::ColorComponentFlagBits::eA);
+                        else R.skip();
+                    });
+                });
+            }
+            else if( key == "logicOpEnable" ) B.logicOpEnable = R.boolean();
+            else if( key == "logicOp"       ) B.logicOp       = _logicOp(R);
+            else if( key == "blendConstants")
+            {
+                size_t i=0;
+                R.array([&]
+                {
+                    auto v = static_cast<float>(R.number());
+                    if( i < 4 )
+                        B.blendConstants[i++] = v;
+                });
+            }
+            else R.skip();
+        });
+    }
+
+    static void _colorComponent(JsonReader & R, vk::PipelineColorBlendAttachmentState & a, vk::ColorComponentFlagBits bit)
+    {
+        if( R.boolean() )
+            a.colorWriteMask |= bit;
+        else
+            a.colorWriteMask &= ~vk::ColorComponentFlags(bit);
+    }
+
+    static void _inputAssemblyState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        R.object([&](std::string_view key)
+        {
+            if( key == "topology" )
+                info.inputAssemblyState.topology = _topology(R);
+            else
+                R.skip();
+        });
+    }
+
+    static void _vertexInputState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & V = info.vertexInputState;
+        R.object([&](std::string_view key)
+        {
+            if( key == "vertexAttributeDescriptions" )
+            {
+                R.array([&]
+                {
+                    auto & a = V.vertexAttributeDescriptions.emplace_back();
+                    a.format = vk::Format::eR32G32B32Sfloat;
+                    R.object([&](std::string_view k)
+                    {
+                        if(      k == "format"   ) a.format   = _format(R);
+                        else if( k == "location" ) a.location = R.integer();
+                        else if( k == "binding"  ) a.binding  = R.integer();
+                        else if( k == "offset"   ) a.offset   = R.integer();
+                        else R.skip();
+                    });
+                });
+            }
+            else if( key == "vertexBindingDescriptions" )
+            {
+                R.array([&]
+                {
+                    auto & b = V.vertexBindingDescriptions.emplace_back();
+                    b.inputRate = vk::VertexInputRate::eVertex;
+                    R.object([&](std::string_view k)
+                    {
+                        if(      k == "binding"   ) b.binding   = R.integer();
+                        else if( k == "stride"    ) b.stride    = R.integer();
+                        else if( k == "inputRate" ) b.inputRate = _inputRate(R);
+                        else R.skip();
+                    });
+                });
+            }
+            else R.skip();
+        });
+    }
+
+    static void _rasterizationState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & S = info.rasterizationState;
+        R.object([&](std::string_view key)
+        {
+            if(      key == "DepthBiasClamp"          ) S.depthBiasClamp          = R.numberOrBoolean();
+            else if( key == "DepthClampEnable"        ) S.depthClampEnable        = R.boolean();
+            else if( key == "RasterizerDiscardEnable" ) S.rasterizerDiscardEnable = R.boolean();
+            else if( key == "PolygonMode"             ) S.polygonMode             = _polygonMode(R);
+            else if( key == "LineWidth"               ) S.lineWidth               = static_cast<float>(R.number());
+            else if( key == "CullMode"                ) S.cullMode                = _cullMode(R);
+            else if( key == "FrontFace"               ) S.frontFace               = _frontFace(R);
+            else if( key == "DepthBiasEnable"         ) S.depthBiasEnable         = R.boolean();
+            else R.skip();
+        });
+    }
+
+    static void _depthStencilState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & S = info.depthStencilState;
+        R.object([&](std::string_view key)
+        {
+            if(      key == "DepthTestEnable"       ) S.depthTestEnable       = R.boolean();
+            else if( key == "DepthWriteEnable"      ) S.depthWriteEnable      = R.boolean();
+            else if( key == "DepthCompareOp"        ) S.depthCompareOp        = _compareOp(R);
+            else if( key == "DepthBoundsTestEnable" ) S.depthBoundsTestEnable = R.boolean();
+            else if( key == "MinDepthBounds"        ) S.minDepthBounds        = static_cast<float>(R.number());
+            else if( key == "MaxDepthBounds"        ) S.maxDepthBounds        = static_cast<float>(R.number());
+            else if( key == "StencilTestEnable"     ) S.stencilTestEnable     = R.boolean();
+            else R.skip();
+        });
+    }
+
+    static void _multisampleState(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        auto & S = info.multisampleState;
+        R.object([&](std::string_view key)
+        {
+            if(      key == "SampleShadingEnable"  ) S.sampleShadingEnable  = R.boolean();
+            else if( key == "RasterizationSamples" ) S.rasterizationSamples = _sampleCount(R);
+            else R.skip();
+        });
+    }
+
+    static std::pair<vk::Format, vk::ImageLayout> _attachment(JsonReader & R, vk::ImageLayout finalLayout)
+    {
+        std::pair<vk::Format, vk::ImageLayout> a{vk::Format::eUndefined, finalLayout};
+        R.object([&](std::string_view key)
+        {
+            if(      key == "format"      ) a.first  = _format(R);
+            else if( key == "finalLayout" ) a.second = _imageLayout(R);
+            else R.skip();
+        });
+        if( a.first == vk::Format::eUndefined )
+            R.error("Render pass attachments must have a format");
+        return a;
+    }
+
+    static void _renderPass(JsonReader & R, GraphicsPipelineCreateInfo2 & info)
+    {
+        std::vector< std::pair<vk::Format, vk::ImageLayout> > colors;
+        std::pair<vk::Format, vk::ImageLayout>                depth{vk::Format::eUndefined, vk::ImageLayout::eUndefined};
+
+        R.object([&](std::string_view key)
+        {
+            if( key == "colorAttachments" )
+                R.array([&]{ colors.push_back( _attachment(R, vk::ImageLayout::eColorAttachmentOptimal) ); });
+            else if( key == "depthAttachment" )
+                depth = _attachment(R, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+            else
+                R.skip();
+        });
+        info.renderPass = RenderPassCreateInfo2::createSimpleRenderPass(colors, depth);
+    }
+};
+
+}
+
+#endif
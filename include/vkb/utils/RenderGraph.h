@@ -0,0 +1,714 @@
+#ifndef VKB_RENDERGRAPH_H
+#define VKB_RENDERGRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <optional>
+#include "../detail/RenderPassCreateInfo2.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The RenderGraph struct
+ *
+ * A declarative way of building RenderPassCreateInfo2 structs. Each
+ * pass declares which resources it reads and writes, and compile()
+ * will generate the renderpasses, subpasses, dependencies and layouts.
+ *
+ * Passes are executed in the order they are added.
+ *
+ * vkb::RenderGraph G;
+ *
+ * G.addResource("albedo",    vk::Format::eR8G8B8A8Unorm);
+ * G.addResource("depth",     vk::Format::eD32Sfloat);
+ * G.addResource("hdr",       vk::Format::eR16G16B16A16Sfloat);
+ * G.addResource("swapchain", vk::Format::eB8G8R8A8Unorm);
+ *
+ * G.addPass("gbuffer")  .addColorOutput("albedo").setDepthOutput("depth");
+ * G.addPass("lighting") .addInputAttachment("albedo").addInputAttachment("depth").addColorOutput("hdr");
+ * G.addPass("tonemap")  .addSampledInput("hdr").addColorOutput("swapchain");
+ *
+ * G.setOutput("swapchain", vk::ImageLayout::ePresentSrcKHR);
+ *
+ * auto compiled = G.compile();
+ *
+ * // compiled.renderPasses[0] contains 2 subpasses: gbuffer and lighting. albedo and depth
+ * //                          are never written to memory.
+ * // compiled.renderPasses[1] contains 1 subpass: tonemap
+ *
+ * Passes which do not contribute to an output are culled.
+ *
+ * Consecutive passes are merged into subpasses of the same renderpass
+ * unless a pass samples a resource which was written in the current
+ * renderpass, writes to a resource which was sampled in the current
+ * renderpass, or uses a different sample count or extent.
+ *
+ * Resources which are not the size of the output, eg: shadow map cascades,
+ * are given an extent, so that they are never put in the same renderpass
+ * (and framebuffer) as attachments of another size:
+ *
+ * G.addResource("shadow0", vk::Format::eD32Sfloat, {2048, 2048});
+ */
+struct RenderGraph
+{
+    struct Resource
+    {
+        std::string             name;
+        vk::Format              format        = vk::Format::eUndefined;
+        vk::SampleCountFlagBits samples       = vk::SampleCountFlagBits::e1;
+
+        // the size of the resource, 0x0 for the size of the output
+        vk::Extent2D            extent;
+
+        // if not eUndefined, the contents of the resource are valid
+        // before the graph is executed and are in this layout.
+        vk::ImageLayout         initialLayout = vk::ImageLayout::eUndefined;
+
+        // the resource is used after the graph has been executed
+        // and must be transitioned to finalLayout
+        bool                    isOutput      = false;
+        vk::ImageLayout         finalLayout   = vk::ImageLayout::eUndefined;
+    };
+
+    struct Pass
+    {
+        std::string                name;
+        std::vector<std::string>   colorOutputs;
+        std::optional<std::string> depthOutput;      // depth attachment which is written to
+        std::optional<std::string> depthInput;       // read-only depth attachment
+        std::vector<std::string>   inputAttachments; // read at the current pixel location (subpassLoad)
+        std::vector<std::string>   sampledInputs;    // read as a texture
+
+        Pass& addColorOutput(std::string const & r)
+        {
+            colorOutputs.push_back(r);
+            return *this;
+        }
+        Pass& setDepthOutput(std::string const & r)
+        {
+            depthOutput = r;
+            return *this;
+        }
+        Pass& setDepthInput(std::string const & r)
+        {
+            depthInput = r;
+            return *this;
+        }
+        Pass& addInputAttachment(std::string const & r)
+        {
+            inputAttachments.push_back(r);
+            return *this;
+        }
+        Pass& addSampledInput(std::string const & r)
+        {
+            sampledInputs.push_back(r);
+            return *this;
+        }
+    };
+
+    struct CompiledRenderPass
+    {
+        vkb::RenderPassCreateInfo2 renderPass;
+        std::vector<std::string>   attachments; // the resource name of each attachment
+        std::vector<std::string>   subpasses;   // the pass name of each subpass
+        vk::Extent2D               extent;      // the framebuffer size, 0x0 for the size of the output
+    };
+
+    struct CompiledGraph
+    {
+        std::vector<CompiledRenderPass> renderPasses;
+        std::vector<std::string>        culledPasses;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass>     passes;
+
+    //=========================================================================
+    // Helper functions
+    //=========================================================================
+    Resource& addResource(std::string const & name, vk::Format format, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1)
+    {
+        auto & r   = resources.emplace_back();
+        r.name     = name;
+        r.format   = format;
+        r.samples  = samples;
+        return r;
+    }
+
+    Resource& addResource(std::string const & name, vk::Format format, vk::Extent2D extent, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1)
+    {
+        auto & r   = addResource(name, format, samples);
+        r.extent   = extent;
+        return r;
+    }
+
+    Pass& addPass(std::string const & name)
+    {
+        auto & p = passes.emplace_back();
+        p.name   = name;
+        return p;
+    }
+
+    void setOutput(std::string const & name, vk::ImageLayout finalLayout)
+    {
+        auto & r       = resources.at( _findResource(name) );
+        r.isOutput     = true;
+        r.finalLayout  = finalLayout;
+    }
+
+    /**
+     * @brief compile
+     * @return
+     *
+     * Compile the graph into a list of renderpasses. Throws std::runtime_error
+     * if a pass references a resource which has not been added, if
+     * a pass does not write to any attachments, or if the attachments
+     * of a pass have different extents.
+     */
+    CompiledGraph compile() const
+    {
+        CompiledGraph out;
+
+        auto live = _cullPasses();
+
+        for(size_t i=0;i<passes.size();i++)
+        {
+            if( !live[i] )
+                out.culledPasses.push_back(passes[i].name);
+        }
+
+        // the accesses of each resource, in pass order
+        std::vector< std::vector<_access> > accesses(resources.size());
+        for(size_t i=0;i<passes.size();i++)
+        {
+            if( !live[i] )
+                continue;
+            for(auto & a : _passAccesses(i))
+            {
+                accesses[a.first].push_back(a.second);
+            }
+        }
+
+        auto groups = _groupPasses(live);
+
+        // the layout each resource is currently in
+        std::vector<vk::ImageLayout> currentLayout;
+        for(auto & r : resources)
+            currentLayout.push_back(r.initialLayout);
+
+        for(auto & g : groups)
+        {
+            out.renderPasses.push_back( _compileGroup(g, accesses, currentLayout) );
+        }
+        return out;
+    }
+
+    static bool isDepthFormat(vk::Format f)
+    {
+        switch(f)
+        {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+            case vk::Format::eS8Uint:
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool hasStencil(vk::Format f)
+    {
+        switch(f)
+        {
+            case vk::Format::eS8Uint:
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+protected:
+    // how a single pass accesses a single resource
+    struct _access
+    {
+        size_t                 pass   = 0;
+        bool                   write  = false;
+        bool                   sampled= false; // read as a texture, not as an attachment
+        vk::ImageLayout        layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags        access;
+    };
+
+    size_t _findResource(std::string const & name) const
+    {
+        for(size_t i=0;i<resources.size();i++)
+        {
+            if( resources[i].name == name)
+                return i;
+        }
+        throw std::runtime_error("RenderGraph: resource " + name + " has not been added");
+    }
+
+    std::vector<size_t> _writes(Pass const & p) const
+    {
+        std::vector<size_t> w;
+        for(auto & c : p.colorOutputs)
+            w.push_back( _findResource(c) );
+        if( p.depthOutput.has_value() )
+            w.push_back( _findResource(*p.depthOutput) );
+        return w;
+    }
+
+    std::vector<size_t> _reads(Pass const & p) const
+    {
+        std::vector<size_t> r;
+        for(auto & c : p.inputAttachments)
+            r.push_back( _findResource(c) );
+        for(auto & c : p.sampledInputs)
+            r.push_back( _findResource(c) );
+        if( p.depthInput.has_value() )
+            r.push_back( _findResource(*p.depthInput) );
+        return r;
+    }
+
+    // returns the combined access of each resource used by the pass.
+    std::map<size_t, _access> _passAccesses(size_t passIndex) const
+    {
+        auto & p = passes[passIndex];
+
+        std::map<size_t, _access> A;
+
+        auto _add = [&](std::string const & name, bool write, bool sampled, vk::ImageLayout layout, vk::PipelineStageFlags stages, vk::AccessFlags access)
+        {
+            auto i = _findResource(name);
+            auto f = A.find(i);
+            if( f == A.end() )
+            {
+                _access a;
+                a.pass    = passIndex;
+                a.write   = write;
+                a.sampled = sampled;
+                a.layout  = layout;
+                a.stages  = stages;
+                a.access  = access;
+                A[i]      = a;
+            }
+            else
+            {
+                auto & a   = f->second;
+                a.stages  |= stages;
+                a.access  |= access;
+                a.sampled  = a.sampled && sampled;
+                // the attachment layout takes priority over
+                // the input attachment/sampled layout
+                if( write || (!a.write && a.layout == vk::ImageLayout::eShaderReadOnlyOptimal) )
+                    a.layout = layout;
+                a.write = a.write || write;
+            }
+        };
+
+        auto const fragTests = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+
+        for(auto & c : p.colorOutputs)
+            _add(c, true, false, vk::ImageLayout::eColorAttachmentOptimal,
+                 vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                 vk::AccessFlagBits::eColorAttachmentWrite);
+
+        if( p.depthOutput.has_value() && p.depthInput.has_value() )
+            throw std::runtime_error("RenderGraph: pass " + p.name + " cannot have both a depth input and a depth output");
+
+        if( p.depthOutput.has_value() )
+            _add(*p.depthOutput, true, false, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                 fragTests,
+                 vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+        if( p.depthInput.has_value() )
+            _add(*p.depthInput, false, false, vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                 fragTests,
+                 vk::AccessFlagBits::eDepthStencilAttachmentRead);
+
+        for(auto & c : p.inputAttachments)
+        {
+            auto isDepth = isDepthFormat( resources[_findResource(c)].format );
+            _add(c, false, false, isDepth ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal,
+                 vk::PipelineStageFlagBits::eFragmentShader,
+                 vk::AccessFlagBits::eInputAttachmentRead);
+        }
+
+        for(auto & c : p.sampledInputs)
+            _add(c, false, true, vk::ImageLayout::eShaderReadOnlyOptimal,
+                 vk::PipelineStageFlagBits::eFragmentShader,
+                 vk::AccessFlagBits::eShaderRead);
+
+        return A;
+    }
+
+    // walk backwards from the outputs and mark all the passes
+    // which contribute to them.
+    std::vector<bool> _cullPasses() const
+    {
+        std::vector<bool> live(passes.size(), false);
+        std::set<size_t>  needed;
+
+        for(size_t i=0;i<resources.size();i++)
+        {
+            if( resources[i].isOutput )
+                needed.insert(i);
+        }
+
+        for(size_t j=passes.size(); j-- > 0; )
+        {
+            auto & p = passes[j];
+
+            auto writes = _writes(p);
+            auto reads  = _reads(p);
+
+            if( writes.empty() )
+                throw std::runtime_error("RenderGraph: pass " + p.name + " does not write to any attachments");
+
+            for(auto w : writes)
+            {
+                if( needed.count(w) )
+                {
+                    live[j] = true;
+                    break;
+                }
+            }
+
+            if( live[j] )
+            {
+                needed.insert(reads.begin(), reads.end());
+            }
+        }
+        return live;
+    }
+
+    vk::SampleCountFlagBits _passSamples(Pass const & p) const
+    {
+        return resources[ _writes(p).front() ].samples;
+    }
+
+    static bool _sameExtent(vk::Extent2D a, vk::Extent2D b)
+    {
+        return a.width == b.width && a.height == b.height;
+    }
+
+    // the extent of all the attachments of the pass. Sampled inputs
+    // are not attachments, so they can have any size.
+    vk::Extent2D _passExtent(Pass const & p) const
+    {
+        auto attachments = _writes(p);
+        for(auto & c : p.inputAttachments)
+            attachments.push_back( _findResource(c) );
+        if( p.depthInput.has_value() )
+            attachments.push_back( _findResource(*p.depthInput) );
+
+        auto e = resources[ attachments.front() ].extent;
+        for(auto a : attachments)
+        {
+            if( !_sameExtent(resources[a].extent, e) )
+                throw std::runtime_error("RenderGraph: the attachments of pass " + p.name + " have different extents");
+        }
+        return e;
+    }
+
+    // group consecutive live passes together so that they
+    // can be executed as subpasses of the same renderpass
+    std::vector< std::vector<size_t> > _groupPasses(std::vector<bool> const & live) const
+    {
+        std::vector< std::vector<size_t> > groups;
+
+        std::set<size_t>        writtenInGroup;
+        std::set<size_t>        sampledInGroup;
+        vk::SampleCountFlagBits groupSamples = vk::SampleCountFlagBits::e1;
+        vk::Extent2D            groupExtent;
+
+        for(size_t i=0;i<passes.size();i++)
+        {
+            if( !live[i] )
+                continue;
+
+            auto & p = passes[i];
+
+            bool newGroup = groups.empty()
+                         || _passSamples(p) != groupSamples
+                         || !_sameExtent(_passExtent(p), groupExtent);
+
+            std::set<size_t> sampled;
+            for(auto & s : p.sampledInputs)
+                sampled.insert( _findResource(s) );
+
+            auto writes = _writes(p);
+
+            for(auto s : sampled)
+            {
+                if( writtenInGroup.count(s) )
+                    newGroup = true;
+            }
+            for(auto w : writes)
+            {
+                if( sampledInGroup.count(w) )
+                    newGroup = true;
+            }
+
+            if( newGroup )
+            {
+                groups.emplace_back();
+                writtenInGroup.clear();
+                sampledInGroup.clear();
+                groupSamples = _passSamples(p);
+                groupExtent  = _passExtent(p);
+            }
+
+            groups.back().push_back(i);
+            writtenInGroup.insert(writes.begin(), writes.end());
+            sampledInGroup.insert(sampled.begin(), sampled.end());
+        }
+        return groups;
+    }
+
+    static void _addDependency(std::vector<vk::SubpassDependency> & deps,
+                               uint32_t src, uint32_t dst,
+                               vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess,
+                               vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+    {
+        for(auto & d : deps)
+        {
+            if( d.srcSubpass == src && d.dstSubpass == dst)
+            {
+                d.srcStageMask  |= srcStage;
+                d.srcAccessMask |= srcAccess;
+                d.dstStageMask  |= dstStage;
+                d.dstAccessMask |= dstAccess;
+                return;
+            }
+        }
+        auto & d = deps.emplace_back();
+        d.srcSubpass      = src;
+        d.dstSubpass      = dst;
+        d.srcStageMask    = srcStage;
+        d.srcAccessMask   = srcAccess;
+        d.dstStageMask    = dstStage;
+        d.dstAccessMask   = dstAccess;
+        d.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+    }
+
+    // only the write accesses need to be made available
+    static vk::AccessFlags _writeAccess(vk::AccessFlags a)
+    {
+        return a & (vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+    }
+
+    CompiledRenderPass _compileGroup(std::vector<size_t> const & group,
+                                     std::vector< std::vector<_access> > const & accesses,
+                                     std::vector<vk::ImageLayout> & currentLayout) const
+    {
+        CompiledRenderPass C;
+        auto & R = C.renderPass;
+
+        auto firstPass = group.front();
+        auto lastPass  = group.back();
+
+        C.extent = _passExtent(passes[firstPass]);
+
+        // the subpass index of each pass in the group
+        std::map<size_t, uint32_t> subpassIndex;
+        for(auto p : group)
+        {
+            subpassIndex[p] = static_cast<uint32_t>(subpassIndex.size());
+            C.subpasses.push_back(passes[p].name);
+        }
+
+        // the resources used as attachments in the group, in order of first use
+        // sampled resources are not attachments.
+        std::vector<size_t>        attachmentResources;
+        std::map<size_t, uint32_t> attachmentIndex;
+        for(auto p : group)
+        {
+            for(auto & a : _passAccesses(p))
+            {
+                if( a.second.sampled || attachmentIndex.count(a.first) )
+                    continue;
+                attachmentIndex[a.first] = static_cast<uint32_t>(attachmentResources.size());
+                attachmentResources.push_back(a.first);
+            }
+        }
+
+        //=====================================================================
+        // Attachment descriptions
+        //=====================================================================
+        for(auto r : attachmentResources)
+        {
+            auto & res = resources[r];
+            auto & acc = accesses[r];
+
+            _access const * previous = nullptr; // last access before this group
+            _access const * next     = nullptr; // first access after this group
+            _access const * lastUse  = nullptr; // last access in this group
+
+            for(auto & a : acc)
+            {
+                if( a.pass < firstPass)
+                    previous = &a;
+                else if( a.pass <= lastPass )
+                    lastUse = &a;
+                else if( next == nullptr )
+                    next = &a;
+            }
+
+            bool load  = previous != nullptr || res.initialLayout != vk::ImageLayout::eUndefined;
+            bool store = next     != nullptr || res.isOutput;
+
+            auto & d = R.attachments.emplace_back();
+            d.format  = res.format;
+            d.samples = res.samples;
+            d.loadOp  = load  ? vk::AttachmentLoadOp::eLoad   : vk::AttachmentLoadOp::eClear;
+            d.storeOp = store ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+
+            d.stencilLoadOp  = hasStencil(res.format) ? d.loadOp  : vk::AttachmentLoadOp::eDontCare;
+            d.stencilStoreOp = hasStencil(res.format) ? d.storeOp : vk::AttachmentStoreOp::eDontCare;
+
+            d.initialLayout  = load ? currentLayout[r] : vk::ImageLayout::eUndefined;
+
+            if( next )
+                d.finalLayout = next->layout;
+            else if( res.isOutput && res.finalLayout != vk::ImageLayout::eUndefined )
+                d.finalLayout = res.finalLayout;
+            else
+                d.finalLayout = lastUse->layout;
+
+            currentLayout[r] = d.finalLayout;
+
+            //=================================================================
+            // External dependencies
+            //=================================================================
+            auto firstUse = std::find_if(acc.begin(), acc.end(), [&](_access const & a){ return a.pass >= firstPass;});
+            if( previous )
+            {
+                _addDependency(R.dependencies, VK_SUBPASS_EXTERNAL, subpassIndex.at(firstUse->pass),
+                               previous->stages, _writeAccess(previous->access),
+                               firstUse->stages, firstUse->access);
+            }
+            else if( load )
+            {
+                _addDependency(R.dependencies, VK_SUBPASS_EXTERNAL, subpassIndex.at(firstUse->pass),
+                               vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlagBits::eMemoryRead,
+                               firstUse->stages, firstUse->access);
+            }
+
+            if( next )
+            {
+                _addDependency(R.dependencies, subpassIndex.at(lastUse->pass), VK_SUBPASS_EXTERNAL,
+                               lastUse->stages, _writeAccess(lastUse->access),
+                               next->stages, next->access);
+            }
+            else if( store )
+            {
+                _addDependency(R.dependencies, subpassIndex.at(lastUse->pass), VK_SUBPASS_EXTERNAL,
+                               lastUse->stages, _writeAccess(lastUse->access),
+                               vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlagBits::eMemoryRead);
+            }
+        }
+
+        //=====================================================================
+        // Subpasses
+        //=====================================================================
+        for(auto p : group)
+        {
+            auto & P = passes[p];
+            auto & s = R.subpasses.emplace_back();
+            s.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+
+            for(auto & c : P.colorOutputs)
+                s.colorAttachments.emplace_back( attachmentIndex.at(_findResource(c)), vk::ImageLayout::eColorAttachmentOptimal);
+
+            if( P.depthOutput.has_value() )
+                s.depthStencilAttachment = vk::AttachmentReference( attachmentIndex.at(_findResource(*P.depthOutput)), vk::ImageLayout::eDepthStencilAttachmentOptimal);
+            if( P.depthInput.has_value() )
+                s.depthStencilAttachment = vk::AttachmentReference( attachmentIndex.at(_findResource(*P.depthInput)), vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+
+            for(auto & c : P.inputAttachments)
+            {
+                auto r = _findResource(c);
+                s.inputAttachments.emplace_back( attachmentIndex.at(r), isDepthFormat(resources[r].format) ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal);
+            }
+        }
+
+        //=====================================================================
+        // Preserve attachments and dependencies between subpasses
+        //=====================================================================
+        for(auto r : attachmentResources)
+        {
+            auto i = attachmentIndex.at(r);
+            auto & d = R.attachments[i];
+
+            std::vector<_access> inGroup;
+            for(auto & a : accesses[r])
+            {
+                if( a.pass >= firstPass && a.pass <= lastPass)
+                    inGroup.push_back(a);
+            }
+
+            // the contents must be preserved through every subpass between
+            // the first and last use, or until the end of the renderpass if
+            // the attachment is stored, including the last subpass
+            auto first = subpassIndex.at(inGroup.front().pass);
+            auto end   = d.storeOp == vk::AttachmentStoreOp::eStore ? static_cast<uint32_t>(group.size()) : subpassIndex.at(inGroup.back().pass);
+            for(uint32_t s = first+1; s < end; s++)
+            {
+                bool used = std::any_of(inGroup.begin(), inGroup.end(), [&](_access const & a){ return subpassIndex.at(a.pass) == s;});
+                if( !used )
+                    R.subpasses[s].preserveAttachments.push_back(i);
+            }
+
+            // only add dependencies on the most recent writer/readers
+            _access const *               lastWriter = nullptr;
+            std::vector<_access const*>   readersSinceWrite;
+            for(auto & a : inGroup)
+            {
+                auto dst = subpassIndex.at(a.pass);
+                if( lastWriter )
+                {
+                    _addDependency(R.dependencies, subpassIndex.at(lastWriter->pass), dst,
+                                   lastWriter->stages, _writeAccess(lastWriter->access),
+                                   a.stages, a.access);
+                }
+                if( a.write )
+                {
+                    for(auto rd : readersSinceWrite)
+                    {
+                        _addDependency(R.dependencies, subpassIndex.at(rd->pass), dst,
+                                       rd->stages, {},
+                                       a.stages, a.access);
+                    }
+                    readersSinceWrite.clear();
+                    lastWriter = &a;
+                }
+                else
+                {
+                    readersSinceWrite.push_back(&a);
+                }
+            }
+
+            C.attachments.push_back(resources[r].name);
+        }
+
+        return C;
+    }
+};
+
+}
+
+#endif
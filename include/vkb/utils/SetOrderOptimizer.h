@@ -0,0 +1,299 @@
+#ifndef VKB_SETORDEROPTIMIZER_H
+#define VKB_SETORDEROPTIMIZER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../detail/Storage.h"
+#include "../detail/PipelineLayoutCreateInfo2.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The DrawStream struct
+ *
+ * A recording of the pipeline layouts and descriptor sets used by a
+ * sequence of draws. sets[i] is the descriptor set used at set index i
+ * of the layout.
+ *
+ * vkb::DrawStream D;
+ * D.draw(layout, {frameSet, materialSet, objectSet});
+ */
+struct DrawStream
+{
+    struct Draw
+    {
+        vk::PipelineLayout             layout;
+        std::vector<vk::DescriptorSet> sets;
+    };
+
+    std::vector<Draw> draws;
+
+    void draw(vk::PipelineLayout layout, std::vector<vk::DescriptorSet> sets)
+    {
+        draws.push_back( {layout, std::move(sets)} );
+    }
+};
+
+/**
+ * @brief The SetOrderOptimizer struct
+ *
+ * Descriptor sets stay bound across a pipeline switch only for the set
+ * indices where the two pipeline layouts share the same prefix of set
+ * layouts (and the same push constant ranges). The optimizer reorders the
+ * sets of every pipeline layout in the Storage so the set layouts which
+ * change least often come first, eg: per-frame at set 0, per-material at
+ * set 1, per-object at set 2.
+ *
+ * auto R = vkb::SetOrderOptimizer::optimize(S, drawStream);
+ * printf("%zu rebinds saved\n", R.saved());
+ *
+ * for(auto & L : R.layouts)
+ * {
+ *     // L.createInfo is the reordered layout, the shaders must use the
+ *     // new set indices:
+ *     vkb::SetOrderOptimizer::remapSets(spirv, L.order);
+ * }
+ *
+ * Only layouts created with the Storage are optimized.
+ */
+struct SetOrderOptimizer
+{
+    struct Layout
+    {
+        vk::PipelineLayout        layout;
+        std::vector<uint32_t>     order;      // order[newIndex] = oldIndex
+        PipelineLayoutCreateInfo2 createInfo; // with the reordered setLayouts
+    };
+
+    struct Result
+    {
+        std::vector<Layout> layouts; // sorted by layout handle
+        size_t bindsBefore = 0;      // vkCmdBindDescriptorSets calls needed by the stream
+        size_t bindsAfter  = 0;      // ... after the sets are reordered
+
+        size_t saved() const
+        {
+            return bindsBefore > bindsAfter ? bindsBefore - bindsAfter : 0;
+        }
+
+        Layout const * find(vk::PipelineLayout l) const
+        {
+            auto f = std::lower_bound(layouts.begin(), layouts.end(), l, [](auto & a, auto & b){ return a.layout < b;});
+            return f != layouts.end() && f->layout == l ? &*f : nullptr;
+        }
+    };
+
+    /**
+     * @brief optimize
+     * @param S
+     * @param stream
+     * @return
+     *
+     * Ranks every set layout by how often the set bound with it changes
+     * in the stream, then orders the sets of each pipeline layout by that
+     * rank. Set layouts which are not used in the stream are ranked after
+     * the used ones, by the number of pipeline layouts sharing them.
+     */
+    static Result optimize(Storage const & S, DrawStream const & stream)
+    {
+        struct _Rank
+        {
+            size_t            changes = 0;
+            size_t            users   = 0;
+            uint64_t          hash    = 0;
+            bool              used    = false;
+            vk::DescriptorSet last;
+        };
+        std::map<vk::DescriptorSetLayout, _Rank> ranks;
+
+        for(auto & [h, l] : S.pipelineLayouts)
+        {
+            (void)h;
+            auto c = S.tryGetCreateInfo<PipelineLayoutCreateInfo2>(l);
+            if( !c )
+                continue;
+            for(auto & sl : c->setLayouts)
+            {
+                auto & r = ranks[sl];
+                if( r.users++ == 0 )
+                {
+                    auto d = S.tryGetCreateInfo<DescriptorSetLayoutCreateInfo2>(sl);
+                    r.hash = d ? d->stableHash(S) : 0;
+                }
+            }
+        }
+
+        for(auto & d : stream.draws)
+        {
+            auto & c = _layout(S, d.layout);
+            for(size_t i=0; i<d.sets.size() && i<c.setLayouts.size(); i++)
+            {
+                auto & r = ranks[c.setLayouts[i]];
+                if( !r.used || r.last != d.sets[i] )
+                    r.changes++;
+                r.used = true;
+                r.last = d.sets[i];
+            }
+        }
+
+        auto _before = [&](vk::DescriptorSetLayout a, vk::DescriptorSetLayout b)
+        {
+            auto & x = ranks[a];
+            auto & y = ranks[b];
+            if( x.used    != y.used    ) return x.used;
+            if( x.changes != y.changes ) return x.changes < y.changes;
+            if( x.users   != y.users   ) return x.users   > y.users;
+            return x.hash < y.hash;
+        };
+
+        Result R;
+        for(auto & [h, l] : S.pipelineLayouts)
+        {
+            (void)h;
+            auto c = S.tryGetCreateInfo<PipelineLayoutCreateInfo2>(l);
+            if( !c )
+                continue;
+
+            auto & L = R.layouts.emplace_back();
+            L.layout = l;
+            L.order.resize(c->setLayouts.size());
+            for(uint32_t i=0;i<L.order.size();i++)
+                L.order[i] = i;
+            std::stable_sort(L.order.begin(), L.order.end(), [&](uint32_t a, uint32_t b)
+            {
+                return _before(c->setLayouts[a], c->setLayouts[b]);
+            });
+
+            L.createInfo.pushConstantRanges = c->pushConstantRanges;
+            for(auto i : L.order)
+                L.createInfo.setLayouts.push_back(c->setLayouts[i]);
+        }
+        std::sort(R.layouts.begin(), R.layouts.end(), [](auto & a, auto & b){ return a.layout < b.layout;});
+
+        R.bindsBefore = countBinds(S, stream);
+        R.bindsAfter  = countBinds(S, stream, &R);
+        return R;
+    }
+
+    /**
+     * @brief countBinds
+     * @param S
+     * @param stream
+     * @param reordered
+     * @return
+     *
+     * Returns the number of descriptor sets which must be bound to record
+     * the stream, following the pipeline layout compatibility rules. If
+     * reordered is given, the sets of each draw are moved to their new
+     * index first.
+     */
+    static size_t countBinds(Storage const & S, DrawStream const & stream, Result const * reordered = nullptr)
+    {
+        size_t binds = 0;
+
+        std::vector<vk::DescriptorSetLayout> boundLayouts;
+        std::vector<vk::DescriptorSet>       boundSets;
+        std::vector<vk::PushConstantRange>   const * boundRanges = nullptr;
+
+        std::vector<vk::DescriptorSetLayout> layouts;
+        std::vector<vk::DescriptorSet>       sets;
+
+        for(auto & d : stream.draws)
+        {
+            auto & c = _layout(S, d.layout);
+            auto   L = reordered ? reordered->find(d.layout) : nullptr;
+
+            layouts.clear();
+            sets.clear();
+            for(size_t i=0;i<c.setLayouts.size();i++)
+            {
+                auto old = L ? L->order[i] : static_cast<uint32_t>(i);
+                layouts.push_back( c.setLayouts[old] );
+                sets.push_back( old < d.sets.size() ? d.sets[old] : vk::DescriptorSet() );
+            }
+
+            // the sets stay bound up to the first incompatible set layout
+            size_t keep = 0;
+            if( boundRanges && _equal(*boundRanges, c.pushConstantRanges) )
+            {
+                while( keep < layouts.size() && keep < boundLayouts.size() && layouts[keep] == boundLayouts[keep] )
+                    keep++;
+            }
+            boundSets.resize(keep);
+            boundLayouts = layouts;
+            boundRanges  = &c.pushConstantRanges;
+
+            for(size_t i=0;i<sets.size();i++)
+            {
+                if( sets[i] == vk::DescriptorSet() )
+                    continue;
+                if( i < boundSets.size() && boundSets[i] == sets[i] )
+                    continue;
+                if( boundSets.size() <= i )
+                    boundSets.resize(i+1);
+                boundSets[i] = sets[i];
+                binds++;
+            }
+        }
+        return binds;
+    }
+
+    /**
+     * @brief remapSets
+     * @param spirv
+     * @param order - order[newIndex] = oldIndex, as in Layout::order
+     *
+     * Rewrites the DescriptorSet decorations of a SPIR-V module so the
+     * shader uses the reordered layout.
+     */
+    static void remapSets(std::vector<uint32_t> & spirv, std::vector<uint32_t> const & order)
+    {
+        std::vector<uint32_t> newIndex(order.size());
+        for(uint32_t i=0;i<order.size();i++)
+            newIndex.at(order[i]) = i;
+
+        size_t i = 5;
+        while( i < spirv.size() )
+        {
+            uint32_t count = spirv[i] >> 16;
+            if( count == 0 || i + count > spirv.size() )
+                throw std::runtime_error("Truncated SPIR-V instruction");
+
+            // OpDecorate %id DescriptorSet N
+            if( (spirv[i] & 0xFFFFu) == 71 && count == 4 && spirv[i+2] == 34 && spirv[i+3] < newIndex.size() )
+                spirv[i+3] = newIndex[ spirv[i+3] ];
+            i += count;
+        }
+    }
+
+protected:
+    static PipelineLayoutCreateInfo2 const & _layout(Storage const & S, vk::PipelineLayout l)
+    {
+        auto c = S.tryGetCreateInfo<PipelineLayoutCreateInfo2>(l);
+        if( !c )
+            throw std::runtime_error("The draw stream uses a pipeline layout which was not created with the Storage");
+        return *c;
+    }
+
+    static bool _equal(std::vector<vk::PushConstantRange> const & a, std::vector<vk::PushConstantRange> const & b)
+    {
+        if( a.size() != b.size() )
+            return false;
+        for(size_t i=0;i<a.size();i++)
+        {
+            if( a[i].stageFlags != b[i].stageFlags || a[i].offset != b[i].offset || a[i].size != b[i].size )
+                return false;
+        }
+        return true;
+    }
+};
+
+}
+
+#endif
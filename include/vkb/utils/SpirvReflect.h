@@ -0,0 +1,661 @@
+#ifndef VKB_SPIRVREFLECT_H
+#define VKB_SPIRVREFLECT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "../detail/HashFunctions.h"
+#include "../detail/PipelineCreateInfo2.h"
+#include "../detail/PipelineLayoutCreateInfo2.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The ShaderReflection struct
+ *
+ * The resource interface of a single SPIR-V entry point: the descriptors,
+ * the push constant block and, for vertex shaders, the vertex inputs.
+ * Descriptors are sorted by set/binding and inputs by location.
+ *
+ * auto R = vkb::ShaderReflection::parse(code.data(), code.size(), "main");
+ */
+struct ShaderReflection
+{
+    struct Descriptor
+    {
+        uint32_t           set     = 0;
+        uint32_t           binding = 0;
+        vk::DescriptorType type    = vk::DescriptorType::eSampler;
+        uint32_t           count   = 1;
+    };
+
+    struct VertexInput
+    {
+        uint32_t   location = 0;
+        vk::Format format   = vk::Format::eUndefined;
+        uint32_t   size     = 0; // in bytes
+    };
+
+    vk::ShaderStageFlagBits  stage = vk::ShaderStageFlagBits::eVertex;
+    std::vector<Descriptor>  descriptors;
+    std::vector<VertexInput> inputs;
+
+    // the push constant block, size is 0 if there is none
+    uint32_t pushConstantOffset = 0;
+    uint32_t pushConstantSize   = 0;
+
+    /**
+     * @brief parse
+     * @param code
+     * @param wordCount
+     * @param entryPoint
+     * @return
+     *
+     * Parses the SPIR-V module. Throws a std::runtime_error if the module
+     * is malformed, does not have the entry point, or uses a resource which
+     * cannot be described by a DescriptorSetLayoutCreateInfo2 (eg: runtime
+     * sized descriptor arrays).
+     */
+    static ShaderReflection parse(uint32_t const * code, size_t wordCount, std::string const & entryPoint = "main")
+    {
+        _Module M;
+        M.read(code, wordCount);
+
+        auto ep = std::find_if(M.entryPoints.begin(), M.entryPoints.end(), [&](auto & e){ return e.name == entryPoint;});
+        if( ep == M.entryPoints.end() )
+            throw std::runtime_error("The SPIR-V module does not have the entry point: " + entryPoint);
+
+        ShaderReflection R;
+        R.stage = _stage(ep->executionModel);
+
+        for(auto & v : M.variables)
+        {
+            auto & d = M.decorations[v.id];
+            switch(v.storageClass)
+            {
+                case _UniformConstant:
+                case _Uniform:
+                case _StorageBuffer:
+                {
+                    if( !d.hasSet || !d.hasBinding )
+                        break;
+                    auto & D   = R.descriptors.emplace_back();
+                    D.set      = d.set;
+                    D.binding  = d.binding;
+                    auto t     = M.unwrapArrays( M.pointee(v.resultType), D.count);
+                    D.type     = M.descriptorType(t, v.storageClass);
+                    break;
+                }
+                case _PushConstant:
+                {
+                    auto t = M.pointee(v.resultType);
+                    M.memberRange(t, R.pushConstantOffset, R.pushConstantSize);
+                    break;
+                }
+                case _Input:
+                {
+                    if( R.stage != vk::ShaderStageFlagBits::eVertex || !d.hasLocation || d.builtIn )
+                        break;
+                    if( std::find(ep->interface.begin(), ep->interface.end(), v.id) == ep->interface.end() )
+                        break;
+                    M.vertexInputs( M.pointee(v.resultType), d.location, R.inputs);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        std::sort(R.descriptors.begin(), R.descriptors.end(), [](auto & a, auto & b)
+        {
+            return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+        });
+        std::sort(R.inputs.begin(), R.inputs.end(), [](auto & a, auto & b)
+        {
+            return a.location < b.location;
+        });
+        return R;
+    }
+
+protected:
+    enum : uint32_t
+    {
+        _UniformConstant = 0,
+        _Input           = 1,
+        _Uniform         = 2,
+        _PushConstant    = 9,
+        _StorageBuffer   = 12
+    };
+
+    static vk::ShaderStageFlagBits _stage(uint32_t executionModel)
+    {
+        switch(executionModel)
+        {
+            case 0: return vk::ShaderStageFlagBits::eVertex;
+            case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+            case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+            case 3: return vk::ShaderStageFlagBits::eGeometry;
+            case 4: return vk::ShaderStageFlagBits::eFragment;
+            case 5: return vk::ShaderStageFlagBits::eCompute;
+            default:
+                throw std::runtime_error("Unsupported SPIR-V execution model: " + std::to_string(executionModel));
+        }
+    }
+
+    // The parts of a SPIR-V module which are needed for reflection
+    struct _Module
+    {
+        struct Decoration
+        {
+            uint32_t set = 0, binding = 0, location = 0, arrayStride = 0;
+            bool hasSet = false, hasBinding = false, hasLocation = false;
+            bool block = false, bufferBlock = false, builtIn = false;
+        };
+        struct MemberDecoration
+        {
+            uint32_t offset = 0, matrixStride = 0;
+            bool     rowMajor = false;
+        };
+        struct Type
+        {
+            uint32_t              opcode = 0;
+            std::vector<uint32_t> operands; // without the result id
+        };
+        struct Variable
+        {
+            uint32_t resultType = 0, id = 0, storageClass = 0;
+        };
+        struct EntryPoint
+        {
+            uint32_t              executionModel = 0;
+            std::string           name;
+            std::vector<uint32_t> interface;
+        };
+
+        std::unordered_map<uint32_t, Decoration>                     decorations;
+        std::unordered_map<uint32_t, std::vector<MemberDecoration> > memberDecorations;
+        std::unordered_map<uint32_t, Type>                           types;
+        std::unordered_map<uint32_t, uint32_t>                       constants;
+        std::vector<Variable>                                        variables;
+        std::vector<EntryPoint>                                      entryPoints;
+
+        void read(uint32_t const * code, size_t wordCount)
+        {
+            if( wordCount < 5 || code[0] != 0x07230203u )
+                throw std::runtime_error("Not a SPIR-V module");
+
+            size_t i = 5;
+            while( i < wordCount )
+            {
+                uint32_t opcode = code[i] & 0xFFFFu;
+                uint32_t count  = code[i] >> 16;
+                if( count == 0 || i + count > wordCount )
+                    throw std::runtime_error("Truncated SPIR-V instruction");
+
+                auto op = code + i + 1; // operands
+                auto n  = count - 1;    // number of operands
+
+                switch(opcode)
+                {
+                    case 15: // OpEntryPoint
+                    {
+                        if( n < 3 )
+                            throw std::runtime_error("Truncated SPIR-V entry point");
+                        auto & e = entryPoints.emplace_back();
+                        e.executionModel = op[0];
+                        uint32_t w = 2;
+                        for(; w < n; w++)
+                        {
+                            auto word = op[w];
+                            bool end  = false;
+                            for(uint32_t b=0;b<4;b++)
+                            {
+                                char c = static_cast<char>( (word >> (8*b)) & 0xFF );
+                                if( c == 0 ) { end = true; break; }
+                                e.name.push_back(c);
+                            }
+                            if( end ) { w++; break; }
+                        }
+                        e.interface.assign(op + w, op + n);
+                        break;
+                    }
+                    case 71: // OpDecorate
+                        if( n >= 2 )
+                            decorate( decorations[op[0]], op[1], n >= 3 ? op[2] : 0);
+                        break;
+                    case 72: // OpMemberDecorate
+                        if( n >= 3 )
+                        {
+                            auto & m = memberDecorations[op[0]];
+                            if( m.size() <= op[1] )
+                                m.resize(op[1]+1);
+                            if(      op[2] == 35 && n >= 4 ) m[op[1]].offset       = op[3]; // Offset
+                            else if( op[2] == 7  && n >= 4 ) m[op[1]].matrixStride = op[3]; // MatrixStride
+                            else if( op[2] == 4  )           m[op[1]].rowMajor     = true;  // RowMajor
+                            else if( op[2] == 11 )           decorations[op[0]].builtIn = true;
+                        }
+                        break;
+                    case 43: // OpConstant
+                        if( n >= 3 )
+                            constants[op[1]] = op[2];
+                        break;
+                    case 59: // OpVariable
+                        if( n >= 3 )
+                            variables.push_back( {op[0], op[1], op[2]} );
+                        break;
+                    default:
+                        // OpTypeVoid .. OpTypeForwardPointer and OpTypeAccelerationStructureKHR
+                        if( ((opcode >= 19 && opcode <= 32) || opcode == 5341) && n >= 1 )
+                        {
+                            auto & t = types[op[0]];
+                            t.opcode = opcode;
+                            t.operands.assign(op + 1, op + n);
+                            if( t.operands.size() < minOperands(opcode) )
+                                throw std::runtime_error("Truncated SPIR-V type, opcode: " + std::to_string(opcode));
+                        }
+                        break;
+                }
+                i += count;
+            }
+        }
+
+        static size_t minOperands(uint32_t typeOpcode)
+        {
+            switch(typeOpcode)
+            {
+                case 21: return 2; // OpTypeInt:     width, signedness
+                case 22: return 1; // OpTypeFloat:   width
+                case 23: return 2; // OpTypeVector:  component type, count
+                case 24: return 2; // OpTypeMatrix:  column type, count
+                case 25: return 7; // OpTypeImage
+                case 28: return 2; // OpTypeArray:   element type, length
+                case 29: return 1; // OpTypeRuntimeArray
+                case 32: return 2; // OpTypePointer: storage class, type
+                default: return 0;
+            }
+        }
+
+        static void decorate(Decoration & d, uint32_t decoration, uint32_t value)
+        {
+            switch(decoration)
+            {
+                case 2:  d.block       = true; break;
+                case 3:  d.bufferBlock = true; break;
+                case 6:  d.arrayStride = value; break;
+                case 11: d.builtIn     = true; break;
+                case 30: d.location    = value; d.hasLocation = true; break;
+                case 33: d.binding     = value; d.hasBinding  = true; break;
+                case 34: d.set         = value; d.hasSet      = true; break;
+                default: break;
+            }
+        }
+
+        Type const & type(uint32_t id) const
+        {
+            auto f = types.find(id);
+            if( f == types.end() )
+                throw std::runtime_error("Unknown SPIR-V type id: " + std::to_string(id));
+            return f->second;
+        }
+
+        uint32_t constant(uint32_t id) const
+        {
+            auto f = constants.find(id);
+            if( f == constants.end() )
+                throw std::runtime_error("Array lengths must be constants, specialization constants are not supported");
+            return f->second;
+        }
+
+        uint32_t pointee(uint32_t pointerType) const
+        {
+            auto & t = type(pointerType);
+            if( t.opcode != 32 || t.operands.size() < 2 ) // OpTypePointer
+                throw std::runtime_error("SPIR-V variable is not a pointer");
+            return t.operands[1];
+        }
+
+        uint32_t unwrapArrays(uint32_t id, uint32_t & count) const
+        {
+            count = 1;
+            for(;;)
+            {
+                auto & t = type(id);
+                if( t.opcode == 28 ) // OpTypeArray
+                {
+                    count *= constant(t.operands[1]);
+                    id = t.operands[0];
+                }
+                else if( t.opcode == 29 ) // OpTypeRuntimeArray
+                {
+                    throw std::runtime_error("Runtime sized descriptor arrays are not supported");
+                }
+                else
+                {
+                    return id;
+                }
+            }
+        }
+
+        vk::DescriptorType descriptorType(uint32_t id, uint32_t storageClass) const
+        {
+            auto & t = type(id);
+            switch(t.opcode)
+            {
+                case 26: return vk::DescriptorType::eSampler;              // OpTypeSampler
+                case 27: return vk::DescriptorType::eCombinedImageSampler; // OpTypeSampledImage
+                case 25: // OpTypeImage: sampledType, dim, depth, arrayed, ms, sampled, format
+                {
+                    auto dim     = t.operands[1];
+                    auto sampled = t.operands[5];
+                    if( dim == 6 ) // SubpassData
+                        return vk::DescriptorType::eInputAttachment;
+                    if( dim == 5 ) // Buffer
+                        return sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                    return sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                }
+                case 30: // OpTypeStruct
+                {
+                    if( storageClass == _StorageBuffer )
+                        return vk::DescriptorType::eStorageBuffer;
+                    auto f = decorations.find(id);
+                    if( f != decorations.end() && f->second.bufferBlock )
+                        return vk::DescriptorType::eStorageBuffer;
+                    return vk::DescriptorType::eUniformBuffer;
+                }
+                default:
+                    throw std::runtime_error("Unsupported SPIR-V descriptor type, opcode: " + std::to_string(t.opcode));
+            }
+        }
+
+        // the size in bytes of a type inside a block
+        uint32_t sizeOf(uint32_t id, MemberDecoration const * member = nullptr) const
+        {
+            auto & t = type(id);
+            switch(t.opcode)
+            {
+                case 20: return 4;                  // OpTypeBool
+                case 21:                            // OpTypeInt
+                case 22: return t.operands[0] / 8;  // OpTypeFloat
+                case 23: return t.operands[1] * sizeOf(t.operands[0]); // OpTypeVector
+                case 24:                            // OpTypeMatrix
+                {
+                    auto columns = t.operands[1];
+                    auto rows    = type(t.operands[0]).operands[1];
+                    if( member && member->matrixStride )
+                        return (member->rowMajor ? rows : columns) * member->matrixStride;
+                    return columns * sizeOf(t.operands[0]);
+                }
+                case 28: // OpTypeArray
+                {
+                    auto length = constant(t.operands[1]);
+                    auto f      = decorations.find(id);
+                    if( f != decorations.end() && f->second.arrayStride )
+                        return length * f->second.arrayStride;
+                    return length * sizeOf(t.operands[0], member);
+                }
+                case 30: // OpTypeStruct
+                {
+                    uint32_t offset = 0, size = 0;
+                    memberRange(id, offset, size);
+                    return offset + size;
+                }
+                case 32: return 8; // OpTypePointer, physical storage buffer address
+                default:
+                    throw std::runtime_error("Cannot determine the size of SPIR-V type, opcode: " + std::to_string(t.opcode));
+            }
+        }
+
+        // the byte range covered by the members of a struct
+        void memberRange(uint32_t structId, uint32_t & offset, uint32_t & size) const
+        {
+            auto & t = type(structId);
+            if( t.opcode != 30 )
+                throw std::runtime_error("Push constant blocks must be structs");
+
+            static const std::vector<MemberDecoration> none;
+            auto f   = memberDecorations.find(structId);
+            auto & m = f == memberDecorations.end() ? none : f->second;
+
+            uint32_t begin = ~0u, end = 0;
+            for(size_t i=0;i<t.operands.size();i++)
+            {
+                auto md = i < m.size() ? &m[i] : nullptr;
+                auto o  = md ? md->offset : 0u;
+                begin   = std::min(begin, o);
+                end     = std::max(end,   o + sizeOf(t.operands[i], md));
+            }
+            if( t.operands.empty() )
+                begin = 0;
+
+            // push constant ranges must be multiples of 4
+            offset = begin & ~3u;
+            size   = ((end + 3u) & ~3u) - offset;
+        }
+
+        void vertexInputs(uint32_t id, uint32_t location, std::vector<VertexInput> & inputs) const
+        {
+            auto & t = type(id);
+            if( t.opcode == 24 ) // matrices use one location per column
+            {
+                for(uint32_t c=0;c<t.operands[1];c++)
+                    vertexInputs(t.operands[0], location + c, inputs);
+                return;
+            }
+            if( t.opcode == 28 ) // arrays use one location per element
+            {
+                auto length = constant(t.operands[1]);
+                for(uint32_t c=0;c<length;c++)
+                    vertexInputs(t.operands[0], location + c, inputs);
+                return;
+            }
+
+            uint32_t components = 1;
+            auto scalar = &t;
+            if( t.opcode == 23 ) // OpTypeVector
+            {
+                components = t.operands[1];
+                scalar     = &type(t.operands[0]);
+            }
+            if( (scalar->opcode != 21 && scalar->opcode != 22) || scalar->operands[0] != 32 || components < 1 || components > 4 )
+                throw std::runtime_error("Only 32 bit vertex inputs are supported, location: " + std::to_string(location));
+
+            static const vk::Format formats[3][4] = {
+                {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat},
+                {vk::Format::eR32Sint,   vk::Format::eR32G32Sint,   vk::Format::eR32G32B32Sint,   vk::Format::eR32G32B32A32Sint  },
+                {vk::Format::eR32Uint,   vk::Format::eR32G32Uint,   vk::Format::eR32G32B32Uint,   vk::Format::eR32G32B32A32Uint  }
+            };
+            size_t kind = scalar->opcode == 22 ? 0 : (scalar->operands[1] ? 1 : 2);
+
+            auto & I    = inputs.emplace_back();
+            I.location  = location;
+            I.format    = formats[kind][components-1];
+            I.size      = 4 * components;
+        }
+    };
+};
+
+/**
+ * @brief The SpirvReflector struct
+ *
+ * Builds the pipeline layout and vertex input of a pipeline from the
+ * SPIR-V code of its stages. Each module is only parsed once, the results
+ * are cached by the content hash of the SPIR-V and the entry point.
+ *
+ * vkb::SpirvReflector R;
+ *
+ * vkb::GraphicsPipelineCreateInfo2 PCI;
+ * PCI.addStage(vk::ShaderStageFlagBits::eVertex,   "main", "vert.spv");
+ * PCI.addStage(vk::ShaderStageFlagBits::eFragment, "main", "frag.spv");
+ * R.apply(PCI); // sets PCI.layout and PCI.vertexInputState
+ *
+ * Bindings used by more than one stage are merged. The set layouts and push
+ * constant ranges are sorted, so shaders with the same interface produce
+ * the same layout and share the layouts cached in the Storage.
+ *
+ * The reflector is not thread safe.
+ */
+struct SpirvReflector
+{
+    enum class VertexLayout
+    {
+        eInterleaved, // all attributes in binding 0, packed in location order
+        eSeparate     // each attribute in its own binding, binding = location
+    };
+
+    /**
+     * @brief reflect
+     * @param code
+     * @param wordCount
+     * @param entryPoint
+     * @return
+     *
+     * Returns the reflection of the module, parsing it if it has not been
+     * seen before. The reference is valid for the lifetime of the reflector.
+     */
+    ShaderReflection const & reflect(uint32_t const * code, size_t wordCount, std::string const & entryPoint = "main")
+    {
+        auto key = StableHash().words(code, wordCount).str(entryPoint).value;
+
+        auto f = m_cache.find(key);
+        if( f != m_cache.end() )
+            return f->second;
+
+        return m_cache.emplace(key, ShaderReflection::parse(code, wordCount, entryPoint)).first->second;
+    }
+
+    ShaderReflection const & reflect(PipelineShaderStageCreateInfo2 const & stage)
+    {
+        if( stage.code.empty() )
+            throw std::runtime_error("Shader stages can only be reflected if they have SPIR-V code");
+        auto & R = reflect(stage.code.data(), stage.code.size(), stage.name);
+        if( R.stage != stage.stage )
+            throw std::runtime_error("The entry point " + stage.name + " is not for the stage it is used in");
+        return R;
+    }
+
+    /**
+     * @brief pipelineLayout
+     * @param stages
+     * @return
+     *
+     * Returns the layout used by the stages. Throws a std::runtime_error
+     * if two stages use the same set/binding with a different type or count.
+     */
+    PipelineLayoutCreateInfo2 pipelineLayout(std::vector<PipelineShaderStageCreateInfo2> const & stages)
+    {
+        struct _Binding
+        {
+            vk::DescriptorType   type;
+            uint32_t             count;
+            vk::ShaderStageFlags stageFlags;
+        };
+        std::map< std::pair<uint32_t,uint32_t>, _Binding > bindings;
+        std::map< std::pair<uint32_t,uint32_t>, vk::ShaderStageFlags > ranges;
+
+        for(auto & s : stages)
+        {
+            auto & R = reflect(s);
+            for(auto & d : R.descriptors)
+            {
+                auto key = std::make_pair(d.set, d.binding);
+                auto f   = bindings.find(key);
+                if( f == bindings.end() )
+                {
+                    bindings.emplace(key, _Binding{d.type, d.count, vk::ShaderStageFlags(s.stage)});
+                }
+                else if( f->second.type != d.type || f->second.count != d.count )
+                {
+                    throw std::runtime_error("Stages use set " + std::to_string(d.set) + " binding " + std::to_string(d.binding) + " with different descriptors");
+                }
+                else
+                {
+                    f->second.stageFlags |= s.stage;
+                }
+            }
+            if( R.pushConstantSize > 0 )
+                ranges[ std::make_pair(R.pushConstantOffset, R.pushConstantSize) ] |= s.stage;
+        }
+
+        PipelineLayoutCreateInfo2 L;
+        for(auto & [key, b] : bindings)
+        {
+            while( L.setLayoutsDescriptions.size() <= key.first )
+                L.newDescriptorSet();
+            L.setLayoutsDescriptions[key.first].addDescriptor(key.second, b.type, b.count, b.stageFlags);
+        }
+        for(auto & [key, flags] : ranges)
+        {
+            L.addPushConstantRange(flags, key.first, key.second);
+        }
+        return L;
+    }
+
+    /**
+     * @brief apply
+     * @param P
+     * @param layout
+     *
+     * Replaces the layout and the vertex input of the pipeline with
+     * the ones used by its stages.
+     */
+    void apply(GraphicsPipelineCreateInfo2 & P, VertexLayout layout = VertexLayout::eInterleaved)
+    {
+        P.layout = pipelineLayout(P.stages);
+
+        P.vertexInputState.vertexBindingDescriptions.clear();
+        P.vertexInputState.vertexAttributeDescriptions.clear();
+
+        auto v = std::find_if(P.stages.begin(), P.stages.end(), [](auto & s){ return s.stage == vk::ShaderStageFlagBits::eVertex;});
+        if( v == P.stages.end() )
+            return;
+
+        auto & R = reflect(*v);
+        if( R.inputs.empty() )
+            return;
+
+        if( layout == VertexLayout::eInterleaved )
+        {
+            uint32_t offset = 0;
+            for(auto & i : R.inputs)
+            {
+                P.setVertexInputAttribute(i.location, 0, i.format, offset);
+                offset += i.size;
+            }
+            P.setVertexInputBinding(0, offset, vk::VertexInputRate::eVertex);
+        }
+        else
+        {
+            for(auto & i : R.inputs)
+            {
+                P.setVertexInputAttribute(i.location, i.location, i.format, 0);
+                P.setVertexInputBinding(i.location, i.size, vk::VertexInputRate::eVertex);
+            }
+        }
+    }
+
+    /**
+     * @brief size
+     * @return
+     *
+     * The number of modules which have been parsed.
+     */
+    size_t size() const
+    {
+        return m_cache.size();
+    }
+
+protected:
+    std::unordered_map<uint64_t, ShaderReflection> m_cache;
+};
+
+}
+
+#endif
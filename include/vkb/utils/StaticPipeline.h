@@ -0,0 +1,460 @@
+#ifndef VKB_STATICPIPELINE_H
+#define VKB_STATICPIPELINE_H
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include "../vkb.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The StaticInit struct
+ *
+ * constexpr constructors for the vulkan structs used by the headers
+ * which are generated by the pipeline compiler. The structs are
+ * filled member by member so that the generated code does not depend
+ * on the argument order of the vulkan.hpp constructors.
+ */
+struct StaticInit
+{
+    static constexpr vk::DescriptorSetLayoutBinding binding(uint32_t binding, vk::DescriptorType type, uint32_t count, vk::ShaderStageFlags stageFlags)
+    {
+        vk::DescriptorSetLayoutBinding b;
+        b.binding         = binding;
+        b.descriptorType  = type;
+        b.descriptorCount = count;
+        b.stageFlags      = stageFlags;
+        return b;
+    }
+
+    static constexpr vk::PushConstantRange pushConstantRange(vk::ShaderStageFlags stageFlags, uint32_t offset, uint32_t size)
+    {
+        vk::PushConstantRange r;
+        r.stageFlags = stageFlags;
+        r.offset     = offset;
+        r.size       = size;
+        return r;
+    }
+
+    static constexpr vk::AttachmentDescription attachment(vk::AttachmentDescriptionFlags flags, vk::Format format, vk::SampleCountFlagBits samples,
+                                                          vk::AttachmentLoadOp loadOp, vk::AttachmentStoreOp storeOp,
+                                                          vk::AttachmentLoadOp stencilLoadOp, vk::AttachmentStoreOp stencilStoreOp,
+                                                          vk::ImageLayout initialLayout, vk::ImageLayout finalLayout)
+    {
+        vk::AttachmentDescription a;
+        a.flags          = flags;
+        a.format         = format;
+        a.samples        = samples;
+        a.loadOp         = loadOp;
+        a.storeOp        = storeOp;
+        a.stencilLoadOp  = stencilLoadOp;
+        a.stencilStoreOp = stencilStoreOp;
+        a.initialLayout  = initialLayout;
+        a.finalLayout    = finalLayout;
+        return a;
+    }
+
+    static constexpr vk::AttachmentReference reference(uint32_t attachment, vk::ImageLayout layout)
+    {
+        vk::AttachmentReference r;
+        r.attachment = attachment;
+        r.layout     = layout;
+        return r;
+    }
+
+    static constexpr vk::SubpassDependency dependency(uint32_t srcSubpass, uint32_t dstSubpass,
+                                                      vk::PipelineStageFlags srcStageMask, vk::PipelineStageFlags dstStageMask,
+                                                      vk::AccessFlags srcAccessMask, vk::AccessFlags dstAccessMask,
+                                                      vk::DependencyFlags dependencyFlags)
+    {
+        vk::SubpassDependency d;
+        d.srcSubpass      = srcSubpass;
+        d.dstSubpass      = dstSubpass;
+        d.srcStageMask    = srcStageMask;
+        d.dstStageMask    = dstStageMask;
+        d.srcAccessMask   = srcAccessMask;
+        d.dstAccessMask   = dstAccessMask;
+        d.dependencyFlags = dependencyFlags;
+        return d;
+    }
+
+    static constexpr vk::PipelineColorBlendAttachmentState blendAttachment(vk::Bool32 blendEnable,
+                                                                           vk::BlendFactor srcColorBlendFactor, vk::BlendFactor dstColorBlendFactor, vk::BlendOp colorBlendOp,
+                                                                           vk::BlendFactor srcAlphaBlendFactor, vk::BlendFactor dstAlphaBlendFactor, vk::BlendOp alphaBlendOp,
+                                                                           vk::ColorComponentFlags colorWriteMask)
+    {
+        vk::PipelineColorBlendAttachmentState a;
+        a.blendEnable         = blendEnable;
+        a.srcColorBlendFactor = srcColorBlendFactor;
+        a.dstColorBlendFactor = dstColorBlendFactor;
+        a.colorBlendOp        = colorBlendOp;
+        a.srcAlphaBlendFactor = srcAlphaBlendFactor;
+        a.dstAlphaBlendFactor = dstAlphaBlendFactor;
+        a.alphaBlendOp        = alphaBlendOp;
+        a.colorWriteMask      = colorWriteMask;
+        return a;
+    }
+
+    static constexpr vk::VertexInputBindingDescription vertexBinding(uint32_t binding, uint32_t stride, vk::VertexInputRate inputRate)
+    {
+        vk::VertexInputBindingDescription b;
+        b.binding   = binding;
+        b.stride    = stride;
+        b.inputRate = inputRate;
+        return b;
+    }
+
+    static constexpr vk::VertexInputAttributeDescription vertexAttribute(uint32_t location, uint32_t binding, vk::Format format, uint32_t offset)
+    {
+        vk::VertexInputAttributeDescription a;
+        a.location = location;
+        a.binding  = binding;
+        a.format   = format;
+        a.offset   = offset;
+        return a;
+    }
+
+    static constexpr vk::Viewport viewport(float x, float y, float width, float height, float minDepth, float maxDepth)
+    {
+        vk::Viewport v;
+        v.x        = x;
+        v.y        = y;
+        v.width    = width;
+        v.height   = height;
+        v.minDepth = minDepth;
+        v.maxDepth = maxDepth;
+        return v;
+    }
+
+    static constexpr vk::Rect2D scissor(int32_t x, int32_t y, uint32_t width, uint32_t height)
+    {
+        vk::Rect2D r;
+        r.offset.x      = x;
+        r.offset.y      = y;
+        r.extent.width  = width;
+        r.extent.height = height;
+        return r;
+    }
+
+    static constexpr vk::PipelineRasterizationStateCreateInfo rasterizationState(vk::PipelineRasterizationStateCreateFlags flags,
+                                                                                 vk::Bool32 depthClampEnable, vk::Bool32 rasterizerDiscardEnable,
+                                                                                 vk::PolygonMode polygonMode, vk::CullModeFlags cullMode, vk::FrontFace frontFace,
+                                                                                 vk::Bool32 depthBiasEnable, float depthBiasConstantFactor, float depthBiasClamp,
+                                                                                 float depthBiasSlopeFactor, float lineWidth)
+    {
+        vk::PipelineRasterizationStateCreateInfo s;
+        s.flags                   = flags;
+        s.depthClampEnable        = depthClampEnable;
+        s.rasterizerDiscardEnable = rasterizerDiscardEnable;
+        s.polygonMode             = polygonMode;
+        s.cullMode                = cullMode;
+        s.frontFace               = frontFace;
+        s.depthBiasEnable         = depthBiasEnable;
+        s.depthBiasConstantFactor = depthBiasConstantFactor;
+        s.depthBiasClamp          = depthBiasClamp;
+        s.depthBiasSlopeFactor    = depthBiasSlopeFactor;
+        s.lineWidth               = lineWidth;
+        return s;
+    }
+
+    static constexpr vk::PipelineMultisampleStateCreateInfo multisampleState(vk::PipelineMultisampleStateCreateFlags flags,
+                                                                             vk::SampleCountFlagBits rasterizationSamples, vk::Bool32 sampleShadingEnable,
+                                                                             float minSampleShading, vk::Bool32 alphaToCoverageEnable, vk::Bool32 alphaToOneEnable)
+    {
+        vk::PipelineMultisampleStateCreateInfo s;
+        s.flags                 = flags;
+        s.rasterizationSamples  = rasterizationSamples;
+        s.sampleShadingEnable   = sampleShadingEnable;
+        s.minSampleShading      = minSampleShading;
+        s.alphaToCoverageEnable = alphaToCoverageEnable;
+        s.alphaToOneEnable      = alphaToOneEnable;
+        return s;
+    }
+
+    static constexpr vk::StencilOpState stencilOp(vk::StencilOp failOp, vk::StencilOp passOp, vk::StencilOp depthFailOp, vk::CompareOp compareOp,
+                                                  uint32_t compareMask, uint32_t writeMask, uint32_t reference)
+    {
+        vk::StencilOpState s;
+        s.failOp      = failOp;
+        s.passOp      = passOp;
+        s.depthFailOp = depthFailOp;
+        s.compareOp   = compareOp;
+        s.compareMask = compareMask;
+        s.writeMask   = writeMask;
+        s.reference   = reference;
+        return s;
+    }
+
+    static constexpr vk::PipelineDepthStencilStateCreateInfo depthStencilState(vk::PipelineDepthStencilStateCreateFlags flags,
+                                                                               vk::Bool32 depthTestEnable, vk::Bool32 depthWriteEnable, vk::CompareOp depthCompareOp,
+                                                                               vk::Bool32 depthBoundsTestEnable, vk::Bool32 stencilTestEnable,
+                                                                               vk::StencilOpState front, vk::StencilOpState back,
+                                                                               float minDepthBounds, float maxDepthBounds)
+    {
+        vk::PipelineDepthStencilStateCreateInfo s;
+        s.flags                 = flags;
+        s.depthTestEnable       = depthTestEnable;
+        s.depthWriteEnable      = depthWriteEnable;
+        s.depthCompareOp        = depthCompareOp;
+        s.depthBoundsTestEnable = depthBoundsTestEnable;
+        s.stencilTestEnable     = stencilTestEnable;
+        s.front                 = front;
+        s.back                  = back;
+        s.minDepthBounds        = minDepthBounds;
+        s.maxDepthBounds        = maxDepthBounds;
+        return s;
+    }
+
+    static constexpr vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState(vk::PipelineInputAssemblyStateCreateFlags flags,
+                                                                                 vk::PrimitiveTopology topology, vk::Bool32 primitiveRestartEnable)
+    {
+        vk::PipelineInputAssemblyStateCreateInfo s;
+        s.flags                  = flags;
+        s.topology               = topology;
+        s.primitiveRestartEnable = primitiveRestartEnable;
+        return s;
+    }
+
+    static constexpr vk::PipelineTessellationStateCreateInfo tessellationState(vk::PipelineTessellationStateCreateFlags flags, uint32_t patchControlPoints)
+    {
+        vk::PipelineTessellationStateCreateInfo s;
+        s.flags              = flags;
+        s.patchControlPoints = patchControlPoints;
+        return s;
+    }
+};
+
+/**
+ * @brief The StaticDescriptorSetLayout struct
+ *
+ * A constexpr DescriptorSetLayoutCreateInfo2. hash is the value of
+ * DescriptorSetLayoutCreateInfo2::hash() and is used as the storage key,
+ * so creating the layout never rehashes it.
+ */
+struct StaticDescriptorSetLayout
+{
+    vk::DescriptorSetLayoutCreateFlags     flags        = {};
+    vk::DescriptorSetLayoutBinding const * bindings     = nullptr;
+    uint32_t                               bindingCount = 0;
+    size_t                                 hash         = 0;
+
+    DescriptorSetLayoutCreateInfo2 createInfo() const
+    {
+        DescriptorSetLayoutCreateInfo2 C;
+        C.flags = flags;
+        C.bindings.assign(bindings, bindings + bindingCount);
+        return C;
+    }
+
+    vk::DescriptorSetLayout create(Storage & S, vk::Device device) const
+    {
+        auto f = S.descriptorSetLayouts.find(hash);
+        if( f != S.descriptorSetLayouts.end() )
+            return f->second;
+        return createInfo().create(S, device, hash);
+    }
+};
+
+/**
+ * @brief The StaticSubpass struct
+ *
+ * A constexpr SubpassDescription2. depthStencilAttachment and
+ * resolveAttachment are nullptr when the subpass does not have them.
+ */
+struct StaticSubpass
+{
+    vk::PipelineBindPoint           pipelineBindPoint       = vk::PipelineBindPoint::eGraphics;
+    vk::AttachmentReference const * inputAttachments        = nullptr;
+    uint32_t                        inputAttachmentCount    = 0;
+    vk::AttachmentReference const * colorAttachments        = nullptr;
+    uint32_t                        colorAttachmentCount    = 0;
+    vk::AttachmentReference const * depthStencilAttachment  = nullptr;
+    vk::AttachmentReference const * resolveAttachment       = nullptr;
+    uint32_t const *                preserveAttachments     = nullptr;
+    uint32_t                        preserveAttachmentCount = 0;
+
+    SubpassDescription2 createInfo() const
+    {
+        SubpassDescription2 C;
+        C.pipelineBindPoint = pipelineBindPoint;
+        C.inputAttachments.assign(inputAttachments, inputAttachments + inputAttachmentCount);
+        C.colorAttachments.assign(colorAttachments, colorAttachments + colorAttachmentCount);
+        if( depthStencilAttachment )
+            C.depthStencilAttachment = *depthStencilAttachment;
+        if( resolveAttachment )
+            C.resolveAttachment = *resolveAttachment;
+        C.preserveAttachments.assign(preserveAttachments, preserveAttachments + preserveAttachmentCount);
+        return C;
+    }
+};
+
+/**
+ * @brief The StaticRenderPass struct
+ *
+ * A constexpr RenderPassCreateInfo2. hash and compatibilityHash are the
+ * values of RenderPassCreateInfo2::hash() and compatibilityHash().
+ */
+struct StaticRenderPass
+{
+    vk::AttachmentDescription const * attachments     = nullptr;
+    uint32_t                          attachmentCount = 0;
+    vk::SubpassDependency const *     dependencies    = nullptr;
+    uint32_t                          dependencyCount = 0;
+    StaticSubpass const *             subpasses       = nullptr;
+    uint32_t                          subpassCount    = 0;
+    size_t                            hash              = 0;
+    size_t                            compatibilityHash = 0;
+
+    RenderPassCreateInfo2 createInfo() const
+    {
+        RenderPassCreateInfo2 C;
+        C.attachments.assign(attachments, attachments + attachmentCount);
+        C.dependencies.assign(dependencies, dependencies + dependencyCount);
+        C.subpasses.reserve(subpassCount);
+        for(uint32_t i=0;i<subpassCount;i++)
+            C.subpasses.push_back( subpasses[i].createInfo() );
+        return C;
+    }
+
+    vk::RenderPass create(Storage & S, vk::Device device) const
+    {
+        auto f = S.renderPasses.find(hash);
+        if( f != S.renderPasses.end() )
+            return f->second;
+        return createInfo().create(S, device, hash);
+    }
+};
+
+/**
+ * @brief The StaticGraphicsPipeline struct
+ *
+ * A constexpr GraphicsPipelineCreateInfo2 generated by the pipeline
+ * compiler (tools/pipeline-compiler.cpp). renderPass is nullptr if
+ * the pipeline does not describe its render pass.
+ *
+ * Shader stages are not part of the description, add them to the
+ * GraphicsPipelineCreateInfo2 returned by createInfo(). The pipeline
+ * has no precomputed hash: it is stored under the key of the final
+ * create info, which depends on the stages and the layout handle, so
+ * it is hashed when it is created.
+ *
+ * #include <vkb_pipelines/gbuffer.h>
+ *
+ * auto info = vkb_pipelines::gbuffer::pipeline.createInfo(S, device);
+ * info.addStage( vk::ShaderStageFlagBits::eVertex, "main", "gbuffer.vert.spv");
+ * auto [pipeline, layout, renderPass] = info.create(S, device);
+ */
+struct StaticGraphicsPipeline
+{
+    StaticDescriptorSetLayout const *             setLayouts             = nullptr;
+    uint32_t                                      setLayoutCount         = 0;
+    vk::PushConstantRange const *                 pushConstantRanges     = nullptr;
+    uint32_t                                      pushConstantRangeCount = 0;
+
+    vk::PipelineColorBlendAttachmentState const * blendAttachments       = nullptr;
+    uint32_t                                      blendAttachmentCount   = 0;
+    vk::PipelineColorBlendStateCreateFlags        blendFlags             = {};
+    vk::Bool32                                    logicOpEnable          = {};
+    vk::LogicOp                                   logicOp                = vk::LogicOp::eClear;
+    float                                         blendConstants[4]      = {};
+
+    vk::VertexInputBindingDescription const *     vertexBindings         = nullptr;
+    uint32_t                                      vertexBindingCount     = 0;
+    vk::VertexInputAttributeDescription const *   vertexAttributes       = nullptr;
+    uint32_t                                      vertexAttributeCount   = 0;
+
+    vk::PipelineRasterizationStateCreateInfo      rasterizationState;
+    vk::PipelineMultisampleStateCreateInfo        multisampleState;
+    vk::PipelineDepthStencilStateCreateInfo       depthStencilState;
+    vk::PipelineInputAssemblyStateCreateInfo      inputAssemblyState;
+    vk::PipelineTessellationStateCreateInfo       tessellation;
+
+    vk::DynamicState const *                      dynamicStates          = nullptr;
+    uint32_t                                      dynamicStateCount      = 0;
+    vk::Viewport const *                          viewports              = nullptr;
+    uint32_t                                      viewportCount          = 0;
+    vk::Rect2D const *                            scissors               = nullptr;
+    uint32_t                                      scissorCount           = 0;
+
+    StaticRenderPass const *                      renderPass             = nullptr;
+
+    /**
+     * @brief createInfo
+     * @return
+     *
+     * Returns the description with the layout and render pass as
+     * create infos. Every vector is allocated once with its final size.
+     */
+    GraphicsPipelineCreateInfo2 createInfo() const
+    {
+        GraphicsPipelineCreateInfo2 C;
+        _fill(C);
+
+        PipelineLayoutCreateInfo2 L;
+        L.setLayoutsDescriptions.reserve(setLayoutCount);
+        for(uint32_t i=0;i<setLayoutCount;i++)
+            L.setLayoutsDescriptions.push_back( setLayouts[i].createInfo() );
+        L.pushConstantRanges.assign(pushConstantRanges, pushConstantRanges + pushConstantRangeCount);
+        C.layout = std::move(L);
+
+        if( renderPass )
+            C.renderPass = renderPass->createInfo();
+        return C;
+    }
+
+    /**
+     * @brief createInfo
+     * @param S
+     * @param device
+     * @return
+     *
+     * Same as createInfo(), but the descriptor set layouts, pipeline layout
+     * and render pass are created in the storage using the precomputed hashes.
+     * The render pass is left as a null handle if it is not described.
+     */
+    GraphicsPipelineCreateInfo2 createInfo(Storage & S, vk::Device device) const
+    {
+        GraphicsPipelineCreateInfo2 C;
+        _fill(C);
+
+        PipelineLayoutCreateInfo2 L;
+        L.setLayouts.reserve(setLayoutCount);
+        for(uint32_t i=0;i<setLayoutCount;i++)
+            L.setLayouts.push_back( setLayouts[i].create(S, device) );
+        L.pushConstantRanges.assign(pushConstantRanges, pushConstantRanges + pushConstantRangeCount);
+        C.layout = L.create(S, device);
+
+        C.renderPass = renderPass ? renderPass->create(S, device) : vk::RenderPass();
+        return C;
+    }
+
+protected:
+    void _fill(GraphicsPipelineCreateInfo2 & C) const
+    {
+        C.blendState.attachments.assign(blendAttachments, blendAttachments + blendAttachmentCount);
+        C.blendState.flags         = blendFlags;
+        C.blendState.logicOpEnable = logicOpEnable;
+        C.blendState.logicOp       = logicOp;
+        for(uint32_t i=0;i<4;i++)
+            C.blendState.blendConstants[i] = blendConstants[i];
+
+        C.vertexInputState.vertexBindingDescriptions.assign(vertexBindings, vertexBindings + vertexBindingCount);
+        C.vertexInputState.vertexAttributeDescriptions.assign(vertexAttributes, vertexAttributes + vertexAttributeCount);
+
+        C.rasterizationState = rasterizationState;
+        C.multisampleState   = multisampleState;
+        C.depthStencilState  = depthStencilState;
+        C.inputAssemblyState = inputAssemblyState;
+        C.tessellation       = tessellation;
+
+        C.dynamicStates.assign(dynamicStates, dynamicStates + dynamicStateCount);
+        C.viewportState.viewports.assign(viewports, viewports + viewportCount);
+        C.viewportState.scissors.assign(scissors, scissors + scissorCount);
+    }
+};
+
+}
+
+#endif
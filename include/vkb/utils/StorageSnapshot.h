@@ -0,0 +1,459 @@
+#ifndef VKB_STORAGESNAPSHOT_H
+#define VKB_STORAGESNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BinaryEncoding.h"
+
+namespace vkb
+{
+
+/**
+ * @brief The StorageSnapshot struct
+ *
+ * A copy of all the samplers, shader modules, renderpasses, descriptor set
+ * layouts, pipeline layouts and graphics pipelines in a vkb::Storage, with
+ * the vulkan handles replaced by indices into the snapshot's own tables.
+ * It can be written to a compact binary blob and used in a later process
+ * to recreate all the objects.
+ *
+ * // first run
+ * auto blob = vkb::StorageSnapshot::capture(S).serialize();
+ * vkb::StorageSnapshot::writeFile("storage.vkbs", blob);
+ *
+ * // later runs
+ * auto snapshot = vkb::StorageSnapshot::deserialize( vkb::StorageSnapshot::readFile("storage.vkbs") );
+ * auto objects  = snapshot.restore(S, device);
+ *
+ * Only objects whose create info is in the storage can be captured.
+ * Descriptor pools, buffers, images and memory are not captured.
+ */
+struct StorageSnapshot
+{
+    static constexpr uint32_t magic   = 0x53424B56; // "VKBS"
+    static constexpr uint32_t version = 4;
+
+    // the renderPass index of pipelines using dynamic rendering
+    static constexpr uint32_t noRenderPass = 0xFFFFFFFFu;
+
+    struct PipelineLayout
+    {
+        std::vector<uint32_t>              setLayouts; // indices into descriptorSetLayouts
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+    };
+
+    struct Pipeline
+    {
+        // the layout, renderPass and shader modules in info are
+        // null and are given by the indices below. With dynamic
+        // rendering info.renderPass holds the formats instead.
+        GraphicsPipelineCreateInfo2 info;
+        uint32_t                    layout     = 0; // index into pipelineLayouts
+        uint32_t                    renderPass = 0; // index into renderPasses, or noRenderPass
+        std::vector<uint32_t>       modules;        // index into shaderModules for each stage
+    };
+
+    // the objects created by restore( ). Each vector is
+    // parallel to the snapshot table of the same name
+    struct Objects
+    {
+        std::vector<vk::Sampler>             samplers;
+        std::vector<vk::ShaderModule>        shaderModules;
+        std::vector<vk::RenderPass>          renderPasses;
+        std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+        std::vector<vk::PipelineLayout>      pipelineLayouts;
+        std::vector<vk::Pipeline>            pipelines;
+    };
+
+    std::vector<SamplerCreateInfo2>             samplers;
+    std::vector<ShaderModuleCreateInfo2>        shaderModules;
+    std::vector<RenderPassCreateInfo2>          renderPasses;
+    std::vector<DescriptorSetLayoutCreateInfo2> descriptorSetLayouts; // immutable samplers are always SamplerCreateInfo2
+    std::vector<PipelineLayout>                 pipelineLayouts;
+    std::vector<Pipeline>                       pipelines;
+
+    /**
+     * @brief capture
+     * @param S
+     * @return
+     *
+     * Copies the create infos of all the objects in the storage. Throws
+     * std::runtime_error if an object refers to an object which was not
+     * created using the storage.
+     */
+    static StorageSnapshot capture(Storage const & S)
+    {
+        StorageSnapshot out;
+
+        auto samplerIds      = _captureTable(S, S.samplers,      out.samplers);
+        auto shaderModuleIds = _captureTable(S, S.shaderModules, out.shaderModules);
+        auto renderPassIds   = _captureTable(S, S.renderPasses,  out.renderPasses);
+
+        std::map<vk::DescriptorSetLayout, uint32_t> layoutIds;
+        for(auto & x : S.descriptorSetLayouts)
+        {
+            auto c = S.tryGetCreateInfo<DescriptorSetLayoutCreateInfo2>(x.second);
+            if( c == nullptr )
+                throw std::runtime_error("Cannot capture a descriptor set layout without a create info");
+
+            auto cpy = *c;
+            for(auto & b : cpy.immutableSamplers)
+            {
+                for(auto & v : b.second)
+                {
+                    if( auto s = std::get_if<vk::Sampler>(&v) )
+                        v = out.samplers.at( _id(samplerIds, *s, "sampler") );
+                }
+            }
+            layoutIds[x.second] = static_cast<uint32_t>(out.descriptorSetLayouts.size());
+            out.descriptorSetLayouts.push_back( std::move(cpy) );
+        }
+
+        std::map<vk::PipelineLayout, uint32_t> pipelineLayoutIds;
+        for(auto & x : S.pipelineLayouts)
+        {
+            auto c = S.tryGetCreateInfo<PipelineLayoutCreateInfo2>(x.second);
+            if( c == nullptr )
+                throw std::runtime_error("Cannot capture a pipeline layout without a create info");
+
+            auto & p = out.pipelineLayouts.emplace_back();
+            p.pushConstantRanges = c->pushConstantRanges;
+            for(auto & l : c->setLayouts)
+                p.setLayouts.push_back( _id(layoutIds, l, "descriptor set layout") );
+
+            pipelineLayoutIds[x.second] = static_cast<uint32_t>(out.pipelineLayouts.size()-1);
+        }
+
+        for(auto & x : S.pipelines)
+        {
+            auto c = S.tryGetCreateInfo<GraphicsPipelineCreateInfo2>(x.second);
+            if( c == nullptr )
+                throw std::runtime_error("Cannot capture a pipeline without a create info");
+
+            auto & p     = out.pipelines.emplace_back();
+            p.info       = *c;
+            p.layout     = _id(pipelineLayoutIds, std::get<vk::PipelineLayout>(c->layout), "pipeline layout");
+            p.info.layout     = vk::PipelineLayout();
+            if( std::holds_alternative<PipelineRenderingCreateInfo2>(c->renderPass) )
+            {
+                p.renderPass = noRenderPass;
+            }
+            else
+            {
+                p.renderPass      = _id(renderPassIds, std::get<vk::RenderPass>(c->renderPass), "renderpass");
+                p.info.renderPass = vk::RenderPass();
+            }
+            for(auto & s : p.info.stages)
+            {
+                p.modules.push_back( _id(shaderModuleIds, s.module, "shader module") );
+                s.module = vk::ShaderModule();
+                s.code.clear();
+            }
+        }
+
+        return out;
+    }
+
+    /**
+     * @brief restore
+     * @param S
+     * @param device
+     * @param threadCount - the number of threads used to create the pipelines, 0 to use all cores
+     * @return
+     *
+     * Creates all the objects in the snapshot, in dependency order, and stores
+     * them in S. Objects which already exist in S are reused.
+     *
+     * The references follow the same rules as create(S, device): each
+     * returned sampler and pipeline holds one reference, whether it was
+     * created or found in S, and is released with S.destroy( ).
+     *
+     * Samplers, shader modules, renderpasses and layouts are cheap and are
+     * created in order. Pipelines do not depend on each other and are created
+     * in parallel and then added to the storage.
+     */
+    Objects restore(Storage & S, vk::Device device, uint32_t threadCount = 0) const
+    {
+        Objects out;
+
+        for(auto & x : samplers)
+            out.samplers.push_back( x.create(S, device) );
+        for(auto & x : shaderModules)
+            out.shaderModules.push_back( x.create(S, device) );
+        for(auto & x : renderPasses)
+            out.renderPasses.push_back( x.create(S, device) );
+        for(auto & x : descriptorSetLayouts)
+            out.descriptorSetLayouts.push_back( x.create(S, device) );
+
+        for(auto & x : pipelineLayouts)
+        {
+            PipelineLayoutCreateInfo2 L;
+            L.pushConstantRanges = x.pushConstantRanges;
+            for(auto i : x.setLayouts)
+                L.setLayouts.push_back( out.descriptorSetLayouts.at(i) );
+            out.pipelineLayouts.push_back( L.create(S, device) );
+        }
+
+        // resolve the handles of each pipeline, and find out
+        // which ones need to be created
+        std::vector<GraphicsPipelineCreateInfo2> resolved;
+        std::vector<size_t>                      keys;
+        std::vector<size_t>                      toCreate;
+        std::map<size_t, size_t>                 firstWithKey;
+
+        resolved.reserve(pipelines.size());
+        out.pipelines.resize(pipelines.size());
+
+        for(size_t i=0;i<pipelines.size();i++)
+        {
+            auto & p = pipelines[i];
+            auto & r = resolved.emplace_back(p.info);
+            r.layout     = out.pipelineLayouts.at(p.layout);
+            if( p.renderPass != noRenderPass )
+                r.renderPass = out.renderPasses.at(p.renderPass);
+            for(size_t j=0;j<r.stages.size();j++)
+                r.stages[j].module = out.shaderModules.at( p.modules.at(j) );
+
+            auto k = r.storageKey(S);
+            keys.push_back(k);
+
+            auto f = S.pipelines.find(k);
+            if( f != S.pipelines.end() )
+            {
+                S.acquire(f->second, false);
+                out.pipelines[i] = f->second;
+            }
+            else if( firstWithKey.emplace(k, i).second )
+                toCreate.push_back(i);
+        }
+
+        if( threadCount == 0 )
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min<uint32_t>(threadCount, static_cast<uint32_t>(toCreate.size()));
+
+        std::vector<std::exception_ptr> errors(threadCount);
+        std::vector<std::thread>        threads;
+        for(uint32_t t=0;t<threadCount;t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                try
+                {
+                    for(size_t j=t; j<toCreate.size(); j+=threadCount)
+                        out.pipelines[toCreate[j]] = resolved[toCreate[j]].create(device);
+                }
+                catch(...)
+                {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for(auto & t : threads)
+            t.join();
+
+        for(auto i : toCreate)
+        {
+            if( out.pipelines[i] )
+            {
+                S.pipelines[keys[i]] = out.pipelines[i];
+                S.storeCreateInfo(out.pipelines[i], resolved[i]);
+            }
+        }
+        for(auto & e : errors)
+        {
+            if( e )
+                std::rethrow_exception(e);
+        }
+
+        // pipelines which were duplicated in the snapshot share
+        // the first one, and each copy holds its own reference
+        for(size_t i=0;i<pipelines.size();i++)
+        {
+            if( !out.pipelines[i] )
+            {
+                out.pipelines[i] = out.pipelines[ firstWithKey.at(keys[i]) ];
+                if( out.pipelines[i] )
+                    S.acquire(out.pipelines[i], false);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief serialize
+     * @return
+     *
+     * Writes the snapshot into a binary blob.
+     */
+    std::vector<uint8_t> serialize() const
+    {
+        BinaryWriter W;
+        W.pod(magic);
+        W.pod(version);
+
+        W.pod( static_cast<uint32_t>(samplers.size()) );
+        for(auto & x : samplers)
+            writeBinary(W, x);
+
+        W.pod( static_cast<uint32_t>(shaderModules.size()) );
+        for(auto & x : shaderModules)
+        {
+            W.pod( static_cast<uint32_t>(x.codeSize()) );
+            for(size_t i=0;i<x.codeSize();i++)
+                W.pod(x.codeData()[i]);
+        }
+
+        W.pod( static_cast<uint32_t>(renderPasses.size()) );
+        for(auto & x : renderPasses)
+            writeBinary(W, x);
+
+        W.pod( static_cast<uint32_t>(descriptorSetLayouts.size()) );
+        for(auto & x : descriptorSetLayouts)
+            writeBinary(W, x);
+
+        W.pod( static_cast<uint32_t>(pipelineLayouts.size()) );
+        for(auto & x : pipelineLayouts)
+        {
+            W.vec(x.setLayouts);
+            W.vec(x.pushConstantRanges);
+        }
+
+        W.pod( static_cast<uint32_t>(pipelines.size()) );
+        for(auto & x : pipelines)
+        {
+            writeBinary(W, x.info);
+            W.pod(x.layout);
+            W.pod(x.renderPass);
+            W.vec(x.modules);
+        }
+        return std::move(W.data);
+    }
+
+    /**
+     * @brief deserialize
+     * @param data
+     * @return
+     *
+     * Reads a blob written by serialize( ). Throws std::runtime_error if
+     * the blob is not a snapshot, was written by a different version, or
+     * is truncated.
+     */
+    static StorageSnapshot deserialize(std::vector<uint8_t> const & data)
+    {
+        return deserialize(data.data(), data.size());
+    }
+
+    static StorageSnapshot deserialize(uint8_t const * data, size_t size)
+    {
+        BinaryReader R{data, data+size};
+
+        if( R.pod<uint32_t>() != magic )
+            throw std::runtime_error("Not a vkb::StorageSnapshot");
+        auto v = R.pod<uint32_t>();
+        if( v != version )
+            throw std::runtime_error("Unsupported vkb::StorageSnapshot version " + std::to_string(v));
+
+        StorageSnapshot out;
+
+        out.samplers.resize( R.count() );
+        for(auto & x : out.samplers)
+            readBinary(R, x);
+
+        out.shaderModules.resize( R.count() );
+        for(auto & x : out.shaderModules)
+            R.vec(x.code);
+
+        out.renderPasses.resize( R.count() );
+        for(auto & x : out.renderPasses)
+            readBinary(R, x);
+
+        out.descriptorSetLayouts.resize( R.count() );
+        for(auto & x : out.descriptorSetLayouts)
+            readBinary(R, x);
+
+        out.pipelineLayouts.resize( R.count() );
+        for(auto & x : out.pipelineLayouts)
+        {
+            R.vec(x.setLayouts);
+            R.vec(x.pushConstantRanges);
+            for(auto i : x.setLayouts)
+                R.check(i < out.descriptorSetLayouts.size());
+        }
+
+        out.pipelines.resize( R.count() );
+        for(auto & x : out.pipelines)
+        {
+            readBinary(R, x.info);
+            x.layout     = R.pod<uint32_t>();
+            x.renderPass = R.pod<uint32_t>();
+            R.vec(x.modules);
+
+            R.check(x.layout     < out.pipelineLayouts.size());
+            R.check(x.renderPass < out.renderPasses.size()
+                    || (x.renderPass == noRenderPass && std::holds_alternative<PipelineRenderingCreateInfo2>(x.info.renderPass)) );
+            R.check(x.modules.size() == x.info.stages.size());
+            for(auto i : x.modules)
+                R.check(i < out.shaderModules.size());
+        }
+
+        if( R.p != R.end )
+            throw std::runtime_error("Unexpected data at the end of the vkb::StorageSnapshot");
+        return out;
+    }
+
+    static void writeFile(std::string const & path, std::vector<uint8_t> const & data)
+    {
+        std::ofstream f(path, std::ios::out | std::ios::binary);
+        f.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if( !f )
+            throw std::runtime_error("Could not write " + path);
+    }
+
+    static std::vector<uint8_t> readFile(std::string const & path)
+    {
+        std::ifstream f(path, std::ios::in | std::ios::binary);
+        if( !f )
+            throw std::runtime_error("Could not open " + path);
+        return std::vector<uint8_t>( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+    }
+
+protected:
+    //=========================================================================
+    // Capturing
+    //=========================================================================
+    template<typename CreateInfo, typename vulkan_handle>
+    static std::map<vulkan_handle, uint32_t> _captureTable(Storage const & S,
+                                                           std::map<size_t, vulkan_handle> const & objects,
+                                                           std::vector<CreateInfo> & table)
+    {
+        std::map<vulkan_handle, uint32_t> ids;
+        for(auto & x : objects)
+        {
+            auto c = S.tryGetCreateInfo<CreateInfo>(x.second);
+            if( c == nullptr )
+                throw std::runtime_error("Cannot capture an object without a create info");
+            ids[x.second] = static_cast<uint32_t>(table.size());
+            table.push_back(*c);
+        }
+        return ids;
+    }
+
+    template<typename vulkan_handle>
+    static uint32_t _id(std::map<vulkan_handle, uint32_t> const & ids, vulkan_handle h, char const * what)
+    {
+        auto f = ids.find(h);
+        if( f == ids.end() )
+            throw std::runtime_error(std::string("Cannot capture an object which uses a ") + what + " that was not created using the storage");
+        return f->second;
+    }
+};
+
+}
+
+#endif
@@ -6,10 +6,13 @@
 #include "detail/PipelineCreateInfo2.h"
 #include "detail/PipelineLayoutCreateInfo2.h"
 #include "detail/RenderPassCreateInfo2.h"
+#include "detail/PipelineRenderingCreateInfo2.h"
 #include "detail/ShaderModuleCreateInfo2.h"
 #include "detail/DescriptorPoolCreateInfo2.h"
 #include "detail/DescriptorUpdater.h"
 #include "detail/BufferCreateInfo.h"
 #include "detail/SamplerCreateInfo2.h"
 #include "detail/MemoryAlloc.h"
+#include "detail/ImageViewCreateInfo2.h"
+#include "detail/FramebufferCreateInfo2.h"
 #endif
@@ -0,0 +1,22 @@
+#ifndef VKB_TEST_FAKEHANDLE_H
+#define VKB_TEST_FAKEHANDLE_H
+
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+/**
+ * @brief fakeHandle
+ * @param v
+ * @return
+ *
+ * Returns a vulkan handle with the value v, for tests which only
+ * store or compare handles. The handle must never be passed to vulkan.
+ */
+template<typename T>
+static T fakeHandle(uintptr_t v)
+{
+    using c_type = typename T::CType;
+    return T( reinterpret_cast<c_type>(v) );
+}
+
+#endif
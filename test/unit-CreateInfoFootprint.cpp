@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "FakeHandle.h"
+
+#include <any>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+
+// Count the number of bytes currently allocated on the heap so that
+// the footprint of the create info storage can be compared. Each
+// allocation is prefixed with its size.
+static std::atomic<size_t> g_allocatedBytes{0};
+static std::atomic<size_t> g_allocationCount{0};
+
+static constexpr size_t g_header = alignof(std::max_align_t);
+
+void* operator new(std::size_t n)
+{
+    auto p = static_cast<char*>( std::malloc(n + g_header) );
+    if( p == nullptr )
+        throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(p) = n;
+    g_allocatedBytes += n;
+    g_allocationCount++;
+    return p + g_header;
+}
+void operator delete(void * p) noexcept
+{
+    if( p == nullptr )
+        return;
+    auto b = static_cast<char*>(p) - g_header;
+    g_allocatedBytes -= *reinterpret_cast<std::size_t*>(b);
+    g_allocationCount--;
+    std::free(b);
+}
+void operator delete(void * p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+// exposes the create info erase so that fake handles are never
+// passed to a vulkan destroy function
+struct TestStorage : public vkb::Storage
+{
+    using vkb::Storage::_eraseCreateInfo;
+};
+
+SCENARIO( "Create info memory footprint with 100k objects" )
+{
+    const uintptr_t N = 100000;
+
+    vkb::BufferCreateInfo2 C;
+    C.size  = 1024;
+    C.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+
+    // the previous storage: one std::any per object in a std::map
+    size_t anyBytes = 0;
+    size_t anyCount = 0;
+    {
+        auto before      = g_allocatedBytes.load();
+        auto beforeCount = g_allocationCount.load();
+
+        std::map<void*, std::any> M;
+        for(uintptr_t i=1;i<=N;i++)
+            M[ static_cast<void*>( fakeHandle<vk::Buffer>(i*16) ) ] = C;
+
+        anyBytes = g_allocatedBytes.load() - before;
+        anyCount = g_allocationCount.load() - beforeCount;
+    }
+
+    size_t arenaBytes = 0;
+    size_t arenaCount = 0;
+    {
+        auto before      = g_allocatedBytes.load();
+        auto beforeCount = g_allocationCount.load();
+
+        vkb::Storage S;
+        for(uintptr_t i=1;i<=N;i++)
+            S.storeCreateInfo( fakeHandle<vk::Buffer>(i*16), C);
+
+        arenaBytes = g_allocatedBytes.load() - before;
+        arenaCount = g_allocationCount.load() - beforeCount;
+
+        REQUIRE( S.getCreateInfoArena<vkb::BufferCreateInfo2>()->size() == N );
+        REQUIRE( S.getCreateInfo<vkb::BufferCreateInfo2>( fakeHandle<vk::Buffer>(N*16) ).size == 1024 );
+    }
+
+    WARN( "Create info footprint for " << N << " objects.\n"
+          "  std::map<void*, std::any>: " << anyBytes   << " bytes in " << anyCount   << " allocations\n"
+          "  CreateInfoArena:           " << arenaBytes << " bytes in " << arenaCount << " allocations" );
+
+    REQUIRE( arenaBytes < anyBytes );
+    REQUIRE( arenaCount * 10 < anyCount );
+}
+
+SCENARIO( "Looking up create infos" )
+{
+    TestStorage S;
+
+    vkb::BufferCreateInfo2 C;
+    C.size = 1024;
+
+    auto b1 = fakeHandle<vk::Buffer>(0x10);
+    auto b2 = fakeHandle<vk::Buffer>(0x20);
+
+    S.storeCreateInfo(b1, C);
+
+    REQUIRE( S.tryGetCreateInfo<vkb::BufferCreateInfo2>(b1) != nullptr );
+    REQUIRE( S.tryGetCreateInfo<vkb::BufferCreateInfo2>(b2) == nullptr );
+
+    // a null handle never matches the empty slots of the index
+    REQUIRE( S.tryGetCreateInfo<vkb::BufferCreateInfo2>(vk::Buffer()) == nullptr );
+
+    // the wrong type is a miss, not an exception
+    REQUIRE( S.tryGetCreateInfo<vkb::SamplerCreateInfo2>(b1) == nullptr );
+
+    REQUIRE_THROWS_AS( S.getCreateInfo<vkb::BufferCreateInfo2>(b2), std::out_of_range );
+    REQUIRE_THROWS_AS( S.storeCreateInfo(b1, C), std::runtime_error );
+
+    WHEN("Objects are erased, their slots are reused and other references stay valid")
+    {
+        auto & c1 = S.getCreateInfo<vkb::BufferCreateInfo2>(b1);
+
+        S.storeCreateInfo(b2, C);
+        S._eraseCreateInfo(b2);
+
+        REQUIRE( S.tryGetCreateInfo<vkb::BufferCreateInfo2>(b2) == nullptr );
+        REQUIRE( &S.getCreateInfo<vkb::BufferCreateInfo2>(b1) == &c1 );
+    }
+}
@@ -1,4 +1,5 @@
 #include "catch.hpp"
+#include "FakeHandle.h"
 #include <fstream>
 
 #include <SDL2/SDL.h>
@@ -36,6 +37,40 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
 }
 
 
+SCENARIO( "Descriptor pool statistics" )
+{
+    vkb::Storage S;
+
+    std::vector<vk::DescriptorSetLayoutBinding> bindings(1);
+    bindings[0].descriptorType  = vk::DescriptorType::eUniformBuffer;
+    bindings[0].descriptorCount = 4;
+
+    WHEN("The sets of a layout are spread over several pools")
+    {
+        S.descriptorPoolStatistics[ fakeHandle<vk::DescriptorPool>(0x10) ].recordAllocation(7, bindings, 10);
+        S.descriptorPoolStatistics[ fakeHandle<vk::DescriptorPool>(0x20) ].recordAllocation(7, bindings, 5);
+
+        THEN("The peaks of the pools are added")
+        {
+            REQUIRE( S.getPeakSetsPerLayout().at(7) == 15 );
+        }
+    }
+    WHEN("The descriptor counts overflow")
+    {
+        bindings[0].descriptorCount = 0x10000;
+
+        auto & st = S.descriptorPoolStatistics[ fakeHandle<vk::DescriptorPool>(0x10) ];
+        st.recordAllocation(7, bindings, 0x10000);
+        st.recordAllocation(7, bindings, 1);
+
+        THEN("They are clamped")
+        {
+            REQUIRE( st.allocatedDescriptors.at(vk::DescriptorType::eUniformBuffer) == std::numeric_limits<uint32_t>::max() );
+            REQUIRE( st.peakDescriptors.at(vk::DescriptorType::eUniformBuffer)      == std::numeric_limits<uint32_t>::max() );
+        }
+    }
+}
+
 SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 {
     SDL_Init(SDL_INIT_EVERYTHING);
@@ -100,6 +135,58 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 
         REQUIRE( dSet != vk::DescriptorSet()) ;
 
+        auto & stats = S.descriptorPoolStatistics.at(dPool);
+        REQUIRE( stats.allocatedSets == 1);
+        REQUIRE( stats.allocatedDescriptors.at(vk::DescriptorType::eCombinedImageSampler) == 4);
+        REQUIRE( S.getPeakSetsPerLayout().at(v.hash()) == 1);
+
+        S.resetDescriptorPool(dPool, window->getDevice());
+        REQUIRE( stats.allocatedSets == 0);
+        REQUIRE( stats.peakSets == 1);
+    }
+    {
+        vkb::DescriptorSetLayoutCreateInfo2 v1;
+        v1.addDescriptor(0, vk::DescriptorType::eCombinedImageSampler, 4, vk::ShaderStageFlagBits::eFragment);
+
+        vkb::DescriptorSetLayoutCreateInfo2 v2;
+        v2.addDescriptor(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
+        v2.addDescriptor(1, vk::DescriptorType::eCombinedImageSampler, 2, vk::ShaderStageFlagBits::eFragment);
+
+        v1.create(S, window->getDevice());
+        v2.create(S, window->getDevice());
+
+        // 10 sets of v1 and 5 sets of v2
+        auto pC2 = vkb::DescriptorPoolCreateInfo2::createFromLayouts(S, { {v1.hash(), 10}, {v2.hash(), 5} });
+
+        REQUIRE( pC2.maxSets == 15);
+        REQUIRE( pC2.sizes.size() == 2);
+        for(auto & s : pC2.sizes)
+        {
+            if( s.type == vk::DescriptorType::eCombinedImageSampler)
+                REQUIRE( s.descriptorCount == 4*10 + 2*5);
+            if( s.type == vk::DescriptorType::eUniformBuffer)
+                REQUIRE( s.descriptorCount == 5);
+        }
+
+        auto pool2 = pC2.create(S, window->getDevice());
+
+        // allocate 8 sets of v1 in one call
+        std::array<vk::DescriptorSet, 8> sets;
+        REQUIRE( v1.allocateFromPool(S, pool2, window->getDevice(), 8, sets.data()) == vk::Result::eSuccess );
+        for(auto & x : sets)
+            REQUIRE( x != vk::DescriptorSet() );
+
+        // allocate the remaining 2 sets of v1 and 5 sets of v2 in one call
+        std::array<vkb::DescriptorSetLayoutCreateInfo2 const*, 7> layouts = {&v1, &v2, &v2, &v1, &v2, &v2, &v2};
+        std::array<vk::DescriptorSet, 7> mixedSets;
+        REQUIRE( vkb::DescriptorSetLayoutCreateInfo2::allocateFromPool(S, pool2, window->getDevice(), layouts.data(), 7, mixedSets.data()) == vk::Result::eSuccess );
+
+        auto & stats = S.descriptorPoolStatistics.at(pool2);
+        REQUIRE( stats.allocatedSets == 15);
+        REQUIRE( stats.allocatedSetsPerLayout.at(v1.hash()) == 10);
+        REQUIRE( stats.allocatedSetsPerLayout.at(v2.hash()) == 5);
+
+        S.destroy(pool2, window->getDevice());
     }
     S.destroyAll( window->getDevice());
 
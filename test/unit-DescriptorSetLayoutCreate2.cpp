@@ -85,8 +85,6 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
         REQUIRE( d != vk::DescriptorSetLayout() );
 
 
-        S.destroy(d, window->getDevice());
-
         auto & Ci = S.getCreateInfo<vkb::DescriptorSetLayoutCreateInfo2>(d);
 
         REQUIRE( Ci.bindings.size()             == v.bindings.size()            );
@@ -97,6 +95,79 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 
         REQUIRE( Ci.hash() == v.hash() );
 
+        S.destroy(d, window->getDevice());
+
+        REQUIRE_THROWS_AS( S.getCreateInfo<vkb::DescriptorSetLayoutCreateInfo2>(d), std::out_of_range );
+
+    }
+
+    {
+        vkb::Storage S;
+        auto device = vk::Device(window->getDevice());
+
+        vkb::SamplerCreateInfo2 linear;
+        linear.magFilter = vk::Filter::eLinear;
+        linear.minFilter = vk::Filter::eLinear;
+
+        vkb::SamplerCreateInfo2 nearest;
+
+        vkb::DescriptorSetLayoutCreateInfo2 v;
+        v.addDescriptor(0, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment, {linear, nearest});
+        v.addDescriptor(1, vk::DescriptorType::eSampler,              vk::ShaderStageFlagBits::eFragment, {linear});
+
+        REQUIRE( v.bindings[0].descriptorCount == 2);
+        REQUIRE( v.bindings[1].descriptorCount == 1);
+
+        // the samplers are part of the hash
+        vkb::DescriptorSetLayoutCreateInfo2 v2 = v;
+        REQUIRE( v2 == v );
+        REQUIRE( v2.hash() == v.hash() );
+
+        std::get<vkb::SamplerCreateInfo2>(v2.immutableSamplers[1][0]).maxLod = 8.0f;
+        REQUIRE( v2 != v );
+        REQUIRE( v2.hash() != v.hash() );
+
+        // immutable samplers must be created using the storage
+        REQUIRE_THROWS_AS( v.create(device), std::runtime_error );
+
+        auto d  = v.create(S, device);
+        auto d2 = v.create(S, device);
+
+        REQUIRE( d != vk::DescriptorSetLayout() );
+        REQUIRE( d == d2 );
+
+        // linear is shared by both bindings
+        REQUIRE( S.samplers.size() == 2 );
+        auto sLinear = S.samplers.at(linear.hash());
+        REQUIRE( S.getReferenceCount(sLinear) == 2 );
+
+        // a layout can also use sampler handles
+        vkb::DescriptorSetLayoutCreateInfo2 v3;
+        v3.addDescriptor(0, vk::DescriptorType::eSampler, vk::ShaderStageFlagBits::eFragment, {sLinear});
+        auto d3 = v3.create(S, device);
+        REQUIRE( d3 != d );
+        REQUIRE( S.getReferenceCount(sLinear) == 3 );
+
+        // a layout which fails to be created releases the samplers it acquired
+        vk::SamplerReductionModeCreateInfo R;
+        vkb::SamplerCreateInfo2 reduced;
+        reduced.pNext = &R;
+
+        vkb::DescriptorSetLayoutCreateInfo2 v4;
+        v4.addDescriptor(0, vk::DescriptorType::eSampler, vk::ShaderStageFlagBits::eFragment, {linear});
+        v4.addDescriptor(1, vk::DescriptorType::eSampler, vk::ShaderStageFlagBits::eFragment, {reduced});
+        REQUIRE_THROWS_AS( v4.create(S, device), std::runtime_error );
+        REQUIRE( S.getReferenceCount(sLinear) == 3 );
+
+        // destroying the layout releases its samplers, linear
+        // is still used by d3
+        S.destroy(d, device);
+        REQUIRE( S.samplers.size() == 1 );
+        REQUIRE( S.getReferenceCount(sLinear) == 1 );
+
+        S.destroy(d3, device);
+        REQUIRE( S.samplers.size() == 0 );
+        S.destroyAll(device);
     }
 
 
@@ -1,5 +1,7 @@
 #include "catch.hpp"
 #include <fstream>
+#include <chrono>
+#include <thread>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
@@ -38,6 +40,78 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
 }
 
 
+SCENARIO( "PipelineStateKey fields" )
+{
+    using K = vkb::PipelineStateKey;
+
+    // the fields do not overlap
+    uint64_t all = 0;
+    for(auto m : {K::Topology::mask, K::PrimitiveRestart::mask, K::PolygonMode::mask, K::CullMode::mask,
+                  K::FrontFace::mask, K::DepthClamp::mask, K::RasterizerDiscard::mask, K::DepthBias::mask, K::Extra::mask})
+    {
+        REQUIRE( (all & m) == 0 );
+        all |= m;
+    }
+
+    K k;
+    k.set<K::Topology>( static_cast<uint64_t>(vk::PrimitiveTopology::ePatchList) )
+     .set<K::CullMode>( 3 )
+     .set<K::Extra>( 0xffffffffu );
+    REQUIRE( k.get<K::Topology>() == static_cast<uint64_t>(vk::PrimitiveTopology::ePatchList) );
+    REQUIRE( k.get<K::CullMode>() == 3 );
+    REQUIRE( k.get<K::FrontFace>() == 0 );
+    REQUIRE( k.get<K::Extra>() == 0xffffffffu );
+
+    k.set<K::CullMode>( 1 );
+    REQUIRE( k.get<K::CullMode>() == 1 );
+    REQUIRE( k.get<K::Extra>() == 0xffffffffu );
+
+    REQUIRE_THROWS_AS( k.set<K::CullMode>(4), std::runtime_error );
+    REQUIRE_THROWS_AS( k.set<K::Extra>(uint64_t(1) << 32), std::runtime_error );
+}
+
+// exposes the interning of the extra states, so that
+// hash collisions can be tested without a device
+struct ExtraStates : vkb::DynamicPipeline
+{
+    using vkb::DynamicPipeline::_intern;
+};
+
+SCENARIO( "Extra states with the same hash get their own ids" )
+{
+    ExtraStates dP;
+
+    vkb::GraphicsPipelineCreateInfo2 a;
+    a.stages.emplace_back().setSpecializationConstant(0, 1.0f);
+    a.rasterizationState.lineWidth = 1.0f;
+
+    auto b = a;
+    b.rasterizationState.lineWidth = 2.0f;
+
+    auto c = a;
+    c.stages[0].setSpecializationConstant(0, 2.0f);
+
+    // the same hash is given for every state
+    auto ia = dP._intern(42, a, true);
+    auto ib = dP._intern(42, b, true);
+    auto ic = dP._intern(42, c, true);
+
+    REQUIRE( ia != ib );
+    REQUIRE( ia != ic );
+    REQUIRE( ib != ic );
+
+    THEN("Equal states get the same id")
+    {
+        REQUIRE( dP._intern(42, b, true) == ib );
+
+        // the polygon mode is part of the key when it fits
+        auto d = a;
+        d.rasterizationState.polygonMode = vk::PolygonMode::eLine;
+        REQUIRE( dP._intern(42, d, true)  == ia );
+        REQUIRE( dP._intern(42, d, false) != ia );
+    }
+}
+
 SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 {
     SDL_Init(SDL_INIT_EVERYTHING);
@@ -137,3 +211,688 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 
 }
 
+
+static vkb::GraphicsPipelineCreateInfo2 makePipeline(vk::Format swapchainFormat)
+{
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+
+    PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+    PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+
+    PCI.setVertexInputAttribute(0,0,vk::Format::eR32G32B32Sfloat,0 );
+    PCI.setVertexInputBinding(0,12, vk::VertexInputRate::eVertex);
+
+    PCI.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+    PCI.addStage( vk::ShaderStageFlagBits::eFragment, "main", CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+
+    PCI.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{ swapchainFormat, vk::ImageLayout::ePresentSrcKHR}});
+    PCI.addPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 128);
+    PCI.addBlendStateAttachment();
+    return PCI;
+}
+
+// records the dynamic state commands instead of calling vulkan
+struct MockCommandBuffer
+{
+    std::vector<vk::CullModeFlags>     cullModes;
+    std::vector<vk::FrontFace>         frontFaces;
+    std::vector<vk::PrimitiveTopology> topologies;
+
+    template<typename Dispatch_t>
+    void setCullModeEXT(vk::CullModeFlags c, Dispatch_t const &)            { cullModes.push_back(c); }
+    template<typename Dispatch_t>
+    void setFrontFaceEXT(vk::FrontFace f, Dispatch_t const &)               { frontFaces.push_back(f); }
+    template<typename Dispatch_t>
+    void setPrimitiveTopologyEXT(vk::PrimitiveTopology t, Dispatch_t const &){ topologies.push_back(t); }
+};
+
+SCENARIO( "Recording the dynamic state into a vk::CommandBuffer" )
+{
+    // the EXT commands are not exported by the loader, so they
+    // are called through the dispatcher which is given
+    vk::DispatchLoaderDynamic dld;
+    vk::CommandBuffer         cmd;
+
+    vkb::DynamicPipeline dP;
+    vkb::DynamicPipeline::CommandBufferState state;
+    REQUIRE( !dP.extendedDynamicState() );
+
+    // nothing is recorded unless the extended dynamic state is enabled
+    dP.recordDynamicState(cmd, state, dP.dynamicState(), dld);
+    REQUIRE( !state.valid );
+}
+
+SCENARIO( " Scenario 2: Extended dynamic state" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+    PCI.rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+
+    vkb::DynamicPipeline dP;
+    dP.init(&S, PCI, window->getDevice(), true);
+
+    REQUIRE( dP.extendedDynamicState() );
+    REQUIRE( dP.pipelineCount() == 1);
+
+    // the pipeline was created with the dynamic states, and the
+    // current state still holds the values which were given
+    auto & created = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(dP.get()) );
+    for(auto d : {vk::DynamicState::eCullModeEXT, vk::DynamicState::eFrontFaceEXT, vk::DynamicState::ePrimitiveTopologyEXT})
+        REQUIRE( std::count(created.dynamicStates.begin(), created.dynamicStates.end(), d) == 1 );
+    REQUIRE( dP.currentCreateInfo().rasterizationState.cullMode == vk::CullModeFlagBits::eBack );
+
+    auto x = dP.get();
+
+    WHEN("The dynamic states change")
+    {
+        dP.setCullMode( vk::CullModeFlagBits::eFront );
+        dP.setFrontFace( vk::FrontFace::eClockwise );
+        dP.setTopology( vk::PrimitiveTopology::eTriangleStrip );
+
+        THEN("No new pipeline is created")
+        {
+            REQUIRE( std::get<0>(dP.get()) == std::get<0>(x) );
+            REQUIRE( dP.pipelineCount() == 1);
+        }
+    }
+    WHEN("The topology class changes")
+    {
+        dP.setTopology( vk::PrimitiveTopology::eLineStrip );
+        auto y = dP.get();
+        REQUIRE( std::get<0>(y) != std::get<0>(x) );
+
+        dP.setTopology( vk::PrimitiveTopology::eLineList );
+        REQUIRE( std::get<0>(dP.get()) == std::get<0>(y) );
+        REQUIRE( dP.pipelineCount() == 2);
+    }
+    WHEN("A state which is not dynamic changes")
+    {
+        dP.setPolygonMode( vk::PolygonMode::eLine );
+        REQUIRE( std::get<0>(dP.get()) != std::get<0>(x) );
+        REQUIRE( dP.pipelineCount() == 2);
+    }
+    WHEN("Recording the dynamic state")
+    {
+        MockCommandBuffer cmd;
+        vkb::DynamicPipeline::CommandBufferState state;
+
+        dP.recordDynamicState(cmd, state, dP.dynamicState());
+        REQUIRE( cmd.cullModes  == std::vector<vk::CullModeFlags>{vk::CullModeFlagBits::eBack} );
+        REQUIRE( cmd.frontFaces.size() == 1 );
+        REQUIRE( cmd.topologies.size() == 1 );
+
+        THEN("Redundant values are not recorded")
+        {
+            dP.recordDynamicState(cmd, state, dP.dynamicState());
+            dP.setCullMode( vk::CullModeFlagBits::eBack );
+            dP.recordDynamicState(cmd, state, dP.dynamicState());
+            REQUIRE( cmd.cullModes.size()  == 1 );
+            REQUIRE( cmd.frontFaces.size() == 1 );
+            REQUIRE( cmd.topologies.size() == 1 );
+
+            dP.setCullMode( vk::CullModeFlagBits::eNone );
+            dP.recordDynamicState(cmd, state, dP.dynamicState());
+            REQUIRE( cmd.cullModes.size()  == 2 );
+            REQUIRE( cmd.cullModes.back()  == vk::CullModeFlags(vk::CullModeFlagBits::eNone) );
+            REQUIRE( cmd.frontFaces.size() == 1 );
+        }
+        THEN("Every value is recorded after invalidating")
+        {
+            state.invalidate();
+            dP.recordDynamicState(cmd, state, dP.dynamicState());
+            REQUIRE( cmd.cullModes.size()  == 2 );
+            REQUIRE( cmd.frontFaces.size() == 2 );
+            REQUIRE( cmd.topologies.size() == 2 );
+        }
+        THEN("Each recording thread can give its own values")
+        {
+            auto k = dP.key();
+            auto v = dP.dynamicState();
+            v.cullMode = vk::CullModeFlagBits::eFront;
+
+            // the key selects the same pipeline, the values are recorded
+            REQUIRE( std::get<0>( dP.get( dP.setCullMode(k, v.cullMode) ) ) == std::get<0>(x) );
+            dP.recordDynamicState(cmd, state, v);
+            REQUIRE( cmd.cullModes.size() == 2 );
+            REQUIRE( cmd.cullModes.back() == vk::CullModeFlags(vk::CullModeFlagBits::eFront) );
+            REQUIRE( state.recorded == v );
+
+            // the current state is not changed
+            REQUIRE( dP.dynamicState().cullMode == vk::CullModeFlags(vk::CullModeFlagBits::eBack) );
+        }
+        THEN("A second DynamicPipeline recording into the same command buffer is taken into account")
+        {
+            auto PCI2 = PCI;
+            PCI2.rasterizationState.cullMode = vk::CullModeFlagBits::eFront;
+
+            vkb::DynamicPipeline dP2;
+            dP2.init(&S, PCI2, window->getDevice(), true);
+
+            dP2.recordDynamicState(cmd, state, dP2.dynamicState());
+            dP.recordDynamicState(cmd, state, dP.dynamicState());
+            REQUIRE( cmd.cullModes == std::vector<vk::CullModeFlags>{vk::CullModeFlagBits::eBack,
+                                                                     vk::CullModeFlagBits::eFront,
+                                                                     vk::CullModeFlagBits::eBack} );
+            REQUIRE( cmd.frontFaces.size() == 1 );
+            REQUIRE( cmd.topologies.size() == 1 );
+
+            dP2.destroy();
+        }
+    }
+
+    dP.destroy();
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+SCENARIO( " Scenario 3: Varying specialization constants" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+    PCI.stages[1].setSpecializationConstant(0, false);
+
+    vkb::DynamicPipeline dP;
+    dP.init(&S, PCI, window->getDevice());
+
+    auto x = dP.get();
+
+    dP.setSpecializationConstant(vk::ShaderStageFlagBits::eFragment, 0, true);
+    auto y = dP.get();
+    REQUIRE( std::get<0>(y) != std::get<0>(x) );
+    REQUIRE( dP.pipelineCount() == 2);
+
+    // the shader module is shared by both variants
+    auto & cx = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(x) );
+    auto & cy = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(y) );
+    REQUIRE( cx.stages[1].module == cy.stages[1].module );
+    REQUIRE( cy.stages[1].getSpecializationConstant<bool>(0) == true );
+
+    dP.setSpecializationConstant(vk::ShaderStageFlagBits::eFragment, 0, false);
+    REQUIRE( std::get<0>(dP.get()) == std::get<0>(x) );
+    REQUIRE( dP.pipelineCount() == 2);
+
+    REQUIRE_THROWS_AS( dP.setSpecializationConstant(vk::ShaderStageFlagBits::eGeometry, 0, 1u), std::runtime_error );
+
+    dP.destroy();
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+SCENARIO( " Scenario 4: Variants are created as derivatives" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+
+    WHEN("Derivatives are enabled")
+    {
+        vkb::DynamicPipeline dP;
+        dP.init(&S, PCI, window->getDevice());
+
+        auto x = std::get<0>(dP.get());
+        REQUIRE( dP.statistics().size() == 1 );
+
+        auto & sx = dP.statistics().begin()->second;
+        REQUIRE( sx.pipeline == x );
+        REQUIRE( sx.compiled );
+        REQUIRE( !sx.basePipeline );
+        REQUIRE( (S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(x).flags & vk::PipelineCreateFlagBits::eAllowDerivatives) );
+
+        dP.setPolygonMode(vk::PolygonMode::eLine);
+        auto y = std::get<0>(dP.get());
+
+        auto & cy = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(y);
+        REQUIRE( (cy.flags & vk::PipelineCreateFlagBits::eDerivative) );
+        REQUIRE( cy.basePipelineHandle == x );
+
+        // the closest variant is the parent
+        dP.setCullMode(vk::CullModeFlagBits::eBack);
+        auto z = std::get<0>(dP.get());
+        REQUIRE( S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(z).basePipelineHandle == y );
+
+        REQUIRE( dP.statistics().size() == 3 );
+        for(auto & st : dP.statistics())
+        {
+            REQUIRE( st.second.compiled );
+            REQUIRE( (st.second.pipeline == x) == !st.second.basePipeline );
+        }
+
+        // the caller's flags are not changed
+        REQUIRE( !(dP.currentCreateInfo().flags & vk::PipelineCreateFlagBits::eAllowDerivatives) );
+
+        dP.destroy();
+        REQUIRE( dP.statistics().empty() );
+    }
+    WHEN("Derivatives are disabled")
+    {
+        vkb::DynamicPipeline dP;
+        dP.setDerivatives(false);
+        dP.init(&S, PCI, window->getDevice());
+
+        dP.setPolygonMode(vk::PolygonMode::eLine);
+        auto y = std::get<0>(dP.get());
+        REQUIRE( !S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(y).flags );
+        for(auto & st : dP.statistics())
+            REQUIRE( !st.second.basePipeline );
+
+        dP.destroy();
+    }
+
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+SCENARIO( " Scenario 5: DynamicPipelines share their variants" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+
+    WHEN("Two DynamicPipelines use the same states")
+    {
+        vkb::DynamicPipeline a;
+        vkb::DynamicPipeline b;
+        a.init(&S, PCI, window->getDevice());
+        b.init(&S, PCI, window->getDevice());
+
+        auto x = std::get<0>(a.get());
+        REQUIRE( std::get<0>(b.get()) == x );
+        REQUIRE( S.pipelines.size() == 1 );
+        REQUIRE( S.getReferenceCount(x) == 2 );
+        REQUIRE( !b.statistics().begin()->second.compiled );
+
+        a.setPolygonMode(vk::PolygonMode::eLine);
+        b.setPolygonMode(vk::PolygonMode::eLine);
+        auto y = std::get<0>(a.get());
+        REQUIRE( std::get<0>(b.get()) == y );
+        REQUIRE( S.pipelines.size() == 2 );
+
+        THEN("The variants are destroyed when the last one is destroyed")
+        {
+            a.destroy();
+            REQUIRE( S.pipelines.size() == 2 );
+            REQUIRE( S.getReferenceCount(x) == 1 );
+            REQUIRE( S.getReferenceCount(y) == 1 );
+
+            b.destroy();
+            REQUIRE( S.pipelines.empty() );
+            REQUIRE( S.pipelineReferenceCount.empty() );
+        }
+    }
+    WHEN("A DynamicPipeline uses a pipeline created with the storage")
+    {
+        auto x = std::get<0>(PCI.create(S, window->getDevice()));
+
+        vkb::DynamicPipeline a;
+        a.init(&S, PCI, window->getDevice());
+        REQUIRE( std::get<0>(a.get()) == x );
+        REQUIRE( S.getReferenceCount(x) == 2 );
+
+        // the pipeline stays alive for its creator
+        a.destroy();
+        REQUIRE( S.pipelines.size() == 1 );
+
+        S.destroy(x, window->getDevice());
+        REQUIRE( S.pipelines.empty() );
+    }
+
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+SCENARIO( " Scenario 6: The state key is a single integer lookup" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+
+    vkb::DynamicPipeline dP;
+    dP.init(&S, PCI, window->getDevice());
+
+    auto k0 = dP.key();
+    REQUIRE( dP.statistics().begin()->first == k0.value );
+
+    WHEN("The setters change the state")
+    {
+        dP.setCullMode( vk::CullModeFlagBits::eBack );
+        dP.setFrontFace( vk::FrontFace::eClockwise );
+        dP.setPolygonMode( vk::PolygonMode::eLine );
+        dP.setTopology( vk::PrimitiveTopology::eLineList );
+        auto k1 = dP.key();
+
+        THEN("The key is the same as setting the state directly")
+        {
+            vkb::DynamicPipeline d2;
+            d2.init(&S, PCI, window->getDevice());
+            d2.getRasterizationState().cullMode    = vk::CullModeFlagBits::eBack;
+            d2.getRasterizationState().frontFace   = vk::FrontFace::eClockwise;
+            d2.getRasterizationState().polygonMode = vk::PolygonMode::eLine;
+            d2.getInputAssemblyState().topology    = vk::PrimitiveTopology::eLineList;
+            REQUIRE( d2.key() == k1 );
+            d2.destroy();
+        }
+        THEN("Setting the state back gives the first key")
+        {
+            dP.setCullMode( vk::CullModeFlagBits::eNone );
+            dP.setFrontFace( vk::FrontFace::eCounterClockwise );
+            dP.setPolygonMode( vk::PolygonMode::eFill );
+            dP.setTopology( vk::PrimitiveTopology::eTriangleList );
+            REQUIRE( dP.key() == k0 );
+        }
+    }
+    WHEN("A state which is not packed into bits changes")
+    {
+        dP.getRasterizationState().lineWidth = 2.0f;
+        auto k1 = dP.key();
+        REQUIRE( k1 != k0 );
+        REQUIRE( k1.get<vkb::PipelineStateKey::Extra>() != k0.get<vkb::PipelineStateKey::Extra>() );
+
+        dP.getRasterizationState().lineWidth = 1.0f;
+        REQUIRE( dP.key() == k0 );
+    }
+    WHEN("Calling get() 1M times")
+    {
+        constexpr size_t N = 1000000;
+
+        auto t0 = std::chrono::steady_clock::now();
+        size_t n = 0;
+        for(size_t i=0;i<N;i++)
+            n += std::get<0>(dP.get()) ? 1 : 0;
+        auto t1 = std::chrono::steady_clock::now();
+
+        // alternate between two variants, as when drawing
+        // front and back faces
+        for(size_t i=0;i<N;i++)
+        {
+            dP.setCullMode( i & 1 ? vk::CullModeFlagBits::eBack : vk::CullModeFlagBits::eFront );
+            n += std::get<0>(dP.get()) ? 1 : 0;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        REQUIRE( n == 2*N );
+        REQUIRE( dP.pipelineCount() == 3 );
+
+        auto ns = [](auto d){ return std::chrono::duration<double, std::nano>(d).count() / N; };
+        WARN("get(): " << ns(t1-t0) << " ns/call, setCullMode() + get(): " << ns(t2-t1) << " ns/call");
+    }
+
+    dP.destroy();
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+// every combination of cull mode and polygon mode
+static std::vector<vkb::PipelineStateKey> makeKeys(vkb::DynamicPipeline const & dP, vkb::PipelineStateKey k)
+{
+    std::vector<vkb::PipelineStateKey> keys;
+    for(auto c : {vk::CullModeFlagBits::eNone, vk::CullModeFlagBits::eFront, vk::CullModeFlagBits::eBack, vk::CullModeFlagBits::eFrontAndBack})
+    {
+        for(auto m : {vk::PolygonMode::eFill, vk::PolygonMode::eLine, vk::PolygonMode::ePoint})
+            keys.push_back( dP.setPolygonMode( dP.setCullMode(k, c), m) );
+    }
+    return keys;
+}
+
+SCENARIO( " Scenario 7: Getting pipelines from multiple threads" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+
+    vkb::DynamicPipeline dP;
+    dP.init(&S, PCI, window->getDevice());
+
+    auto keys = makeKeys(dP, dP.key());
+
+    THEN("The key overloads of the setters give the same key as the setters")
+    {
+        dP.setCullMode( vk::CullModeFlagBits::eBack );
+        dP.setPolygonMode( vk::PolygonMode::eLine );
+        REQUIRE( dP.key() == keys[7] );
+        REQUIRE( std::get<0>(dP.get()) == std::get<0>(dP.get(keys[7])) );
+    }
+    THEN("Every variant is still found after the table has grown")
+    {
+        std::vector<vk::Pipeline> created;
+        for(auto & k : keys)
+            created.push_back( std::get<0>(dP.get(k)) );
+        REQUIRE( dP.pipelineCount() == keys.size() );
+
+        for(size_t i=0;i<keys.size();i++)
+            REQUIRE( std::get<0>(dP.get(keys[i])) == created[i] );
+        REQUIRE( dP.pipelineCount() == keys.size() );
+    }
+    THEN("A key from another DynamicPipeline throws")
+    {
+        auto k = dP.key();
+        k.set<vkb::PipelineStateKey::Extra>(1000);
+        REQUIRE_THROWS_AS( dP.get(k), std::runtime_error );
+    }
+    WHEN("8 threads get the pipelines at the same time")
+    {
+        constexpr size_t threadCount = 8;
+        constexpr size_t N           = 20000;
+
+        std::vector< std::vector<vk::Pipeline> > results(threadCount, std::vector<vk::Pipeline>(keys.size()));
+        std::vector< size_t >                    mismatches(threadCount);
+        std::vector< std::thread >               threads;
+        for(size_t t=0;t<threadCount;t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for(size_t i=0;i<N;i++)
+                {
+                    auto j = (i*7 + t) % keys.size();
+                    auto p = std::get<0>( dP.get(keys[j]) );
+                    if( !results[t][j] )
+                        results[t][j] = p;
+                    else if( results[t][j] != p )
+                        mismatches[t]++;
+                }
+            });
+        }
+        for(auto & t : threads)
+            t.join();
+
+        THEN("Each pipeline is created once and every thread gets the same one")
+        {
+            REQUIRE( dP.pipelineCount() == keys.size() );
+            REQUIRE( S.pipelines.size() == keys.size() );
+            for(size_t t=0;t<threadCount;t++)
+            {
+                REQUIRE( mismatches[t] == 0 );
+                REQUIRE( results[t] == results[0] );
+            }
+            for(auto & st : dP.statistics())
+                REQUIRE( st.second.compiled );
+
+            // the variants unpacked from the keys have the state of the key
+            auto & c = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( results[0][7] );
+            REQUIRE( c.rasterizationState.cullMode    == vk::CullModeFlagBits::eBack );
+            REQUIRE( c.rasterizationState.polygonMode == vk::PolygonMode::eLine );
+        }
+    }
+
+    dP.destroy();
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
+
+SCENARIO( " Scenario 8: get() scales with the number of threads" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    vkb::Storage S;
+
+    auto PCI = makePipeline( vk::Format(window->getSwapchainFormat()) );
+
+    vkb::DynamicPipeline dP;
+    dP.init(&S, PCI, window->getDevice());
+
+    auto keys = makeKeys(dP, dP.key());
+    for(auto & k : keys)
+        dP.get(k);
+
+    // every thread does the same amount of work, so
+    // the calls per second grow with the thread count
+    constexpr size_t N = 250000;
+    for(size_t threadCount : {1u, 2u, 4u, 8u})
+    {
+        std::vector<size_t>      found(threadCount);
+        std::vector<std::thread> threads;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for(size_t t=0;t<threadCount;t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                // counted locally, the counters of neighbouring
+                // threads would share a cache line
+                size_t n = 0;
+                for(size_t i=0;i<N;i++)
+                    n += std::get<0>( dP.get(keys[(i+t) % keys.size()]) ) ? 1 : 0;
+                found[t] = n;
+            });
+        }
+        for(auto & t : threads)
+            t.join();
+        auto t1 = std::chrono::steady_clock::now();
+
+        for(auto f : found)
+            REQUIRE( f == N );
+
+        auto s = std::chrono::duration<double>(t1-t0).count();
+        WARN(threadCount << " threads: " << (threadCount * N / s) / 1e6 << " M get()/s");
+    }
+    REQUIRE( dP.pipelineCount() == keys.size() );
+
+    dP.destroy();
+    S.destroyAll(window->getDevice());
+
+    delete window;
+    SDL_Quit();
+}
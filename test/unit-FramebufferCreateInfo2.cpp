@@ -0,0 +1,204 @@
+#include "catch.hpp"
+#include <fstream>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+
+SCENARIO( " Scenario 1: Create a Framebuffer" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+    auto physicalDevice = vk::PhysicalDevice(window->getPhysicalDevice());
+
+    vkb::Storage S;
+
+    // create an image to render into
+    vk::ImageCreateInfo ici;
+    ici.imageType   = vk::ImageType::e2D;
+    ici.format      = vk::Format::eR8G8B8A8Unorm;
+    ici.extent      = vk::Extent3D(256, 256, 1);
+    ici.mipLevels   = 1;
+    ici.arrayLayers = 1;
+    ici.samples     = vk::SampleCountFlagBits::e1;
+    ici.tiling      = vk::ImageTiling::eOptimal;
+    ici.usage       = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
+
+    auto image = device.createImage(ici);
+
+    vkb::MemoryAllocInfo2 ma;
+    ma.bufferOrImage = image;
+    ma.flags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    auto mem = ma.create(S, device, physicalDevice);
+    device.bindImageMemory(image, mem, 0);
+
+    // create the image view, creating it twice will return
+    // the same image view
+    vkb::ImageViewCreateInfo2 ivci;
+    ivci.setImage(image, vk::Format::eR8G8B8A8Unorm);
+
+    auto view  = ivci.create(S, device);
+    auto view2 = ivci.create(S, device);
+
+    REQUIRE( view != vk::ImageView() );
+    REQUIRE( view == view2 );
+    REQUIRE( S.imageViews.size() == 1);
+
+    // create a framebuffer
+    vkb::FramebufferCreateInfo2 fbci;
+    fbci.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass( { {vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::eShaderReadOnlyOptimal} } );
+    fbci.attachments.push_back(view);
+    fbci.width  = 256;
+    fbci.height = 256;
+
+    auto fb  = fbci.create(S, device);
+    auto fb2 = fbci.create(S, device);
+
+    REQUIRE( fb != vk::Framebuffer() );
+    REQUIRE( fb == fb2 );
+
+    // a compatible renderpass will reuse the same framebuffer
+    auto fbci2 = fbci;
+    std::get<vkb::RenderPassCreateInfo2>(fbci2.renderPass).attachments[0].finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+    auto fb3 = fbci2.create(S, device);
+
+    REQUIRE( fb3 == fb );
+    REQUIRE( S.renderPasses.size() == 2);
+    REQUIRE( S.framebuffers.size() == 1);
+
+    // invalidating the image will destroy the view and the framebuffer
+    S.invalidate(image, device);
+
+    REQUIRE( S.imageViews.size()   == 0);
+    REQUIRE( S.framebuffers.size() == 0);
+    REQUIRE_THROWS( S.getCreateInfo<vkb::FramebufferCreateInfo2>(fb) );
+
+    S.destroy(image, device);
+    S.destroy(mem, device);
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+
+}
+
+SCENARIO( " Scenario 2: Retire a Framebuffer and its image view" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+    auto physicalDevice = vk::PhysicalDevice(window->getPhysicalDevice());
+
+    vkb::Storage S;
+
+    vk::ImageCreateInfo ici;
+    ici.imageType   = vk::ImageType::e2D;
+    ici.format      = vk::Format::eR8G8B8A8Unorm;
+    ici.extent      = vk::Extent3D(256, 256, 1);
+    ici.mipLevels   = 1;
+    ici.arrayLayers = 1;
+    ici.samples     = vk::SampleCountFlagBits::e1;
+    ici.tiling      = vk::ImageTiling::eOptimal;
+    ici.usage       = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
+
+    auto image = device.createImage(ici);
+
+    vkb::MemoryAllocInfo2 ma;
+    ma.bufferOrImage = image;
+    ma.flags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    auto mem = ma.create(S, device, physicalDevice);
+    device.bindImageMemory(image, mem, 0);
+
+    vkb::ImageViewCreateInfo2 ivci;
+    ivci.setImage(image, vk::Format::eR8G8B8A8Unorm);
+    auto view = ivci.create(S, device);
+
+    vkb::FramebufferCreateInfo2 fbci;
+    fbci.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass( { {vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::eShaderReadOnlyOptimal} } );
+    fbci.attachments.push_back(view);
+    fbci.width  = 256;
+    fbci.height = 256;
+    auto fb = fbci.create(S, device);
+
+    // the framebuffer is retired later than the view it uses
+    S.retire(fb, 10);
+    S.retire(view, 5);
+
+    // collecting the view also destroys the framebuffer
+    REQUIRE( S.collect(5, device) == 1 );
+    REQUIRE( S.imageViews.size()   == 0);
+    REQUIRE( S.framebuffers.size() == 0);
+
+    // so it must not be destroyed a second time
+    REQUIRE( S.collect(10, device) == 0 );
+    REQUIRE( S.retiredCount() == 0 );
+
+    S.destroy(image, device);
+    S.destroy(mem, device);
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
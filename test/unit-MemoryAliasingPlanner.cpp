@@ -0,0 +1,143 @@
+#include "catch.hpp"
+
+#include <random>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/utils/MemoryAliasingPlanner.h>
+
+static vk::MemoryRequirements req(vk::DeviceSize size, vk::DeviceSize alignment = 256, uint32_t memoryTypeBits = 0xFF)
+{
+    vk::MemoryRequirements r;
+    r.size           = size;
+    r.alignment      = alignment;
+    r.memoryTypeBits = memoryTypeBits;
+    return r;
+}
+
+SCENARIO( "Planning resources with disjoint lifetimes" )
+{
+    vkb::MemoryAliasingPlanner P;
+
+    auto a = P.addResource( req(1024), 0, 1);
+    auto b = P.addResource( req(1024), 2, 3);
+    auto c = P.addResource( req(512),  4, 5);
+
+    auto plan = P.plan();
+
+    REQUIRE( P.isValid(plan) );
+
+    THEN("All resources share the same memory")
+    {
+        REQUIRE( plan.blocks.size() == 1);
+        REQUIRE( plan.blocks[0].size == 1024);
+        REQUIRE( plan.placements[a].offset == 0);
+        REQUIRE( plan.placements[b].offset == 0);
+        REQUIRE( plan.placements[c].offset == 0);
+
+        REQUIRE( plan.unaliasedSize == 2560);
+        REQUIRE( plan.totalSize     == 1024);
+        REQUIRE( plan.bytesSaved()  == 1536);
+    }
+}
+
+SCENARIO( "Planning resources with overlapping lifetimes" )
+{
+    vkb::MemoryAliasingPlanner P;
+
+    // lifetimes are inclusive, so a and b overlap at 1
+    auto a = P.addResource( req(1024), 0, 1);
+    auto b = P.addResource( req(1024), 1, 2);
+    auto c = P.addResource( req(1024), 2, 3);
+
+    auto plan = P.plan();
+
+    REQUIRE( P.isValid(plan) );
+
+    // a and c can share memory, b cannot
+    REQUIRE( plan.placements[a].block  == plan.placements[c].block);
+    REQUIRE( plan.placements[a].offset == plan.placements[c].offset);
+    REQUIRE( plan.bytesSaved() == 1024);
+
+    WHEN("A smaller resource fits beside a larger one")
+    {
+        vkb::MemoryAliasingPlanner Q;
+
+        auto big    = Q.addResource( req(4096), 0, 0);
+        auto small1 = Q.addResource( req(1000), 1, 1);
+        auto small2 = Q.addResource( req(1000), 1, 1);
+
+        auto plan2 = Q.plan();
+
+        REQUIRE( Q.isValid(plan2) );
+        REQUIRE( plan2.blocks.size() == 1);
+        REQUIRE( plan2.placements[big].offset    == 0);
+        REQUIRE( plan2.placements[small1].offset == 0);
+        REQUIRE( plan2.placements[small2].offset == 1024); // aligned to 256
+    }
+}
+
+SCENARIO( "Planning resources with incompatible memory types" )
+{
+    vkb::MemoryAliasingPlanner P;
+
+    auto a = P.addResource( req(1024, 256, 0x1), 0, 0);
+    auto b = P.addResource( req(1024, 256, 0x2), 1, 1);
+    auto c = P.addResource( req(1024, 256, 0x3), 2, 2);
+
+    auto plan = P.plan();
+
+    REQUIRE( P.isValid(plan) );
+    REQUIRE( plan.blocks.size() == 2);
+    REQUIRE( plan.placements[a].block != plan.placements[b].block);
+    REQUIRE( plan.placements[c].block == plan.placements[a].block);
+    REQUIRE( plan.blocks[plan.placements[a].block].memoryTypeBits == 0x1);
+}
+
+SCENARIO( "Planning linear and optimal resources" )
+{
+    vkb::MemoryAliasingPlanner P;
+    P.bufferImageGranularity = 4096;
+
+    auto image  = P.addResource( req(8192), 0, 0, false);
+    auto buffer = P.addResource( req(1024), 0, 1, true);
+    auto image2 = P.addResource( req(1024), 1, 1, false);
+    auto image3 = P.addResource( req(9000), 1, 1, false);
+    P.addResource( req(16384), 2, 2, false);
+
+    auto plan = P.plan();
+
+    REQUIRE( P.isValid(plan) );
+    REQUIRE( plan.blocks.size() == 1);
+
+    REQUIRE( plan.placements[image].offset  == 0);
+    REQUIRE( plan.placements[image3].offset == 0);
+
+    // the buffer is alive at the same time as the images, so
+    // it cannot share a 4096 byte page with them.
+    REQUIRE( plan.placements[buffer].offset == 12288);
+    REQUIRE( plan.placements[image2].offset == 9216);
+}
+
+SCENARIO( "Comparing the planner against one allocation per resource" )
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> size(1, 64);
+    std::uniform_int_distribution<uint32_t> start(0, 99);
+    std::uniform_int_distribution<uint32_t> length(0, 9);
+    std::uniform_int_distribution<uint32_t> type(0, 3);
+
+    vkb::MemoryAliasingPlanner P;
+    P.bufferImageGranularity = 1024;
+
+    for(int i=0;i<1000;i++)
+    {
+        auto first = start(rng);
+        P.addResource( req(size(rng) * 4096, 256u << type(rng), type(rng)==0 ? 0x1 : 0x3), first, first + length(rng), type(rng)!=0);
+    }
+
+    auto plan = P.plan();
+
+    REQUIRE( P.isValid(plan) );
+    REQUIRE( plan.totalSize < plan.unaliasedSize / 4 );
+}
@@ -0,0 +1,240 @@
+#include "catch.hpp"
+#include <cstdio>
+#include <fstream>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/PipelineArchive.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+static vkb::GraphicsPipelineCreateInfo2 makePipeline(vk::Format format)
+{
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+
+    PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+    PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+
+    uint32_t stride=0+12+24;
+    PCI.setVertexInputAttribute(0,0,vk::Format::eR32G32B32Sfloat,0 );
+    PCI.setVertexInputAttribute(1,1,vk::Format::eR32G32B32Sfloat,12);
+    PCI.setVertexInputAttribute(2,2,vk::Format::eR8G8B8A8Unorm  ,24);
+
+    PCI.setVertexInputBinding(0,stride, vk::VertexInputRate::eVertex);
+    PCI.setVertexInputBinding(1,stride, vk::VertexInputRate::eVertex);
+    PCI.setVertexInputBinding(2,stride, vk::VertexInputRate::eVertex);
+
+    PCI.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+    PCI.addStage( vk::ShaderStageFlagBits::eFragment, "main", CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+
+    PCI.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{ format, vk::ImageLayout::ePresentSrcKHR}});
+
+    vkb::PipelineLayoutCreateInfo2 layout;
+    layout.pushConstantRanges.push_back( vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 128) );
+    layout.setLayoutsDescriptions.emplace_back().addDescriptor(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
+    PCI.layout = layout;
+
+    PCI.addBlendStateAttachment();
+    return PCI;
+}
+
+SCENARIO( "Building a pipeline archive" )
+{
+    auto opaque = makePipeline(vk::Format::eB8G8R8A8Unorm);
+    auto culled = opaque;
+    culled.rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+
+    vkb::PipelineArchive::Builder B;
+    B.addPipeline("opaque", opaque);
+    B.addPipeline("culled", culled);
+    B.setPipelineCache({1,2,3,4,5});
+
+    REQUIRE_THROWS_AS( B.addPipeline("opaque", opaque), std::runtime_error );
+
+    auto data = B.build();
+    REQUIRE( data.size() % 8 == 0 );
+
+    // keep the data 8 byte aligned
+    std::vector<uint64_t> aligned( data.size() / 8 );
+    std::memcpy(aligned.data(), data.data(), data.size());
+    auto bytes = reinterpret_cast<uint8_t const*>(aligned.data());
+
+    vkb::PipelineArchive A(bytes, data.size());
+
+    // the shaders are shared by both pipelines
+    REQUIRE( A.shaderCount()   == 2 );
+    REQUIRE( A.pipelineCount() == 2 );
+
+    REQUIRE( A.hasPipeline("opaque") );
+    REQUIRE( A.hasPipeline("culled") );
+    REQUIRE( !A.hasPipeline("transparent") );
+
+    THEN("Shader modules read the SPIR-V from the archive without copying it")
+    {
+        auto & code = opaque.stages[0].code;
+        auto key    = vkb::PipelineArchive::contentHash(code.data(), code.size() * sizeof(uint32_t));
+
+        REQUIRE( A.hasShader(key) );
+
+        auto C = A.getShaderModule(key);
+        REQUIRE( C.code.empty() );
+        REQUIRE( reinterpret_cast<uint8_t const*>(C.codeData()) >= bytes );
+        REQUIRE( reinterpret_cast<uint8_t const*>(C.codeData()) <  bytes + data.size() );
+        REQUIRE( std::vector<uint32_t>(C.codeData(), C.codeData() + C.codeSize()) == code );
+
+        // a view hashes the same as the code it views
+        vkb::ShaderModuleCreateInfo2 owned;
+        owned.code = code;
+        REQUIRE( C.hash() == owned.hash() );
+
+        REQUIRE_THROWS_AS( A.getShaderModule(key+1), std::out_of_range );
+    }
+
+    THEN("The pipeline cache is embedded")
+    {
+        REQUIRE( A.pipelineCacheSize() == 5 );
+        auto p = static_cast<uint8_t const*>(A.pipelineCacheData());
+        REQUIRE( std::vector<uint8_t>(p, p+5) == std::vector<uint8_t>({1,2,3,4,5}) );
+    }
+
+    THEN("Corrupt archives are rejected")
+    {
+        auto header = aligned;
+        header[0] ^= 0xFF;
+        REQUIRE_THROWS_AS( vkb::PipelineArchive(reinterpret_cast<uint8_t const*>(header.data()), data.size()), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineArchive(bytes, data.size() - 8), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineArchive(bytes, 16), std::runtime_error );
+    }
+
+    WHEN("A pipeline does not describe its handles")
+    {
+        auto p = opaque;
+        p.layout = vk::PipelineLayout();
+        REQUIRE_THROWS_AS( B.addPipeline("layout", p), std::runtime_error );
+
+        p = opaque;
+        p.stages[0].code.clear();
+        REQUIRE_THROWS_AS( B.addPipeline("module", p), std::runtime_error );
+    }
+}
+
+SCENARIO( "Memory mapping a pipeline archive" )
+{
+    auto path = "unit-PipelineArchive.vkba";
+
+    vkb::PipelineArchive::Builder B;
+    B.addPipeline("opaque", makePipeline(vk::Format::eB8G8R8A8Unorm));
+    B.writeFile(path);
+
+    {
+        auto A = vkb::PipelineArchive::open(path);
+
+        REQUIRE( A.pipelineCount() == 1 );
+        REQUIRE( A.shaderCount()   == 2 );
+        REQUIRE( A.hasPipeline("opaque") );
+        REQUIRE( A.pipelineCacheData() == nullptr );
+
+        auto moved = std::move(A);
+        REQUIRE( moved.hasPipeline("opaque") );
+    }
+
+    REQUIRE_THROWS_AS( vkb::PipelineArchive::open("does-not-exist.vkba"), std::runtime_error );
+
+    std::remove(path);
+}
+
+SCENARIO( " Scenario 1: Create pipelines from an archive" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    auto path = "unit-PipelineArchive-device.vkba";
+    {
+        vkb::PipelineArchive::Builder B;
+        B.addPipeline("opaque", makePipeline(vk::Format(window->getSwapchainFormat())));
+
+        auto rendering = makePipeline(vk::Format(window->getSwapchainFormat()));
+        vkb::PipelineRenderingCreateInfo2 R;
+        R.colorAttachmentFormats = { vk::Format(window->getSwapchainFormat()) };
+        rendering.renderPass = R;
+        B.addPipeline("rendering", rendering);
+
+        B.writeFile(path);
+    }
+
+    vkb::Storage S;
+    {
+        auto A  = vkb::PipelineArchive::open(path);
+        auto PCI = A.getPipeline("opaque", S, device);
+
+        REQUIRE( S.shaderModules.size() == 2 );
+        REQUIRE( PCI.stages[0].module != vk::ShaderModule() );
+
+        auto [pipeline, layout, renderpass] = PCI.create(S, device);
+        REQUIRE( pipeline != vk::Pipeline() );
+
+        // the modules are shared with pipelines created from the original code
+        auto original = makePipeline(vk::Format(window->getSwapchainFormat()));
+        original.create(S, device);
+        REQUIRE( S.shaderModules.size() == 2 );
+
+        // pipelines using dynamic rendering keep their formats
+        auto R = A.getPipeline("rendering", S, device);
+        REQUIRE( std::get<vkb::PipelineRenderingCreateInfo2>(R.renderPass).colorAttachmentFormats.size() == 1 );
+
+        auto [p2, layout2, renderpass2] = R.create(S, device);
+        REQUIRE( p2 != pipeline );
+        REQUIRE( renderpass2 == vk::RenderPass() );
+    }
+
+    std::remove(path);
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
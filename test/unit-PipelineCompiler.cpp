@@ -0,0 +1,195 @@
+#include "catch.hpp"
+#include <cstdio>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/PipelineCompiler.h>
+
+// generated by vkb_compile_pipelines( ) in test/CMakeLists.txt
+#include <vkb_pipelines/deferred.h>
+#include <vkb_pipelines/shadow.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+// the descriptions are usable at compile time
+static_assert( vkb_pipelines::deferred::pipeline.setLayoutCount       == 2, "");
+static_assert( vkb_pipelines::deferred::pipeline.blendAttachmentCount == 3, "");
+static_assert( vkb_pipelines::deferred::setLayouts[1].bindingCount    == 2, "");
+static_assert( vkb_pipelines::deferred::renderPass.attachmentCount    == 4, "");
+static_assert( vkb_pipelines::deferred::pipeline.renderPass == &vkb_pipelines::deferred::renderPass, "");
+static_assert( vkb_pipelines::shadow::pipeline.renderPass   == nullptr, "");
+static_assert( vkb_pipelines::shadow::pipeline.rasterizationState.cullMode == vk::CullModeFlagBits::eFront, "");
+
+SCENARIO( "Compiled pipelines have the same hashes as the runtime builder" )
+{
+    auto & D = vkb_pipelines::deferred::pipeline;
+
+    auto runtime  = vkb::PipelineJson::load(CMAKE_SOURCE_DIR "/test/pipelines/deferred.json");
+    auto compiled = D.createInfo();
+
+    REQUIRE( compiled.hash() == runtime.hash() );
+
+    THEN("The states are the same")
+    {
+        REQUIRE( compiled.blendState.hash()       == runtime.blendState.hash() );
+        REQUIRE( compiled.vertexInputState.hash() == runtime.vertexInputState.hash() );
+        REQUIRE( compiled.dynamicStates           == runtime.dynamicStates );
+        REQUIRE( vkb::hash_pod(compiled.rasterizationState) == vkb::hash_pod(runtime.rasterizationState) );
+        REQUIRE( vkb::hash_pod(compiled.depthStencilState)  == vkb::hash_pod(runtime.depthStencilState) );
+        REQUIRE( compiled.blendState.blendConstants[2] == 0.1f );
+        REQUIRE( compiled.blendState.attachments[2].colorWriteMask == (vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB) );
+    }
+
+    THEN("The descriptor set layouts are the same")
+    {
+        auto & sets = std::get<vkb::PipelineLayoutCreateInfo2>(runtime.layout).setLayoutsDescriptions;
+        REQUIRE( sets.size() == 2 );
+        for(size_t i=0;i<sets.size();i++)
+        {
+            auto & S = vkb_pipelines::deferred::setLayouts[i];
+            REQUIRE( S.hash == sets[i].hash() );
+            REQUIRE( S.createInfo() == sets[i] );
+            REQUIRE( S.createInfo().hash() == S.hash );
+        }
+    }
+
+    THEN("The render passes are the same")
+    {
+        auto & R  = vkb_pipelines::deferred::renderPass;
+        auto & rp = std::get<vkb::RenderPassCreateInfo2>(runtime.renderPass);
+
+        REQUIRE( R.hash              == rp.hash() );
+        REQUIRE( R.compatibilityHash == rp.compatibilityHash() );
+        REQUIRE( R.createInfo().hash()              == R.hash );
+        REQUIRE( R.createInfo().compatibilityHash() == R.compatibilityHash );
+        REQUIRE( R.createInfo().subpasses[0].depthStencilAttachment.has_value() );
+    }
+
+    WHEN("The pipeline does not describe a render pass or layout")
+    {
+        auto & S = vkb_pipelines::shadow::pipeline;
+        auto shadow = vkb::PipelineJson::load(CMAKE_SOURCE_DIR "/test/pipelines/shadow.json");
+
+        REQUIRE( S.createInfo().hash() == shadow.hash() );
+        REQUIRE( S.setLayoutCount == 0 );
+        REQUIRE( S.blendAttachmentCount == 0 );
+        REQUIRE( S.rasterizationState.depthBiasClamp == 0.05f );
+    }
+}
+
+SCENARIO( "Generating pipeline headers" )
+{
+    auto info = vkb::PipelineJson::load(CMAKE_SOURCE_DIR "/test/pipelines/deferred.json");
+
+    auto header = vkb::PipelineCompiler::generate("deferred", info, "my_pipelines");
+    REQUIRE( header.find("namespace my_pipelines { namespace deferred {") != std::string::npos );
+    REQUIRE( header.find("inline constexpr vkb::StaticGraphicsPipeline pipeline") != std::string::npos );
+    REQUIRE( header.find("inline constexpr vkb::StaticRenderPass renderPass") != std::string::npos );
+
+    // the output only depends on the description
+    REQUIRE( vkb::PipelineCompiler::generate("deferred", vkb::PipelineJson::load(CMAKE_SOURCE_DIR "/test/pipelines/deferred.json"), "my_pipelines") == header );
+
+    REQUIRE( vkb::PipelineCompiler::identifier("pipelines/3d-shadow.json") == "_3d_shadow" );
+    REQUIRE( vkb::PipelineCompiler::identifier("C:\\pipelines\\gbuffer.json") == "gbuffer" );
+
+    WHEN("The description cannot be compiled")
+    {
+        REQUIRE_THROWS_AS( vkb::PipelineCompiler::generate("3d", info), std::runtime_error );
+
+        auto p = info;
+        p.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+        REQUIRE_THROWS_AS( vkb::PipelineCompiler::generate("p", p), std::runtime_error );
+
+        p = info;
+        p.layout = vk::PipelineLayout();
+        REQUIRE_THROWS_AS( vkb::PipelineCompiler::generate("p", p), std::runtime_error );
+
+        p = info;
+        std::get<vkb::PipelineLayoutCreateInfo2>(p.layout).setLayoutsDescriptions[0].addDescriptor(4, vk::DescriptorType::eSampler, vk::ShaderStageFlagBits::eFragment, {vkb::SamplerCreateInfo2()});
+        REQUIRE_THROWS_AS( vkb::PipelineCompiler::generate("p", p), std::runtime_error );
+    }
+}
+
+SCENARIO( " Scenario 1: Create a pipeline from a compiled description" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    vkb::Storage S;
+    {
+        auto & D = vkb_pipelines::deferred::pipeline;
+
+        auto PCI = D.createInfo(S, device);
+
+        // the layouts and render pass are stored under the precomputed hashes
+        REQUIRE( S.descriptorSetLayouts.count( vkb_pipelines::deferred::setLayouts[0].hash ) == 1 );
+        REQUIRE( S.descriptorSetLayouts.count( vkb_pipelines::deferred::setLayouts[1].hash ) == 1 );
+        REQUIRE( S.renderPasses.count( vkb_pipelines::deferred::renderPass.hash ) == 1 );
+        REQUIRE( std::get<vk::RenderPass>(PCI.renderPass) == S.renderPasses.at(vkb_pipelines::deferred::renderPass.hash) );
+
+        PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+        PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+        PCI.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+        PCI.addStage( vk::ShaderStageFlagBits::eFragment, "main", CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+
+        auto [pipeline, layout, renderPass] = PCI.create(S, device);
+        REQUIRE( pipeline != vk::Pipeline() );
+        REQUIRE( layout   == std::get<vk::PipelineLayout>(PCI.layout) );
+
+        // the same description is not recreated
+        auto again = D.createInfo(S, device);
+        REQUIRE( std::get<vk::PipelineLayout>(again.layout) == layout );
+        REQUIRE( S.descriptorSetLayouts.size() == 2 );
+        REQUIRE( S.renderPasses.size() == 1 );
+        (void)renderPass;
+    }
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
@@ -1,4 +1,5 @@
 #include "catch.hpp"
+#include <cstring>
 #include <fstream>
 
 #include <SDL2/SDL.h>
@@ -36,6 +37,209 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
 }
 
 
+SCENARIO( "Specialization constants" )
+{
+    vkb::PipelineShaderStageCreateInfo2 s;
+    s.name  = "main";
+    s.stage = vk::ShaderStageFlagBits::eFragment;
+    s.code  = {0x07230203u, 0x00010000u, 0x0008000au, 0x00000010u};
+
+    auto h  = s.hash();
+    auto sh = s.stableHash();
+
+    s.setSpecializationConstant(7, 2.0f)
+     .setSpecializationConstant(1, true)
+     .setSpecializationConstant(4, int32_t(-3));
+
+    THEN("The constants are owned by the stage, sorted by constantID")
+    {
+        REQUIRE( s.specializationEntries.size() == 3 );
+        REQUIRE( s.specializationData.size()    == 12 );
+
+        uint32_t offset = 0;
+        for(uint32_t i=0;i<3;i++)
+        {
+            REQUIRE( s.specializationEntries[i].offset == offset );
+            offset += static_cast<uint32_t>(s.specializationEntries[i].size);
+        }
+        REQUIRE( s.specializationEntries[0].constantID == 1 );
+        REQUIRE( s.specializationEntries[1].constantID == 4 );
+        REQUIRE( s.specializationEntries[2].constantID == 7 );
+
+        REQUIRE( s.getSpecializationConstant<bool>(1)    == true );
+        REQUIRE( s.getSpecializationConstant<int32_t>(4) == -3 );
+        REQUIRE( s.getSpecializationConstant<float>(7)   == 2.0f );
+
+        REQUIRE_THROWS_AS( s.getSpecializationConstant<float>(2),  std::runtime_error );
+        REQUIRE_THROWS_AS( s.getSpecializationConstant<double>(7), std::runtime_error );
+    }
+    THEN("The constants are part of the hashes")
+    {
+        REQUIRE( s.hash()       != h );
+        REQUIRE( s.stableHash() != sh );
+
+        auto t = s;
+        t.setSpecializationConstant(7, 3.0f);
+        REQUIRE( t.hash()       != s.hash() );
+        REQUIRE( t.stableHash() != s.stableHash() );
+
+        // the order the constants are set in does not matter
+        vkb::PipelineShaderStageCreateInfo2 u;
+        u.name  = s.name;
+        u.stage = s.stage;
+        u.code  = s.code;
+        u.setSpecializationConstant(4, int32_t(-3))
+         .setSpecializationConstant(7, 2.0f)
+         .setSpecializationConstant(1, true);
+        REQUIRE( u.hash()       == s.hash() );
+        REQUIRE( u.stableHash() == s.stableHash() );
+    }
+    THEN("A constant can change its type")
+    {
+        s.setSpecializationConstant(4, 1.5);
+        REQUIRE( s.getSpecializationConstant<double>(4) == 1.5 );
+        REQUIRE( s.specializationData.size() == 16 );
+        REQUIRE( s.getSpecializationConstant<float>(7) == 2.0f );
+    }
+    THEN("Removing every constant restores the original hashes")
+    {
+        REQUIRE( s.removeSpecializationConstant(4) );
+        REQUIRE( !s.removeSpecializationConstant(4) );
+        REQUIRE( s.getSpecializationConstant<float>(7) == 2.0f );
+        REQUIRE( s.removeSpecializationConstant(1) );
+        REQUIRE( s.removeSpecializationConstant(7) );
+        REQUIRE( s.specializationData.empty() );
+        REQUIRE( s.hash()       == h );
+        REQUIRE( s.stableHash() == sh );
+    }
+}
+
+SCENARIO( "Specialization constants are passed through create_t" )
+{
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+    PCI.layout     = vk::PipelineLayout( reinterpret_cast<VkPipelineLayout>(uintptr_t(1)) );
+    PCI.renderPass = vk::RenderPass( reinterpret_cast<VkRenderPass>(uintptr_t(2)) );
+
+    auto & vert  = PCI.stages.emplace_back();
+    vert.name    = "main";
+    vert.stage   = vk::ShaderStageFlagBits::eVertex;
+    vert.module  = vk::ShaderModule( reinterpret_cast<VkShaderModule>(uintptr_t(3)) );
+
+    auto & frag  = PCI.stages.emplace_back();
+    frag.name    = "main";
+    frag.stage   = vk::ShaderStageFlagBits::eFragment;
+    frag.module  = vk::ShaderModule( reinterpret_cast<VkShaderModule>(uintptr_t(4)) );
+    frag.setSpecializationConstant(0, 16u).setSpecializationConstant(2, 0.5f);
+
+    bool called = false;
+    PCI.create_t([&](vk::GraphicsPipelineCreateInfo & C)
+    {
+        called = true;
+        REQUIRE( C.stageCount == 2 );
+        REQUIRE( C.pStages[0].pSpecializationInfo == nullptr );
+
+        auto sp = C.pStages[1].pSpecializationInfo;
+        REQUIRE( sp != nullptr );
+        REQUIRE( sp->mapEntryCount == 2 );
+        REQUIRE( sp->dataSize == 8 );
+        REQUIRE( sp->pMapEntries[1].constantID == 2 );
+
+        float f;
+        std::memcpy(&f, static_cast<uint8_t const*>(sp->pData) + sp->pMapEntries[1].offset, sizeof(f));
+        REQUIRE( f == 0.5f );
+        return vk::Pipeline();
+    });
+    REQUIRE( called );
+}
+
+SCENARIO( "Derivative pipelines are passed through create_t" )
+{
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+    PCI.layout     = vk::PipelineLayout( reinterpret_cast<VkPipelineLayout>(uintptr_t(1)) );
+    PCI.renderPass = vk::RenderPass( reinterpret_cast<VkRenderPass>(uintptr_t(2)) );
+
+    auto h = PCI.hash();
+
+    auto base = vk::Pipeline( reinterpret_cast<VkPipeline>(uintptr_t(3)) );
+    PCI.flags = vk::PipelineCreateFlagBits::eAllowDerivatives | vk::PipelineCreateFlagBits::eDerivative;
+    PCI.basePipelineHandle = base;
+
+    PCI.create_t([&](vk::GraphicsPipelineCreateInfo & C)
+    {
+        REQUIRE( C.flags == PCI.flags );
+        REQUIRE( C.basePipelineHandle == base );
+        REQUIRE( C.basePipelineIndex  == -1 );
+        return vk::Pipeline();
+    });
+
+    // a derivative is the same pipeline, other flags are not
+    REQUIRE( PCI.hash() == h );
+    PCI.flags |= vk::PipelineCreateFlagBits::eDisableOptimization;
+    REQUIRE( PCI.hash() != h );
+}
+
+SCENARIO( "Dynamic rendering is passed through create_t" )
+{
+    vkb::PipelineRenderingCreateInfo2 R;
+    R.colorAttachmentFormats = {vk::Format::eB8G8R8A8Unorm, vk::Format::eR16G16B16A16Sfloat};
+    R.depthAttachmentFormat  = vk::Format::eD32Sfloat;
+
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+    PCI.layout     = vk::PipelineLayout( reinterpret_cast<VkPipelineLayout>(uintptr_t(1)) );
+    PCI.renderPass = R;
+
+    PCI.create_t([&](vk::GraphicsPipelineCreateInfo & C)
+    {
+        REQUIRE( C.renderPass == vk::RenderPass() );
+        REQUIRE( C.pNext != nullptr );
+
+        auto & r = *static_cast<vk::PipelineRenderingCreateInfoKHR const*>(C.pNext);
+        REQUIRE( r.sType == vk::StructureType::ePipelineRenderingCreateInfoKHR );
+        REQUIRE( r.colorAttachmentCount == 2 );
+        REQUIRE( r.pColorAttachmentFormats[0] == vk::Format::eB8G8R8A8Unorm );
+        REQUIRE( r.pColorAttachmentFormats[1] == vk::Format::eR16G16B16A16Sfloat );
+        REQUIRE( r.depthAttachmentFormat   == vk::Format::eD32Sfloat );
+        REQUIRE( r.stencilAttachmentFormat == vk::Format::eUndefined );
+        return vk::Pipeline();
+    });
+
+    WHEN("Only the formats are compared")
+    {
+        PCI.layout = vkb::PipelineLayoutCreateInfo2();
+
+        auto h = PCI.hash();
+        auto k = PCI.stableHash();
+
+        auto same = PCI;
+        same.renderPass = R;
+        REQUIRE( same.hash() == h );
+        REQUIRE( same.stableHash() == k );
+
+        auto other = R;
+        other.depthAttachmentFormat = vk::Format::eD24UnormS8Uint;
+        same.renderPass = other;
+        REQUIRE( same.hash() != h );
+        REQUIRE( same.stableHash() != k );
+
+        // a render pass with the same formats is a different pipeline
+        same.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{vk::Format::eB8G8R8A8Unorm, vk::ImageLayout::eColorAttachmentOptimal},
+                                                                             {vk::Format::eR16G16B16A16Sfloat, vk::ImageLayout::eColorAttachmentOptimal}},
+                                                                            {vk::Format::eD32Sfloat, vk::ImageLayout::eDepthStencilAttachmentOptimal});
+        REQUIRE( same.hash() != h );
+    }
+    WHEN("Creating a library part")
+    {
+        PCI.createLibrary_t(vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface, [&](vk::GraphicsPipelineCreateInfo & C)
+        {
+            auto & l = *static_cast<vk::GraphicsPipelineLibraryCreateInfoEXT const*>(C.pNext);
+            REQUIRE( l.pNext != nullptr );
+            auto & r = *static_cast<vk::PipelineRenderingCreateInfoKHR const*>(l.pNext);
+            REQUIRE( r.colorAttachmentCount == 2 );
+            return vk::Pipeline();
+        });
+    }
+}
+
 SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 {
     SDL_Init(SDL_INIT_EVERYTHING);
@@ -108,6 +312,49 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
     // and  the getCreateInfo< ... >().renderPass is a vk::RenderPass object
     //REQUIRE(S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(pipeline).hash() == PCI.hash());
 
+    {
+        // a compatible renderpass which transitions to a different layout
+        // will create a new renderpass, but reuse the same pipeline
+        auto PCI2 = PCI;
+        std::get<vkb::RenderPassCreateInfo2>(PCI2.renderPass).attachments[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+        auto [pipeline2, layout2, renderpass2] = PCI2.create( S, window->getDevice() );
+
+        REQUIRE( renderpass2 != renderpass);
+        REQUIRE( layout2     == layout);
+        REQUIRE( pipeline2   == pipeline);
+        REQUIRE( S.renderPasses.size() == 2);
+        REQUIRE( S.pipelines.size() == 1);
+
+        // the shared pipeline is reference counted, so destroying
+        // it once keeps it alive for the other user
+        REQUIRE( S.getReferenceCount(pipeline) == 2);
+        S.destroy(pipeline2, window->getDevice());
+        REQUIRE( S.getReferenceCount(pipeline) == 1);
+        REQUIRE( S.pipelines.size() == 1);
+    }
+
+    {
+        // with dynamic rendering no renderpass is created, and every
+        // pipeline with the same formats is the same pipeline
+        vkb::PipelineRenderingCreateInfo2 R;
+        R.colorAttachmentFormats = { vk::Format(window->getSwapchainFormat()) };
+
+        auto PCI3 = PCI;
+        PCI3.renderPass = R;
+
+        auto [pipeline3, layout3, renderpass3] = PCI3.create( S, window->getDevice() );
+        REQUIRE( pipeline3   != pipeline);
+        REQUIRE( renderpass3 == vk::RenderPass());
+        REQUIRE( S.renderPasses.size() == 2);
+        REQUIRE( S.pipelines.size() == 2);
+        REQUIRE( std::holds_alternative<vkb::PipelineRenderingCreateInfo2>( S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>(pipeline3).renderPass ) );
+
+        auto PCI4 = PCI3;
+        auto [pipeline4, layout4, renderpass4] = PCI4.create( S, window->getDevice() );
+        REQUIRE( pipeline4 == pipeline3);
+        REQUIRE( S.pipelines.size() == 2);
+    }
 
     S.destroy(pipeline, window->getDevice());
 
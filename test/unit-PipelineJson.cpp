@@ -0,0 +1,257 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/PipelineJson.h>
+
+static const char * g_pipeline = R"({
+    "layout" : {
+        "descriptorSets" : [
+            { "set" : 1, "bindings" : [ { "binding" : 0, "descriptorType" : "CombinedImageSampler", "descriptorCount" : 2, "stageFlags" : ["Fragment"] } ] },
+            { "set" : 0, "bindings" : [ { "binding" : 0, "descriptorType" : "UniformBuffer", "stageFlags" : ["Vertex", "Fragment"] },
+                                        { "binding" : 3, "descriptorType" : "StorageBuffer", "stageFlags" : ["Compute"] } ] }
+        ]
+    },
+    "dynamicStates" : { "dynamicStates" : ["Viewport", "Scissor", "LineStippleEXT"] },
+    "colorBlendState" : {
+        "ColorBlendAttachmentState" : [
+            { "blendEnable" : false, "srcColorBlendFactor" : "One", "colorBlendOp" : "MultiplyEXT", "ColorComponentFlagBits.A" : false },
+            { }
+        ],
+        "logicOpEnable" : true,
+        "logicOp" : "Xor",
+        "blendConstants" : [0.25, 0.5, 0.75, 1.0]
+    },
+    "inputAssemblyState" : { "topology" : "LineStrip" },
+    "vertexInputState" : {
+        "vertexAttributeDescriptions" : [ { "location" : 0, "binding" : 0, "format" : "R32G32Sfloat", "offset" : 0 },
+                                          { "location" : 1, "binding" : 1, "offset" : 8 } ],
+        "vertexBindingDescriptions"   : [ { "binding" : 0, "stride" : 8 },
+                                          { "binding" : 1, "stride" : 12, "inputRate" : "Instance" } ]
+    },
+    "rasterizationState" : { "PolygonMode" : "Line", "LineWidth" : 2.5, "CullMode" : "Back", "FrontFace" : "Clockwise", "DepthBiasEnable" : true },
+    "depthStencilState"  : { "DepthTestEnable" : true, "DepthWriteEnable" : true, "DepthCompareOp" : "GreaterOrEqual", "MaxDepthBounds" : 0.5 },
+    "multisampleState"   : { "SampleShadingEnable" : true, "RasterizationSamples" : "4" },
+    "ui:widget" : { "ignored" : [1, 2, {"a" : null}] }
+})";
+
+SCENARIO( "Perfect hash tables" )
+{
+    static constexpr auto T = vkb::makePerfectHashTable({ {"Vertex", 0}, {"Instance", 1}, {"Fragment", 16} });
+
+    // the table is built at compile time
+    static_assert( T.contains("Vertex"), "table was not built");
+    static_assert( !T.contains("Geometry"), "table was not built");
+
+    uint32_t v = 99;
+    REQUIRE( T.find("Instance", v) );
+    REQUIRE( v == 1 );
+    REQUIRE( T.find("Fragment", v) );
+    REQUIRE( v == 16 );
+    REQUIRE( !T.find("Geometry", v) );
+    REQUIRE( !T.find("", v) );
+}
+
+SCENARIO( "Loading a pipeline description" )
+{
+    auto info = vkb::PipelineJson::parse(g_pipeline);
+
+    THEN("The layout is read")
+    {
+        auto & L = std::get<vkb::PipelineLayoutCreateInfo2>(info.layout);
+        REQUIRE( L.setLayoutsDescriptions.size() == 2 );
+
+        auto & s0 = L.setLayoutsDescriptions[0].bindings;
+        REQUIRE( s0.size() == 2 );
+        REQUIRE( s0[0].descriptorType == vk::DescriptorType::eUniformBuffer );
+        REQUIRE( s0[0].descriptorCount == 1 );
+        REQUIRE( s0[0].stageFlags == (vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment) );
+        REQUIRE( s0[1].binding == 3 );
+        REQUIRE( s0[1].stageFlags == vk::ShaderStageFlags(vk::ShaderStageFlagBits::eCompute) );
+
+        auto & s1 = L.setLayoutsDescriptions[1].bindings;
+        REQUIRE( s1.size() == 1 );
+        REQUIRE( s1[0].descriptorType == vk::DescriptorType::eCombinedImageSampler );
+        REQUIRE( s1[0].descriptorCount == 2 );
+    }
+
+    THEN("The fixed function state is read")
+    {
+        REQUIRE( info.dynamicStates.size() == 3 );
+        REQUIRE( info.dynamicStates[1] == vk::DynamicState::eScissor );
+        REQUIRE( static_cast<uint32_t>(info.dynamicStates[2]) == 1000259000u );
+
+        auto & B = info.blendState;
+        REQUIRE( B.attachments.size() == 2 );
+        REQUIRE( B.attachments[0].blendEnable == VK_FALSE );
+        REQUIRE( B.attachments[0].srcColorBlendFactor == vk::BlendFactor::eOne );
+        REQUIRE( static_cast<uint32_t>(B.attachments[0].colorBlendOp) == 1000148012u );
+        REQUIRE( B.attachments[0].colorWriteMask == (vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB) );
+
+        // missing values use the schema's defaults
+        REQUIRE( B.attachments[1].blendEnable == VK_TRUE );
+        REQUIRE( B.attachments[1].dstColorBlendFactor == vk::BlendFactor::eOneMinusDstAlpha );
+
+        REQUIRE( B.logicOpEnable == VK_TRUE );
+        REQUIRE( B.logicOp == vk::LogicOp::eXor );
+        REQUIRE( B.blendConstants[2] == 0.75f );
+
+        REQUIRE( info.inputAssemblyState.topology == vk::PrimitiveTopology::eLineStrip );
+
+        auto & V = info.vertexInputState;
+        REQUIRE( V.vertexAttributeDescriptions.size() == 2 );
+        REQUIRE( V.vertexAttributeDescriptions[0].format == vk::Format::eR32G32Sfloat );
+        REQUIRE( V.vertexAttributeDescriptions[1].format == vk::Format::eR32G32B32Sfloat );
+        REQUIRE( V.vertexAttributeDescriptions[1].offset == 8 );
+        REQUIRE( V.vertexBindingDescriptions[1].stride == 12 );
+        REQUIRE( V.vertexBindingDescriptions[1].inputRate == vk::VertexInputRate::eInstance );
+
+        REQUIRE( info.rasterizationState.polygonMode == vk::PolygonMode::eLine );
+        REQUIRE( info.rasterizationState.lineWidth == 2.5f );
+        REQUIRE( info.rasterizationState.cullMode == vk::CullModeFlags(vk::CullModeFlagBits::eBack) );
+        REQUIRE( info.rasterizationState.frontFace == vk::FrontFace::eClockwise );
+        REQUIRE( info.rasterizationState.depthBiasEnable == VK_TRUE );
+
+        REQUIRE( info.depthStencilState.depthTestEnable == VK_TRUE );
+        REQUIRE( info.depthStencilState.depthCompareOp == vk::CompareOp::eGreaterOrEqual );
+        REQUIRE( info.depthStencilState.minDepthBounds == 0.0f );
+        REQUIRE( info.depthStencilState.maxDepthBounds == 0.5f );
+
+        REQUIRE( info.multisampleState.sampleShadingEnable == VK_TRUE );
+        REQUIRE( info.multisampleState.rasterizationSamples == vk::SampleCountFlagBits::e4 );
+    }
+
+    THEN("Invalid documents are rejected")
+    {
+        REQUIRE_THROWS_AS( vkb::PipelineJson::parse(R"({ "inputAssemblyState" : { "topology" : "Quads" } })"), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineJson::parse(R"({ "inputAssemblyState" : { "topology" : "PointList" )"), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineJson::parse(R"({ "multisampleState" : { "SampleShadingEnable" : 1 } })"), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineJson::parse(R"({ } { })"), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::PipelineJson::load("does-not-exist.json"), std::runtime_error );
+    }
+}
+
+// Generates a random document which follows samples/pipeline.json
+static std::string generatePipeline(std::mt19937 & rng)
+{
+    static const char * factors[]  = {"Zero", "One", "SrcAlpha", "OneMinusSrcAlpha", "DstColor", "ConstantColor"};
+    static const char * ops[]      = {"Add", "Subtract", "Min", "Max", "ScreenEXT", "OverlayEXT"};
+    static const char * types[]    = {"UniformBuffer", "StorageBuffer", "CombinedImageSampler", "SampledImage"};
+    static const char * stages[]   = {"Vertex", "Fragment", "Geometry", "Compute"};
+    static const char * topology[] = {"TriangleList", "TriangleStrip", "LineList", "PointList"};
+    static const char * compare[]  = {"Less", "LessOrEqual", "Greater", "Always"};
+
+    auto pick = [&](auto & a) { return a[ rng() % (sizeof(a)/sizeof(a[0])) ]; };
+
+    std::ostringstream o;
+    o << "{\n  \"layout\" : { \"descriptorSets\" : [";
+    auto sets = 1 + rng() % 3;
+    for(uint32_t s=0;s<sets;s++)
+    {
+        o << (s ? "," : "") << "\n    { \"set\" : " << s << ", \"bindings\" : [";
+        auto bindings = 1 + rng() % 6;
+        for(uint32_t b=0;b<bindings;b++)
+            o << (b ? "," : "") << "\n      { \"binding\" : " << b << ", \"descriptorType\" : \"" << pick(types)
+              << "\", \"descriptorCount\" : " << 1 + rng() % 4 << ", \"stageFlags\" : [\"" << pick(stages) << "\", \"" << pick(stages) << "\"] }";
+        o << " ] }";
+    }
+    o << " ] },\n";
+    o << "  \"dynamicStates\" : { \"dynamicStates\" : [\"Viewport\", \"Scissor\"] },\n";
+    o << "  \"colorBlendState\" : { \"ColorBlendAttachmentState\" : [";
+    auto attachments = 1 + rng() % 4;
+    for(uint32_t a=0;a<attachments;a++)
+        o << (a ? "," : "") << "\n    { \"blendEnable\" : " << (rng()%2 ? "true" : "false")
+          << ", \"srcColorBlendFactor\" : \"" << pick(factors) << "\", \"dstColorBlendFactor\" : \"" << pick(factors)
+          << "\", \"colorBlendOp\" : \"" << pick(ops) << "\", \"srcAlphaBlendFactor\" : \"" << pick(factors)
+          << "\", \"dstAlphaBlendFactor\" : \"" << pick(factors) << "\", \"alphaBlendOp\" : \"" << pick(ops)
+          << "\", \"ColorComponentFlagBits.A\" : " << (rng()%2 ? "true" : "false") << " }";
+    o << " ], \"logicOpEnable\" : false, \"blendConstants\" : [0.0, 0.5, 1.0, " << (rng()%100)/100.0 << "] },\n";
+    o << "  \"inputAssemblyState\" : { \"topology\" : \"" << pick(topology) << "\" },\n";
+    o << "  \"vertexInputState\" : { \"vertexAttributeDescriptions\" : [";
+    auto attributes = 1 + rng() % 6;
+    for(uint32_t a=0;a<attributes;a++)
+        o << (a ? ", " : "") << "{ \"location\" : " << a << ", \"binding\" : 0, \"format\" : \"R32G32B32Sfloat\", \"offset\" : " << a*12 << " }";
+    o << "], \"vertexBindingDescriptions\" : [ { \"binding\" : 0, \"stride\" : " << attributes*12 << ", \"inputRate\" : \"Vertex\" } ] },\n";
+    o << "  \"rasterizationState\" : { \"PolygonMode\" : \"Fill\", \"LineWidth\" : 1.0, \"CullMode\" : \"" << (rng()%2 ? "Back" : "None")
+      << "\", \"FrontFace\" : \"CounterClockwise\", \"DepthBiasEnable\" : false },\n";
+    o << "  \"depthStencilState\" : { \"DepthTestEnable\" : true, \"DepthWriteEnable\" : true, \"DepthCompareOp\" : \"" << pick(compare) << "\" },\n";
+    o << "  \"multisampleState\" : { \"SampleShadingEnable\" : false, \"RasterizationSamples\" : \"1\" }\n}\n";
+    return o.str();
+}
+
+// A directory in the system's temp folder which is removed, with
+// everything in it, when it goes out of scope or a REQUIRE fails
+struct TempDirectory
+{
+    std::filesystem::path path;
+
+    explicit TempDirectory(std::string const & prefix)
+    {
+        path = std::filesystem::temp_directory_path() / (prefix + "-" + std::to_string( std::random_device()() ));
+        std::filesystem::create_directories(path);
+    }
+    ~TempDirectory()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+    TempDirectory(TempDirectory const &) = delete;
+    TempDirectory & operator=(TempDirectory const &) = delete;
+};
+
+SCENARIO( "Loading a corpus of pipeline descriptions" )
+{
+    const size_t N = 2000;
+
+    TempDirectory dir("unit-PipelineJson");
+
+    std::mt19937 rng(1234);
+    std::vector<std::string> paths;
+    size_t bytes = 0;
+    for(size_t i=0;i<N;i++)
+    {
+        auto text = generatePipeline(rng);
+        bytes += text.size();
+
+        paths.push_back( ( dir.path / ("pipeline-" + std::to_string(i) + ".json") ).string() );
+        std::ofstream f(paths.back());
+        f << text;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    auto t0 = clock::now();
+    std::vector<vkb::GraphicsPipelineCreateInfo2> serial;
+    for(auto & p : paths)
+        serial.push_back( vkb::PipelineJson::load(p) );
+    auto t1 = clock::now();
+    auto parallel = vkb::PipelineJson::loadAll(paths);
+    auto t2 = clock::now();
+
+    auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    WARN( "Loaded " << N << " pipeline files (" << bytes / 1024 << " KiB)\n"
+          "  1 thread:   " << ms(t1-t0) << " ms\n"
+          "  loadAll:    " << ms(t2-t1) << " ms" );
+
+    REQUIRE( parallel.size() == N );
+    for(size_t i=0;i<N;i++)
+    {
+        REQUIRE( parallel[i].blendState.hash()       == serial[i].blendState.hash() );
+        REQUIRE( parallel[i].vertexInputState.hash() == serial[i].vertexInputState.hash() );
+        REQUIRE( std::get<vkb::PipelineLayoutCreateInfo2>(parallel[i].layout).setLayoutsDescriptions.size() ==
+                 std::get<vkb::PipelineLayoutCreateInfo2>(serial[i].layout).setLayoutsDescriptions.size() );
+    }
+
+    WHEN("One of the files is invalid")
+    {
+        std::ofstream(paths[N/2]) << "{ \"inputAssemblyState\" : { \"topology\" : \"Quads\" } }";
+        REQUIRE_THROWS_AS( vkb::PipelineJson::loadAll(paths), std::runtime_error );
+    }
+}
@@ -0,0 +1,315 @@
+#include "catch.hpp"
+#include "FakeHandle.h"
+#include <array>
+#include <cstdio>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+using Part = vk::GraphicsPipelineLibraryFlagBitsEXT;
+
+static vkb::GraphicsPipelineCreateInfo2 makePipeline()
+{
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+
+    PCI.setVertexInputAttribute(0, 0, vk::Format::eR32G32B32Sfloat, 0);
+    PCI.setVertexInputBinding(0, 12, vk::VertexInputRate::eVertex);
+
+    auto & vert  = PCI.stages.emplace_back();
+    vert.name    = "main";
+    vert.stage   = vk::ShaderStageFlagBits::eVertex;
+    vert.module  = fakeHandle<vk::ShaderModule>(1);
+
+    auto & frag  = PCI.stages.emplace_back();
+    frag.name    = "main";
+    frag.stage   = vk::ShaderStageFlagBits::eFragment;
+    frag.module  = fakeHandle<vk::ShaderModule>(2);
+
+    PCI.viewportState.viewports.emplace_back( vk::Viewport(0, 0, 1024, 768, 0, 1.0f) );
+    PCI.viewportState.scissors.emplace_back( vk::Rect2D({0,0}, {1024,768}) );
+
+    PCI.layout     = fakeHandle<vk::PipelineLayout>(3);
+    PCI.renderPass = fakeHandle<vk::RenderPass>(4);
+    PCI.addBlendStateAttachment();
+    return PCI;
+}
+
+static std::vector<size_t> libraryHashes(vkb::GraphicsPipelineCreateInfo2 const & P)
+{
+    std::vector<size_t> h;
+    for(auto p : vkb::GraphicsPipelineCreateInfo2::libraryParts)
+        h.push_back( P.libraryHash(p) );
+    return h;
+}
+
+// returns which of the four library hashes differ between a and b
+static std::vector<bool> changedParts(vkb::GraphicsPipelineCreateInfo2 const & a, vkb::GraphicsPipelineCreateInfo2 const & b)
+{
+    auto x = libraryHashes(a);
+    auto y = libraryHashes(b);
+    std::vector<bool> c;
+    for(size_t i=0;i<x.size();i++)
+        c.push_back( x[i] != y[i] );
+    return c;
+}
+
+SCENARIO( "Library hashes only depend on the state of their part" )
+{
+    auto P = makePipeline();
+
+    auto h = libraryHashes(P);
+    REQUIRE( h[0] != h[1] );
+    REQUIRE( h[1] != h[2] );
+    REQUIRE( h[2] != h[3] );
+
+    WHEN("The vertex input changes")
+    {
+        auto Q = P;
+        Q.setVertexInputAttribute(1, 0, vk::Format::eR32G32Sfloat, 12);
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{true, false, false, false} );
+
+        Q = P;
+        Q.inputAssemblyState.topology = vk::PrimitiveTopology::eLineList;
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{true, false, false, false} );
+    }
+    WHEN("The pre-rasterization state changes")
+    {
+        auto Q = P;
+        Q.rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, true, false, false} );
+
+        Q = P;
+        Q.stages[0].name = "vs_main";
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, true, false, false} );
+    }
+    WHEN("The fragment shader state changes")
+    {
+        auto Q = P;
+        Q.depthStencilState.depthTestEnable = VK_TRUE;
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, false, true, false} );
+
+        Q = P;
+        Q.stages[1].module = fakeHandle<vk::ShaderModule>(5);
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, false, true, false} );
+    }
+    WHEN("The fragment output state changes")
+    {
+        auto Q = P;
+        Q.blendState.attachments[0].blendEnable = VK_FALSE;
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, false, false, true} );
+    }
+    WHEN("State shared by several parts changes")
+    {
+        auto Q = P;
+        Q.multisampleState.rasterizationSamples = vk::SampleCountFlagBits::e4;
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, false, true, true} );
+
+        Q = P;
+        Q.layout = fakeHandle<vk::PipelineLayout>(6);
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, true, true, false} );
+
+        Q = P;
+        Q.renderPass = fakeHandle<vk::RenderPass>(7);
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{false, true, true, true} );
+
+        Q = P;
+        Q.dynamicStates.push_back(vk::DynamicState::eLineWidth);
+        REQUIRE( changedParts(P, Q) == std::vector<bool>{true, true, true, true} );
+    }
+}
+
+SCENARIO( "createLibrary_t only passes the state of one part" )
+{
+    auto P = makePipeline();
+
+    for(auto part : vkb::GraphicsPipelineCreateInfo2::libraryParts)
+    {
+        vk::GraphicsPipelineCreateInfo C;
+        vk::GraphicsPipelineLibraryFlagsEXT partFlags;
+        std::vector<vk::ShaderStageFlagBits> stages;
+
+        auto p = P.createLibrary_t(part, [&](vk::GraphicsPipelineCreateInfo & c)
+        {
+            C = c;
+            auto L = static_cast<vk::GraphicsPipelineLibraryCreateInfoEXT const*>(c.pNext);
+            REQUIRE( L != nullptr );
+            REQUIRE( L->sType == vk::StructureType::eGraphicsPipelineLibraryCreateInfoEXT );
+            partFlags = L->flags;
+            for(uint32_t i=0;i<c.stageCount;i++)
+                stages.push_back( c.pStages[i].stage );
+            return fakeHandle<vk::Pipeline>(10);
+        });
+
+        REQUIRE( p == fakeHandle<vk::Pipeline>(10) );
+        REQUIRE( partFlags == vk::GraphicsPipelineLibraryFlagsEXT(part) );
+        REQUIRE( (C.flags & vk::PipelineCreateFlagBits::eLibraryKHR) );
+        REQUIRE( C.pDynamicState != nullptr );
+
+        bool vertexInput = part == Part::eVertexInputInterface;
+        bool preRaster   = part == Part::ePreRasterizationShaders;
+        bool fragment    = part == Part::eFragmentShader;
+        bool output      = part == Part::eFragmentOutputInterface;
+
+        REQUIRE( (C.pVertexInputState   != nullptr) == vertexInput );
+        REQUIRE( (C.pInputAssemblyState != nullptr) == vertexInput );
+        REQUIRE( (C.pViewportState      != nullptr) == preRaster );
+        REQUIRE( (C.pRasterizationState != nullptr) == preRaster );
+        REQUIRE( (C.pTessellationState  != nullptr) == preRaster );
+        REQUIRE( (C.pDepthStencilState  != nullptr) == fragment );
+        REQUIRE( (C.pMultisampleState   != nullptr) == (fragment || output) );
+        REQUIRE( (C.pColorBlendState    != nullptr) == output );
+        REQUIRE( (C.layout     == std::get<vk::PipelineLayout>(P.layout))  == (preRaster || fragment) );
+        REQUIRE( (C.renderPass == std::get<vk::RenderPass>(P.renderPass))  == !vertexInput );
+
+        if( preRaster )
+            REQUIRE( stages == std::vector<vk::ShaderStageFlagBits>{vk::ShaderStageFlagBits::eVertex} );
+        else if( fragment )
+            REQUIRE( stages == std::vector<vk::ShaderStageFlagBits>{vk::ShaderStageFlagBits::eFragment} );
+        else
+            REQUIRE( stages.empty() );
+    }
+}
+
+SCENARIO( "link_t chains the libraries" )
+{
+    auto P = makePipeline();
+
+    std::array<vk::Pipeline, 4> libraries;
+    for(uintptr_t i=0;i<libraries.size();i++)
+        libraries[i] = fakeHandle<vk::Pipeline>(20+i);
+
+    WHEN("Linking")
+    {
+        bool called = false;
+        P.link_t(libraries, [&](vk::GraphicsPipelineCreateInfo & C)
+        {
+            called = true;
+            auto L = static_cast<vk::PipelineLibraryCreateInfoKHR const*>(C.pNext);
+            REQUIRE( L != nullptr );
+            REQUIRE( L->sType == vk::StructureType::ePipelineLibraryCreateInfoKHR );
+            REQUIRE( L->libraryCount == 4 );
+            for(uint32_t i=0;i<4;i++)
+                REQUIRE( L->pLibraries[i] == libraries[i] );
+
+            REQUIRE( C.layout == std::get<vk::PipelineLayout>(P.layout) );
+            REQUIRE( C.stageCount == 0 );
+            REQUIRE( !(C.flags & vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT) );
+            return vk::Pipeline();
+        });
+        REQUIRE( called );
+    }
+    WHEN("Linking with link time optimization")
+    {
+        P.link_t(libraries, [&](vk::GraphicsPipelineCreateInfo & C)
+        {
+            REQUIRE( (C.flags & vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT) );
+            return vk::Pipeline();
+        }, true);
+    }
+    WHEN("A library is missing")
+    {
+        libraries[2] = vk::Pipeline();
+        REQUIRE_THROWS_AS( P.link_t(libraries, [](vk::GraphicsPipelineCreateInfo &){ return vk::Pipeline(); }), std::runtime_error );
+    }
+}
+
+SCENARIO( " Scenario 1: Linked pipelines share their library parts" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    vkb::Storage S;
+    {
+        vkb::GraphicsPipelineCreateInfo2 PCI;
+
+        PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+        PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+
+        PCI.setVertexInputAttribute(0,0,vk::Format::eR32G32B32Sfloat,0 );
+        PCI.setVertexInputBinding(0,12, vk::VertexInputRate::eVertex);
+
+        PCI.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+        PCI.addStage( vk::ShaderStageFlagBits::eFragment, "main", CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+
+        PCI.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{ vk::Format(window->getSwapchainFormat()), vk::ImageLayout::ePresentSrcKHR}});
+        PCI.addPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 128);
+        PCI.addBlendStateAttachment();
+
+        auto opaque = PCI;
+        opaque.blendState.attachments[0].blendEnable = VK_FALSE;
+
+        auto x = PCI.createLinked(S, device);
+        REQUIRE( std::get<0>(x) );
+        REQUIRE( S.pipelineLibraries.size() == 4 );
+
+        // only the fragment output part is new
+        auto y = opaque.createLinked(S, device);
+        REQUIRE( std::get<0>(y) != std::get<0>(x) );
+        REQUIRE( S.pipelineLibraries.size() == 5 );
+        REQUIRE( S.pipelines.size() == 2 );
+
+        // linked pipelines are stored like compiled ones
+        auto z = PCI.createLinked(S, device);
+        REQUIRE( std::get<0>(z) == std::get<0>(x) );
+        REQUIRE( std::get<0>(PCI.create(S, device)) == std::get<0>(x) );
+        REQUIRE( S.getReferenceCount( std::get<0>(x) ) == 3 );
+        REQUIRE( S.tryGetCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(x) ) != nullptr );
+
+        // the libraries are keyed by the handles created with the storage
+        auto & stored = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( std::get<0>(x) );
+        for(auto part : vkb::GraphicsPipelineCreateInfo2::libraryParts)
+            REQUIRE( S.pipelineLibraries.count( stored.libraryKey(S, part) ) == 1 );
+    }
+
+    S.destroyAll(device);
+    REQUIRE( S.pipelineLibraries.empty() );
+
+    delete window;
+    SDL_Quit();
+}
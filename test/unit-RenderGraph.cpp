@@ -0,0 +1,247 @@
+#include "catch.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/RenderGraph.h>
+
+SCENARIO( "Compiling a deferred renderer" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("albedo",    vk::Format::eR8G8B8A8Unorm);
+    G.addResource("normal",    vk::Format::eR16G16B16A16Sfloat);
+    G.addResource("depth",     vk::Format::eD32Sfloat);
+    G.addResource("hdr",       vk::Format::eR16G16B16A16Sfloat);
+    G.addResource("debug",     vk::Format::eR8G8B8A8Unorm);
+    G.addResource("swapchain", vk::Format::eB8G8R8A8Unorm);
+
+    G.addPass("gbuffer") .addColorOutput("albedo")
+                         .addColorOutput("normal")
+                         .setDepthOutput("depth");
+
+    G.addPass("debug")   .addSampledInput("normal")
+                         .addColorOutput("debug");
+
+    G.addPass("lighting").addInputAttachment("albedo")
+                         .addInputAttachment("normal")
+                         .addInputAttachment("depth")
+                         .addColorOutput("hdr");
+
+    G.addPass("tonemap") .addSampledInput("hdr")
+                         .addColorOutput("swapchain");
+
+    G.setOutput("swapchain", vk::ImageLayout::ePresentSrcKHR);
+
+    auto C = G.compile();
+
+    THEN("Passes which do not contribute to the output are culled")
+    {
+        REQUIRE( C.culledPasses.size() == 1);
+        REQUIRE( C.culledPasses[0] == "debug");
+    }
+
+    THEN("The gbuffer and lighting passes are merged into a single renderpass")
+    {
+        REQUIRE( C.renderPasses.size() == 2);
+
+        auto & R = C.renderPasses[0];
+        REQUIRE( R.subpasses   == std::vector<std::string>({"gbuffer", "lighting"}) );
+        REQUIRE( R.attachments == std::vector<std::string>({"albedo", "normal", "depth", "hdr"}) );
+        REQUIRE( R.renderPass.subpasses.size() == 2);
+        REQUIRE( R.renderPass.subpasses[1].inputAttachments.size() == 3);
+        REQUIRE( R.renderPass.subpasses[1].inputAttachments[2].layout == vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+
+        REQUIRE( C.renderPasses[1].subpasses == std::vector<std::string>({"tonemap"}) );
+    }
+
+    THEN("Attachments which are only used within the renderpass are not stored")
+    {
+        auto & A = C.renderPasses[0].renderPass.attachments;
+        for(uint32_t i=0;i<3;i++)
+        {
+            REQUIRE( A[i].loadOp        == vk::AttachmentLoadOp::eClear);
+            REQUIRE( A[i].storeOp       == vk::AttachmentStoreOp::eDontCare);
+            REQUIRE( A[i].initialLayout == vk::ImageLayout::eUndefined);
+        }
+    }
+
+    THEN("Attachments which are sampled later are stored and transitioned")
+    {
+        auto & hdr = C.renderPasses[0].renderPass.attachments[3];
+        REQUIRE( hdr.storeOp     == vk::AttachmentStoreOp::eStore);
+        REQUIRE( hdr.finalLayout == vk::ImageLayout::eShaderReadOnlyOptimal);
+
+        auto & swapchain = C.renderPasses[1].renderPass.attachments[0];
+        REQUIRE( swapchain.storeOp     == vk::AttachmentStoreOp::eStore);
+        REQUIRE( swapchain.finalLayout == vk::ImageLayout::ePresentSrcKHR);
+    }
+
+    THEN("The lighting subpass depends on the gbuffer subpass")
+    {
+        auto & D = C.renderPasses[0].renderPass.dependencies;
+
+        auto f = std::find_if(D.begin(), D.end(), [](auto & d){ return d.srcSubpass == 0 && d.dstSubpass == 1;});
+        REQUIRE( f != D.end() );
+        REQUIRE( (f->dstAccessMask & vk::AccessFlagBits::eInputAttachmentRead) );
+        REQUIRE( (f->srcAccessMask & vk::AccessFlagBits::eColorAttachmentWrite) );
+        REQUIRE( (f->srcAccessMask & vk::AccessFlagBits::eDepthStencilAttachmentWrite) );
+        REQUIRE( f->dependencyFlags == vk::DependencyFlagBits::eByRegion);
+
+        // only one dependency between the two subpasses, and one to
+        // the external tonemap pass
+        REQUIRE( D.size() == 2);
+
+        auto e = std::find_if(D.begin(), D.end(), [](auto & d){ return d.srcSubpass == 1 && d.dstSubpass == VK_SUBPASS_EXTERNAL;});
+        REQUIRE( e != D.end() );
+        REQUIRE( e->dstStageMask  == vk::PipelineStageFlagBits::eFragmentShader);
+        REQUIRE( e->dstAccessMask == vk::AccessFlagBits::eShaderRead);
+    }
+}
+
+SCENARIO( "Preserving attachments between subpasses" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("a",     vk::Format::eR8G8B8A8Unorm);
+    G.addResource("b",     vk::Format::eR8G8B8A8Unorm);
+    G.addResource("c",     vk::Format::eR8G8B8A8Unorm);
+
+    G.addPass("p0").addColorOutput("a");
+    G.addPass("p1").addColorOutput("b");
+    G.addPass("p2").addInputAttachment("a").addInputAttachment("b").addColorOutput("c");
+
+    G.setOutput("c", vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    auto C = G.compile();
+
+    REQUIRE( C.renderPasses.size() == 1);
+
+    auto & R = C.renderPasses[0].renderPass;
+    REQUIRE( R.subpasses.size() == 3);
+
+    // attachment a must be preserved through p1
+    REQUIRE( R.subpasses[1].preserveAttachments == std::vector<uint32_t>({0}) );
+
+    // the compiled renderpass is a regular RenderPassCreateInfo2
+    REQUIRE( R.hash() != 0 );
+}
+
+SCENARIO( "Preserving stored attachments until the end of the renderpass" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("a",   vk::Format::eR8G8B8A8Unorm);
+    G.addResource("b",   vk::Format::eR8G8B8A8Unorm);
+    G.addResource("c",   vk::Format::eR8G8B8A8Unorm);
+    G.addResource("out", vk::Format::eR8G8B8A8Unorm);
+
+    G.addPass("p0").addColorOutput("a").addColorOutput("b");
+    G.addPass("p1").addInputAttachment("b").addColorOutput("c");
+    G.addPass("p2").addSampledInput("a").addSampledInput("c").addColorOutput("out");
+
+    G.setOutput("out", vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    auto C = G.compile();
+
+    REQUIRE( C.renderPasses.size() == 2);
+    REQUIRE( C.renderPasses[0].subpasses == std::vector<std::string>({"p0", "p1"}) );
+
+    auto & R = C.renderPasses[0].renderPass;
+    REQUIRE( R.attachments[0].storeOp == vk::AttachmentStoreOp::eStore );
+
+    // a is stored for p2, so it must be preserved through the last subpass
+    REQUIRE( R.subpasses[1].preserveAttachments == std::vector<uint32_t>({0}) );
+}
+
+SCENARIO( "Multiple passes writing to the same attachment" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("swapchain", vk::Format::eB8G8R8A8Unorm);
+    G.addResource("depth",     vk::Format::eD24UnormS8Uint);
+
+    G.addPass("opaque").addColorOutput("swapchain").setDepthOutput("depth");
+    G.addPass("ui")    .addColorOutput("swapchain").setDepthInput("depth");
+
+    G.setOutput("swapchain", vk::ImageLayout::ePresentSrcKHR);
+
+    auto C = G.compile();
+
+    REQUIRE( C.culledPasses.empty() );
+    REQUIRE( C.renderPasses.size() == 1);
+
+    auto & R = C.renderPasses[0].renderPass;
+
+    REQUIRE( R.attachments[1].stencilLoadOp == vk::AttachmentLoadOp::eClear);
+    REQUIRE( R.subpasses[1].depthStencilAttachment->layout == vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+
+    auto & D = R.dependencies;
+    auto f = std::find_if(D.begin(), D.end(), [](auto & d){ return d.srcSubpass == 0 && d.dstSubpass == 1;});
+    REQUIRE( f != D.end() );
+    REQUIRE( (f->dstAccessMask & vk::AccessFlagBits::eColorAttachmentWrite) );
+    REQUIRE( (f->dstAccessMask & vk::AccessFlagBits::eDepthStencilAttachmentRead) );
+}
+
+SCENARIO( "Passes with different extents" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("shadow0",   vk::Format::eD32Sfloat, {2048, 2048});
+    G.addResource("shadow1",   vk::Format::eD32Sfloat, {1024, 1024});
+    G.addResource("shadow2",   vk::Format::eD32Sfloat, {1024, 1024});
+    G.addResource("swapchain", vk::Format::eB8G8R8A8Unorm);
+
+    G.addPass("cascade0").setDepthOutput("shadow0");
+    G.addPass("cascade1").setDepthOutput("shadow1");
+    G.addPass("cascade2").setDepthOutput("shadow2");
+    G.addPass("forward") .addSampledInput("shadow0")
+                         .addSampledInput("shadow1")
+                         .addSampledInput("shadow2")
+                         .addColorOutput("swapchain");
+
+    G.setOutput("swapchain", vk::ImageLayout::ePresentSrcKHR);
+
+    auto C = G.compile();
+
+    THEN("Passes are only merged when their attachments have the same extent")
+    {
+        REQUIRE( C.renderPasses.size() == 3);
+
+        REQUIRE( C.renderPasses[0].subpasses == std::vector<std::string>({"cascade0"}) );
+        REQUIRE( C.renderPasses[0].extent.width  == 2048 );
+        REQUIRE( C.renderPasses[0].extent.height == 2048 );
+
+        REQUIRE( C.renderPasses[1].subpasses == std::vector<std::string>({"cascade1", "cascade2"}) );
+        REQUIRE( C.renderPasses[1].extent.width  == 1024 );
+        REQUIRE( C.renderPasses[1].extent.height == 1024 );
+
+        // sampled inputs do not need to match the framebuffer
+        REQUIRE( C.renderPasses[2].subpasses == std::vector<std::string>({"forward"}) );
+        REQUIRE( C.renderPasses[2].extent.width  == 0 );
+        REQUIRE( C.renderPasses[2].extent.height == 0 );
+    }
+    WHEN("The attachments of a pass have different extents")
+    {
+        G.addPass("mixed").addColorOutput("swapchain").setDepthInput("shadow0");
+        REQUIRE_THROWS_AS( G.compile(), std::runtime_error );
+    }
+}
+
+SCENARIO( "Invalid graphs throw exceptions" )
+{
+    vkb::RenderGraph G;
+
+    G.addResource("a", vk::Format::eR8G8B8A8Unorm);
+
+    WHEN("A pass uses a resource which does not exist")
+    {
+        G.addPass("p0").addColorOutput("b");
+        REQUIRE_THROWS( G.compile() );
+    }
+    WHEN("A pass does not write to any attachment")
+    {
+        G.addPass("p0").addSampledInput("a");
+        REQUIRE_THROWS( G.compile() );
+    }
+}
@@ -149,3 +149,146 @@ SCENARIO( " Scenario 1: Create a DescriptorSetLayout" )
 
 }
 
+
+SCENARIO( "Render pass compatibility" )
+{
+    auto base = vkb::RenderPassCreateInfo2::createSimpleRenderPass( { {vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::ePresentSrcKHR} },
+                                                                      {vk::Format::eD32Sfloat, vk::ImageLayout::eDepthStencilAttachmentOptimal});
+
+    WHEN("The final layout is different")
+    {
+        auto R = base;
+        R.attachments[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+        THEN("The render passes are compatible")
+        {
+            REQUIRE( R.hash() != base.hash() );
+            REQUIRE( R.isCompatible(base) );
+        }
+    }
+    WHEN("The initial layout is different")
+    {
+        auto R = base;
+        R.attachments[0].initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        THEN("The render passes are compatible")
+        {
+            REQUIRE( R.isCompatible(base) );
+        }
+    }
+    WHEN("The load/store ops are different")
+    {
+        auto R = base;
+        R.attachments[0].loadOp         = vk::AttachmentLoadOp::eLoad;
+        R.attachments[1].storeOp        = vk::AttachmentStoreOp::eDontCare;
+        R.attachments[1].stencilLoadOp  = vk::AttachmentLoadOp::eClear;
+
+        THEN("The render passes are compatible")
+        {
+            REQUIRE( R.hash() != base.hash() );
+            REQUIRE( R.isCompatible(base) );
+        }
+    }
+    WHEN("The layout of an attachment reference is different")
+    {
+        auto R = base;
+        R.subpasses[0].colorAttachments[0].layout = vk::ImageLayout::eGeneral;
+
+        THEN("The render passes are compatible")
+        {
+            REQUIRE( R.isCompatible(base) );
+        }
+    }
+    WHEN("An unused color attachment is added to the end of the subpass")
+    {
+        auto R = base;
+        R.subpasses[0].colorAttachments.emplace_back( VK_ATTACHMENT_UNUSED, vk::ImageLayout::eUndefined);
+
+        THEN("The render passes are compatible")
+        {
+            REQUIRE( R.isCompatible(base) );
+        }
+    }
+    WHEN("The format of an attachment is different")
+    {
+        auto R = base;
+        R.attachments[0].format = vk::Format::eB8G8R8A8Unorm;
+
+        THEN("The render passes are not compatible")
+        {
+            REQUIRE( !R.isCompatible(base) );
+        }
+    }
+    WHEN("The sample count of an attachment is different")
+    {
+        auto R = base;
+        R.attachments[1].samples = vk::SampleCountFlagBits::e4;
+
+        THEN("The render passes are not compatible")
+        {
+            REQUIRE( !R.isCompatible(base) );
+        }
+    }
+    WHEN("The number of color attachments is different")
+    {
+        auto R = vkb::RenderPassCreateInfo2::createSimpleRenderPass( { {vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::ePresentSrcKHR},
+                                                                       {vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::ePresentSrcKHR} },
+                                                                       {vk::Format::eD32Sfloat, vk::ImageLayout::eDepthStencilAttachmentOptimal});
+
+        THEN("The render passes are not compatible")
+        {
+            REQUIRE( !R.isCompatible(base) );
+        }
+    }
+    WHEN("The depth attachment is removed from the subpass")
+    {
+        auto R = base;
+        R.subpasses[0].depthStencilAttachment.reset();
+
+        THEN("The render passes are not compatible")
+        {
+            REQUIRE( !R.isCompatible(base) );
+        }
+    }
+    WHEN("A dependency is different")
+    {
+        auto R = base;
+        R.dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+
+        THEN("The render passes are not compatible")
+        {
+            REQUIRE( !R.isCompatible(base) );
+        }
+    }
+    WHEN("Two pipelines are given compatible render passes")
+    {
+        auto R = base;
+        R.attachments[0].finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        R.attachments[0].loadOp      = vk::AttachmentLoadOp::eLoad;
+
+        vkb::GraphicsPipelineCreateInfo2 P1;
+        P1.renderPass = base;
+        auto P2 = P1;
+        P2.renderPass = R;
+
+        THEN("The pipelines have the same hash")
+        {
+            REQUIRE( P1.hash() == P2.hash() );
+        }
+    }
+    WHEN("Two pipelines are given incompatible render passes")
+    {
+        auto R = base;
+        R.attachments[0].format = vk::Format::eB8G8R8A8Unorm;
+
+        vkb::GraphicsPipelineCreateInfo2 P1;
+        P1.renderPass = base;
+        auto P2 = P1;
+        P2.renderPass = R;
+
+        THEN("The pipelines have different hashes")
+        {
+            REQUIRE( P1.hash() != P2.hash() );
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include "catch.hpp"
+#include <fstream>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+SCENARIO( "Sampler hashes only depend on the fields which are used" )
+{
+    vkb::SamplerCreateInfo2 a;
+    a.magFilter        = vk::Filter::eLinear;
+    a.minFilter        = vk::Filter::eLinear;
+    a.anisotropyEnable = VK_FALSE;
+    a.maxAnisotropy    = 1.0f;
+    a.compareOp        = vk::CompareOp::eLess;
+    a.borderColor      = vk::BorderColor::eIntOpaqueWhite;
+
+    vkb::SamplerCreateInfo2 b;
+    b.magFilter        = vk::Filter::eLinear;
+    b.minFilter        = vk::Filter::eLinear;
+    b.anisotropyEnable = VK_FALSE;
+    b.maxAnisotropy    = 16.0f;
+
+    // maxAnisotropy, compareOp and borderColor are not used
+    REQUIRE( a == b );
+    REQUIRE( a.hash() == b.hash() );
+
+    WHEN("Anisotropy is enabled")
+    {
+        a.anisotropyEnable = VK_TRUE;
+        b.anisotropyEnable = VK_TRUE;
+
+        REQUIRE( a != b );
+        REQUIRE( a.hash() != b.hash() );
+    }
+    WHEN("The border color is used")
+    {
+        a.addressModeU = vk::SamplerAddressMode::eClampToBorder;
+        b.addressModeU = vk::SamplerAddressMode::eClampToBorder;
+
+        REQUIRE( a != b );
+        REQUIRE( a.hash() != b.hash() );
+    }
+    WHEN("The sampler has a pNext chain")
+    {
+        vk::SamplerReductionModeCreateInfo R;
+        R.reductionMode = vk::SamplerReductionMode::eMin;
+        a.pNext = &R;
+
+        THEN("It cannot be shared through the storage")
+        {
+            vkb::Storage S;
+            REQUIRE_THROWS_AS( a.create(S, vk::Device()), std::runtime_error );
+            REQUIRE( S.samplers.empty() );
+        }
+    }
+}
+
+SCENARIO( " Scenario 1: Create shared samplers" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    vkb::Storage S;
+
+    vkb::SamplerCreateInfo2 a;
+    a.magFilter     = vk::Filter::eLinear;
+    a.maxAnisotropy = 1.0f;
+
+    vkb::SamplerCreateInfo2 b;
+    b.magFilter     = vk::Filter::eLinear;
+    b.maxAnisotropy = 8.0f;
+
+    auto s1 = a.create(S, device);
+    auto s2 = b.create(S, device);
+
+    REQUIRE( s1 != vk::Sampler() );
+    REQUIRE( s1 == s2 );
+    REQUIRE( S.samplers.size() == 1 );
+    REQUIRE( S.getReferenceCount(s1) == 2 );
+
+    // the first user is done with it, but the sampler is still alive
+    S.destroy(s1, device);
+    REQUIRE( S.getReferenceCount(s1) == 1 );
+    REQUIRE( S.samplers.size() == 1 );
+
+    S.destroy(s2, device);
+    REQUIRE( S.getReferenceCount(s1) == 0 );
+    REQUIRE( S.samplers.size() == 0 );
+
+    {
+        S.maxSamplerAllocationCount = 2;
+
+        vkb::SamplerCreateInfo2 c;
+        c.magFilter = vk::Filter::eLinear;
+        vkb::SamplerCreateInfo2 d;
+        d.magFilter = vk::Filter::eNearest;
+        vkb::SamplerCreateInfo2 e;
+        e.maxLod    = 4.0f;
+
+        c.create(S, device);
+        d.create(S, device);
+
+        // existing samplers can still be shared
+        REQUIRE_NOTHROW( c.create(S, device) );
+        REQUIRE_THROWS_AS( e.create(S, device), std::runtime_error );
+    }
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
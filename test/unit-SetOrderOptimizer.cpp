@@ -0,0 +1,161 @@
+#include "catch.hpp"
+#include <cstdio>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/SetOrderOptimizer.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+// descriptor sets are only compared, they are never used
+static vk::DescriptorSet fakeSet(uintptr_t i)
+{
+    return vk::DescriptorSet( reinterpret_cast<VkDescriptorSet>(i) );
+}
+
+SCENARIO( "Remapping descriptor sets in SPIR-V" )
+{
+    std::vector<uint32_t> code = {0x07230203u, 0x00010000u, 0u, 10u, 0u,
+                                  4u << 16 | 71u, 5, 34, 2,   // OpDecorate %5 DescriptorSet 2
+                                  4u << 16 | 71u, 5, 33, 2,   // OpDecorate %5 Binding 2
+                                  4u << 16 | 71u, 6, 34, 0};  // OpDecorate %6 DescriptorSet 0
+
+    // new set 0 is the old set 2
+    vkb::SetOrderOptimizer::remapSets(code, {2, 0, 1});
+
+    REQUIRE( code[8]  == 0 );
+    REQUIRE( code[12] == 2 ); // bindings are not changed
+    REQUIRE( code[16] == 1 );
+
+    code.pop_back();
+    REQUIRE_THROWS_AS( vkb::SetOrderOptimizer::remapSets(code, {2, 0, 1}), std::runtime_error );
+}
+
+SCENARIO( " Scenario 1: Reordering sets so bound sets survive pipeline switches" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    vkb::Storage S;
+    {
+        vkb::DescriptorSetLayoutCreateInfo2 frame, material, object;
+        frame.addDescriptor(   0, vk::DescriptorType::eUniformBuffer,        1, vk::ShaderStageFlagBits::eVertex);
+        material.addDescriptor(0, vk::DescriptorType::eCombinedImageSampler, 2, vk::ShaderStageFlagBits::eFragment);
+        object.addDescriptor(  0, vk::DescriptorType::eStorageBuffer,        1, vk::ShaderStageFlagBits::eVertex);
+
+        // two layouts written in different orders
+        vkb::PipelineLayoutCreateInfo2 A, B;
+        A.setLayoutsDescriptions = {object, frame, material};
+        B.setLayoutsDescriptions = {material, object, frame};
+
+        auto a = A.create(S, device);
+        auto b = B.create(S, device);
+        REQUIRE( a != b );
+
+        auto F  = fakeSet(1);
+        auto M  = fakeSet(2);
+
+        vkb::DrawStream D;
+        D.draw(a, {fakeSet(10), F, M});
+        D.draw(b, {M, fakeSet(11), F});
+        D.draw(a, {fakeSet(12), F, M});
+        D.draw(b, {M, fakeSet(13), F});
+
+        auto R = vkb::SetOrderOptimizer::optimize(S, D);
+
+        // every switch rebinds everything
+        REQUIRE( R.bindsBefore == 12 );
+
+        // afterwards only the object set is rebound
+        REQUIRE( R.bindsAfter  == 6 );
+        REQUIRE( R.saved()     == 6 );
+
+        REQUIRE( R.layouts.size() == 2 );
+        auto La = R.find(a);
+        auto Lb = R.find(b);
+        REQUIRE( La != nullptr );
+        REQUIRE( Lb != nullptr );
+
+        // frame, material, object
+        REQUIRE( La->order == std::vector<uint32_t>({1, 2, 0}) );
+        REQUIRE( Lb->order == std::vector<uint32_t>({2, 0, 1}) );
+
+        // both layouts are canonicalized to the same set layouts
+        REQUIRE( La->createInfo.hash() == Lb->createInfo.hash() );
+        REQUIRE( La->createInfo.setLayouts[0] == S.descriptorSetLayouts.at(frame.hash()) );
+
+        // the reordered layout can be created
+        auto c = La->createInfo.create(S, device);
+        REQUIRE( c != a );
+
+        WHEN("Push constant ranges differ")
+        {
+            vkb::PipelineLayoutCreateInfo2 C;
+            C.setLayoutsDescriptions = {frame, material, object};
+            C.addPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 64);
+            auto pc = C.create(S, device);
+
+            vkb::DrawStream E;
+            E.draw(c,  {F, M, fakeSet(10)});
+            E.draw(pc, {F, M, fakeSet(10)});
+
+            // the layouts are not compatible at all
+            REQUIRE( vkb::SetOrderOptimizer::countBinds(S, E) == 6 );
+        }
+        WHEN("The stream uses a layout which is not in the storage")
+        {
+            vkb::DrawStream E;
+            E.draw(vk::PipelineLayout(), {F});
+            REQUIRE_THROWS_AS( vkb::SetOrderOptimizer::optimize(S, E), std::runtime_error );
+        }
+    }
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
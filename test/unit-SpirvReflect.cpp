@@ -0,0 +1,289 @@
+#include "catch.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/SpirvReflect.h>
+
+// A minimal SPIR-V assembler, only what is needed to describe an interface
+struct SpirvAssembler
+{
+    std::vector<uint32_t> words = {0x07230203u, 0x00010000u, 0u, 100u, 0u};
+
+    SpirvAssembler& op(uint32_t opcode, std::vector<uint32_t> operands)
+    {
+        words.push_back( static_cast<uint32_t>(operands.size()+1) << 16 | opcode );
+        words.insert(words.end(), operands.begin(), operands.end());
+        return *this;
+    }
+
+    // OpEntryPoint executionModel %id "name" interface...
+    SpirvAssembler& entryPoint(uint32_t executionModel, uint32_t id, std::string const & name, std::vector<uint32_t> interface = {})
+    {
+        std::vector<uint32_t> o = {executionModel, id};
+        std::vector<uint32_t> s( name.size() / 4 + 1, 0u);
+        std::memcpy(s.data(), name.data(), name.size());
+        o.insert(o.end(), s.begin(), s.end());
+        o.insert(o.end(), interface.begin(), interface.end());
+        return op(15, o);
+    }
+
+    SpirvAssembler& decorate(uint32_t id, uint32_t decoration, std::vector<uint32_t> v = {})
+    {
+        std::vector<uint32_t> o = {id, decoration};
+        o.insert(o.end(), v.begin(), v.end());
+        return op(71, o);
+    }
+};
+
+static std::vector<uint32_t> readSpirv(std::string const & path)
+{
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    std::vector<uint32_t> code(contents.size() / sizeof(uint32_t));
+    std::memcpy(code.data(), contents.data(), code.size() * sizeof(uint32_t));
+    return code;
+}
+
+// a fragment shader using
+//   set 0 binding 0: uniform block
+//   set 0 binding 1: sampler2D[4]
+//   set 1 binding 0: buffer block
+//   push constants: vec4 at offset 16, float at offset 32
+static std::vector<uint32_t> fragmentShader(bool reversed)
+{
+    SpirvAssembler A;
+    A.entryPoint(4, 1, "main");
+
+    std::vector< std::pair<uint32_t, std::vector<uint32_t>> > decorations = {
+        {20, {34, 0}}, {20, {33, 0}},   // ubo
+        {21, {34, 0}}, {21, {33, 1}},   // sampler array
+        {22, {34, 1}}, {22, {33, 0}},   // ssbo
+        {10, {2}}, {11, {3}}            // Block, BufferBlock
+    };
+    if( reversed )
+        std::reverse(decorations.begin(), decorations.end());
+    for(auto & d : decorations)
+        A.decorate(d.first, d.second[0], std::vector<uint32_t>(d.second.begin()+1, d.second.end()));
+
+    A.op(72, {12, 0, 35, 16})                // member offsets of the push constants
+     .op(72, {12, 1, 35, 32});
+
+    A.op(22, {2, 32})                        // %2  = float
+     .op(23, {3, 2, 4})                      // %3  = vec4
+     .op(21, {4, 32, 0})                     // %4  = uint
+     .op(43, {4, 5, 4})                      // %5  = 4u
+     .op(25, {6, 2, 1, 0, 0, 0, 1, 0})       // %6  = image2D
+     .op(27, {7, 6})                         // %7  = sampler2D
+     .op(28, {8, 7, 5})                      // %8  = sampler2D[4]
+     .op(30, {10, 3})                        // %10 = ubo struct
+     .op(30, {11, 3})                        // %11 = ssbo struct
+     .op(30, {12, 3, 2})                     // %12 = push constant struct
+     .op(32, {13, 2, 10})                    // uniform pointers
+     .op(32, {14, 0, 8})
+     .op(32, {15, 2, 11})
+     .op(32, {16, 9, 12});
+
+    std::vector< std::vector<uint32_t> > variables = {
+        {13, 20, 2}, {14, 21, 0}, {15, 22, 2}, {16, 23, 9}
+    };
+    if( reversed )
+        std::reverse(variables.begin(), variables.end());
+    for(auto & v : variables)
+        A.op(59, v);
+
+    return A.words;
+}
+
+// a vertex shader using set 0 binding 0 and two inputs
+static std::vector<uint32_t> vertexShader()
+{
+    SpirvAssembler A;
+    A.entryPoint(0, 1, "main", {30, 31, 32})
+     .decorate(20, 34, {0}).decorate(20, 33, {0}).decorate(10, 2)
+     .decorate(30, 30, {1})   // vec2 at location 1
+     .decorate(31, 30, {0})   // vec3 at location 0
+     .decorate(32, 11, {0});  // gl_VertexIndex
+
+    A.op(22, {2, 32})
+     .op(23, {3, 2, 4})
+     .op(23, {4, 2, 3})
+     .op(23, {5, 2, 2})
+     .op(21, {6, 32, 1})
+     .op(30, {10, 3})
+     .op(32, {13, 2, 10})
+     .op(32, {14, 1, 5})
+     .op(32, {15, 1, 4})
+     .op(32, {16, 1, 6})
+     .op(59, {13, 20, 2})
+     .op(59, {14, 30, 1})
+     .op(59, {15, 31, 1})
+     .op(59, {16, 32, 1});
+    return A.words;
+}
+
+SCENARIO( "Reflecting SPIR-V modules" )
+{
+    WHEN("Reflecting a shader compiled by glslang")
+    {
+        // share/shaders/model_attributes_MVP.vert
+        auto code = readSpirv(CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+        auto R    = vkb::ShaderReflection::parse(code.data(), code.size());
+
+        REQUIRE( R.stage == vk::ShaderStageFlagBits::eVertex );
+        REQUIRE( R.descriptors.empty() );
+
+        // two mat4s
+        REQUIRE( R.pushConstantOffset == 0 );
+        REQUIRE( R.pushConstantSize   == 128 );
+
+        REQUIRE( R.inputs.size() == 3 );
+        REQUIRE( R.inputs[0].format == vk::Format::eR32G32B32Sfloat );
+        REQUIRE( R.inputs[1].format == vk::Format::eR32G32B32Sfloat );
+        REQUIRE( R.inputs[2].format == vk::Format::eR32G32B32A32Sfloat );
+        REQUIRE( R.inputs[2].location == 2 );
+        REQUIRE( R.inputs[2].size     == 16 );
+
+        auto F = readSpirv(CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+        auto RF = vkb::ShaderReflection::parse(F.data(), F.size());
+        REQUIRE( RF.stage == vk::ShaderStageFlagBits::eFragment );
+        REQUIRE( RF.inputs.empty() );
+        REQUIRE( RF.pushConstantSize == 0 );
+    }
+
+    WHEN("Reflecting descriptors")
+    {
+        auto code = fragmentShader(false);
+        auto R    = vkb::ShaderReflection::parse(code.data(), code.size());
+
+        REQUIRE( R.stage == vk::ShaderStageFlagBits::eFragment );
+        REQUIRE( R.descriptors.size() == 3 );
+
+        REQUIRE( R.descriptors[0].set     == 0 );
+        REQUIRE( R.descriptors[0].binding == 0 );
+        REQUIRE( R.descriptors[0].type    == vk::DescriptorType::eUniformBuffer );
+
+        REQUIRE( R.descriptors[1].binding == 1 );
+        REQUIRE( R.descriptors[1].type    == vk::DescriptorType::eCombinedImageSampler );
+        REQUIRE( R.descriptors[1].count   == 4 );
+
+        REQUIRE( R.descriptors[2].set     == 1 );
+        REQUIRE( R.descriptors[2].type    == vk::DescriptorType::eStorageBuffer );
+
+        REQUIRE( R.pushConstantOffset == 16 );
+        REQUIRE( R.pushConstantSize   == 20 );
+
+        // only the vertex stage has vertex inputs
+        REQUIRE( R.inputs.empty() );
+    }
+
+    WHEN("The module is invalid")
+    {
+        auto code = fragmentShader(false);
+        REQUIRE_THROWS_AS( vkb::ShaderReflection::parse(code.data(), code.size(), "other"), std::runtime_error );
+        REQUIRE_THROWS_AS( vkb::ShaderReflection::parse(code.data(), code.size()-1), std::runtime_error );
+
+        code[0] = 0;
+        REQUIRE_THROWS_AS( vkb::ShaderReflection::parse(code.data(), code.size()), std::runtime_error );
+    }
+}
+
+SCENARIO( "Building pipeline layouts from SPIR-V" )
+{
+    vkb::SpirvReflector R;
+
+    vkb::GraphicsPipelineCreateInfo2 P;
+    P.stages.push_back( {"main", vk::ShaderStageFlagBits::eVertex,   {}, vertexShader()} );
+    P.stages.push_back( {"main", vk::ShaderStageFlagBits::eFragment, {}, fragmentShader(false)} );
+
+    R.apply(P);
+
+    auto & L = std::get<vkb::PipelineLayoutCreateInfo2>(P.layout);
+
+    THEN("Bindings are merged across stages")
+    {
+        REQUIRE( L.setLayoutsDescriptions.size() == 2 );
+
+        auto & s0 = L.setLayoutsDescriptions[0].bindings;
+        REQUIRE( s0.size() == 2 );
+        REQUIRE( s0[0].binding    == 0 );
+        REQUIRE( s0[0].stageFlags == (vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment) );
+        REQUIRE( s0[1].binding    == 1 );
+        REQUIRE( s0[1].stageFlags == vk::ShaderStageFlags(vk::ShaderStageFlagBits::eFragment) );
+
+        REQUIRE( L.pushConstantRanges.size() == 1 );
+        REQUIRE( L.pushConstantRanges[0].offset == 16 );
+        REQUIRE( L.pushConstantRanges[0].size   == 20 );
+    }
+
+    THEN("The vertex input is interleaved in location order")
+    {
+        auto & V = P.vertexInputState;
+        REQUIRE( V.vertexBindingDescriptions.size() == 1 );
+        REQUIRE( V.vertexBindingDescriptions[0].stride == 20 );
+
+        REQUIRE( V.vertexAttributeDescriptions.size() == 2 );
+        REQUIRE( V.vertexAttributeDescriptions[0].location == 0 );
+        REQUIRE( V.vertexAttributeDescriptions[0].format   == vk::Format::eR32G32B32Sfloat );
+        REQUIRE( V.vertexAttributeDescriptions[1].location == 1 );
+        REQUIRE( V.vertexAttributeDescriptions[1].offset   == 12 );
+        REQUIRE( V.vertexAttributeDescriptions[1].format   == vk::Format::eR32G32Sfloat );
+
+        R.apply(P, vkb::SpirvReflector::VertexLayout::eSeparate);
+        REQUIRE( V.vertexBindingDescriptions.size() == 2 );
+        REQUIRE( V.vertexBindingDescriptions[1].stride == 8 );
+        REQUIRE( V.vertexAttributeDescriptions[1].binding == 1 );
+    }
+
+    THEN("Identical interfaces produce identical layouts")
+    {
+        auto Q = P;
+        Q.stages[1].code = fragmentShader(true);
+        R.apply(Q);
+
+        auto & LQ = std::get<vkb::PipelineLayoutCreateInfo2>(Q.layout);
+        REQUIRE( LQ.stableHash() == L.stableHash() );
+        for(size_t i=0;i<L.setLayoutsDescriptions.size();i++)
+            REQUIRE( LQ.setLayoutsDescriptions[i].hash() == L.setLayoutsDescriptions[i].hash() );
+    }
+
+    THEN("Each module is only parsed once")
+    {
+        REQUIRE( R.size() == 2 );
+        auto & a = R.reflect(P.stages[1]);
+        R.apply(P);
+        REQUIRE( R.size() == 2 );
+        REQUIRE( &R.reflect(P.stages[1]) == &a );
+    }
+
+    WHEN("The stages do not agree")
+    {
+        auto Q = P;
+
+        // the fragment shader declares binding 0 as a buffer block
+        auto F = fragmentShader(false);
+        for(size_t i=5;i<F.size();)
+        {
+            auto n = F[i] >> 16;
+            if( (F[i] & 0xFFFF) == 71 && F[i+1] == 10 && F[i+2] == 2 )
+                F[i+2] = 3;
+            i += n;
+        }
+        Q.stages[1].code = F;
+        REQUIRE_THROWS_AS( R.apply(Q), std::runtime_error );
+
+        // stages need their code
+        Q = P;
+        Q.stages[0].code.clear();
+        REQUIRE_THROWS_AS( R.apply(Q), std::runtime_error );
+
+        // the entry point must be for the stage it is used in
+        Q = P;
+        Q.stages[0].stage = vk::ShaderStageFlagBits::eGeometry;
+        REQUIRE_THROWS_AS( R.apply(Q), std::runtime_error );
+    }
+}
@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "FakeHandle.h"
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+
+SCENARIO( "Retiring objects and collecting them when the frame completes" )
+{
+    vkb::Storage S;
+
+    auto p1 = fakeHandle<vk::Pipeline>(0x10);
+    auto p2 = fakeHandle<vk::Pipeline>(0x20);
+    auto b1 = fakeHandle<vk::Buffer>(0x30);
+    auto m1 = fakeHandle<vk::DeviceMemory>(0x40);
+
+    S.retire(p1, 1);
+    S.retire(b1, 1);
+    S.retire(m1, 1);
+    S.retire(p2, 2);
+
+    REQUIRE( S.retiredCount() == 4 );
+
+    std::vector<void*> destroyed;
+    auto destroyer = [&](auto h)
+    {
+        destroyed.push_back( static_cast<void*>(h) );
+    };
+
+    WHEN("No frame has completed")
+    {
+        REQUIRE( S.collect(0, destroyer) == 0 );
+        REQUIRE( destroyed.empty() );
+    }
+    WHEN("Frame 1 has completed")
+    {
+        REQUIRE( S.collect(1, destroyer) == 3 );
+
+        THEN("Objects are destroyed before the memory they are bound to")
+        {
+            REQUIRE( destroyed.size() == 3 );
+            REQUIRE( destroyed[0] == static_cast<void*>(p1) );
+            REQUIRE( destroyed[1] == static_cast<void*>(b1) );
+            REQUIRE( destroyed[2] == static_cast<void*>(m1) );
+        }
+        THEN("Objects retired in later frames are kept")
+        {
+            REQUIRE( S.retiredCount() == 1 );
+            REQUIRE( S.collect(2, destroyer) == 1 );
+            REQUIRE( destroyed.back() == static_cast<void*>(p2) );
+            REQUIRE( S.retiredCount() == 0 );
+        }
+    }
+}
+
+SCENARIO( "The destruction queue is bounded" )
+{
+    vkb::DestructionQueue<vk::Pipeline> Q(4);
+
+    for(uintptr_t i=1;i<=4;i++)
+        Q.push( fakeHandle<vk::Pipeline>(i * 0x10), i);
+
+    REQUIRE( Q.size() == 4 );
+    REQUIRE_THROWS_AS( Q.push( fakeHandle<vk::Pipeline>(0x50), 5), std::runtime_error );
+
+    std::vector<vk::Pipeline> destroyed;
+    auto destroyer = [&](vk::Pipeline p) { destroyed.push_back(p); };
+
+    REQUIRE( Q.collect(2, destroyer) == 2 );
+
+    THEN("The freed space can be reused")
+    {
+        Q.push( fakeHandle<vk::Pipeline>(0x50), 5);
+        Q.push( fakeHandle<vk::Pipeline>(0x60), 6);
+        REQUIRE( Q.size() == 4 );
+
+        // the queue wraps around and keeps the order
+        Q.setCapacity(8);
+        REQUIRE( Q.collect(100, destroyer) == 4 );
+        REQUIRE( destroyed.size() == 6 );
+        for(size_t i=0;i<destroyed.size();i++)
+            REQUIRE( destroyed[i] == fakeHandle<vk::Pipeline>( (i+1) * 0x10) );
+    }
+    THEN("Objects retired out of order are not destroyed early")
+    {
+        Q.push( fakeHandle<vk::Pipeline>(0x50), 1);
+        REQUIRE( Q.collect(3, destroyer) == 1 );
+        REQUIRE( Q.collect(4, destroyer) == 2 );
+    }
+    THEN("Removed objects are not destroyed when collected")
+    {
+        Q.remove( fakeHandle<vk::Pipeline>(0x30) );
+        REQUIRE( Q.size() == 2 );
+        REQUIRE( Q.collect(4, destroyer) == 1 );
+        REQUIRE( destroyed.back() == fakeHandle<vk::Pipeline>(0x40) );
+        REQUIRE( Q.size() == 0 );
+    }
+}
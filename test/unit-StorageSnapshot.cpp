@@ -0,0 +1,353 @@
+#include "catch.hpp"
+#include "FakeHandle.h"
+#include <fstream>
+#include <set>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+
+#include <vkw/SDLVulkanWindow.h>
+#include <vkw/SDLVulkanWindow_INIT.inl>
+#include <vkw/SDLVulkanWindow_USAGE.inl>
+using namespace vkw;
+
+#include <vulkan/vulkan.hpp>
+
+#include <vkb/vkb.h>
+#include <vkb/utils/StorageSnapshot.h>
+
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
+    VkDebugReportFlagsEXT flags,
+    VkDebugReportObjectTypeEXT objType,
+    uint64_t obj,
+    size_t location,
+    int32_t code,
+    const char* layerPrefix,
+    const char* msg,
+    void* userData)
+{
+    (void)obj;
+    (void)flags;
+    (void)objType;
+    (void)location;
+    (void)code;
+    (void)userData;
+    printf("VULKAN VALIDATION: [%s] %s\n", layerPrefix, msg);
+    //throw std::runtime_error( msg );
+    return VK_FALSE;
+}
+
+// Fill a storage with create infos for fake handles. Nothing
+// is created on the GPU.
+static void fillStorage(vkb::Storage & S)
+{
+    vkb::SamplerCreateInfo2 sampler;
+    sampler.magFilter    = vk::Filter::eLinear;
+    sampler.addressModeU = vk::SamplerAddressMode::eClampToBorder;
+    sampler.borderColor  = vk::BorderColor::eFloatOpaqueWhite;
+    sampler.maxLod       = 8.0f;
+
+    auto samplerHandle = fakeHandle<vk::Sampler>(0x100);
+    S.samplers[sampler.hash()] = samplerHandle;
+    S.storeCreateInfo(samplerHandle, sampler);
+
+    vkb::ShaderModuleCreateInfo2 vert;
+    vert.code = {0x07230203, 1, 2, 3};
+    vkb::ShaderModuleCreateInfo2 frag;
+    frag.code = {0x07230203, 4, 5, 6, 7};
+
+    auto vertHandle = fakeHandle<vk::ShaderModule>(0x200);
+    auto fragHandle = fakeHandle<vk::ShaderModule>(0x210);
+    S.shaderModules[vert.hash()] = vertHandle;
+    S.shaderModules[frag.hash()] = fragHandle;
+    S.storeCreateInfo(vertHandle, vert);
+    S.storeCreateInfo(fragHandle, frag);
+
+    auto rp = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{vk::Format::eB8G8R8A8Unorm, vk::ImageLayout::ePresentSrcKHR}});
+    auto rpHandle = fakeHandle<vk::RenderPass>(0x300);
+    S.renderPasses[rp.hash()] = rpHandle;
+    S.storeCreateInfo(rpHandle, rp);
+
+    vkb::DescriptorSetLayoutCreateInfo2 dsl;
+    dsl.addDescriptor(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
+    dsl.addDescriptor(1, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment, {samplerHandle, sampler});
+    auto dslHandle = fakeHandle<vk::DescriptorSetLayout>(0x400);
+    S.descriptorSetLayouts[dsl.hash()] = dslHandle;
+    S.storeCreateInfo(dslHandle, dsl);
+
+    vkb::PipelineLayoutCreateInfo2 pl;
+    pl.setLayouts.push_back(dslHandle);
+    pl.pushConstantRanges.push_back( vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 64) );
+    auto plHandle = fakeHandle<vk::PipelineLayout>(0x500);
+    S.pipelineLayouts[pl.hash()] = plHandle;
+    S.storeCreateInfo(plHandle, pl);
+
+    vkb::GraphicsPipelineCreateInfo2 PCI;
+    PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+    PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+    PCI.setVertexInputAttribute(0,0,vk::Format::eR32G32B32Sfloat,0 );
+    PCI.setVertexInputBinding(0,12, vk::VertexInputRate::eVertex);
+    PCI.addBlendStateAttachment().setBlendEnable(true);
+    PCI.blendState.blendConstants[2] = 0.5f;
+    PCI.rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+    PCI.depthStencilState.depthTestEnable = VK_TRUE;
+    PCI.depthStencilState.front.compareMask = 0xF0;
+    PCI.dynamicStates.push_back(vk::DynamicState::eViewport);
+
+    auto & s0  = PCI.stages.emplace_back();
+    s0.stage   = vk::ShaderStageFlagBits::eVertex;
+    s0.name    = "main";
+    s0.module  = vertHandle;
+    auto & s1  = PCI.stages.emplace_back();
+    s1.stage   = vk::ShaderStageFlagBits::eFragment;
+    s1.name    = "fragMain";
+    s1.module  = fragHandle;
+    s1.setSpecializationConstant(0, true).setSpecializationConstant(3, 0.25f);
+
+    PCI.layout     = plHandle;
+    PCI.renderPass = rpHandle;
+
+    auto pHandle = fakeHandle<vk::Pipeline>(0x600);
+    S.pipelines[PCI.storageKey(S)] = pHandle;
+    S.storeCreateInfo(pHandle, PCI);
+}
+
+SCENARIO( "Serializing a storage snapshot" )
+{
+    vkb::Storage S;
+    fillStorage(S);
+
+    auto snapshot = vkb::StorageSnapshot::capture(S);
+
+    REQUIRE( snapshot.samplers.size()             == 1 );
+    REQUIRE( snapshot.shaderModules.size()        == 2 );
+    REQUIRE( snapshot.renderPasses.size()         == 1 );
+    REQUIRE( snapshot.descriptorSetLayouts.size() == 1 );
+    REQUIRE( snapshot.pipelineLayouts.size()      == 1 );
+    REQUIRE( snapshot.pipelines.size()            == 1 );
+
+    // handles are replaced by indices
+    REQUIRE( snapshot.pipelines[0].info.stages[0].module == vk::ShaderModule() );
+    REQUIRE( std::holds_alternative<vkb::SamplerCreateInfo2>(snapshot.descriptorSetLayouts[0].immutableSamplers.at(1)[0]) );
+
+    auto blob = snapshot.serialize();
+
+    THEN("Deserializing gives the same snapshot")
+    {
+        auto copy = vkb::StorageSnapshot::deserialize(blob);
+
+        REQUIRE( copy.serialize() == blob );
+
+        REQUIRE( copy.samplers[0] == snapshot.samplers[0] );
+        REQUIRE( copy.renderPasses[0].hash() == snapshot.renderPasses[0].hash() );
+        REQUIRE( copy.descriptorSetLayouts[0] == snapshot.descriptorSetLayouts[0] );
+        REQUIRE( copy.pipelineLayouts[0].pushConstantRanges == snapshot.pipelineLayouts[0].pushConstantRanges );
+        REQUIRE( copy.pipelines[0].info.blendState.hash()       == snapshot.pipelines[0].info.blendState.hash() );
+        REQUIRE( copy.pipelines[0].info.vertexInputState.hash() == snapshot.pipelines[0].info.vertexInputState.hash() );
+        REQUIRE( copy.pipelines[0].info.viewportState.hash()    == snapshot.pipelines[0].info.viewportState.hash() );
+        REQUIRE( copy.pipelines[0].info.dynamicStates           == snapshot.pipelines[0].info.dynamicStates );
+        REQUIRE( copy.pipelines[0].info.rasterizationState.cullMode == vk::CullModeFlagBits::eBack );
+        REQUIRE( copy.pipelines[0].modules == snapshot.pipelines[0].modules );
+
+        for(size_t i=0;i<snapshot.shaderModules.size();i++)
+            REQUIRE( copy.shaderModules[i].code == snapshot.shaderModules[i].code );
+
+        REQUIRE( copy.pipelines[0].info.stages[1].name == "fragMain" );
+        REQUIRE( copy.pipelines[0].info.stages[1].getSpecializationConstant<bool>(0) == true );
+        REQUIRE( copy.pipelines[0].info.stages[1].getSpecializationConstant<float>(3) == 0.25f );
+        REQUIRE( copy.pipelines[0].info.stages[0].specializationEntries.empty() );
+        REQUIRE( copy.pipelines[0].info.blendState.blendConstants[2] == 0.5f );
+        REQUIRE( copy.pipelines[0].info.depthStencilState.front.compareMask == 0xF0 );
+    }
+
+    THEN("Corrupt data is rejected")
+    {
+        auto badMagic = blob;
+        badMagic[0] ^= 0xFF;
+        REQUIRE_THROWS_AS( vkb::StorageSnapshot::deserialize(badMagic), std::runtime_error );
+
+        auto badVersion = blob;
+        badVersion[4] += 1;
+        REQUIRE_THROWS_AS( vkb::StorageSnapshot::deserialize(badVersion), std::runtime_error );
+
+        for(size_t n : {size_t(0), size_t(3), blob.size()/2, blob.size()-1})
+            REQUIRE_THROWS_AS( vkb::StorageSnapshot::deserialize(blob.data(), n), std::runtime_error );
+
+        auto extra = blob;
+        extra.push_back(0);
+        REQUIRE_THROWS_AS( vkb::StorageSnapshot::deserialize(extra), std::runtime_error );
+    }
+
+    WHEN("A pipeline uses dynamic rendering")
+    {
+        auto PCI = S.getCreateInfo<vkb::GraphicsPipelineCreateInfo2>( fakeHandle<vk::Pipeline>(0x600) );
+
+        vkb::PipelineRenderingCreateInfo2 R;
+        R.colorAttachmentFormats = {vk::Format::eR16G16B16A16Sfloat};
+        R.depthAttachmentFormat  = vk::Format::eD32Sfloat;
+        PCI.renderPass = R;
+
+        auto pHandle = fakeHandle<vk::Pipeline>(0x610);
+        S.pipelines[PCI.storageKey(S)] = pHandle;
+        S.storeCreateInfo(pHandle, PCI);
+
+        auto copy = vkb::StorageSnapshot::deserialize( vkb::StorageSnapshot::capture(S).serialize() );
+        REQUIRE( copy.pipelines.size() == 2 );
+
+        size_t rendering = 0;
+        for(auto & p : copy.pipelines)
+        {
+            if( p.renderPass == vkb::StorageSnapshot::noRenderPass )
+            {
+                REQUIRE( std::get<vkb::PipelineRenderingCreateInfo2>(p.info.renderPass) == R );
+                rendering++;
+            }
+        }
+        REQUIRE( rendering == 1 );
+    }
+
+    WHEN("An object has no create info")
+    {
+        S.samplers[1] = fakeHandle<vk::Sampler>(0x110);
+        REQUIRE_THROWS_AS( vkb::StorageSnapshot::capture(S), std::runtime_error );
+    }
+}
+
+SCENARIO( "Restoring a snapshot into a storage which already holds its objects" )
+{
+    vkb::Storage S;
+    fillStorage(S);
+
+    auto samplerHandle  = fakeHandle<vk::Sampler>(0x100);
+    auto pipelineHandle = fakeHandle<vk::Pipeline>(0x600);
+    S.samplerReferenceCount[samplerHandle] = 1;
+
+    // the pipeline appears twice, nothing needs to be created
+    auto snapshot = vkb::StorageSnapshot::capture(S);
+    snapshot.pipelines.push_back( snapshot.pipelines[0] );
+
+    // the snapshot gives the immutable sampler by its create info,
+    // so the layout is looked up under a different key
+    S.descriptorSetLayouts[ snapshot.descriptorSetLayouts[0].hash() ] = fakeHandle<vk::DescriptorSetLayout>(0x400);
+
+    auto objects = snapshot.restore(S, vk::Device());
+
+    REQUIRE( objects.samplers.size()  == 1 );
+    REQUIRE( objects.pipelines.size() == 2 );
+    REQUIRE( objects.samplers[0]  == samplerHandle );
+    REQUIRE( objects.pipelines[0] == pipelineHandle );
+    REQUIRE( objects.pipelines[1] == pipelineHandle );
+
+    THEN("Every returned handle holds a reference, as with create(S, device)")
+    {
+        REQUIRE( S.samplerReferenceCount.at(samplerHandle) == 2 );
+        REQUIRE( S.getReferenceCount(pipelineHandle) == 3 );
+
+        // releasing the restored references keeps the originals
+        S.destroy(objects.samplers[0], vk::Device());
+        S.destroy(objects.pipelines[0], vk::Device());
+        S.destroy(objects.pipelines[1], vk::Device());
+
+        REQUIRE( S.samplerReferenceCount.at(samplerHandle) == 1 );
+        REQUIRE( S.getReferenceCount(pipelineHandle) == 1 );
+        REQUIRE( S.samplers.size()  == 1 );
+        REQUIRE( S.pipelines.size() == 1 );
+    }
+}
+
+SCENARIO( " Scenario 1: Restore a storage from a snapshot" )
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+    auto window = new SDLVulkanWindow();
+
+    // 1. create the window
+    window->createWindow("Simple Deferred", SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED, 1024,768);
+
+    // 2. initialize the vulkan instance
+    SDLVulkanWindow::InitilizationInfo info;
+    info.callback = VulkanReportFunc;
+    window->createVulkanInstance( info);
+
+    // 3. Create the following objects:
+    //    instance, physical device, device, graphics/present queues,
+    //    swap chain, depth buffer, render pass and framebuffers
+    window->initSurface(SDLVulkanWindow::SurfaceInitilizationInfo());
+
+    auto device = vk::Device(window->getDevice());
+
+    std::vector<uint8_t> blob;
+    {
+        vkb::Storage S;
+
+        vkb::GraphicsPipelineCreateInfo2 PCI;
+        PCI.viewportState.viewports.emplace_back( vk::Viewport(0,0,1024,768,0,1.0f));
+        PCI.viewportState.scissors.emplace_back( vk::Rect2D( {0,0}, {1024,768}));
+
+        uint32_t stride=0+12+24;
+        PCI.setVertexInputAttribute(0,0,vk::Format::eR32G32B32Sfloat,0 );
+        PCI.setVertexInputAttribute(1,1,vk::Format::eR32G32B32Sfloat,12);
+        PCI.setVertexInputAttribute(2,2,vk::Format::eR8G8B8A8Unorm  ,24);
+
+        PCI.setVertexInputBinding(0,stride, vk::VertexInputRate::eVertex);
+        PCI.setVertexInputBinding(1,stride, vk::VertexInputRate::eVertex);
+        PCI.setVertexInputBinding(2,stride, vk::VertexInputRate::eVertex);
+
+        PCI.addStage( vk::ShaderStageFlagBits::eVertex, "main", CMAKE_SOURCE_DIR "/share/shaders/vert.spv");
+        PCI.addStage( vk::ShaderStageFlagBits::eFragment, "main", CMAKE_SOURCE_DIR "/share/shaders/frag.spv");
+
+        PCI.renderPass = vkb::RenderPassCreateInfo2::createSimpleRenderPass({{ vk::Format(window->getSwapchainFormat()), vk::ImageLayout::ePresentSrcKHR}});
+        PCI.addPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 128);
+        PCI.addBlendStateAttachment();
+
+        PCI.create(S, device);
+
+        // a second pipeline which only differs by its culling
+        PCI.rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+        PCI.create(S, device);
+
+        REQUIRE( S.pipelines.size() == 2 );
+
+        blob = vkb::StorageSnapshot::capture(S).serialize();
+
+        S.destroyAll(device);
+    }
+
+    vkb::Storage S;
+    auto snapshot = vkb::StorageSnapshot::deserialize(blob);
+    auto objects  = snapshot.restore(S, device);
+
+    REQUIRE( objects.pipelines.size() == 2 );
+    REQUIRE( objects.pipelines[0] != vk::Pipeline() );
+    REQUIRE( objects.pipelines[1] != vk::Pipeline() );
+    REQUIRE( objects.pipelines[0] != objects.pipelines[1] );
+
+    REQUIRE( S.pipelines.size()       == 2 );
+    REQUIRE( S.shaderModules.size()   == 2 );
+    REQUIRE( S.renderPasses.size()    == 1 );
+    REQUIRE( S.pipelineLayouts.size() == 1 );
+
+    // the restored storage captures the same objects. Pipelines are
+    // stored by hash, so they are not captured in the same order
+    {
+        auto recaptured = vkb::StorageSnapshot::capture(S);
+        REQUIRE( recaptured.shaderModules.size() == snapshot.shaderModules.size() );
+        REQUIRE( recaptured.pipelines.size()     == snapshot.pipelines.size() );
+
+        std::set<vk::CullModeFlags> a, b;
+        for(auto & p : snapshot.pipelines)   a.insert(p.info.rasterizationState.cullMode);
+        for(auto & p : recaptured.pipelines) b.insert(p.info.rasterizationState.cullMode);
+        REQUIRE( a == b );
+        REQUIRE( a.size() == 2 );
+    }
+
+    // restoring again reuses all the objects
+    auto again = snapshot.restore(S, device);
+    REQUIRE( again.pipelines == objects.pipelines );
+    REQUIRE( S.pipelines.size() == 2 );
+
+    S.destroyAll(device);
+
+    delete window;
+    SDL_Quit();
+}
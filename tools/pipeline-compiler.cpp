@@ -0,0 +1,66 @@
+// Compiles a pipeline json file (see samples/pipeline.json) into a C++
+// header holding a constexpr vkb::StaticGraphicsPipeline.
+//
+// usage: vkb-pipeline-compiler [--namespace <ns>] [--name <name>] --output <header> <pipeline.json>
+//
+// Normally called through vkb_compile_pipelines( ) in cmake.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vkb/utils/PipelineCompiler.h>
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: vkb-pipeline-compiler [--namespace <ns>] [--name <name>] --output <header> <pipeline.json>\n");
+    return 2;
+}
+
+int main(int argc, char ** argv)
+{
+    std::string nameSpace = "vkb_pipelines";
+    std::string name;
+    std::string output;
+    std::string input;
+
+    for(int i=1;i<argc;i++)
+    {
+        std::string a = argv[i];
+        if( (a == "--namespace" || a == "--name" || a == "--output") && i+1 < argc )
+        {
+            std::string v = argv[++i];
+            if(      a == "--namespace" ) nameSpace = v;
+            else if( a == "--name"      ) name      = v;
+            else                          output    = v;
+        }
+        else if( input.empty() && a.rfind("--", 0) != 0 )
+        {
+            input = a;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if( input.empty() || output.empty() )
+        return usage();
+
+    if( name.empty() )
+        name = vkb::PipelineCompiler::identifier(input);
+
+    try
+    {
+        auto header = vkb::PipelineCompiler::compile(input, name, nameSpace);
+
+        std::ofstream out(output, std::ios::out | std::ios::binary | std::ios::trunc);
+        if( !out )
+            throw std::runtime_error("Could not write " + output);
+        out << header;
+    }
+    catch(std::exception & e)
+    {
+        std::fprintf(stderr, "vkb-pipeline-compiler: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}